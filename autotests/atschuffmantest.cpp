@@ -0,0 +1,191 @@
+/*
+ * atschuffmantest.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "dvb/dvbsi.h"
+
+/*
+ * the bit by bit decoder which was used before the lookup tables; kept as
+ * the reference for AtscHuffmanString
+ */
+
+class AtscHuffmanReference
+{
+public:
+	AtscHuffmanReference(const char *data_, int length, const unsigned short *offsets_,
+		const unsigned char *tableBase_) : data(data_), bitsLeft(8 * length),
+		offsets(offsets_), tableBase(tableBase_) { }
+	~AtscHuffmanReference() { }
+
+	QString decompress();
+
+private:
+	unsigned char getBit();
+	unsigned char getByte();
+
+	const char *data;
+	int bitsLeft;
+	const unsigned short *offsets;
+	const unsigned char *tableBase;
+};
+
+unsigned char AtscHuffmanReference::getBit()
+{
+	if (bitsLeft >= 1) {
+		int shift = (--bitsLeft % 8);
+		unsigned char value = (data[0] >> shift) & 0x1;
+
+		if (shift == 0) {
+			data++;
+		}
+		return value;
+	}
+
+	return 0;
+}
+
+unsigned char AtscHuffmanReference::getByte()
+{
+	if (bitsLeft >= 8) {
+		int shift = ((bitsLeft - 1) % 8);
+		// reads one byte past the end; the test data is padded
+		unsigned char value = ((((data[0] << 8) | quint8(data[1])) >> (shift + 1)) & 0xff);
+
+		bitsLeft -= 8;
+		data++;
+		return value;
+	}
+
+	return 0;
+}
+
+QString AtscHuffmanReference::decompress()
+{
+	QString result;
+	const unsigned char *table = tableBase;
+
+	while (bitsLeft > 0) {
+		int index = 0;
+
+		do {
+			index = table[2 * index + getBit()];
+		} while (index < 128);
+
+		index &= 0x7f;
+
+		if (index == 27) {
+			// escape --> uncompressed character(s)
+			while (true) {
+				index = getByte();
+
+				if (index < 128) {
+					break;
+				}
+
+				result += QChar(index);
+			}
+		}
+
+		if (index == 0) {
+			// end
+			break;
+		}
+
+		result += QChar(index);
+		table = tableBase + offsets[index];
+	}
+
+	return result;
+}
+
+class AtscHuffmanTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void decode_data();
+	void decode();
+};
+
+void AtscHuffmanTest::decode_data()
+{
+	QTest::addColumn<int>("table");
+	QTest::addColumn<int>("length");
+	QTest::addColumn<int>("count");
+	QTest::addColumn<bool>("exhaustive");
+
+	for (int table = 1; table <= 2; ++table) {
+		QByteArray prefix = QByteArray("table ") + QByteArray::number(table);
+		QTest::newRow((prefix + ", all 1 byte strings").constData())
+			<< table << 1 << 256 << true;
+		QTest::newRow((prefix + ", all 2 byte strings").constData())
+			<< table << 2 << 65536 << true;
+		QTest::newRow((prefix + ", random 3 byte strings").constData())
+			<< table << 3 << 200000 << false;
+		QTest::newRow((prefix + ", random 16 byte strings").constData())
+			<< table << 16 << 100000 << false;
+		QTest::newRow((prefix + ", random 255 byte strings").constData())
+			<< table << 255 << 10000 << false;
+	}
+}
+
+void AtscHuffmanTest::decode()
+{
+	QFETCH(int, table);
+	QFETCH(int, length);
+	QFETCH(int, count);
+	QFETCH(bool, exhaustive);
+
+	const unsigned short *offsets = AtscHuffmanString::Huffman1Offsets;
+	const unsigned char *tableBase = AtscHuffmanString::Huffman1Tables;
+
+	if (table == 2) {
+		offsets = AtscHuffmanString::Huffman2Offsets;
+		tableBase = AtscHuffmanString::Huffman2Tables;
+	}
+
+	// the same strings on every run
+	QRandomGenerator random(quint32((length << 8) | table));
+	QByteArray data(length + 1, 0);
+
+	for (int i = 0; i < count; ++i) {
+		for (int j = 0; j < length; ++j) {
+			if (exhaustive) {
+				data[j] = char((i >> (8 * (length - j - 1))) & 0xff);
+			} else {
+				data[j] = char(random.bounded(256));
+			}
+		}
+
+		AtscHuffmanReference reference(data.constData(), length, offsets, tableBase);
+		QString expected = reference.decompress();
+		QString actual = AtscHuffmanString::convertText(data.constData(), length, table);
+
+		if (actual != expected) {
+			qWarning("input: %s", data.left(length).toHex().constData());
+			QCOMPARE(actual, expected);
+		}
+	}
+}
+
+QTEST_GUILESS_MAIN(AtscHuffmanTest)
+
+#include "atschuffmantest.moc"
@@ -0,0 +1,121 @@
+/*
+ * dvbchanneltest.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QTest>
+
+#include "dvb/dvbchannel.h"
+
+class DvbChannelTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void rescan();
+	void rescanSingleChannel();
+	void rescanWithNewChannel();
+
+private:
+	static DvbChannel createChannel(const QString &name, int serviceId);
+	static QList<DvbChannel> scannedChannels();
+	static QMap<int, QString> channelNames(const DvbChannelModel &model);
+};
+
+DvbChannel DvbChannelTest::createChannel(const QString &name, int serviceId)
+{
+	// as found by a scan: no number yet
+	DvbChannel channel;
+	channel.name = name;
+	channel.source = QLatin1String("Autoscan");
+	channel.transponder = DvbTransponder(DvbTransponderBase::DvbT);
+	channel.transponder.as<DvbTTransponder>()->frequency = 474000000;
+	channel.networkId = 0x2114;
+	channel.transportStreamId = 0x0401;
+	channel.pmtPid = (0x100 + serviceId);
+	channel.serviceId = serviceId;
+	return channel;
+}
+
+QList<DvbChannel> DvbChannelTest::scannedChannels()
+{
+	QList<DvbChannel> channels;
+	channels.append(createChannel(QLatin1String("One"), 1));
+	channels.append(createChannel(QLatin1String("Two"), 2));
+	channels.append(createChannel(QLatin1String("Two"), 3)); // becomes "Two-1"
+	channels.append(createChannel(QLatin1String("Three"), 4));
+	return channels;
+}
+
+QMap<int, QString> DvbChannelTest::channelNames(const DvbChannelModel &model)
+{
+	QMap<int, QString> names; // number -> name
+
+	foreach (const DvbSharedChannel &channel, model.getChannels()) {
+		names.insert(channel->number, channel->name);
+	}
+
+	return names;
+}
+
+void DvbChannelTest::rescan()
+{
+	DvbChannelModel model(NULL);
+	model.addChannels(scannedChannels());
+	QMap<int, QString> names = channelNames(model);
+	QCOMPARE(names.size(), 4);
+	QCOMPARE(names.value(1), QString(QLatin1String("One")));
+	QCOMPARE(names.value(2), QString(QLatin1String("Two")));
+	QCOMPARE(names.value(3), QString(QLatin1String("Two-1")));
+	QCOMPARE(names.value(4), QString(QLatin1String("Three")));
+
+	// the existing channels are updated in place
+	QList<DvbChannel> channels = scannedChannels();
+	channels[1].pmtPid = 0x200;
+	model.addChannels(channels);
+	QCOMPARE(channelNames(model), names);
+	QCOMPARE(model.findChannelByNumber(2)->pmtPid, 0x200);
+}
+
+void DvbChannelTest::rescanSingleChannel()
+{
+	DvbChannelModel model(NULL);
+	model.addChannels(scannedChannels());
+	QMap<int, QString> names = channelNames(model);
+
+	DvbChannel channel = createChannel(QLatin1String("Two"), 3);
+	model.addChannel(channel);
+	QCOMPARE(channelNames(model), names);
+}
+
+void DvbChannelTest::rescanWithNewChannel()
+{
+	DvbChannelModel model(NULL);
+	model.addChannels(scannedChannels());
+	QMap<int, QString> names = channelNames(model);
+
+	// existing channels before and after a new one in the same batch
+	QList<DvbChannel> channels = scannedChannels();
+	channels.insert(2, createChannel(QLatin1String("One"), 5));
+	model.addChannels(channels);
+	names.insert(5, QLatin1String("One-1"));
+	QCOMPARE(channelNames(model), names);
+}
+
+QTEST_GUILESS_MAIN(DvbChannelTest)
+
+#include "dvbchanneltest.moc"
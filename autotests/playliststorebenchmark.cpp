@@ -0,0 +1,141 @@
+/*
+ * playliststorebenchmark.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QDir>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "playlist/playlistmodel.h"
+#include "playlist/playliststore.h"
+
+/*
+ * saving and loading one large playlist; the files are written to the
+ * QStandardPaths test location
+ */
+
+class PlaylistStoreBenchmark : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanup();
+	void save_data();
+	void save();
+	void load_data();
+	void load();
+
+private:
+	static Playlist *createPlaylist(int count);
+};
+
+Playlist *PlaylistStoreBenchmark::createPlaylist(int count)
+{
+	// a music collection: repeated artists and albums, distinct urls and titles
+	Playlist *playlist = new Playlist();
+	playlist->title = QLatin1String("Benchmark");
+	playlist->tracks.reserve(count);
+
+	for (int i = 0; i < count; ++i) {
+		PlaylistTrack track;
+		int album = (i / 12);
+		int artist = (album / 5);
+		track.url = QUrl::fromLocalFile(QString::fromLatin1(
+			"/music/Artist %1/Album %2/%3 - Track %4.ogg").arg(artist).arg(album)
+			.arg(i % 12 + 1).arg(i));
+		track.title = QString::fromLatin1("Track %1").arg(i);
+		track.artist = QString::fromLatin1("Artist %1").arg(artist);
+		track.album = QString::fromLatin1("Album %1").arg(album);
+		track.trackNumber = (i % 12 + 1);
+		track.length = QTime(0, 0, 0).addSecs(120 + (i % 240));
+		playlist->tracks.append(track);
+	}
+
+	return playlist;
+}
+
+void PlaylistStoreBenchmark::initTestCase()
+{
+	QStandardPaths::setTestModeEnabled(true);
+}
+
+void PlaylistStoreBenchmark::cleanup()
+{
+	QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) +
+		QLatin1String("/playlists")).removeRecursively();
+}
+
+void PlaylistStoreBenchmark::save_data()
+{
+	QTest::addColumn<int>("tracks");
+
+	QTest::newRow("100k tracks") << 100000;
+	QTest::newRow("1M tracks") << 1000000;
+}
+
+void PlaylistStoreBenchmark::save()
+{
+	QFETCH(int, tracks);
+	QList<Playlist *> playlists;
+	playlists.append(createPlaylist(tracks));
+
+	QBENCHMARK_ONCE {
+		PlaylistStore store;
+		store.save(playlists);
+	}
+
+	qDeleteAll(playlists);
+}
+
+void PlaylistStoreBenchmark::load_data()
+{
+	save_data();
+}
+
+void PlaylistStoreBenchmark::load()
+{
+	QFETCH(int, tracks);
+	QList<Playlist *> playlists;
+	playlists.append(createPlaylist(tracks));
+
+	{
+		PlaylistStore store;
+		store.save(playlists);
+	}
+
+	qDeleteAll(playlists);
+	playlists.clear();
+
+	QBENCHMARK_ONCE {
+		PlaylistStore store;
+		QVERIFY(store.readIndex(playlists));
+
+		foreach (Playlist *playlist, playlists) {
+			store.ensureLoaded(playlist);
+		}
+	}
+
+	QCOMPARE(playlists.size(), 1);
+	QCOMPARE(playlists.at(0)->tracks.size(), tracks);
+	qDeleteAll(playlists);
+}
+
+QTEST_GUILESS_MAIN(PlaylistStoreBenchmark)
+
+#include "playliststorebenchmark.moc"
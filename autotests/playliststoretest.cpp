@@ -0,0 +1,205 @@
+/*
+ * playliststoretest.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "playlist/playlistmodel.h"
+#include "playlist/playliststore.h"
+
+class PlaylistStoreTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanup();
+	void roundTrip();
+	void corruptFile();
+	void missingFile();
+
+private:
+	static Playlist *createPlaylist(const QString &title, int count);
+	static QString storePath();
+	static QByteArray readFile(const QString &fileName);
+};
+
+Playlist *PlaylistStoreTest::createPlaylist(const QString &title, int count)
+{
+	Playlist *playlist = new Playlist();
+	playlist->title = title;
+
+	for (int i = 0; i < count; ++i) {
+		PlaylistTrack track;
+		track.url = QUrl::fromLocalFile(QString::fromLatin1("/music/%1/track%2.ogg")
+			.arg(title).arg(i));
+		track.title = QString::fromLatin1("Track %1").arg(i);
+		track.artist = QString::fromLatin1("Artist %1").arg(i % 3);
+		track.album = title;
+		track.trackNumber = (i + 1);
+		track.length = QTime(0, 3, i % 60);
+
+		if ((i % 2) == 0) {
+			track.subtitles.append(QUrl::fromLocalFile(
+				QString::fromLatin1("/music/%1/track%2.srt").arg(title).arg(i)));
+			track.currentSubtitle = 0;
+		}
+
+		playlist->tracks.append(track);
+	}
+
+	return playlist;
+}
+
+QString PlaylistStoreTest::storePath()
+{
+	return (QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) +
+		QLatin1String("/playlists"));
+}
+
+QByteArray PlaylistStoreTest::readFile(const QString &fileName)
+{
+	QFile file(storePath() + QLatin1Char('/') + fileName);
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return QByteArray();
+	}
+
+	return file.readAll();
+}
+
+void PlaylistStoreTest::initTestCase()
+{
+	QStandardPaths::setTestModeEnabled(true);
+	QDir(storePath()).removeRecursively();
+}
+
+void PlaylistStoreTest::cleanup()
+{
+	QDir(storePath()).removeRecursively();
+}
+
+void PlaylistStoreTest::roundTrip()
+{
+	QList<Playlist *> playlists;
+	playlists.append(createPlaylist(QLatin1String("First"), 10));
+	playlists.append(createPlaylist(QLatin1String("Second"), 0));
+	playlists.append(createPlaylist(QLatin1String("Third"), 100));
+
+	{
+		PlaylistStore store;
+		store.save(playlists);
+	}
+
+	PlaylistStore store;
+	QList<Playlist *> loadedPlaylists;
+	QVERIFY(store.readIndex(loadedPlaylists));
+	QCOMPARE(loadedPlaylists.size(), playlists.size());
+
+	for (int i = 0; i < playlists.size(); ++i) {
+		const Playlist *playlist = playlists.at(i);
+		Playlist *loadedPlaylist = loadedPlaylists.at(i);
+		QCOMPARE(loadedPlaylist->title, playlist->title);
+		QVERIFY(loadedPlaylist->tracks.isEmpty()); // read on demand
+		store.ensureLoaded(loadedPlaylist);
+		QCOMPARE(loadedPlaylist->tracks.size(), playlist->tracks.size());
+
+		for (int j = 0; j < playlist->tracks.size(); ++j) {
+			const PlaylistTrack &track = playlist->tracks.at(j);
+			const PlaylistTrack &loadedTrack = loadedPlaylist->tracks.at(j);
+			QCOMPARE(loadedTrack.url, track.url);
+			QCOMPARE(loadedTrack.title, track.title);
+			QCOMPARE(loadedTrack.artist, track.artist);
+			QCOMPARE(loadedTrack.album, track.album);
+			QCOMPARE(loadedTrack.trackNumber, track.trackNumber);
+			QCOMPARE(loadedTrack.length, track.length);
+			QCOMPARE(loadedTrack.subtitles, track.subtitles);
+			QCOMPARE(loadedTrack.currentSubtitle, track.currentSubtitle);
+		}
+	}
+
+	qDeleteAll(playlists);
+	qDeleteAll(loadedPlaylists);
+}
+
+void PlaylistStoreTest::corruptFile()
+{
+	QList<Playlist *> playlists;
+	playlists.append(createPlaylist(QLatin1String("First"), 10));
+
+	{
+		PlaylistStore store;
+		store.save(playlists);
+	}
+
+	qDeleteAll(playlists);
+	playlists.clear();
+
+	// cut off the track columns
+	QByteArray data = readFile(QLatin1String("1"));
+	QVERIFY(!data.isEmpty());
+	QFile file(storePath() + QLatin1String("/1"));
+	QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	QCOMPARE(file.write(data.left(data.size() / 2)), qint64(data.size() / 2));
+	file.close();
+	QByteArray corruptData = readFile(QLatin1String("1"));
+
+	PlaylistStore store;
+	QVERIFY(store.readIndex(playlists));
+	QCOMPARE(playlists.size(), 1);
+	store.ensureLoaded(playlists.at(0));
+	QVERIFY(playlists.at(0)->tracks.isEmpty());
+
+	// the file which couldn't be read isn't replaced
+	store.save(playlists);
+	QCOMPARE(readFile(QLatin1String("1")), corruptData);
+	qDeleteAll(playlists);
+}
+
+void PlaylistStoreTest::missingFile()
+{
+	QList<Playlist *> playlists;
+	playlists.append(createPlaylist(QLatin1String("First"), 10));
+
+	{
+		PlaylistStore store;
+		store.save(playlists);
+	}
+
+	qDeleteAll(playlists);
+	playlists.clear();
+	QVERIFY(QFile::remove(storePath() + QLatin1String("/1")));
+
+	PlaylistStore store;
+	QVERIFY(store.readIndex(playlists));
+	QCOMPARE(playlists.size(), 1);
+	store.ensureLoaded(playlists.at(0));
+	QVERIFY(playlists.at(0)->tracks.isEmpty());
+
+	// no empty playlist is written in its place
+	store.save(playlists);
+	QVERIFY(!QFile::exists(storePath() + QLatin1String("/1")));
+	qDeleteAll(playlists);
+}
+
+QTEST_GUILESS_MAIN(PlaylistStoreTest)
+
+#include "playliststoretest.moc"
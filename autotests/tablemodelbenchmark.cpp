@@ -0,0 +1,257 @@
+/*
+ * tablemodelbenchmark.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QPersistentModelIndex>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QTest>
+
+#include "tablemodel.h"
+
+/*
+ * inserts and removes through TableModel, the way the channel, epg and
+ * recording models do them; the inserted items are removed again, so that
+ * every iteration starts with the same model
+ */
+
+class BenchmarkItem
+{
+public:
+	BenchmarkItem() : value(-1) { }
+	explicit BenchmarkItem(int value_) : value(value_) { }
+	~BenchmarkItem() { }
+
+	bool isValid() const
+	{
+		return (value >= 0);
+	}
+
+	bool operator==(const BenchmarkItem &other) const
+	{
+		return (value == other.value);
+	}
+
+	int value;
+};
+
+class BenchmarkLessThan
+{
+public:
+	BenchmarkLessThan() : sortOrder(Ascending) { }
+	~BenchmarkLessThan() { }
+
+	enum SortOrder
+	{
+		Ascending = 0,
+		Descending = 1
+	};
+
+	SortOrder getSortOrder() const
+	{
+		return sortOrder;
+	}
+
+	void setSortOrder(SortOrder sortOrder_)
+	{
+		sortOrder = sortOrder_;
+	}
+
+	bool operator()(const BenchmarkItem &x, const BenchmarkItem &y) const
+	{
+		if (sortOrder == Ascending) {
+			return (x.value < y.value);
+		} else {
+			return (y.value < x.value);
+		}
+	}
+
+private:
+	SortOrder sortOrder;
+};
+
+class BenchmarkTableModelHelper
+{
+public:
+	BenchmarkTableModelHelper() { }
+	~BenchmarkTableModelHelper() { }
+
+	typedef BenchmarkItem ItemType;
+	typedef BenchmarkLessThan LessThanType;
+
+	int columnCount() const
+	{
+		return 1;
+	}
+
+	bool filterAcceptsItem(const BenchmarkItem &item) const
+	{
+		Q_UNUSED(item)
+		return true;
+	}
+};
+
+class BenchmarkTableModel : public TableModel<BenchmarkTableModelHelper>
+{
+public:
+	BenchmarkTableModel() : TableModel<BenchmarkTableModelHelper>(NULL) { }
+	~BenchmarkTableModel() { }
+
+	QVariant data(const QModelIndex &index, int role) const override
+	{
+		if (role == Qt::DisplayRole) {
+			return value(index).value;
+		}
+
+		return QVariant();
+	}
+
+	using TableModel<BenchmarkTableModelHelper>::reset;
+	using TableModel<BenchmarkTableModelHelper>::insert;
+	using TableModel<BenchmarkTableModelHelper>::insertItems;
+	using TableModel<BenchmarkTableModelHelper>::remove;
+	using TableModel<BenchmarkTableModelHelper>::removeItems;
+};
+
+class TableModelBenchmark : public QObject
+{
+	Q_OBJECT
+private slots:
+	void insertRemove_data();
+	void insertRemove();
+	void insertRemoveItems_data();
+	void insertRemoveItems();
+	void reset();
+
+private:
+	static QList<BenchmarkItem> sortedItems(int count);
+	static QList<BenchmarkItem> newItems(int count, int range);
+};
+
+QList<BenchmarkItem> TableModelBenchmark::sortedItems(int count)
+{
+	QList<BenchmarkItem> items;
+	items.reserve(count);
+
+	for (int i = 0; i < count; ++i) {
+		items.append(BenchmarkItem(2 * i));
+	}
+
+	return items;
+}
+
+QList<BenchmarkItem> TableModelBenchmark::newItems(int count, int range)
+{
+	// distinct odd values, so that they never collide with the sorted items
+	QRandomGenerator random(quint32(range));
+	QSet<int> values;
+	QList<BenchmarkItem> items;
+
+	while (items.size() < count) {
+		int value = 2 * int(random.bounded(range)) + 1;
+
+		if (!values.contains(value)) {
+			values.insert(value);
+			items.append(BenchmarkItem(value));
+		}
+	}
+
+	return items;
+}
+
+void TableModelBenchmark::insertRemove_data()
+{
+	QTest::addColumn<int>("rows");
+
+	QTest::newRow("10k rows") << 10000;
+	QTest::newRow("100k rows") << 100000;
+	QTest::newRow("1M rows") << 1000000;
+}
+
+// one item at a time (like channels or epg entries being added)
+void TableModelBenchmark::insertRemove()
+{
+	QFETCH(int, rows);
+
+	BenchmarkTableModel model;
+	model.reset(sortedItems(rows));
+	QList<BenchmarkItem> items = newItems(10000, rows);
+
+	// a selected row, whose index has to follow the changes
+	QPersistentModelIndex selected(model.index(rows / 2, 0));
+
+	QBENCHMARK {
+		foreach (const BenchmarkItem &item, items) {
+			model.insert(item);
+		}
+
+		foreach (const BenchmarkItem &item, items) {
+			model.remove(item);
+		}
+	}
+
+	QCOMPARE(model.rowCount(QModelIndex()), rows);
+	QCOMPARE(selected.row(), rows / 2);
+}
+
+void TableModelBenchmark::insertRemoveItems_data()
+{
+	QTest::addColumn<int>("rows");
+	QTest::addColumn<int>("count");
+
+	// few ranges are inserted one by one, many are merged in a layout change
+	QTest::newRow("100k rows, 16 items") << 100000 << 16;
+	QTest::newRow("100k rows, 10k items") << 100000 << 10000;
+	QTest::newRow("1M rows, 16 items") << 1000000 << 16;
+	QTest::newRow("1M rows, 10k items") << 1000000 << 10000;
+}
+
+// whole batches (like the epg entries of a section)
+void TableModelBenchmark::insertRemoveItems()
+{
+	QFETCH(int, rows);
+	QFETCH(int, count);
+
+	BenchmarkTableModel model;
+	model.reset(sortedItems(rows));
+	QList<BenchmarkItem> items = newItems(count, rows);
+	QPersistentModelIndex selected(model.index(rows / 2, 0));
+
+	QBENCHMARK {
+		model.insertItems(items);
+		model.removeItems(items);
+	}
+
+	QCOMPARE(model.rowCount(QModelIndex()), rows);
+	QCOMPARE(selected.row(), rows / 2);
+}
+
+void TableModelBenchmark::reset()
+{
+	QList<BenchmarkItem> items = sortedItems(1000000);
+
+	QBENCHMARK {
+		BenchmarkTableModel model;
+		model.reset(items);
+	}
+}
+
+QTEST_GUILESS_MAIN(TableModelBenchmark)
+
+#include "tablemodelbenchmark.moc"
@@ -0,0 +1,35 @@
+/*
+ * testlog.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "log.h"
+
+// the log categories of mainwindow.cpp, for the code under test
+
+Q_LOGGING_CATEGORY(logCam, "kaffeine.cam")
+Q_LOGGING_CATEGORY(logDev, "kaffeine.dev")
+Q_LOGGING_CATEGORY(logDvb, "kaffeine.dvb")
+Q_LOGGING_CATEGORY(logDvbSi, "kaffeine.dvbsi")
+Q_LOGGING_CATEGORY(logEpg, "kaffeine.epg")
+
+Q_LOGGING_CATEGORY(logConfig, "kaffeine.config")
+Q_LOGGING_CATEGORY(logMediaWidget, "kaffeine.mediawidget")
+Q_LOGGING_CATEGORY(logPlaylist, "kaffeine.playlist")
+Q_LOGGING_CATEGORY(logSql, "kaffeine.sql")
+Q_LOGGING_CATEGORY(logVlc, "kaffeine.vlc")
@@ -21,6 +21,7 @@
 #include <QCoreApplication>
 
 #include "abstractmediawidget.h"
+#include "tracing.h"
 
 AbstractMediaWidget::AbstractMediaWidget(QWidget *parent) : QWidget(parent), mediaWidget(NULL)
 {
@@ -67,6 +68,7 @@ void AbstractMediaWidget::addPendingUpdates(PendingUpdates pendingUpdatesToBeAdd
 void AbstractMediaWidget::customEvent(QEvent *event)
 {
 	Q_UNUSED(event)
+	KAFFEINE_TRACE_SCOPE("AbstractMediaWidget::customEvent");
 
 	while (true) {
 		int oldValue = pendingUpdates;
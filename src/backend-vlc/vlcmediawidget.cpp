@@ -28,6 +28,8 @@
 #include <vlc/libvlc_version.h>
 
 #include "../configuration.h"
+#include "../tracing.h"
+#include "../zaplatency.h"
 #include "vlcmediawidget.h"
 
 const char *vlcEventName(int event)
@@ -178,6 +180,8 @@ VlcMediaWidget::VlcMediaWidget(QWidget *parent) : AbstractMediaWidget(parent),
 		libvlc_MediaMetaChanged,
 		libvlc_MediaPlayerESAdded,
 		libvlc_MediaPlayerESDeleted,
+		libvlc_MediaPlayerPlaying,
+		libvlc_MediaPlayerVout,
 #if 0 // all other possible events
 		libvlc_MediaSubItemAdded,
 		libvlc_MediaDurationChanged,
@@ -189,7 +193,6 @@ VlcMediaWidget::VlcMediaWidget(QWidget *parent) : AbstractMediaWidget(parent),
 		libvlc_MediaPlayerNothingSpecial,
 		libvlc_MediaPlayerOpening,
 		libvlc_MediaPlayerBuffering,
-		libvlc_MediaPlayerPlaying,
 		libvlc_MediaPlayerPaused,
 		libvlc_MediaPlayerForward,
 		libvlc_MediaPlayerBackward,
@@ -197,7 +200,6 @@ VlcMediaWidget::VlcMediaWidget(QWidget *parent) : AbstractMediaWidget(parent),
 		libvlc_MediaPlayerPausableChanged,
 		libvlc_MediaPlayerTitleChanged,
 		libvlc_MediaPlayerSnapshotTaken,
-		libvlc_MediaPlayerVout,
 		libvlc_MediaPlayerScrambledChanged,
 		libvlc_MediaPlayerUncorked,
 		libvlc_MediaPlayerMuted,
@@ -1039,6 +1041,7 @@ void VlcMediaWidget::mouseMoveEvent(QMouseEvent *event)
 
 void VlcMediaWidget::vlcEvent(const libvlc_event_t *event)
 {
+	KAFFEINE_TRACE_SCOPE("VlcMediaWidget::vlcEvent");
 	PendingUpdates pendingUpdatesToBeAdded = Nothing;
 
 	switch (event->type) {
@@ -1064,8 +1067,19 @@ void VlcMediaWidget::vlcEvent(const libvlc_event_t *event)
 		setMouseTracking(false);
 		break;
 	case libvlc_MediaPlayerTimeChanged:
+		// libvlc has no audio output event; the time only advances once
+		// the first samples are played
+		ZapLatency::instance()->mark(ZapLatency::AudioOutput);
 		pendingUpdatesToBeAdded = CurrentTotalTime;
 		break;
+	case libvlc_MediaPlayerPlaying:
+		ZapLatency::instance()->mark(ZapLatency::PlayerPlaying);
+		pendingUpdatesToBeAdded = PlaybackStatus;
+		break;
+	case libvlc_MediaPlayerVout:
+		ZapLatency::instance()->mark(ZapLatency::VideoOutput);
+		pendingUpdatesToBeAdded = VideoSize;
+		break;
 	}
 
 	if (pendingUpdatesToBeAdded != 0) {
@@ -0,0 +1,369 @@
+/*
+ * vlcmetadataprober.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../log.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include "vlcmetadataprober.h"
+
+static const int parseTimeout = 5000; // ms
+
+VlcMetadataProber::VlcMetadataProber(QObject *receiver_, const char *member_) :
+	receiver(receiver_), member(member_), busy(false), stopping(false), vlcInstance(NULL),
+	cacheChanged(false)
+{
+	setObjectName(QLatin1String("VlcMetadataProber"));
+	maxParsing = qBound(1, QThread::idealThreadCount() / 2, 4);
+}
+
+VlcMetadataProber::~VlcMetadataProber()
+{
+	stop();
+}
+
+void VlcMetadataProber::probe(const QList<QUrl> &urls)
+{
+	QMutexLocker locker(&mutex);
+	pendingUrls.append(urls);
+	busy = true;
+	condition.wakeOne();
+}
+
+QList<VlcProbedMetadata> VlcMetadataProber::takeResults()
+{
+	QMutexLocker locker(&mutex);
+	QList<VlcProbedMetadata> takenResults;
+	takenResults.swap(results);
+	return takenResults;
+}
+
+bool VlcMetadataProber::isIdle()
+{
+	QMutexLocker locker(&mutex);
+	return (!busy && results.isEmpty());
+}
+
+void VlcMetadataProber::stop()
+{
+	mutex.lock();
+	stopping = true;
+	condition.wakeOne();
+	mutex.unlock();
+	wait();
+}
+
+void VlcMetadataProber::run()
+{
+	loadCache();
+	vlcInstance = libvlc_new(0, NULL);
+
+	if (vlcInstance == NULL) {
+		qCWarning(logVlc, "Cannot create vlc instance for reading metadata %s",
+			qPrintable(libvlc_errmsg()));
+	}
+
+	while (true) {
+		mutex.lock();
+
+		if (busy && pendingUrls.isEmpty() && parsedMedia.isEmpty() &&
+		    parsingMedia.isEmpty()) {
+			busy = false;
+			mutex.unlock();
+
+			if (cacheChanged) {
+				saveCache();
+			}
+
+			// lets the receiver know that everything has been probed
+			QMetaObject::invokeMethod(receiver, member, Qt::QueuedConnection);
+			mutex.lock();
+		}
+
+		while (parsedMedia.isEmpty() && !stopping &&
+		       (pendingUrls.isEmpty() || (parsingMedia.size() >= maxParsing))) {
+			condition.wait(&mutex);
+		}
+
+		if (stopping) {
+			mutex.unlock();
+			break;
+		}
+
+		QList<libvlc_media_t *> media;
+		media.swap(parsedMedia);
+		mutex.unlock();
+
+		foreach (libvlc_media_t *parsed, media) {
+			finishParsing(parsed);
+		}
+
+		while (parsingMedia.size() < maxParsing) {
+			mutex.lock();
+
+			if (pendingUrls.isEmpty() || stopping) {
+				mutex.unlock();
+				break;
+			}
+
+			QUrl url = pendingUrls.takeFirst();
+			mutex.unlock();
+			startParsing(url);
+		}
+	}
+
+	for (QHash<libvlc_media_t *, PendingMedia>::ConstIterator it = parsingMedia.constBegin();
+	     it != parsingMedia.constEnd(); ++it) {
+		libvlc_event_detach(libvlc_media_event_manager(it.key()),
+			libvlc_MediaParsedChanged, vlcEventHandler, this);
+		libvlc_media_parse_stop(it.key());
+		libvlc_media_release(it.key());
+	}
+
+	parsingMedia.clear();
+	mutex.lock();
+	parsedMedia.clear();
+	mutex.unlock();
+
+	if (vlcInstance != NULL) {
+		libvlc_release(vlcInstance);
+		vlcInstance = NULL;
+	}
+
+	if (cacheChanged) {
+		saveCache();
+	}
+}
+
+void VlcMetadataProber::startParsing(const QUrl &url)
+{
+	QString localFile = url.toLocalFile();
+
+	if (localFile.isEmpty()) {
+		return;
+	}
+
+	QFileInfo fileInfo(localFile);
+
+	if (!fileInfo.isFile()) {
+		return;
+	}
+
+	PendingMedia pending;
+	pending.url = url;
+	pending.size = fileInfo.size();
+	pending.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+	QHash<QString, VlcMetadataCacheEntry>::ConstIterator it = cache.constFind(localFile);
+
+	if ((it != cache.constEnd()) && (it->size == pending.size) &&
+	    (it->lastModified == pending.lastModified)) {
+		VlcProbedMetadata metadata = it->metadata;
+		metadata.url = url;
+		appendResult(metadata);
+		return;
+	}
+
+	if (vlcInstance == NULL) {
+		return;
+	}
+
+	libvlc_media_t *media = libvlc_media_new_path(vlcInstance,
+		QFile::encodeName(QDir::toNativeSeparators(localFile)).constData());
+
+	if (media == NULL) {
+		return;
+	}
+
+	libvlc_event_manager_t *eventManager = libvlc_media_event_manager(media);
+
+	if (libvlc_event_attach(eventManager, libvlc_MediaParsedChanged, vlcEventHandler,
+	    this) != 0) {
+		libvlc_media_release(media);
+		return;
+	}
+
+	parsingMedia.insert(media, pending);
+
+	if (libvlc_media_parse_with_options(media, libvlc_media_parse_local, parseTimeout) != 0) {
+		qCDebug(logVlc, "Cannot parse %s", qPrintable(localFile));
+		libvlc_event_detach(eventManager, libvlc_MediaParsedChanged, vlcEventHandler, this);
+		parsingMedia.remove(media);
+		libvlc_media_release(media);
+	}
+}
+
+static QString vlcMeta(libvlc_media_t *media, libvlc_meta_t type)
+{
+	char *meta = libvlc_media_get_meta(media, type);
+	QString value;
+
+	if (meta != NULL) {
+		value = QString::fromUtf8(meta);
+		free(meta);
+	}
+
+	return value;
+}
+
+void VlcMetadataProber::finishParsing(libvlc_media_t *media)
+{
+	QHash<libvlc_media_t *, PendingMedia>::Iterator it = parsingMedia.find(media);
+
+	if (it == parsingMedia.end()) {
+		return;
+	}
+
+	PendingMedia pending = it.value();
+	parsingMedia.erase(it);
+	libvlc_event_detach(libvlc_media_event_manager(media), libvlc_MediaParsedChanged,
+		vlcEventHandler, this);
+	libvlc_media_parsed_status_t status = libvlc_media_get_parsed_status(media);
+
+	// a timeout may be temporary (e.g. a sleeping disk), so it isn't cached
+
+	if ((status == libvlc_media_parsed_status_done) ||
+	    (status == libvlc_media_parsed_status_failed)) {
+		VlcProbedMetadata metadata;
+
+		if (status == libvlc_media_parsed_status_done) {
+			metadata.title = vlcMeta(media, libvlc_meta_Title);
+			metadata.artist = vlcMeta(media, libvlc_meta_Artist);
+			metadata.album = vlcMeta(media, libvlc_meta_Album);
+			bool ok;
+			int trackNumber = vlcMeta(media, libvlc_meta_TrackNumber).toInt(&ok);
+
+			if (ok) {
+				metadata.trackNumber = trackNumber;
+			}
+
+			libvlc_time_t duration = libvlc_media_get_duration(media);
+
+			if (duration > 0) {
+				metadata.length = int(duration);
+			}
+		}
+
+		VlcMetadataCacheEntry &entry = cache[pending.url.toLocalFile()];
+		entry.size = pending.size;
+		entry.lastModified = pending.lastModified;
+		entry.metadata = metadata;
+		cacheChanged = true;
+
+		metadata.url = pending.url;
+		appendResult(metadata);
+	}
+
+	libvlc_media_release(media);
+}
+
+void VlcMetadataProber::appendResult(const VlcProbedMetadata &metadata)
+{
+	mutex.lock();
+	bool notify = results.isEmpty();
+	results.append(metadata);
+	mutex.unlock();
+
+	if (notify) {
+		QMetaObject::invokeMethod(receiver, member, Qt::QueuedConnection);
+	}
+}
+
+void VlcMetadataProber::loadCache()
+{
+	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/metadatacache"));
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	int version;
+	stream >> version;
+
+	if (version != 0x20261019) {
+		qCWarning(logVlc, "Wrong version for: %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	while (!stream.atEnd()) {
+		QString localFile;
+		VlcMetadataCacheEntry entry;
+		stream >> localFile;
+		stream >> entry.size;
+		stream >> entry.lastModified;
+		stream >> entry.metadata.title;
+		stream >> entry.metadata.artist;
+		stream >> entry.metadata.album;
+		stream >> entry.metadata.trackNumber;
+		stream >> entry.metadata.length;
+
+		if (stream.status() != QDataStream::Ok) {
+			qCWarning(logVlc, "Corrupt data %s", qPrintable(file.fileName()));
+			break;
+		}
+
+		cache.insert(localFile, entry);
+	}
+}
+
+void VlcMetadataProber::saveCache()
+{
+	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/metadatacache"));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(logVlc, "Cannot open %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	int version = 0x20261019;
+	stream << version;
+
+	for (QHash<QString, VlcMetadataCacheEntry>::ConstIterator it = cache.constBegin();
+	     it != cache.constEnd(); ++it) {
+		stream << it.key();
+		stream << it->size;
+		stream << it->lastModified;
+		stream << it->metadata.title;
+		stream << it->metadata.artist;
+		stream << it->metadata.album;
+		stream << it->metadata.trackNumber;
+		stream << it->metadata.length;
+	}
+
+	cacheChanged = false;
+}
+
+void VlcMetadataProber::vlcEventHandler(const libvlc_event_t *event, void *instance)
+{
+	// called from a libvlc thread; the media is handled by the prober thread
+	VlcMetadataProber *prober = reinterpret_cast<VlcMetadataProber *>(instance);
+	QMutexLocker locker(&prober->mutex);
+	prober->parsedMedia.append(static_cast<libvlc_media_t *>(event->p_obj));
+	prober->condition.wakeOne();
+}
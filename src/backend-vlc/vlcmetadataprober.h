@@ -0,0 +1,116 @@
+/*
+ * vlcmetadataprober.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef VLCMETADATAPROBER_H
+#define VLCMETADATAPROBER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QUrl>
+#include <QWaitCondition>
+#include <vlc/vlc.h>
+
+class VlcProbedMetadata
+{
+public:
+	VlcProbedMetadata() : trackNumber(-1), length(-1) { }
+	~VlcProbedMetadata() { }
+
+	QUrl url;
+	QString title;
+	QString artist;
+	QString album;
+	int trackNumber; // -1 if unknown
+	int length; // ms, -1 if unknown
+};
+
+class VlcMetadataCacheEntry
+{
+public:
+	VlcMetadataCacheEntry() : size(-1), lastModified(-1) { }
+	~VlcMetadataCacheEntry() { }
+
+	qint64 size;
+	qint64 lastModified; // ms since epoch
+	VlcProbedMetadata metadata;
+};
+
+/*
+ * reads the metadata (title, artist, length, ...) of local files without
+ * playing them; only a few files are parsed by libvlc at the same time and
+ * the results are stored on disk (keyed by path, size and modification
+ * time), so that adding the same files again doesn't need libvlc at all
+ *
+ * "member" of "receiver" is invoked (queued) whenever new results are
+ * available; it should call takeResults()
+ */
+
+class VlcMetadataProber : public QThread
+{
+public:
+	VlcMetadataProber(QObject *receiver_, const char *member_);
+	~VlcMetadataProber();
+
+	void probe(const QList<QUrl> &urls);
+	QList<VlcProbedMetadata> takeResults();
+	bool isIdle();
+	void stop();
+
+private:
+	class PendingMedia
+	{
+	public:
+		PendingMedia() : size(-1), lastModified(-1) { }
+		~PendingMedia() { }
+
+		QUrl url;
+		qint64 size;
+		qint64 lastModified;
+	};
+
+	void run() override;
+	void startParsing(const QUrl &url);
+	void finishParsing(libvlc_media_t *media);
+	void appendResult(const VlcProbedMetadata &metadata);
+	void loadCache();
+	void saveCache();
+
+	static void vlcEventHandler(const libvlc_event_t *event, void *instance);
+
+	QObject *receiver;
+	const char *member;
+	QMutex mutex;
+	QWaitCondition condition;
+	QList<QUrl> pendingUrls;
+	QList<libvlc_media_t *> parsedMedia;
+	QList<VlcProbedMetadata> results;
+	int maxParsing;
+	bool busy;
+	bool stopping;
+
+	// only accessed by the thread itself
+	libvlc_instance_t *vlcInstance;
+	QHash<libvlc_media_t *, PendingMedia> parsingMedia;
+	QHash<QString, VlcMetadataCacheEntry> cache; // key = local file
+	bool cacheChanged;
+};
+
+#endif /* VLCMETADATAPROBER_H */
@@ -0,0 +1,361 @@
+/*
+ * chunkedlist.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CHUNKEDLIST_H
+#define CHUNKEDLIST_H
+
+#include <QList>
+#include <QVector>
+#include <algorithm>
+
+/*
+ * a list which stores its items in chunks of limited size, so that inserting
+ * or removing an item only moves the items of one chunk (and the chunk
+ * offsets) instead of the whole list; finding the chunk of a row is a binary
+ * search over the chunk offsets
+ */
+
+template<class T> class ChunkedList
+{
+public:
+	ChunkedList() : count(0) { }
+	~ChunkedList() { }
+
+	int size() const
+	{
+		return count;
+	}
+
+	bool isEmpty() const
+	{
+		return (count == 0);
+	}
+
+	const T &at(int index) const
+	{
+		int chunk = findChunk(index);
+		return chunks.at(chunk).at(index - offsets.at(chunk));
+	}
+
+	void clear()
+	{
+		chunks.clear();
+		offsets.clear();
+		count = 0;
+	}
+
+	void assign(const QList<T> &list)
+	{
+		clear();
+
+		for (int i = 0; i < list.size(); i += ChunkSize) {
+			offsets.append(i);
+			chunks.append(list.mid(i, ChunkSize));
+		}
+
+		count = list.size();
+	}
+
+	QList<T> toList() const
+	{
+		QList<T> list;
+		list.reserve(count);
+
+		foreach (const QVector<T> &chunk, chunks) {
+			for (int i = 0; i < chunk.size(); ++i) {
+				list.append(chunk.at(i));
+			}
+		}
+
+		return list;
+	}
+
+	void insert(int index, const T &value)
+	{
+		if (chunks.isEmpty()) {
+			chunks.append(QVector<T>());
+			offsets.append(0);
+		}
+
+		int chunk = findChunk(index);
+		chunks[chunk].insert(index - offsets.at(chunk), value);
+		++count;
+
+		for (int i = chunk + 1; i < offsets.size(); ++i) {
+			++offsets[i];
+		}
+
+		if (chunks.at(chunk).size() > MaxChunkSize) {
+			splitChunk(chunk);
+		}
+	}
+
+	void insert(int index, const QList<T> &values)
+	{
+		if (values.isEmpty()) {
+			return;
+		}
+
+		if (chunks.isEmpty()) {
+			assign(values);
+			return;
+		}
+
+		int chunk = findChunk(index);
+		QVector<T> &target = chunks[chunk];
+		int position = index - offsets.at(chunk);
+		int total = target.size() + values.size();
+		count += values.size();
+
+		if (total <= MaxChunkSize) {
+			QVector<T> tail = target.mid(position);
+			target.resize(position);
+			target.reserve(total);
+
+			for (int i = 0; i < values.size(); ++i) {
+				target.append(values.at(i));
+			}
+
+			target += tail;
+			updateOffsets(chunk + 1);
+			return;
+		}
+
+		// the chunk together with the new items is cut into chunks of ChunkSize
+		// in one pass, instead of splitting the same (large) chunk repeatedly
+		QVector<QVector<T> > newChunks;
+		newChunks.reserve(chunks.size() + (total / ChunkSize) + 1);
+
+		for (int i = 0; i < chunk; ++i) {
+			newChunks.append(chunks.at(i));
+		}
+
+		QVector<T> current;
+		current.reserve(ChunkSize);
+
+		for (int i = 0; i < total; ++i) {
+			if (i < position) {
+				current.append(target.at(i));
+			} else if (i < (position + values.size())) {
+				current.append(values.at(i - position));
+			} else {
+				current.append(target.at(i - values.size()));
+			}
+
+			if (current.size() == ChunkSize) {
+				newChunks.append(current);
+				current.clear();
+				current.reserve(ChunkSize);
+			}
+		}
+
+		if (!current.isEmpty()) {
+			// total > MaxChunkSize, so there is a full chunk to append the rest to
+			newChunks.last() += current;
+		}
+
+		for (int i = chunk + 1; i < chunks.size(); ++i) {
+			newChunks.append(chunks.at(i));
+		}
+
+		chunks = newChunks;
+		offsets.resize(chunks.size());
+		updateOffsets(chunk + 1);
+	}
+
+	void removeAt(int index)
+	{
+		int chunk = findChunk(index);
+		chunks[chunk].remove(index - offsets.at(chunk));
+		--count;
+
+		for (int i = chunk + 1; i < offsets.size(); ++i) {
+			--offsets[i];
+		}
+
+		mergeChunk(chunk);
+	}
+
+	void remove(int index, int n)
+	{
+		if (n <= 0) {
+			return;
+		}
+
+		int firstChunk = findChunk(index);
+		int chunk = firstChunk;
+		int position = index - offsets.at(chunk);
+
+		while (n > 0) {
+			QVector<T> &target = chunks[chunk];
+			int removed = qMin(n, target.size() - position);
+			target.remove(position, removed);
+			count -= removed;
+			n -= removed;
+
+			if (target.isEmpty()) {
+				chunks.remove(chunk);
+				offsets.remove(chunk);
+			} else {
+				++chunk;
+			}
+
+			position = 0;
+		}
+
+		updateOffsets(firstChunk);
+		mergeChunk(qMin(firstChunk, chunks.size() - 1));
+	}
+
+	void replace(int index, const T &value)
+	{
+		int chunk = findChunk(index);
+		chunks[chunk][index - offsets.at(chunk)] = value;
+	}
+
+	void move(int from, int to)
+	{
+		if (from != to) {
+			T value = at(from);
+			removeAt(from);
+			insert(to, value);
+		}
+	}
+
+	// the first index whose item isn't less than value
+	template<class LessThan> int lowerBound(const T &value, const LessThan &lessThan) const
+	{
+		int low = 0;
+		int high = chunks.size();
+
+		while (low < high) {
+			int mid = (low + high) / 2;
+
+			if (lessThan(chunks.at(mid).last(), value)) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+
+		if (low == chunks.size()) {
+			return count;
+		}
+
+		const QVector<T> &chunk = chunks.at(low);
+		return (offsets.at(low) + int(std::lower_bound(chunk.constBegin(),
+			chunk.constEnd(), value, lessThan) - chunk.constBegin()));
+	}
+
+	// the first index whose item is greater than value
+	template<class LessThan> int upperBound(const T &value, const LessThan &lessThan) const
+	{
+		int low = 0;
+		int high = chunks.size();
+
+		while (low < high) {
+			int mid = (low + high) / 2;
+
+			if (!lessThan(value, chunks.at(mid).last())) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+
+		if (low == chunks.size()) {
+			return count;
+		}
+
+		const QVector<T> &chunk = chunks.at(low);
+		return (offsets.at(low) + int(std::upper_bound(chunk.constBegin(),
+			chunk.constEnd(), value, lessThan) - chunk.constBegin()));
+	}
+
+private:
+	enum {
+		ChunkSize = 256, // used when (re)building the chunks
+		MaxChunkSize = 512
+	};
+
+	// index == count is mapped to the last chunk
+	int findChunk(int index) const
+	{
+		return int(std::upper_bound(offsets.constBegin(), offsets.constEnd(), index) -
+			offsets.constBegin()) - 1;
+	}
+
+	void updateOffsets(int chunk)
+	{
+		if (!offsets.isEmpty()) {
+			offsets[0] = 0;
+		}
+
+		for (int i = qMax(chunk, 1); i < chunks.size(); ++i) {
+			offsets[i] = offsets.at(i - 1) + chunks.at(i - 1).size();
+		}
+	}
+
+	void splitChunk(int chunk)
+	{
+		QVector<T> &target = chunks[chunk];
+		int position = qMin(target.size() / 2, int(ChunkSize));
+		QVector<T> tail = target.mid(position);
+		target.resize(position);
+		chunks.insert(chunk + 1, tail);
+		offsets.insert(chunk + 1, offsets.at(chunk) + position);
+	}
+
+	// avoids lots of tiny (or empty) chunks
+	void mergeChunk(int chunk)
+	{
+		if ((chunk < 0) || (chunk >= chunks.size())) {
+			return;
+		}
+
+		if (chunks.at(chunk).isEmpty()) {
+			chunks.remove(chunk);
+			offsets.remove(chunk);
+			return;
+		}
+
+		if (chunks.at(chunk).size() >= (ChunkSize / 4)) {
+			return;
+		}
+
+		if (((chunk + 1) < chunks.size()) &&
+		    ((chunks.at(chunk).size() + chunks.at(chunk + 1).size()) <= MaxChunkSize)) {
+			chunks[chunk] += chunks.at(chunk + 1);
+			chunks.remove(chunk + 1);
+			offsets.remove(chunk + 1);
+		} else if ((chunk > 0) &&
+			   ((chunks.at(chunk - 1).size() + chunks.at(chunk).size()) <= MaxChunkSize)) {
+			chunks[chunk - 1] += chunks.at(chunk);
+			chunks.remove(chunk);
+			offsets.remove(chunk);
+		}
+	}
+
+	QVector<QVector<T> > chunks;
+	QVector<int> offsets; // index of the first item of each chunk
+	int count;
+};
+
+#endif /* CHUNKEDLIST_H */
@@ -8,5 +8,6 @@
 #define KAFFEINE_LIB_INSTALL_DIR "${KDE_INSTALL_FULL_LIBDIR}"
 #define HAVE_DVB @HAVE_DVB@
 #define HAVE_LIBDVBV5 @HAVE_LIBDVBV5@
+#define HAVE_TRACING @HAVE_TRACING@
 
 #endif /* CONFIG_KAFFEINE_H */
@@ -34,6 +34,7 @@
 #include "configuration.h"
 #include "configurationdialog.h"
 #include "configurationdialog_p.h"
+#include "metrics.h"
 
 QString Log::log;
 
@@ -103,6 +104,16 @@ ConfigurationDialog::ConfigurationDialog(QWidget *parent) : KPageDialog(parent)
 	gridLayout->addWidget(textEdit, 1, 0, 1, 2);
 	gridLayout->setRowStretch(2, 0);
 
+	label = new QLabel(i18nc("@label:textbox", "Metrics text file:"), widget);
+	gridLayout->addWidget(label, 2, 0);
+
+	metricsTextFileEdit = new QLineEdit(widget);
+	metricsTextFileEdit->setText(Metrics::instance()->getTextFile());
+	metricsTextFileEdit->setPlaceholderText(i18nc("@info:placeholder",
+		"Prometheus text file (leave empty to disable)"));
+	label->setBuddy(metricsTextFileEdit);
+	gridLayout->addWidget(metricsTextFileEdit, 3, 0, 1, 2);
+
 	page = new KPageWidgetItem(widget, i18nc("@title:group", "Diagnostics"));
 	page->setIcon(QIcon::fromTheme(QLatin1String("page-zoom"), QIcon(":page-zoom")));
 	addPage(page);
@@ -141,6 +152,7 @@ void ConfigurationDialog::accept()
 	configuration->setShortSkipDuration(shortSkipBox->value());
 	configuration->setLongSkipDuration(longSkipBox->value());
 	configuration->setLibVlcArguments(libVlcArguments->text());
+	Metrics::instance()->setTextFile(metricsTextFileEdit->text());
 	KPageDialog::accept();
 }
 
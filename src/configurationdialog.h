@@ -63,6 +63,7 @@ private:
 	QSpinBox *shortSkipBox;
 	QSpinBox *longSkipBox;
 	QLineEdit *libVlcArguments;
+	QLineEdit *metricsTextFileEdit;
 };
 
 #endif /* CONFIGURATIONDIALOG_H */
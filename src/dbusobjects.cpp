@@ -25,7 +25,10 @@
 #include "dbusobjects.h"
 #include "dvb/dvbmanager.h"
 #include "dvb/dvbtab.h"
+#include "dvb/dvbtsanalyzer.h"
+#include "metrics.h"
 #include "playlist/playlisttab.h"
+#include "zaplatency.h"
 
 static QDBusArgument &operator<<(QDBusArgument &argument, const MprisStatusStruct &statusStruct)
 {
@@ -317,6 +320,24 @@ void MprisTrackListObject::SetRandom(bool random)
 	playlistTab->setRandom(random);
 }
 
+DBusMetricsObject::DBusMetricsObject(QObject *parent) : QObject(parent)
+{
+}
+
+DBusMetricsObject::~DBusMetricsObject()
+{
+}
+
+QVariantMap DBusMetricsObject::Snapshot()
+{
+	return Metrics::instance()->snapshot();
+}
+
+QString DBusMetricsObject::PrometheusText()
+{
+	return Metrics::instance()->toPrometheusText();
+}
+
 #if HAVE_DVB == 1
 
 DBusTelevisionObject::DBusTelevisionObject(DvbTab *dvbTab_, QObject *parent) : QObject(parent),
@@ -409,6 +430,21 @@ void DBusTelevisionObject::RemoveProgram(quint32 key)
 	}
 }
 
+QVariantMap DBusTelevisionObject::LastZapLatency()
+{
+	return ZapLatency::instance()->getLastZap();
+}
+
+QVariantMap DBusTelevisionObject::ZapLatencyHistogram()
+{
+	return ZapLatency::instance()->getHistogram();
+}
+
+QVariantMap DBusTelevisionObject::TransportStreamHealth()
+{
+	return DvbTsAnalyzer::createReport(dvbTab->getManager());
+}
+
 #endif /* HAVE_DVB == 1 */
 
 #include "moc_dbusobjects.cpp"
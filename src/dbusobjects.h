@@ -129,6 +129,19 @@ private:
 	PlaylistTab *playlistTab;
 };
 
+class DBusMetricsObject : public QObject
+{
+	Q_OBJECT
+	Q_CLASSINFO("D-Bus Interface", "org.freedesktop.MediaPlayer")
+public:
+	explicit DBusMetricsObject(QObject *parent);
+	~DBusMetricsObject();
+
+public slots:
+	QVariantMap Snapshot();
+	QString PrometheusText();
+};
+
 #ifndef HAVE_DVB
 #error HAVE_DVB must be defined
 #endif /* HAVE_DVB */
@@ -153,6 +166,9 @@ public slots:
 	quint32 ScheduleProgram(const QString &name, const QString &channel, const QString &begin,
 		const QString &duration, int repeat);
 	void RemoveProgram(quint32 key);
+	QVariantMap LastZapLatency();
+	QVariantMap ZapLatencyHistogram();
+	QVariantMap TransportStreamHealth();
 
 private:
 	DvbTab *dvbTab;
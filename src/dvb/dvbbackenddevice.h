@@ -21,6 +21,7 @@
 #ifndef DVBBACKENDDEVICE_H
 #define DVBBACKENDDEVICE_H
 
+#include <QList>
 #include <QtGlobal>
 
 class DvbTransponder;
@@ -46,7 +47,8 @@ public:
 		DvbTModulationAuto = (1 << 0),
 		DvbTFecAuto = (1 << 1),
 		DvbTTransmissionModeAuto = (1 << 2),
-		DvbTGuardIntervalAuto = (1 << 3)
+		DvbTGuardIntervalAuto = (1 << 3),
+		NativeSectionFilters = (1 << 4) // sections are filtered and crc-checked by the backend
 	};
 
 	Q_DECLARE_FLAGS(Capabilities, Capability)
@@ -82,6 +84,29 @@ public:
 	int bufferSize; // must be a multiple of 188
 };
 
+// scheduling of the thread which reads the transport stream from the device
+
+class DvbReaderConfig
+{
+public:
+	enum SchedulingPolicy {
+		NormalScheduling = 0,
+		FifoScheduling = 1, // falls back to niceness if real-time scheduling isn't permitted
+		RoundRobinScheduling = 2, // likewise
+		SchedulingPolicyMax = RoundRobinScheduling
+	};
+
+	DvbReaderConfig() : schedulingPolicy(NormalScheduling), realtimePriority(10), niceness(0),
+		dvrBufferSize(0) { }
+	~DvbReaderConfig() { }
+
+	SchedulingPolicy schedulingPolicy;
+	int realtimePriority; // 1 - 99
+	int niceness; // -20 - 19
+	QList<int> cpuAffinity; // empty means all cpus
+	int dvrBufferSize; // bytes; 0 means the kernel default
+};
+
 class DvbPidFilter
 {
 public:
@@ -106,14 +131,30 @@ protected:
 class DvbFrontendDevice : public DvbDeviceBase
 {
 public:
-	virtual bool addPidFilter(int pid, DvbPidFilter *filter) = 0;
-	virtual bool addSectionFilter(int pid, DvbSectionFilter *filter) = 0;
+	// a pid filter for this pid receives every packet of the transport stream
+	enum {
+		FullTsPid = 0x2000
+	};
+
+	// if the demux falls behind, filters with a lower priority are skipped first
+	enum FilterPriority {
+		DumpPriority = 0,
+		EpgPriority = 1,
+		PmtPriority = 2,
+		LiveViewPriority = 3,
+		RecordingPriority = 4 // never skipped
+	};
+
+	virtual bool addPidFilter(int pid, DvbPidFilter *filter, FilterPriority priority) = 0;
+	virtual bool addSectionFilter(int pid, DvbSectionFilter *filter,
+		FilterPriority priority) = 0;
 	virtual void removePidFilter(int pid, DvbPidFilter *filter) = 0;
 	virtual void removeSectionFilter(int pid, DvbSectionFilter *filter) = 0;
 
-	// these two functions are thread-safe
+	// these three functions are thread-safe
 	virtual DvbDataBuffer getBuffer() = 0;
 	virtual void writeBuffer(const DvbDataBuffer &dataBuffer) = 0;
+	virtual void writeSection(int pid, const QByteArray &section) = 0; // native section filters
 
 protected:
 	DvbFrontendDevice() { }
@@ -162,10 +203,17 @@ public:
 	virtual float getFrqMHz() = 0;
 	virtual bool addPidFilter(int pid) = 0;
 	virtual void removePidFilter(int pid) = 0;
+	// only if NativeSectionFilters is supported; sections are passed to writeSection();
+	// if tableIdExtensions isn't empty, only sections with one of them are passed
+	virtual bool addSectionFilter(int pid, int tableId, int tableIdMask,
+		const QList<int> &tableIdExtensions) = 0;
+	virtual void removeSectionFilter(int pid) = 0;
 	virtual void startDescrambling(const QByteArray &pmtSectionData) = 0;
 	virtual void stopDescrambling(int serviceId) = 0;
 	virtual void release() = 0;
 	virtual void enableDvbDump() = 0;
+	// takes effect the next time the device is acquired
+	virtual void setReaderConfig(const DvbReaderConfig &readerConfig) = 0;
 	QList<lnbSat> getLnbSatModels() const { return lnbSatModels; };
 
 
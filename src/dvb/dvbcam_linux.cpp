@@ -23,9 +23,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/dvb/ca.h>
-#include <QCoreApplication>
+#include <poll.h>
 #include <QFile>
-#include <QSocketNotifier>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
@@ -51,18 +50,37 @@ public:
 	QByteArray pmtSectionData;
 };
 
-DvbLinuxCam::DvbLinuxCam(QObject *parent) : QObject(parent), caFd(-1), socketNotifier(NULL), ready(false), eventPosted(false)
+DvbLinuxCam::DvbLinuxCam(QObject *parent) : QThread(parent), caFd(-1), slot(-1), pollInterval(0),
+	pollDeadline(0), pollFailures(0), pendingCommands(Nothing), messageData(NULL), ready(false),
+	caPmtListSent(false), stopping(false)
 {
-	connect(&pollTimer, &QTimer::timeout, this, &DvbLinuxCam::pollModule);
+	wakeUpPipe[0] = -1;
+	wakeUpPipe[1] = -1;
 }
 
 DvbLinuxCam::~DvbLinuxCam()
 {
+	stopCa();
+
+	if (wakeUpPipe[0] >= 0) {
+		close(wakeUpPipe[0]);
+		close(wakeUpPipe[1]);
+	}
 }
 
 void DvbLinuxCam::startCa(const QString &path)
 {
-	Q_ASSERT(caFd < 0);
+	Q_ASSERT((caFd < 0) && !isRunning());
+
+	if (wakeUpPipe[0] < 0) {
+		if (pipe(wakeUpPipe) != 0) {
+			wakeUpPipe[0] = -1;
+			wakeUpPipe[1] = -1;
+			qCWarning(logCam, "Cannot create pipe");
+			return;
+		}
+	}
+
 	caFd = open(QFile::encodeName(path).constData(), O_RDWR | O_NONBLOCK);
 
 	if (caFd < 0) {
@@ -70,15 +88,8 @@ void DvbLinuxCam::startCa(const QString &path)
 		return;
 	}
 
-	slot = -1;
-	pollTimer.start(5000);
-	pendingCommands = ResetCa;
-
-	if (!detectSlot()) {
-		pendingCommands = Nothing;
-	} else {
-		pendingCommands = ResetCa;
-	}
+	stopping = false;
+	start();
 }
 
 void DvbLinuxCam::startDescrambling(const QByteArray &pmtSectionData)
@@ -91,63 +102,71 @@ void DvbLinuxCam::startDescrambling(const QByteArray &pmtSectionData)
 	}
 
 	int serviceId = pmtSection.programNumber();
-	QMap<int, DvbLinuxCamService>::iterator it = services.find(serviceId);
 
-	if (it == services.end()) {
-		it = services.insert(serviceId, DvbLinuxCamService());
-	}
+	{
+		QMutexLocker locker(&mutex);
+		QMap<int, DvbLinuxCamService>::iterator it = services.find(serviceId);
 
-	if (it->pendingAction != DvbLinuxCamService::Add) {
-		it->pendingAction = DvbLinuxCamService::Update;
-	}
+		if (it == services.end()) {
+			it = services.insert(serviceId, DvbLinuxCamService());
+		} else if ((it->pendingAction == DvbLinuxCamService::Nothing) &&
+			   (it->pmtSectionData == pmtSectionData)) {
+			// the module already has this CA PMT
+			return;
+		}
 
-	it->pmtSectionData = pmtSectionData;
+		if (it->pendingAction != DvbLinuxCamService::Add) {
+			it->pendingAction = DvbLinuxCamService::Update;
+		}
 
-	if (ready && !eventPosted) {
-		eventPosted = true;
-		QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+		it->pmtSectionData = pmtSectionData;
 	}
+
+	wakeUp();
 }
 
 void DvbLinuxCam::stopDescrambling(int serviceId)
 {
-	QMap<int, DvbLinuxCamService>::iterator it = services.find(serviceId);
+	{
+		QMutexLocker locker(&mutex);
+		QMap<int, DvbLinuxCamService>::iterator it = services.find(serviceId);
 
-	if (it == services.end()) {
-		qCWarning(logCam, "Cannot find service id %d while stopping CAM", serviceId);
-		return;
-	}
+		if (it == services.end()) {
+			qCWarning(logCam, "Cannot find service id %d while stopping CAM", serviceId);
+			return;
+		}
 
-	switch (it->pendingAction) {
-	case DvbLinuxCamService::Nothing:
-	case DvbLinuxCamService::Update:
-		it->pendingAction = DvbLinuxCamService::Remove;
-		break;
-	case DvbLinuxCamService::Add:
-		services.erase(it);
-		return;
-	case DvbLinuxCamService::Remove:
-		qCWarning(logCam, "CAM Service was already removed");
-		services.erase(it);
-		return;
+		switch (it->pendingAction) {
+		case DvbLinuxCamService::Nothing:
+		case DvbLinuxCamService::Update:
+			it->pendingAction = DvbLinuxCamService::Remove;
+			break;
+		case DvbLinuxCamService::Add:
+			services.erase(it);
+			return;
+		case DvbLinuxCamService::Remove:
+			qCWarning(logCam, "CAM Service was already removed");
+			services.erase(it);
+			return;
+		}
 	}
 
-	if (ready && !eventPosted) {
-		eventPosted = true;
-		QCoreApplication::postEvent(this, new QEvent(QEvent::User));
-	}
+	wakeUp();
 }
 
 void DvbLinuxCam::stopCa()
 {
-	services.clear();
-	ready = false;
-	eventPosted = false;
-
-	delete socketNotifier;
-	socketNotifier = NULL;
+	if (isRunning()) {
+		mutex.lock();
+		stopping = true;
+		mutex.unlock();
+		wakeUp();
+		wait();
+	}
 
-	pollTimer.stop();
+	mutex.lock();
+	services.clear();
+	mutex.unlock();
 
 	if (caFd >= 0) {
 		close(caFd);
@@ -155,8 +174,106 @@ void DvbLinuxCam::stopCa()
 	}
 }
 
+void DvbLinuxCam::wakeUp()
+{
+	if (isRunning() && (write(wakeUpPipe[1], " ", 1) != 1)) {
+		qCWarning(logCam, "Cannot write to pipe");
+	}
+}
+
+void DvbLinuxCam::run()
+{
+	timer.start();
+	pollFailures = 0;
+	slot = -1;
+	ready = false;
+	caPmtListSent = false;
+	queuedMessages.clear();
+	startPollTimer(5000);
+	pendingCommands = ResetCa;
+
+	if (!detectSlot()) {
+		pendingCommands = Nothing;
+	}
+
+	while (true) {
+		pollfd pollFds[2];
+		memset(pollFds, 0, sizeof(pollFds));
+		pollFds[0].fd = wakeUpPipe[0];
+		pollFds[0].events = POLLIN;
+		// the CA device is only watched while a module is present
+		pollFds[1].fd = ((slot >= 0) ? caFd : -1);
+		pollFds[1].events = POLLIN;
+		int timeout = int(qMax(Q_INT64_C(0), pollDeadline - timer.elapsed()));
+
+		if (poll(pollFds, 2, timeout) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			// the thread keeps running: after a growing delay (at most 1.6 s) the
+			// module is reset, which drops it back to 'no module detected' until
+			// detectSlot() finds it again and the CA PMT list is resent
+			int delay = (100 << qMin(pollFailures, 4));
+			++pollFailures;
+			qCWarning(logCam, "Poll failed with error: %d, resetting the CAM in %d ms",
+				errno, delay);
+			msleep(delay);
+
+			mutex.lock();
+			bool stop = stopping;
+			mutex.unlock();
+
+			if (stop) {
+				return;
+			}
+
+			pendingCommands = ResetCa;
+			handlePendingCommands();
+			continue;
+		}
+
+		pollFailures = 0;
+
+		if ((pollFds[0].revents & POLLIN) != 0) {
+			char data[16];
+
+			if (read(wakeUpPipe[0], data, sizeof(data)) <= 0) {
+				qCWarning(logCam, "Cannot read from pipe");
+			}
+
+			mutex.lock();
+			bool stop = stopping;
+			mutex.unlock();
+
+			if (stop) {
+				return;
+			}
+
+			updateServices();
+		}
+
+		if ((pollFds[1].revents & POLLIN) != 0) {
+			readyRead();
+		}
+
+		if (timer.elapsed() >= pollDeadline) {
+			pollModule();
+		}
+	}
+}
+
+void DvbLinuxCam::startPollTimer(int interval)
+{
+	pollInterval = interval;
+	pollDeadline = timer.elapsed() + interval;
+}
+
 void DvbLinuxCam::pollModule()
 {
+	// like a periodic timer
+	pollDeadline = timer.elapsed() + pollInterval;
+
 	if (slot < 0) {
 		detectSlot();
 	} else {
@@ -165,7 +282,7 @@ void DvbLinuxCam::pollModule()
 			qCDebug(logCam, "CAM: request timed out");
 		}
 
-		if (pendingCommands == 0) {
+		if ((pendingCommands == 0) && queuedMessages.isEmpty()) {
 			pendingCommands |= SendPoll;
 		}
 
@@ -205,6 +322,11 @@ void DvbLinuxCam::readyRead()
 		pendingCommands &= ~ExpectingReply;
 		handleTransportLayer(data + 2, size - 2);
 		handlePendingCommands();
+
+		if ((pendingCommands & ExpectingReply) == 0) {
+			// nothing to send; ask the module again soon
+			startPollTimer(100);
+		}
 	} else {
 		qCWarning(logCam, "CAM: unknown recipient");
 	}
@@ -246,11 +368,6 @@ bool DvbLinuxCam::detectSlot()
 		return false;
 	}
 
-	if (socketNotifier == NULL) {
-		socketNotifier = new QSocketNotifier(caFd, QSocketNotifier::Read, this);
-		connect(socketNotifier, &QSocketNotifier::activated, this, &DvbLinuxCam::readyRead);
-	}
-
 	if (pendingCommands == 0) {
 		pendingCommands |= SendCreateTransportConnection;
 	}
@@ -443,8 +560,8 @@ void DvbLinuxCam::handleApplicationLayer(const unsigned char *data, int size)
 			break;
 		case CaInfo:
 			ready = true;
-			eventPosted = true;
-			QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+			caPmtListSent = false;
+			updateServices();
 			break;
 		default:
 			qCWarning(logCam, "CAM: unknown tag %d", tag);
@@ -459,6 +576,13 @@ void DvbLinuxCam::handleApplicationLayer(const unsigned char *data, int size)
 void DvbLinuxCam::handlePendingCommands()
 {
 	if ((pendingCommands & ExpectingReply) == 0) {
+		// data from the module is fetched first
+		if (((pendingCommands & SendReceiveData) == 0) && !queuedMessages.isEmpty()) {
+			QByteArray queuedMessage = queuedMessages.takeFirst();
+			writeMessage(queuedMessage.constData(), uint(queuedMessage.size()));
+			return;
+		}
+
 		int pendingCommand = pendingCommands & (~pendingCommands + 1);
 		pendingCommands &= ~pendingCommand;
 
@@ -472,7 +596,10 @@ void DvbLinuxCam::handlePendingCommands()
 
 			qCDebug(logCam, "--> CAM reset");
 			slot = -1;
-			pollTimer.start(100);
+			ready = false;
+			caPmtListSent = false;
+			queuedMessages.clear();
+			startPollTimer(100);
 			pendingCommands = Nothing;
 			break;
 		case SendCreateTransportConnection:
@@ -509,14 +636,49 @@ void DvbLinuxCam::handlePendingCommands()
 	}
 }
 
-void DvbLinuxCam::customEvent(QEvent *event)
+void DvbLinuxCam::updateServices()
 {
-	Q_UNUSED(event)
-
 	if (!ready) {
 		return;
 	}
 
+	// the CA PMTs are small and the device node is non-blocking
+	QMutexLocker locker(&mutex);
+
+	if (!caPmtListSent) {
+		// the module doesn't know about any service yet (e.g. after a reset)
+		QList<QByteArray> pmtSections;
+
+		for (QMap<int, DvbLinuxCamService>::iterator it = services.begin();
+		     it != services.end();) {
+			if (it->pendingAction == DvbLinuxCamService::Remove) {
+				it = services.erase(it);
+			} else {
+				it->pendingAction = DvbLinuxCamService::Nothing;
+				pmtSections.append(it->pmtSectionData);
+				++it;
+			}
+		}
+
+		for (int i = 0; i < pmtSections.size(); ++i) {
+			CaPmtListManagement listManagement = More;
+
+			if (pmtSections.size() == 1) {
+				listManagement = Only;
+			} else if (i == 0) {
+				listManagement = First;
+			} else if (i == (pmtSections.size() - 1)) {
+				listManagement = Last;
+			}
+
+			DvbPmtSection pmtSection(pmtSections.at(i));
+			sendCaPmt(pmtSection, listManagement, Descramble);
+		}
+
+		caPmtListSent = true;
+		return;
+	}
+
 	int activeCaPmts = 0;
 
 	for (QMap<int, DvbLinuxCamService>::iterator it = services.begin();
@@ -552,14 +714,12 @@ void DvbLinuxCam::customEvent(QEvent *event)
 			break;
 		    }
 		case DvbLinuxCamService::Remove:
-			qCWarning(logCam, "CAM: impossible to remove custom event");
+			qCWarning(logCam, "CAM: impossible to remove service");
 			break;
 		}
 
 		it->pendingAction = DvbLinuxCamService::Nothing;
 	}
-
-	eventPosted = false;
 }
 
 void DvbLinuxCam::sendCaPmt(const DvbPmtSection &pmtSection, CaPmtListManagement listManagement,
@@ -624,6 +784,8 @@ void DvbLinuxCam::sendCaPmt(const DvbPmtSection &pmtSection, CaPmtListManagement
 		messageData[lengthIndex + 1] = (length & 0xff);
 	}
 
+	qCDebug(logCam, "--> CA PMT for service %d (list management %d, command %d)",
+		pmtSection.programNumber(), int(listManagement), int(command));
 	sendApplicationLayerMessage(CaPmt, messageData, messageData + index);
 }
 
@@ -645,12 +807,23 @@ void DvbLinuxCam::sendTransportLayerMessage(TransportLayerTag tag, char *data, c
 	*(--data) = (slot & 0xff);
 	length = uint(end - data);
 
+	// only one message may be outstanding at the transport layer
+	if ((pendingCommands & ExpectingReply) != 0) {
+		queuedMessages.append(QByteArray(data, int(length)));
+		return;
+	}
+
+	writeMessage(data, length);
+}
+
+void DvbLinuxCam::writeMessage(const char *data, uint length)
+{
 	if (write(caFd, data, length) != length) {
 		qCWarning(logCam, "CAM: cannot send message of length %d", length);
 	}
 
 	pendingCommands |= ExpectingReply;
-	pollTimer.start(400);
+	startPollTimer(400);
 }
 
 void DvbLinuxCam::sendSessionLayerMessage(SessionLayerTag tag, char *data, char *end)
@@ -714,5 +887,3 @@ void DvbLinuxCam::sendApplicationLayerMessage(ApplicationLayerTag tag, char *dat
 
 	sendSessionLayerMessage(SessionNumber, data, end);
 }
-
-#include "moc_dvbcam_linux.cpp"
@@ -21,30 +21,33 @@
 #ifndef DVBCAM_LINUX_H
 #define DVBCAM_LINUX_H
 
+#include <QElapsedTimer>
 #include <QMap>
-#include <QTimer>
+#include <QMutex>
+#include <QThread>
 
-class QSocketNotifier;
 class DvbLinuxCamService;
 class DvbPmtSection;
 
-class DvbLinuxCam : public QObject
+/*
+ * drives the CI transport, session and application layers on its own thread,
+ * so that the module is served as soon as the CA device becomes readable and
+ * CA PMTs are sent as soon as a service is started or stopped; messages which
+ * are generated while the module is busy are queued and sent back-to-back
+ */
+
+class DvbLinuxCam : public QThread
 {
-	Q_OBJECT
 public:
 	explicit DvbLinuxCam(QObject *parent);
 	~DvbLinuxCam();
 
+	// called by the main thread
 	void startCa(const QString &path);
 	void startDescrambling(const QByteArray &pmtSection);
 	void stopDescrambling(int serviceId);
 	void stopCa();
 
-private slots:
-	void pollModule();
-	void readyRead();
-
-public:
 	enum PendingCommand {
 		Nothing = 0,
 		ExpectingReply = (1 << 0),
@@ -106,6 +109,9 @@ private:
 	};
 
 	enum CaPmtListManagement {
+		More = 0x00,
+		First = 0x01,
+		Last = 0x02,
 		Only = 0x03,
 		Add = 0x04,
 		Update = 0x05
@@ -116,6 +122,11 @@ private:
 		StopDescrambling = 0x04
 	};
 
+	void run() override;
+	void wakeUp();
+	void startPollTimer(int interval);
+	void pollModule();
+	void readyRead();
 	bool detectSlot();
 	int decodeLength(const unsigned char *&data, int &size);
 	void resize(int messageSize);
@@ -123,23 +134,34 @@ private:
 	void handleSessionLayer(const unsigned char *data, int size);
 	void handleApplicationLayer(const unsigned char *data, int size);
 	void handlePendingCommands();
-	void customEvent(QEvent *event) override;
+	void updateServices();
 	void sendCaPmt(const DvbPmtSection &pmtSection, CaPmtListManagement listManagement,
 		CaPmtCommand command);
 	void sendApplicationLayerMessage(ApplicationLayerTag tag, char *data, char *end);
 	void sendSessionLayerMessage(SessionLayerTag tag, char *data, char *end);
 	void sendTransportLayerMessage(TransportLayerTag tag, char *data, char *end);
+	void writeMessage(const char *data, uint length);
 
 	int caFd;
+	int wakeUpPipe[2];
+
+	// only accessed by the cam thread
 	int slot;
-	QTimer pollTimer;
-	QSocketNotifier *socketNotifier;
+	QElapsedTimer timer;
+	int pollInterval; // ms
+	qint64 pollDeadline; // timer.elapsed() when the module is polled next
+	int pollFailures; // consecutive poll() errors
 	int pendingCommands;
 	QByteArray message;
 	char *messageData;
+	QList<QByteArray> queuedMessages; // sent when the module has replied
 	bool ready;
-	bool eventPosted;
+	bool caPmtListSent; // whether the module knows the current services
+
+	// shared with the main thread
+	QMutex mutex;
 	QMap<int, DvbLinuxCamService> services;
+	bool stopping;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(DvbLinuxCam::PendingCommands)
@@ -117,7 +117,8 @@ DvbChannelModel::~DvbChannelModel()
 	}
 
 	if (isSqlModel) {
-		sqlFlush();
+		// the writer thread may not be able to finish otherwise
+		sqlSync();
 	}
 }
 
@@ -219,8 +220,8 @@ DvbChannelModel *DvbChannelModel::createSqlModel(QObject *parent)
 		channelModel->addChannel(channel);
 	}
 
-	// As we'll remove the old channel file, flush the DB content
-	channelModel->channelFlush();
+	// As we'll remove the old channel file, wait until the DB content is written
+	channelModel->sqlSync();
 
 	if (!file.remove()) {
 		qCWarning(logDvb, "Cannot remove '%s' from DB", qPrintable(file.fileName()));
@@ -269,9 +270,7 @@ void DvbChannelModel::cloneFrom(DvbChannelModel *other)
 		channelNumbers = other->channelNumbers;
 		channelIds = other->channelIds;
 
-		foreach (const DvbSharedChannel &channel, channelNumbers) {
-			emit channelAdded(channel);
-		}
+		emit channelsAdded(channelNumbers.values());
 	} else if (isSqlModel && !other->isSqlModel) {
 		QMultiMap<SqlKey, DvbSharedChannel> otherChannelKeys;
 
@@ -295,10 +294,13 @@ void DvbChannelModel::cloneFrom(DvbChannelModel *other)
 			}
 		}
 
+		QList<DvbChannel> newChannels;
+
 		foreach (const DvbSharedChannel &channel, otherChannelKeys) {
-			DvbChannel newChannel(*channel);
-			addChannel(newChannel);
+			newChannels.append(*channel);
 		}
+
+		addChannels(newChannels);
 	} else {
 		qCWarning(logDvb, "Illegal type of clone");
 	}
@@ -365,9 +367,76 @@ void DvbChannelModel::addChannel(DvbChannel &channel)
 		channel.number = findNextFreeChannelNumber(channel.number);
 	}
 
+	DvbSharedChannel newChannel = insertChannel(channel);
+
+	if (newChannel.isValid()) {
+		emit channelAdded(newChannel);
+	}
+}
+
+void DvbChannelModel::addChannels(const QList<DvbChannel> &newChannels)
+{
+	QList<DvbSharedChannel> addedChannels;
+	QHash<QString, int> suffixHints;
+	int freeNumber = 1;
+
+	foreach (const DvbChannel &newChannel, newChannels) {
+		DvbChannel channel = newChannel;
+		bool forceAdd = (channel.number >= 1);
+
+		if (!forceAdd) {
+			channel.number = 1;
+		}
+
+		if (!channel.validate()) {
+			qCWarning(logDvb, "Invalid channel");
+			continue;
+		}
+
+		if (forceAdd ? (channelNames.contains(channel.name) ||
+				channelNumbers.contains(channel.number)) :
+		    channelIds.contains(DvbChannelId(&channel))) {
+			// existing channels are modified; the views have to know all
+			// added channels before
+			if (!addedChannels.isEmpty()) {
+				emit channelsAdded(addedChannels);
+				addedChannels.clear();
+			}
+
+			// a name or number freed by this update isn't reused by the
+			// following channels; the cursor and the hints stay valid,
+			// because the free checks don't rely on them
+
+			// not 'channel', addChannel() would take its number as forced
+			DvbChannel existingChannel = newChannel;
+			addChannel(existingChannel);
+			continue;
+		}
+
+		if (!forceAdd) {
+			// numbers below freeNumber are known to be in use
+			channel.name = findNextFreeChannelName(channel.name, &suffixHints);
+			freeNumber = findNextFreeChannelNumber(freeNumber);
+			channel.number = freeNumber;
+		}
+
+		DvbSharedChannel addedChannel = insertChannel(channel);
+
+		if (addedChannel.isValid()) {
+			addedChannels.append(addedChannel);
+		}
+	}
+
+	if (!addedChannels.isEmpty()) {
+		emit channelsAdded(addedChannels);
+	}
+}
+
+DvbSharedChannel DvbChannelModel::insertChannel(DvbChannel &channel)
+{
 	if (hasPendingOperation) {
 		qCWarning(logDvb, "Illegal recursive call");
-		return;
+		return DvbSharedChannel();
 	}
 
 	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
@@ -384,11 +453,12 @@ void DvbChannelModel::addChannel(DvbChannel &channel)
 	channelIds.insert(DvbChannelId(newChannel), newChannel);
 
 	if (isSqlModel) {
+		// the statements are submitted together in one transaction
 		channels.insert(*newChannel, newChannel);
 		sqlInsert(*newChannel);
 	}
 
-	emit channelAdded(newChannel);
+	return newChannel;
 }
 
 void DvbChannelModel::updateChannel(DvbSharedChannel channel, DvbChannel &modifiedChannel)
@@ -565,7 +635,7 @@ void DvbChannelModel::dndMoveChannels(const QList<DvbSharedChannel> &selectedCha
 	}
 }
 
-void DvbChannelModel::bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index) const
+void DvbChannelModel::appendSqlValues(SqlKey sqlKey, QVariantList &values) const
 {
 	DvbSharedChannel channel = channels.value(sqlKey);
 
@@ -574,16 +644,16 @@ void DvbChannelModel::bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index)
 		return;
 	}
 
-	query.bindValue(index++, channel->name);
-	query.bindValue(index++, channel->number);
-	query.bindValue(index++, channel->source);
-	query.bindValue(index++, channel->transponder.toString());
-	query.bindValue(index++, channel->networkId);
-	query.bindValue(index++, channel->transportStreamId);
-	query.bindValue(index++, channel->pmtPid);
-	query.bindValue(index++, channel->pmtSectionData);
-	query.bindValue(index++, channel->audioPid);
-	query.bindValue(index++, (channel->hasVideo ? 0x01 : 0) |
+	values.append(channel->name);
+	values.append(channel->number);
+	values.append(channel->source);
+	values.append(channel->transponder.toString());
+	values.append(channel->networkId);
+	values.append(channel->transportStreamId);
+	values.append(channel->pmtPid);
+	values.append(channel->pmtSectionData);
+	values.append(channel->audioPid);
+	values.append((channel->hasVideo ? 0x01 : 0) |
 		(channel->isScrambled ? 0x02 : 0));
 }
 
@@ -642,7 +712,8 @@ QString DvbChannelModel::extractBaseName(const QString &name) const
 	return baseName;
 }
 
-QString DvbChannelModel::findNextFreeChannelName(const QString &name) const
+QString DvbChannelModel::findNextFreeChannelName(const QString &name,
+	QHash<QString, int> *suffixHints) const
 {
 	if (!channelNames.contains(name)) {
 		return name;
@@ -652,11 +723,23 @@ QString DvbChannelModel::findNextFreeChannelName(const QString &name) const
 	int suffix = 0;
 	QString newName = baseName;
 
+	if (suffixHints != NULL) {
+		suffix = suffixHints->value(baseName, 0);
+
+		if (suffix > 0) {
+			newName = baseName + QLatin1Char('-') + QString::number(suffix);
+		}
+	}
+
 	while (channelNames.contains(newName)) {
 		++suffix;
 		newName = baseName + QLatin1Char('-') + QString::number(suffix);
 	}
 
+	if (suffixHints != NULL) {
+		suffixHints->insert(baseName, suffix);
+	}
+
 	return newName;
 }
 
@@ -21,6 +21,7 @@
 #ifndef DVBCHANNEL_H
 #define DVBCHANNEL_H
 
+#include <QHash>
 #include <QObject>
 #include <QMultiHash>
 #include "../shareddata.h"
@@ -102,6 +103,8 @@ public:
 
 	void cloneFrom(DvbChannelModel *other);
 	void addChannel(DvbChannel &channel);
+	// equivalent to calling addChannel() for each channel, but notifies once
+	void addChannels(const QList<DvbChannel> &newChannels);
 	void updateChannel(DvbSharedChannel channel, DvbChannel &modifiedChannel);
 	void removeChannel(DvbSharedChannel channel);
 	bool areInTheSameBunch(DvbSharedChannel channel1, DvbSharedChannel channel2);
@@ -111,6 +114,7 @@ public:
 
 signals:
 	void channelAdded(const DvbSharedChannel &channel);
+	void channelsAdded(const QList<DvbSharedChannel> &channels);
 	// if this is the main model, updating doesn't change the channel pointer
 	// (modifies existing content); otherwise the channel pointer may be updated
 	void channelAboutToBeUpdated(const DvbSharedChannel &channel);
@@ -118,11 +122,15 @@ signals:
 	void channelRemoved(const DvbSharedChannel &channel);
 
 private:
-	void bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index) const override;
+	void appendSqlValues(SqlKey sqlKey, QVariantList &values) const override;
 	bool insertFromSqlQuery(SqlKey sqlKey, const QSqlQuery &query, int index) override;
 
+	DvbSharedChannel insertChannel(DvbChannel &channel);
 	QString extractBaseName(const QString &name) const;
-	QString findNextFreeChannelName(const QString &name) const;
+	// suffixHints (base name -> highest suffix known to be in use) avoids
+	// probing the same suffixes again and again
+	QString findNextFreeChannelName(const QString &name,
+		QHash<QString, int> *suffixHints = NULL) const;
 	int findNextFreeChannelNumber(int number) const;
 
 	QMap<QString, DvbSharedChannel> channelNames;
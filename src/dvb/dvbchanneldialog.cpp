@@ -91,6 +91,8 @@ void DvbChannelTableModel::setChannelModel(DvbChannelModel *channelModel_)
 	channelModel = channelModel_;
 	connect(channelModel, SIGNAL(channelAdded(DvbSharedChannel)),
 		this, SLOT(channelAdded(DvbSharedChannel)));
+	connect(channelModel, SIGNAL(channelsAdded(QList<DvbSharedChannel>)),
+		this, SLOT(channelsAdded(QList<DvbSharedChannel>)));
 	connect(channelModel, SIGNAL(channelAboutToBeUpdated(DvbSharedChannel)),
 		this, SLOT(channelAboutToBeUpdated(DvbSharedChannel)));
 	connect(channelModel, SIGNAL(channelUpdated(DvbSharedChannel)),
@@ -250,6 +252,11 @@ void DvbChannelTableModel::channelAdded(const DvbSharedChannel &channel)
 	insert(channel);
 }
 
+void DvbChannelTableModel::channelsAdded(const QList<DvbSharedChannel> &channels)
+{
+	insertItems(channels);
+}
+
 void DvbChannelTableModel::channelAboutToBeUpdated(const DvbSharedChannel &channel)
 {
 	aboutToUpdate(channel);
@@ -117,6 +117,7 @@ signals:
 
 private slots:
 	void channelAdded(const DvbSharedChannel &channel);
+	void channelsAdded(const QList<DvbSharedChannel> &channels);
 	void channelAboutToBeUpdated(const DvbSharedChannel &channel);
 	void channelUpdated(const DvbSharedChannel &channel);
 	void channelRemoved(const DvbSharedChannel &channel);
@@ -173,6 +173,37 @@ DvbConfigDialog::DvbConfigDialog(DvbManager *manager_, QWidget *parent) : QDialo
 	createInfoFileBox->setChecked(manager->createInfoFile());
 	gridLayout->addWidget(createInfoFileBox, 2, 1);
 
+	gridLayout->addWidget(new QLabel(i18n("Pre-tune neighbouring channels on idle devices:")),
+		4, 0);
+	predictiveZapBox = new QCheckBox(widget);
+	predictiveZapBox->setChecked(manager->isPredictiveZap());
+	predictiveZapBox->setToolTip(i18n("Allows switching to the previous or next channel without waiting for the device to tune. The devices are released as soon as a recording needs them."));
+	gridLayout->addWidget(predictiveZapBox, 4, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Record the whole transponder:")), 5, 0);
+	muxRecordingBox = new QCheckBox(widget);
+	muxRecordingBox->setChecked(manager->isMuxRecording());
+	muxRecordingBox->setToolTip(i18n("Simultaneous recordings on the same transponder share a single stream. The recorded programs are extracted when each recording ends."));
+	gridLayout->addWidget(muxRecordingBox, 5, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Network streaming port (0 = disabled):")), 6, 0);
+	streamServerPortBox = new QSpinBox(widget);
+	streamServerPortBox->setRange(0, 65535);
+	streamServerPortBox->setValue(manager->getStreamServerPort());
+	streamServerPortBox->setToolTip(i18n("Channels can be watched with any player at http://localhost:port/channel/number; http://localhost:port/playlist.m3u lists all channels."));
+	gridLayout->addWidget(streamServerPortBox, 6, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Allow streaming to other computers:")), 7, 0);
+	streamServerRemoteBox = new QCheckBox(widget);
+	streamServerRemoteBox->setChecked(manager->isStreamServerRemote());
+	gridLayout->addWidget(streamServerRemoteBox, 7, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Collect EPG data on idle devices:")), 8, 0);
+	epgHarvestingBox = new QCheckBox(widget);
+	epgHarvestingBox->setChecked(manager->isEpgHarvesting());
+	epgHarvestingBox->setToolTip(i18n("Idle devices visit all transponders in turn to fill the program guide. The devices are released as soon as they are needed otherwise."));
+	gridLayout->addWidget(epgHarvestingBox, 8, 1);
+
 #if 0
 	// FIXME: this functionality is not working. Comment it out
 
@@ -580,6 +611,10 @@ void DvbConfigDialog::accept()
 	manager->setOverride6937Charset(override6937CharsetBox->isChecked());
 	manager->setCreateInfoFile(createInfoFileBox->isChecked());
 	manager->setDisableEpg(disableEpgBox->isChecked());
+	manager->setPredictiveZap(predictiveZapBox->isChecked());
+	manager->setEpgHarvesting(epgHarvestingBox->isChecked());
+	manager->setMuxRecording(muxRecordingBox->isChecked());
+	manager->setStreamServer(streamServerPortBox->value(), streamServerRemoteBox->isChecked());
 #if 0
 	manager->setScanWhenIdle(scanWhenIdleBox->isChecked());
 #endif
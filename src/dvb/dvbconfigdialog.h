@@ -109,6 +109,11 @@ private:
 	QCheckBox *createInfoFileBox;
 	QCheckBox *disableEpgBox;
 	QCheckBox *scanWhenIdleBox;
+	QCheckBox *predictiveZapBox;
+	QCheckBox *epgHarvestingBox;
+	QCheckBox *muxRecordingBox;
+	QSpinBox *streamServerPortBox;
+	QCheckBox *streamServerRemoteBox;
 	QPixmap validPixmap;
 	QPixmap invalidPixmap;
 	QLabel *namingFormatValidLabel;
@@ -19,15 +19,19 @@
  */
 
 #include "../log.h"
+#include "../metrics.h"
+#include "../tracing.h"
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QSet>
 
 #if QT_VERSION >= 0x050a00
 #  include <QRandomGenerator>
 #endif
 #include <unistd.h>
 
+#include <algorithm>
 #include <cmath>
 
 #include "dvbconfig.h"
@@ -35,6 +39,7 @@
 #include "dvbdevice_p.h"
 #include "dvbmanager.h"
 #include "dvbsi.h"
+#include "dvbtuningcache.h"
 
 class DvbFilterInternal
 {
@@ -43,22 +48,32 @@ public:
 	~DvbFilterInternal() { }
 
 	QList<DvbPidFilter *> filters;
+	QList<DvbDevice::FilterPriority> priorities; // same order as filters
 	int activeFilters;
 };
 
 class DvbSectionFilterInternal : public DvbPidFilter
 {
 public:
-	DvbSectionFilterInternal() : activeSectionFilters(0), continuityCounter(0),
-		wrongCrcIndex(0), bufferValid(false)
+	DvbSectionFilterInternal() : activeSectionFilters(0), native(false), tableId(0),
+		tableIdMask(0), continuityCounter(0), wrongCrcIndex(0), bufferValid(false)
 	{
 		memset(wrongCrcs, 0, sizeof(wrongCrcs));
 	}
 
 	~DvbSectionFilterInternal() { }
 
+	void processNativeSection(const QByteArray &section) const;
+	DvbDevice::FilterPriority getPriority() const;
+
 	QList<DvbSectionFilter *> sectionFilters;
+	QList<DvbDevice::FilterPriority> priorities; // same order as sectionFilters
+	QList<QList<int> > tableIdExtensions; // same order as sectionFilters; empty = all
 	int activeSectionFilters;
+	bool native; // filtered by the backend instead of reassembled from ts packets
+	int tableId; // native filter
+	int tableIdMask;
+	QList<int> nativeTableIdExtensions; // empty = all
 
 private:
 	void processData(const char [188]) override;
@@ -71,6 +86,26 @@ private:
 	int wrongCrcs[8];
 };
 
+void DvbSectionFilterInternal::processNativeSection(const QByteArray &section) const
+{
+	// the backend has already checked the crc
+	for (int i = 0; i < sectionFilters.size(); ++i) {
+		sectionFilters.at(i)->processSection(section.constData(), section.size());
+	}
+}
+
+DvbDevice::FilterPriority DvbSectionFilterInternal::getPriority() const
+{
+	// removed filters have the lowest priority
+	DvbDevice::FilterPriority priority = DvbDevice::DumpPriority;
+
+	for (int i = 0; i < priorities.size(); ++i) {
+		priority = qMax(priority, priorities.at(i));
+	}
+
+	return priority;
+}
+
 // FIXME some debug messages may be printed too often
 
 void DvbSectionFilterInternal::processData(const char data[188])
@@ -145,6 +180,7 @@ void DvbSectionFilterInternal::processData(const char data[188])
 
 void DvbSectionFilterInternal::processSections(bool force)
 {
+	KAFFEINE_TRACE_SCOPE("DvbSectionFilterInternal::processSections");
 	const char *it = buffer.constBegin();
 	const char *end = buffer.constEnd();
 
@@ -249,14 +285,47 @@ void DvbDataDumper::processData(const char data[188])
 	write(data, 188);
 }
 
-DvbDevice::DvbDevice(DvbBackendDevice *backend_, QObject *parent) : QObject(parent),
-	backend(backend_), deviceState(DeviceReleased), dataDumper(NULL), cleanUpFilters(false),
-	isAuto(false), unusedBuffersHead(NULL), usedBuffersHead(NULL), usedBuffersTail(NULL)
+DvbDevice::DvbDevice(DvbBackendDevice *backend_, DvbTuningCache *tuningCache_, QObject *parent) :
+	QObject(parent), backend(backend_), deviceState(DeviceReleased), dataDumper(NULL),
+	cleanUpFilters(false), isAuto(false), autoFrequency(0), tuningCache(tuningCache_),
+	unusedBuffersHead(NULL), usedBuffersHead(NULL), usedBuffersTail(NULL), usedBuffersCount(0),
+	shedPriority(DumpPriority)
 {
 	backend->setFrontendDevice(this);
 	backend->setDeviceEnabled(true); // FIXME
 
 	connect(&frontendTimer, SIGNAL(timeout()), this, SLOT(frontendEvent()));
+	arrivalTimer.start();
+
+	// shared between all devices
+	packetsCounter = Metrics::instance()->counter(
+		QLatin1String("kaffeine_dvb_packets_total"),
+		QLatin1String("Transport stream packets received from all devices"));
+	allocatedBuffersGauge = Metrics::instance()->gauge(
+		QLatin1String("kaffeine_dvb_buffers_allocated"),
+		QLatin1String("Data buffers allocated by all devices"));
+	usedBuffersGauge = Metrics::instance()->gauge(
+		QLatin1String("kaffeine_dvb_buffers_used"),
+		QLatin1String("Data buffers waiting to be demultiplexed"));
+	descramblingLatencyHistogram = Metrics::instance()->histogram(
+		QLatin1String("kaffeine_cam_descrambling_latency_ms"),
+		QLatin1String("Time from the start of descrambling until the first clear packet"),
+		QList<qint64>() << 100 << 250 << 500 << 1000 << 2000 << 5000 << 10000);
+	shedPacketsCounters[DumpPriority] = Metrics::instance()->counter(
+		QLatin1String("kaffeine_dvb_shed_dump_packets_total"),
+		QLatin1String("Packets not written to the dump file because the demux fell behind"));
+	shedPacketsCounters[EpgPriority] = Metrics::instance()->counter(
+		QLatin1String("kaffeine_dvb_shed_epg_packets_total"),
+		QLatin1String("Packets not passed to epg filters because the demux fell behind"));
+	shedPacketsCounters[PmtPriority] = Metrics::instance()->counter(
+		QLatin1String("kaffeine_dvb_shed_pmt_packets_total"),
+		QLatin1String("Packets not passed to pmt and scan filters because the demux fell behind"));
+	shedPacketsCounters[LiveViewPriority] = Metrics::instance()->counter(
+		QLatin1String("kaffeine_dvb_shed_live_view_packets_total"),
+		QLatin1String("Packets not passed to live view and streaming filters because the demux fell behind"));
+	shedSectionsCounter = Metrics::instance()->counter(
+		QLatin1String("kaffeine_dvb_shed_sections_total"),
+		QLatin1String("Sections filtered by the backend and dropped because the demux fell behind"));
 }
 
 DvbDevice::~DvbDevice()
@@ -266,12 +335,15 @@ DvbDevice::~DvbDevice()
 	for (DvbDeviceDataBuffer *buffer = unusedBuffersHead; buffer != NULL;) {
 		DvbDeviceDataBuffer *nextBuffer = buffer->next;
 		delete buffer;
+		allocatedBuffersGauge->add(-1);
 		buffer = nextBuffer;
 	}
 
 	for (DvbDeviceDataBuffer *buffer = usedBuffersHead; buffer != NULL;) {
 		DvbDeviceDataBuffer *nextBuffer = buffer->next;
 		delete buffer;
+		allocatedBuffersGauge->add(-1);
+		usedBuffersGauge->add(-1);
 		buffer = nextBuffer;
 	}
 }
@@ -293,6 +365,8 @@ QString DvbDevice::getFrontendName() const
 
 void DvbDevice::tune(const DvbTransponder &transponder)
 {
+	tsAnalyzer.reset();
+
 	DvbTransponderBase::TransmissionType transmissionType = transponder.getTransmissionType();
 
 	autoTransponder.setTransmissionType(transmissionType);
@@ -303,6 +377,7 @@ void DvbDevice::tune(const DvbTransponder &transponder)
 			setDeviceState(DeviceTuning);
 			frontendTimeout = config->timeout;
 			frontendTimer.start(100);
+			tuningTimer.start();
 			discardBuffers();
 		} else {
 			setDeviceState(DeviceTuning);
@@ -402,6 +477,7 @@ void DvbDevice::tune(const DvbTransponder &transponder)
 		}
 
 		frontendTimer.start(100);
+		tuningTimer.start();
 		discardBuffers();
 	} else {
 		setDeviceState(DeviceTuning);
@@ -417,36 +493,19 @@ void DvbDevice::autoTune(const DvbTransponder &transponder)
 	autoTransponder = transponder;
 
 	if (transmissionType == DvbTransponderBase::DvbT) {
-		DvbTTransponder *autoTTransponder = autoTransponder.as<DvbTTransponder>();
 		capabilities = backend->getCapabilities();
+		autoFrequency = autoTransponder.as<DvbTTransponder>()->frequency;
 
-		// we have to iterate over unsupported AUTO values
+		// we have to iterate over unsupported AUTO values; the tuning cache
+		// knows which combinations are worth trying first
 
-		if ((capabilities & DvbTFecAuto) == 0) {
-			autoTTransponder->fecRateHigh = DvbTTransponder::Fec2_3;
-		}
-
-		if ((capabilities & DvbTGuardIntervalAuto) == 0) {
-			autoTTransponder->guardInterval = DvbTTransponder::GuardInterval1_8;
-		}
-
-		if ((capabilities & DvbTModulationAuto) == 0) {
-			autoTTransponder->modulation = DvbTTransponder::Qam64;
-		}
-
-		if ((capabilities & DvbTTransmissionModeAuto) == 0) {
-			autoTTransponder->transmissionMode = DvbTTransponder::TransmissionMode8k;
-		}
-		isAuto = true;
-		tune(autoTransponder);
+		autoCandidates = tuningCache->getCandidates(config->scanSource, autoTransponder,
+			capabilities);
+		autoTransponder = autoCandidates.takeFirst();
 	} else if (transmissionType == DvbTransponderBase::DvbT2) {
 		// I guess all DVB-T2 devices support auto-detection
-		isAuto = true;
-		tune(autoTransponder);
 	} else if (transmissionType == DvbTransponderBase::IsdbT) {
 		// ISDB-T Currently, all ISDB-T tuners should support auto mode
-		isAuto = true;
-		tune(autoTransponder);
 	} else {
 		qCWarning(logDev, "Can't do auto-tune for %d", transmissionType);
 		return;
@@ -456,20 +515,21 @@ void DvbDevice::autoTune(const DvbTransponder &transponder)
 	tune(autoTransponder);
 }
 
-bool DvbDevice::addPidFilter(int pid, DvbPidFilter *filter)
+bool DvbDevice::addPidFilter(int pid, DvbPidFilter *filter, FilterPriority priority)
 {
 	QMap<int, DvbFilterInternal>::iterator it = filters.find(pid);
 
 	if (it == filters.end()) {
 		it = filters.insert(pid, DvbFilterInternal());
 
-		if (dataDumper != NULL) {
+		if ((dataDumper != NULL) && (pid != FullTsPid)) {
 			it->filters.append(dataDumper);
+			it->priorities.append(DumpPriority);
 		}
 	}
 
 	if (it->activeFilters == 0) {
-		if (!backend->addPidFilter(pid)) {
+		if (!addBackendPidFilter(pid)) {
 			cleanUpFilters = true;
 			return false;
 		}
@@ -481,11 +541,18 @@ bool DvbDevice::addPidFilter(int pid, DvbPidFilter *filter)
 	}
 
 	it->filters.append(filter);
+	it->priorities.append(priority);
 	++it->activeFilters;
 	return true;
 }
 
-bool DvbDevice::addSectionFilter(int pid, DvbSectionFilter *filter)
+bool DvbDevice::addSectionFilter(int pid, DvbSectionFilter *filter, FilterPriority priority)
+{
+	return addSectionFilter(pid, filter, priority, QList<int>());
+}
+
+bool DvbDevice::addSectionFilter(int pid, DvbSectionFilter *filter, FilterPriority priority,
+	const QList<int> &tableIdExtensions)
 {
 	QMap<int, DvbSectionFilterInternal>::iterator it = sectionFilters.find(pid);
 
@@ -494,7 +561,40 @@ bool DvbDevice::addSectionFilter(int pid, DvbSectionFilter *filter)
 	}
 
 	if (it->activeSectionFilters == 0) {
-		if (!addPidFilter(pid, &(*it))) {
+		// let the kernel filter the (often heavy) si pids if possible; the table id
+		// filter is only a coarse pre-selection, the section filters check it again
+		int tableId = 0;
+		int tableIdMask = 0;
+
+		switch (pid) {
+		case 0x0000: // pat
+			tableId = 0x00;
+			tableIdMask = 0xff;
+			break;
+		case 0x0010: // nit (actual / other)
+			tableId = 0x40;
+			tableIdMask = 0xfe;
+			break;
+		case 0x0012: // eit (0x4e - 0x6f)
+			tableId = 0x40;
+			tableIdMask = 0xc0;
+			break;
+		}
+
+		it->tableId = tableId;
+		it->tableIdMask = tableIdMask;
+		it->nativeTableIdExtensions = tableIdExtensions;
+
+		if (tableIdExtensions.size() > MaxTableIdExtensions) {
+			it->nativeTableIdExtensions.clear();
+		}
+
+		if (((backend->getCapabilities() & NativeSectionFilters) != 0) &&
+		    (dataDumper == NULL) &&
+		    backend->addSectionFilter(pid, tableId, tableIdMask,
+			it->nativeTableIdExtensions)) {
+			it->native = true;
+		} else if (!addPidFilter(pid, &(*it), priority)) {
 			cleanUpFilters = true;
 			return false;
 		}
@@ -506,7 +606,16 @@ bool DvbDevice::addSectionFilter(int pid, DvbSectionFilter *filter)
 	}
 
 	it->sectionFilters.append(filter);
+	it->priorities.append(priority);
+	it->tableIdExtensions.append(tableIdExtensions);
 	++it->activeSectionFilters;
+
+	if (it->native) {
+		updateNativeSectionFilter(pid, &(*it));
+	} else {
+		updateSectionFilterPriority(pid, &(*it));
+	}
+
 	return true;
 }
 
@@ -527,10 +636,12 @@ void DvbDevice::removePidFilter(int pid, DvbPidFilter *filter)
 	}
 
 	it->filters.replace(index, &dummyPidFilter);
+	// the dummy filter is cheap, so it's never skipped
+	it->priorities.replace(index, RecordingPriority);
 	--it->activeFilters;
 
 	if (it->activeFilters == 0) {
-		backend->removePidFilter(pid);
+		removeBackendPidFilter(pid);
 	}
 
 	cleanUpFilters = true;
@@ -553,10 +664,20 @@ void DvbDevice::removeSectionFilter(int pid, DvbSectionFilter *filter)
 	}
 
 	it->sectionFilters.replace(index, &dummySectionFilter);
+	it->priorities.replace(index, DumpPriority);
 	--it->activeSectionFilters;
 
 	if (it->activeSectionFilters == 0) {
-		removePidFilter(pid, &(*it));
+		if (it->native) {
+			it->native = false;
+			backend->removeSectionFilter(pid);
+		} else {
+			removePidFilter(pid, &(*it));
+		}
+	} else if (it->native) {
+		updateNativeSectionFilter(pid, &(*it));
+	} else {
+		updateSectionFilterPriority(pid, &(*it));
 	}
 
 	cleanUpFilters = true;
@@ -574,6 +695,17 @@ void DvbDevice::startDescrambling(const QByteArray &pmtSectionData, QObject *use
 
 	if (!descramblingServices.contains(serviceId)) {
 		backend->startDescrambling(pmtSectionData);
+
+		if (pmtSection.isValid()) {
+			// measured until the first clear packet of one of the streams
+			stopDescramblingMeasurement(serviceId);
+			descramblingStarts.insert(serviceId, arrivalTimer.nsecsElapsed());
+
+			for (DvbPmtSectionEntry entry = pmtSection.entries(); entry.isValid();
+			     entry.advance()) {
+				descramblingPids.insert(entry.pid(), serviceId);
+			}
+		}
 	}
 
 	if (!descramblingServices.contains(serviceId, user)) {
@@ -600,6 +732,116 @@ void DvbDevice::stopDescrambling(const QByteArray &pmtSectionData, QObject *user
 
 	if (!descramblingServices.contains(serviceId)) {
 		backend->stopDescrambling(serviceId);
+		stopDescramblingMeasurement(serviceId);
+	}
+}
+
+void DvbDevice::stopDescramblingMeasurement(int serviceId)
+{
+	if (descramblingStarts.remove(serviceId) == 0) {
+		return;
+	}
+
+	QMap<int, int>::iterator it = descramblingPids.begin();
+
+	while (it != descramblingPids.end()) {
+		if (it.value() == serviceId) {
+			it = descramblingPids.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void DvbDevice::updateSectionFilterPriority(int pid, DvbSectionFilterInternal *sectionFilter)
+{
+	// the reassembly runs with the highest priority of the attached section filters
+	QMap<int, DvbFilterInternal>::iterator it = filters.find(pid);
+
+	if (it != filters.end()) {
+		int index = it->filters.indexOf(sectionFilter);
+
+		if (index >= 0) {
+			it->priorities.replace(index, sectionFilter->getPriority());
+		}
+	}
+}
+
+QList<int> DvbDevice::getTableIdExtensions(const DvbSectionFilterInternal *sectionFilter) const
+{
+	// returns an empty list if every table id extension is needed
+	QSet<int> extensions;
+
+	for (int i = 0; i < sectionFilter->sectionFilters.size(); ++i) {
+		if (sectionFilter->sectionFilters.at(i) == &dummySectionFilter) {
+			continue;
+		}
+
+		const QList<int> &filterExtensions = sectionFilter->tableIdExtensions.at(i);
+
+		if (filterExtensions.isEmpty()) {
+			return QList<int>();
+		}
+
+		extensions.unite(QSet<int>(filterExtensions.constBegin(), filterExtensions.constEnd()));
+	}
+
+	if (extensions.size() > MaxTableIdExtensions) {
+		return QList<int>();
+	}
+
+	QList<int> sortedExtensions(extensions.constBegin(), extensions.constEnd());
+	std::sort(sortedExtensions.begin(), sortedExtensions.end());
+	return sortedExtensions;
+}
+
+void DvbDevice::updateNativeSectionFilter(int pid, DvbSectionFilterInternal *sectionFilter)
+{
+	QList<int> extensions = getTableIdExtensions(sectionFilter);
+	QList<int> nativeExtensions = sectionFilter->nativeTableIdExtensions;
+	std::sort(nativeExtensions.begin(), nativeExtensions.end());
+
+	if (extensions == nativeExtensions) {
+		return;
+	}
+
+	backend->removeSectionFilter(pid);
+
+	if (backend->addSectionFilter(pid, sectionFilter->tableId, sectionFilter->tableIdMask,
+	    extensions)) {
+		sectionFilter->nativeTableIdExtensions = extensions;
+		return;
+	}
+
+	qCWarning(logDev, "Cannot update section filter for pid %d, reassembling sections", pid);
+	sectionFilter->native = false;
+
+	if (!addPidFilter(pid, sectionFilter, sectionFilter->getPriority())) {
+		cleanUpFilters = true;
+	}
+}
+
+void DvbDevice::updateShedPriority(int backlog)
+{
+	// backlog (in buffers) at which filters of the given priority are skipped;
+	// they are processed again once the backlog has dropped below the half
+	static const int shedThresholds[RecordingPriority] = { 512, 1024, 2048, 4096 };
+	int newShedPriority = shedPriority;
+
+	while ((newShedPriority < RecordingPriority) &&
+	       (backlog >= shedThresholds[newShedPriority])) {
+		++newShedPriority;
+	}
+
+	while ((newShedPriority > DumpPriority) &&
+	       (backlog < (shedThresholds[newShedPriority - 1] / 2))) {
+		--newShedPriority;
+	}
+
+	if (newShedPriority != shedPriority) {
+		qCInfo(logDev, "Demux backlog of %d buffers, skipping filters below priority %d",
+			backlog, newShedPriority);
+		shedPriority = newShedPriority;
 	}
 }
 
@@ -672,12 +914,20 @@ void DvbDevice::enableDvbDump()
 	QMap<int, DvbFilterInternal>::iterator end = filters.end();
 
 	for (; it != end; ++it) {
-		it->filters.append(dataDumper);
+		if (it.key() != FullTsPid) {
+			it->filters.append(dataDumper);
+			it->priorities.append(DumpPriority);
+		}
 	}
 
 	backend->enableDvbDump();
 }
 
+void DvbDevice::setReaderConfig(const DvbReaderConfig &readerConfig)
+{
+	backend->setReaderConfig(readerConfig);
+}
+
 void DvbDevice::frontendEvent()
 {
 	DvbTransponderBase::TransmissionType transmissionType = autoTransponder.getTransmissionType();
@@ -686,6 +936,12 @@ void DvbDevice::frontendEvent()
 		qCDebug(logDvb, "tuning succeeded on %.2f MHz", backend->getFrqMHz());
 		frontendTimer.stop();
 		backend->getProps(autoTransponder);
+
+		if (isAuto && (transmissionType == DvbTransponderBase::DvbT)) {
+			tuningCache->insert(config->scanSource, autoFrequency, autoTransponder,
+				int(tuningTimer.elapsed()));
+		}
+
 		setDeviceState(DeviceTuned);
 		return;
 	}
@@ -712,8 +968,6 @@ void DvbDevice::frontendEvent()
 		 */
 		if (transmissionType == DvbTransponderBase::DvbT) {
 			DvbBackendDevice::Scale scale;
-
-			DvbTTransponder *autoTTransponder = autoTransponder.as<DvbTTransponder>();
 			float signal = backend->getSignal(scale);
 
 			if ((scale != DvbBackendDevice::NotSupported) && (signal < 15)) {
@@ -733,97 +987,19 @@ void DvbDevice::frontendEvent()
 #endif
 			}
 
-			if (carry && ((capabilities & DvbTFecAuto) == 0)) {
-				switch (autoTTransponder->fecRateHigh) {
-				case DvbTTransponder::Fec2_3:
-					autoTTransponder->fecRateHigh = DvbTTransponder::Fec3_4;
-					carry = false;
-					break;
-				case DvbTTransponder::Fec3_4:
-					autoTTransponder->fecRateHigh = DvbTTransponder::Fec1_2;
-					carry = false;
-					break;
-				case DvbTTransponder::Fec1_2:
-					autoTTransponder->fecRateHigh = DvbTTransponder::Fec5_6;
-					carry = false;
-					break;
-				case DvbTTransponder::Fec5_6:
-					autoTTransponder->fecRateHigh = DvbTTransponder::Fec7_8;
-					carry = false;
-					break;
-				default:
-					autoTTransponder->fecRateHigh = DvbTTransponder::Fec2_3;
-					break;
-				}
-			}
-
-			if (carry && ((capabilities & DvbTGuardIntervalAuto) == 0)) {
-				switch (autoTTransponder->guardInterval) {
-				case DvbTTransponder::GuardInterval1_8:
-					autoTTransponder->guardInterval =
-						DvbTTransponder::GuardInterval1_32;
-					carry = false;
-					break;
-				case DvbTTransponder::GuardInterval1_32:
-					autoTTransponder->guardInterval =
-						DvbTTransponder::GuardInterval1_4;
-					carry = false;
-					break;
-				case DvbTTransponder::GuardInterval1_4:
-					autoTTransponder->guardInterval =
-						DvbTTransponder::GuardInterval1_16;
-					carry = false;
-					break;
-				case DvbTTransponder::GuardInterval1_16:
-				case DvbTTransponder::GuardIntervalAuto:
-					autoTTransponder->guardInterval =
-						DvbTTransponder::GuardInterval1_8;
-					break;
-				}
-			}
-
-			if (carry && ((capabilities & DvbTModulationAuto) == 0)) {
-				switch (autoTTransponder->modulation) {
-				case DvbTTransponder::Qam64:
-					autoTTransponder->modulation = DvbTTransponder::Qam16;
-					carry = false;
-					break;
-				case DvbTTransponder::Qam16:
-					autoTTransponder->modulation = DvbTTransponder::Qpsk;
-					carry = false;
-					break;
-				case DvbTTransponder::Qpsk:
-				case DvbTTransponder::ModulationAuto:
-					autoTTransponder->modulation = DvbTTransponder::Qam64;
-					break;
-				}
-			}
-
-			if (carry && ((capabilities & DvbTTransmissionModeAuto) == 0)) {
-				switch (autoTTransponder->transmissionMode) {
-				case DvbTTransponder::TransmissionMode8k:
-					autoTTransponder->transmissionMode =
-						DvbTTransponder::TransmissionMode2k;
-					carry = false;
-					break;
-				case DvbTTransponder::TransmissionMode2k:
-	/* outcommented so that clearly no compatibility problem arises
-					autoTTransponder->transmissionMode =
-						DvbTTransponder::TransmissionMode4k;
-					carry = false;
-					break;
-	*/
-				case DvbTTransponder::TransmissionMode4k:
-				case DvbTTransponder::TransmissionModeAuto:
-					autoTTransponder->transmissionMode =
-						DvbTTransponder::TransmissionMode8k;
-					break;
-				}
+			if (!autoCandidates.isEmpty()) {
+				autoTransponder = autoCandidates.takeFirst();
+				carry = false;
 			}
 		}
 
 		if (!carry) {
 			tune(autoTransponder);
+
+			if (deviceState == DeviceTuning) {
+				frontendTimeout = tuningCache->getTimeout(config->scanSource,
+					config->timeout);
+			}
 		} else {
 			qCDebug(logDvb, "tuning failed on %.2f MHz", backend->getFrqMHz());;
 			setDeviceState(DeviceIdle);
@@ -839,6 +1015,60 @@ void DvbDevice::setDeviceState(DeviceState newState)
 	}
 }
 
+bool DvbDevice::isFullTsActive() const
+{
+	QMap<int, DvbFilterInternal>::const_iterator it = filters.constFind(FullTsPid);
+	return ((it != filters.constEnd()) && (it->activeFilters > 0));
+}
+
+/*
+ * the kernel would deliver the packets twice if there was a pid filter in addition to
+ * the full transport stream filter, so the single pid filters are suspended meanwhile
+ */
+
+bool DvbDevice::addBackendPidFilter(int pid)
+{
+	if (pid == FullTsPid) {
+		if (!backend->addPidFilter(FullTsPid)) {
+			return false;
+		}
+
+		for (QMap<int, DvbFilterInternal>::ConstIterator it = filters.constBegin();
+		     it != filters.constEnd(); ++it) {
+			if ((it.key() != FullTsPid) && (it->activeFilters > 0)) {
+				backend->removePidFilter(it.key());
+			}
+		}
+
+		return true;
+	}
+
+	if (isFullTsActive()) {
+		return true;
+	}
+
+	return backend->addPidFilter(pid);
+}
+
+void DvbDevice::removeBackendPidFilter(int pid)
+{
+	if (pid == FullTsPid) {
+		for (QMap<int, DvbFilterInternal>::ConstIterator it = filters.constBegin();
+		     it != filters.constEnd(); ++it) {
+			if ((it.key() != FullTsPid) && (it->activeFilters > 0)) {
+				backend->addPidFilter(it.key());
+			}
+		}
+
+		backend->removePidFilter(FullTsPid);
+		return;
+	}
+
+	if (!isFullTsActive()) {
+		backend->removePidFilter(pid);
+	}
+}
+
 void DvbDevice::discardBuffers()
 {
 	dataChannelMutex.lock();
@@ -849,17 +1079,30 @@ void DvbDevice::discardBuffers()
 		usedBuffersHead->next = NULL;
 
 		if (nextBuffer != NULL) {
-			nextBuffer->next = unusedBuffersHead;
+			DvbDeviceDataBuffer *lastBuffer = nextBuffer;
+			usedBuffersGauge->add(-1);
+
+			while (lastBuffer->next != NULL) {
+				lastBuffer = lastBuffer->next;
+				usedBuffersGauge->add(-1);
+			}
+
+			lastBuffer->next = unusedBuffersHead;
 			unusedBuffersHead = nextBuffer;
 		}
+
+		usedBuffersTail = usedBuffersHead;
+		usedBuffersCount = 1;
 	}
 
+	pendingSections.clear();
 	dataChannelMutex.unlock();
 }
 
 void DvbDevice::stop()
 {
 	isAuto = false;
+	autoCandidates.clear();
 	frontendTimer.stop();
 
 	for (QMap<int, DvbFilterInternal>::ConstIterator it = filters.constBegin();
@@ -896,6 +1139,7 @@ DvbDataBuffer DvbDevice::getBuffer()
 	} else {
 		dataChannelMutex.unlock();
 		buffer = new DvbDeviceDataBuffer;
+		allocatedBuffersGauge->add(1);
 	}
 
 	return DvbDataBuffer(buffer->data, sizeof(buffer->data));
@@ -908,6 +1152,7 @@ void DvbDevice::writeBuffer(const DvbDataBuffer &dataBuffer)
 
 	if (dataBuffer.dataSize > 0) {
 		buffer->size = dataBuffer.dataSize;
+		buffer->timestamp = arrivalTimer.nsecsElapsed();
 		dataChannelMutex.lock();
 		bool wakeUp = false;
 
@@ -920,7 +1165,9 @@ void DvbDevice::writeBuffer(const DvbDataBuffer &dataBuffer)
 
 		usedBuffersTail = buffer;
 		usedBuffersTail->next = NULL;
+		++usedBuffersCount;
 		dataChannelMutex.unlock();
+		usedBuffersGauge->add(1);
 
 		if (wakeUp) {
 			QCoreApplication::postEvent(this, new QEvent(QEvent::User));
@@ -933,8 +1180,22 @@ void DvbDevice::writeBuffer(const DvbDataBuffer &dataBuffer)
 	}
 }
 
+void DvbDevice::writeSection(int pid, const QByteArray &section)
+{
+	dataChannelMutex.lock();
+	bool wakeUp = (pendingSections.isEmpty() && (usedBuffersHead == NULL));
+	pendingSections.append(qMakePair(pid, section));
+	dataChannelMutex.unlock();
+
+	if (wakeUp) {
+		QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+	}
+}
+
 void DvbDevice::customEvent(QEvent *)
 {
+	KAFFEINE_TRACE_SCOPE("DvbDevice::customEvent");
+
 	if (cleanUpFilters) {
 		cleanUpFilters = false;
 
@@ -946,7 +1207,13 @@ void DvbDevice::customEvent(QEvent *)
 				if (it->activeFilters == 0) {
 					it = filters.erase(it);
 				} else {
-					it->filters.removeAll(&dummyPidFilter);
+					for (int i = (it->filters.size() - 1); i >= 0; --i) {
+						if (it->filters.at(i) == &dummyPidFilter) {
+							it->filters.removeAt(i);
+							it->priorities.removeAt(i);
+						}
+					}
+
 					++it;
 				}
 			}
@@ -960,7 +1227,14 @@ void DvbDevice::customEvent(QEvent *)
 				if (it->activeSectionFilters == 0) {
 					it = sectionFilters.erase(it);
 				} else {
-					it->sectionFilters.removeAll(&dummySectionFilter);
+					for (int i = (it->sectionFilters.size() - 1); i >= 0; --i) {
+						if (it->sectionFilters.at(i) == &dummySectionFilter) {
+							it->sectionFilters.removeAt(i);
+							it->priorities.removeAt(i);
+							it->tableIdExtensions.removeAt(i);
+						}
+					}
+
 					++it;
 				}
 			}
@@ -968,6 +1242,7 @@ void DvbDevice::customEvent(QEvent *)
 	}
 
 	DvbDeviceDataBuffer *buffer = NULL;
+	qint64 shedPackets[RecordingPriority] = { 0 };
 
 	while (true) {
 		dataChannelMutex.lock();
@@ -976,26 +1251,70 @@ void DvbDevice::customEvent(QEvent *)
 			usedBuffersHead = buffer->next;
 			buffer->next = unusedBuffersHead;
 			unusedBuffersHead = buffer;
+			--usedBuffersCount;
+			usedBuffersGauge->add(-1);
 		}
 
 		buffer = usedBuffersHead;
+		int backlog = usedBuffersCount;
 		dataChannelMutex.unlock();
 
 		if (buffer == NULL) {
 			break;
 		}
 
+		updateShedPriority(backlog);
+
+		packetsCounter->increment(buffer->size / 188);
+
+		QMap<int, DvbFilterInternal>::const_iterator fullTsIt = filters.constFind(FullTsPid);
+
 		for (int i = 0; i < buffer->size; i += 188) {
 			char *packet = (buffer->data + i);
+			tsAnalyzer.processPacket(packet, buffer->timestamp);
 
 			if ((packet[1] & 0x80) != 0) {
 				// transport error indicator
 				continue;
 			}
 
+			if (fullTsIt != filters.constEnd()) {
+				const QList<DvbPidFilter *> &fullTsFilters = fullTsIt->filters;
+				int fullTsFiltersSize = fullTsFilters.size();
+
+				for (int j = 0; j < fullTsFiltersSize; ++j) {
+					FilterPriority priority = fullTsIt->priorities.at(j);
+
+					if (priority >= shedPriority) {
+						fullTsFilters.at(j)->processData(packet);
+					} else {
+						++shedPackets[priority];
+					}
+				}
+			}
+
 			int pid = ((static_cast<unsigned char>(packet[1]) << 8) |
 				static_cast<unsigned char>(packet[2])) & ((1 << 13) - 1);
 
+			if (!descramblingPids.isEmpty() && ((packet[3] & 0xd0) == 0x10)) {
+				// payload present and transport scrambling control is zero
+				QMap<int, int>::const_iterator descramblingIt =
+					descramblingPids.constFind(pid);
+
+				if (descramblingIt != descramblingPids.constEnd()) {
+					int serviceId = descramblingIt.value();
+					qint64 start = descramblingStarts.value(serviceId);
+
+					if (buffer->timestamp >= start) {
+						qint64 latency = (buffer->timestamp - start) / 1000000;
+						descramblingLatencyHistogram->observe(latency);
+						qCDebug(logDev, "First clear packet of service %d after %lld ms",
+							serviceId, latency);
+						stopDescramblingMeasurement(serviceId);
+					}
+				}
+			}
+
 			QMap<int, DvbFilterInternal>::const_iterator it = filters.constFind(pid);
 
 			if (it == filters.constEnd()) {
@@ -1006,10 +1325,50 @@ void DvbDevice::customEvent(QEvent *)
 			int pidFiltersSize = pidFilters.size();
 
 			for (int j = 0; j < pidFiltersSize; ++j) {
-				pidFilters.at(j)->processData(packet);
+				FilterPriority priority = it->priorities.at(j);
+
+				if (priority >= shedPriority) {
+					pidFilters.at(j)->processData(packet);
+				} else {
+					++shedPackets[priority];
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < RecordingPriority; ++i) {
+		if (shedPackets[i] != 0) {
+			shedPacketsCounters[i]->increment(shedPackets[i]);
+		}
+	}
+
+	dataChannelMutex.lock();
+	QList<QPair<int, QByteArray> > sections;
+	sections.swap(pendingSections);
+	int backlog = usedBuffersCount;
+	dataChannelMutex.unlock();
+
+	// buffers which have arrived while the sections were queued count as well
+	updateShedPriority(backlog);
+	qint64 shedSections = 0;
+
+	for (int i = 0; i < sections.size(); ++i) {
+		const QPair<int, QByteArray> &section = sections.at(i);
+		QMap<int, DvbSectionFilterInternal>::const_iterator it =
+			sectionFilters.constFind(section.first);
+
+		if ((it != sectionFilters.constEnd()) && it->native) {
+			if (it->getPriority() >= shedPriority) {
+				it->processNativeSection(section.second);
+			} else {
+				++shedSections;
 			}
 		}
 	}
+
+	if (shedSections != 0) {
+		shedSectionsCounter->increment(shedSections);
+	}
 }
 
 #include "moc_dvbdevice.cpp"
@@ -21,18 +21,25 @@
 #ifndef DVBDEVICE_H
 #define DVBDEVICE_H
 
+#include <QElapsedTimer>
 #include <QExplicitlySharedDataPointer>
 #include <QMap>
 #include <QMutex>
+#include <QPair>
 #include <QTimer>
 #include "dvbbackenddevice.h"
 #include "dvbtransponder.h"
+#include "dvbtsanalyzer.h"
 
 class DvbConfigBase;
 class DvbDataDumper;
 class DvbDeviceDataBuffer;
 class DvbFilterInternal;
 class DvbSectionFilterInternal;
+class DvbTuningCache;
+class MetricsCounter;
+class MetricsGauge;
+class MetricsHistogram;
 
 class DvbDummyPidFilter : public DvbPidFilter
 {
@@ -67,7 +74,7 @@ public:
 		// FIXME introduce a TuningFailed state
 	};
 
-	DvbDevice(DvbBackendDevice *backend_, QObject *parent);
+	DvbDevice(DvbBackendDevice *backend_, DvbTuningCache *tuningCache_, QObject *parent);
 	~DvbDevice();
 
 	const DvbBackendDevice *getBackendDevice() const
@@ -91,8 +98,13 @@ public:
 
 	void tune(const DvbTransponder &transponder);
 	void autoTune(const DvbTransponder &transponder);
-	bool addPidFilter(int pid, DvbPidFilter *filter) override;
-	bool addSectionFilter(int pid, DvbSectionFilter *filter) override;
+	bool addPidFilter(int pid, DvbPidFilter *filter, FilterPriority priority) override;
+	bool addSectionFilter(int pid, DvbSectionFilter *filter, FilterPriority priority) override;
+	// the filter only needs the sections with one of the table id extensions (for
+	// example the service ids of eit sections); native section filters drop the
+	// others if no other filter of the pid needs them
+	bool addSectionFilter(int pid, DvbSectionFilter *filter, FilterPriority priority,
+		const QList<int> &tableIdExtensions);
 	void removePidFilter(int pid, DvbPidFilter *filter) override;
 	void removeSectionFilter(int pid, DvbSectionFilter *filter) override;
 	void startDescrambling(const QByteArray &pmtSectionData, QObject *user);
@@ -103,6 +115,11 @@ public:
 	float getSnr(DvbBackendDevice::Scale &scale) const;
 	DvbTransponder getAutoTransponder() const;
 
+	const DvbTsAnalyzer &getTsAnalyzer() const
+	{
+		return tsAnalyzer;
+	}
+
 	/*
 	 * management functions (must be only called by DvbManager)
 	 */
@@ -111,6 +128,7 @@ public:
 	void reacquire(const DvbConfigBase *config_);
 	void release();
 	void enableDvbDump();
+	void setReaderConfig(const DvbReaderConfig &readerConfig);
 
 signals:
 	void stateChanged();
@@ -119,14 +137,27 @@ private slots:
 	void frontendEvent();
 
 private:
+	// above this, native section filters get every table id extension (one
+	// demux filter per extension)
+	enum { MaxTableIdExtensions = 32 };
+
 	void setDeviceState(DeviceState newState);
+	bool isFullTsActive() const;
+	bool addBackendPidFilter(int pid);
+	void removeBackendPidFilter(int pid);
 	void discardBuffers();
 	void stop();
 
 	void processData(const char data[188]);
 	DvbDataBuffer getBuffer() override;
 	void writeBuffer(const DvbDataBuffer &dataBuffer) override;
+	void writeSection(int pid, const QByteArray &section) override;
 	void customEvent(QEvent *) override;
+	void stopDescramblingMeasurement(int serviceId);
+	void updateSectionFilterPriority(int pid, DvbSectionFilterInternal *sectionFilter);
+	QList<int> getTableIdExtensions(const DvbSectionFilterInternal *sectionFilter) const;
+	void updateNativeSectionFilter(int pid, DvbSectionFilterInternal *sectionFilter);
+	void updateShedPriority(int backlog);
 
 	DvbBackendDevice *backend;
 	DeviceState deviceState;
@@ -141,15 +172,33 @@ private:
 	DvbDataDumper *dataDumper;
 	bool cleanUpFilters;
 	QMultiMap<int, QObject *> descramblingServices;
+	QMap<int, int> descramblingPids; // pid -> service id; until the first clear packet
+	QMap<int, qint64> descramblingStarts; // service id -> arrivalTimer.nsecsElapsed()
+	DvbTsAnalyzer tsAnalyzer;
+	QElapsedTimer arrivalTimer;
 
 	bool isAuto;
 	DvbTransponder autoTransponder;
+	QList<DvbTransponder> autoCandidates;
+	int autoFrequency;
 	Capabilities capabilities;
+	DvbTuningCache *tuningCache;
+	QElapsedTimer tuningTimer;
 
 	DvbDeviceDataBuffer *unusedBuffersHead;
 	DvbDeviceDataBuffer *usedBuffersHead;
 	DvbDeviceDataBuffer *usedBuffersTail;
+	int usedBuffersCount;
+	QList<QPair<int, QByteArray> > pendingSections; // (pid, section)
 	QMutex dataChannelMutex;
+	int shedPriority; // filters with a lower priority are skipped
+
+	MetricsCounter *packetsCounter;
+	MetricsGauge *allocatedBuffersGauge;
+	MetricsGauge *usedBuffersGauge;
+	MetricsHistogram *descramblingLatencyHistogram;
+	MetricsCounter *shedPacketsCounters[RecordingPriority]; // indexed by priority
+	MetricsCounter *shedSectionsCounter;
 };
 
 #endif /* DVBDEVICE_H */
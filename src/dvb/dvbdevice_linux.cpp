@@ -27,7 +27,11 @@ extern "C" {
   #include <fcntl.h>
   #include <frontend.h>
   #include <poll.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/resource.h>
   #include <sys/socket.h>
+  #include <sys/syscall.h>
   #include <sys/un.h>
   #include <sys/types.h>
   #include <sys/ioctl.h>
@@ -36,6 +40,7 @@ extern "C" {
   #include <sys/inotify.h>
   #include <vector>
   #include <stdlib.h>
+  #include <unistd.h>
 }
 
 #include <QDebug>
@@ -43,9 +48,12 @@ extern "C" {
 #include <QCheckBox>
 #include <QMessageLogger>
 #include <QRegularExpressionMatch>
+#include <QVector>
 #include <Solid/Device>
 #include <Solid/DeviceNotifier>
 
+#include "../metrics.h"
+#include "../tracing.h"
 #include "dvbdevice_linux.h"
 #include "dvbtransponder.h"
 
@@ -200,12 +208,19 @@ private:
 
 
 DvbLinuxDevice::DvbLinuxDevice(QObject *parent) : QThread(parent), ready(false), frontend(NULL),
-	enabled(false), dvrFd(-1), dvrBuffer(NULL, 0), cam(parent)
+	enabled(false), dvrFd(-1), dvrBuffer(NULL, 0), dvrOverflows(0), cam(parent)
 {
 	verbose = 1;
 	numDemux = 0;
 	dvrPipe[0] = -1;
 	dvrPipe[1] = -1;
+	sectionPipe[0] = -1;
+	sectionPipe[1] = -1;
+
+	// shared between all devices
+	dvrOverflowsCounter = Metrics::instance()->counter(
+		QLatin1String("kaffeine_dvb_dvr_overflows_total"),
+		QLatin1String("Overflows of the kernel dvr buffer of all devices"));
 }
 
 DvbLinuxDevice::~DvbLinuxDevice()
@@ -325,6 +340,9 @@ void DvbLinuxDevice::startDevice(const QString &deviceId_)
 		capabilities |= DvbTGuardIntervalAuto;
 	}
 
+	// every linux demux supports DMX_SET_FILTER
+	capabilities |= NativeSectionFilters;
+
 	// Get the supported LNBf types if the device supports satellite
 	if (transmissionTypes & (DvbS | DvbS2)) {
 		for (int i = 0;; i++) {
@@ -461,6 +479,20 @@ bool DvbLinuxDevice::acquire()
 		return false;
 	}
 
+	if ((readerConfig.dvrBufferSize > 0) &&
+	    (ioctl(dvrFd, DMX_SET_BUFFER_SIZE, readerConfig.dvrBufferSize) != 0)) {
+		qCWarning(logDev, "Cannot set the buffer size of dvr %s to %d bytes",
+			qPrintable(dvrPath), readerConfig.dvrBufferSize);
+	}
+
+	// created before any dvr thread, so that every thread polls it; without
+	// it, no native section filters are set up (see addSectionFilter())
+	if (pipe(sectionPipe) != 0) {
+		sectionPipe[0] = -1;
+		sectionPipe[1] = -1;
+		qCWarning(logDev, "Cannot create pipe");
+	}
+
 	return true;
 }
 
@@ -1602,6 +1634,117 @@ void DvbLinuxDevice::removePidFilter(int pid)
 	close(dmxFds.take(pid));
 }
 
+bool DvbLinuxDevice::addSectionFilter(int pid, int tableId, int tableIdMask,
+	const QList<int> &tableIdExtensions)
+{
+	if ((sectionPipe[0] < 0) || (sectionPipe[1] < 0)) {
+		// the dvr thread couldn't notice the filter; DvbDevice reassembles the sections
+		return false;
+	}
+
+	QMutexLocker locker(&sectionFdsMutex);
+
+	if (sectionFds.contains(pid)) {
+		qCWarning(logDev, "Section filter already set up for pid %d", pid);
+		return false;
+	}
+
+	QList<int> dmxFds;
+
+	if (tableIdExtensions.isEmpty()) {
+		dmxFds.append(openSectionFilter(pid, tableId, tableIdMask, -1));
+	} else {
+		foreach (int tableIdExtension, tableIdExtensions) {
+			dmxFds.append(openSectionFilter(pid, tableId, tableIdMask, tableIdExtension));
+
+			if (dmxFds.last() < 0) {
+				break;
+			}
+		}
+	}
+
+	if (dmxFds.last() < 0) {
+		dmxFds.removeLast();
+
+		foreach (int dmxFd, dmxFds) {
+			close(dmxFd);
+		}
+
+		return false;
+	}
+
+	foreach (int dmxFd, dmxFds) {
+		sectionFds.insert(pid, dmxFd);
+	}
+
+	locker.unlock();
+	wakeUpDvr();
+	return true;
+}
+
+int DvbLinuxDevice::openSectionFilter(int pid, int tableId, int tableIdMask, int tableIdExtension)
+{
+	int dmxFd = open(QFile::encodeName(demuxPath).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+	if (dmxFd < 0) {
+		qCWarning(logDev, "Cannot open demux %s", qPrintable(demuxPath));
+		return -1;
+	}
+
+	// the filter skips the section length (bytes 1 and 2 of the section)
+	dmx_sct_filter_params sct_filter;
+	memset(&sct_filter, 0, sizeof(sct_filter));
+	sct_filter.pid = ushort(pid);
+	sct_filter.filter.filter[0] = quint8(tableId);
+	sct_filter.filter.mask[0] = quint8(tableIdMask);
+
+	if (tableIdExtension >= 0) {
+		sct_filter.filter.filter[1] = quint8(tableIdExtension >> 8);
+		sct_filter.filter.mask[1] = 0xff;
+		sct_filter.filter.filter[2] = quint8(tableIdExtension);
+		sct_filter.filter.mask[2] = 0xff;
+	}
+
+	sct_filter.flags = DMX_CHECK_CRC;
+
+	if (ioctl(dmxFd, DMX_SET_FILTER, &sct_filter) != 0) {
+		qCWarning(logDev, "Cannot set up section filter for demux %s", qPrintable(demuxPath));
+		close(dmxFd);
+		return -1;
+	}
+
+	// the default buffer is too small for eit bursts
+	if (ioctl(dmxFd, DMX_SET_BUFFER_SIZE, 64 * 1024) != 0) {
+		qCDebug(logDev, "Cannot set buffer size for demux %s", qPrintable(demuxPath));
+	}
+
+	if (ioctl(dmxFd, DMX_START) != 0) {
+		qCWarning(logDev, "Cannot start section filter for demux %s", qPrintable(demuxPath));
+		close(dmxFd);
+		return -1;
+	}
+
+	return dmxFd;
+}
+
+void DvbLinuxDevice::removeSectionFilter(int pid)
+{
+	QMutexLocker locker(&sectionFdsMutex);
+
+	if (!sectionFds.contains(pid)) {
+		qCWarning(logDev, "No section filter set up for PID %i", pid);
+		return;
+	}
+
+	foreach (int dmxFd, sectionFds.values(pid)) {
+		close(dmxFd);
+	}
+
+	sectionFds.remove(pid);
+	locker.unlock();
+	wakeUpDvr();
+}
+
 void DvbLinuxDevice::startDescrambling(const QByteArray &pmtSectionData)
 {
 	cam.startDescrambling(pmtSectionData);
@@ -1643,12 +1786,33 @@ void DvbLinuxDevice::release()
 
 	dmxFds.clear();
 
+	foreach (int dmxFd, sectionFds) {
+		close(dmxFd);
+	}
+
+	sectionFds.clear();
+
+	if (sectionPipe[0] >= 0) {
+		close(sectionPipe[0]);
+		sectionPipe[0] = -1;
+	}
+
+	if (sectionPipe[1] >= 0) {
+		close(sectionPipe[1]);
+		sectionPipe[1] = -1;
+	}
+
 	if (dvbv5_parms) {
 		dvb_fe_close(dvbv5_parms);
 		dvbv5_parms = NULL;
 	}
 }
 
+void DvbLinuxDevice::setReaderConfig(const DvbReaderConfig &readerConfig_)
+{
+	readerConfig = readerConfig_;
+}
+
 void DvbLinuxDevice::startDvr()
 {
 	Q_ASSERT((dvrFd >= 0) && !isRunning());
@@ -1724,18 +1888,145 @@ void DvbLinuxDevice::stopDvr()
 	}
 }
 
+void DvbLinuxDevice::wakeUpDvr()
+{
+	if (write(sectionPipe[1], " ", 1) != 1) {
+		qCWarning(logDev, "Cannot write to pipe");
+	}
+}
+
+void DvbLinuxDevice::readSections(const QList<int> &fds)
+{
+	// sections are at most 4096 bytes long; the demux returns one per read()
+	char data[4096];
+	QMutexLocker locker(&sectionFdsMutex);
+
+	foreach (int fd, fds) {
+		// the filter may have been removed (and the fd reused) in the meantime
+		int pid = sectionFds.key(fd, -1);
+
+		if (pid < 0) {
+			continue;
+		}
+
+		while (true) {
+			int size = int(read(fd, data, sizeof(data)));
+
+			if (size < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				if (errno == EOVERFLOW) {
+					qCDebug(logDev, "Section buffer overflow for pid %d", pid);
+					continue;
+				}
+
+				break;
+			}
+
+			if (size == 0) {
+				break;
+			}
+
+			frontend->writeSection(pid, QByteArray(data, size));
+		}
+	}
+}
+
+void DvbLinuxDevice::applyReaderConfig()
+{
+	// must be called by the dvr thread; the thread is recreated by every startDvr()
+
+	if (!readerConfig.cpuAffinity.isEmpty()) {
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+
+		foreach (int cpu, readerConfig.cpuAffinity) {
+			if ((cpu >= 0) && (cpu < CPU_SETSIZE)) {
+				CPU_SET(cpu, &cpuSet);
+			}
+		}
+
+		int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+
+		if (result != 0) {
+			qCWarning(logDev, "Cannot set cpu affinity for dvr %s: error %d",
+				qPrintable(dvrPath), result);
+		}
+	}
+
+	bool useNiceness = true;
+
+	if (readerConfig.schedulingPolicy != DvbReaderConfig::NormalScheduling) {
+		int policy = SCHED_FIFO;
+
+		if (readerConfig.schedulingPolicy == DvbReaderConfig::RoundRobinScheduling) {
+			policy = SCHED_RR;
+		}
+
+		sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = qBound(sched_get_priority_min(policy),
+			readerConfig.realtimePriority, sched_get_priority_max(policy));
+		int result = pthread_setschedparam(pthread_self(), policy, &param);
+
+		if (result == 0) {
+			useNiceness = false;
+		} else if (result == EPERM) {
+			qCInfo(logDev, "Real-time scheduling isn't permitted for dvr %s, using niceness %d",
+				qPrintable(dvrPath), readerConfig.niceness);
+		} else {
+			qCWarning(logDev, "Cannot set scheduling policy for dvr %s: error %d",
+				qPrintable(dvrPath), result);
+		}
+	}
+
+	if (useNiceness && (readerConfig.niceness != 0)) {
+		// the niceness is a per-thread attribute on linux
+		pid_t threadId = pid_t(syscall(SYS_gettid));
+
+		if (setpriority(PRIO_PROCESS, id_t(threadId), readerConfig.niceness) != 0) {
+			qCWarning(logDev, "Cannot set niceness %d for dvr %s: error %d",
+				readerConfig.niceness, qPrintable(dvrPath), errno);
+		}
+	}
+}
+
 void DvbLinuxDevice::run()
 {
 	Q_ASSERT((dvrFd >= 0) && (dvrPipe[0] >= 0) && (dvrBuffer.data != NULL));
-	pollfd pollFds[2];
-	memset(&pollFds, 0, sizeof(pollFds));
-	pollFds[0].fd = dvrPipe[0];
-	pollFds[0].events = POLLIN;
-	pollFds[1].fd = dvrFd;
-	pollFds[1].events = POLLIN;
+	QVector<pollfd> pollFds;
+	bool updatePollFds = true;
+	applyReaderConfig();
 
 	while (true) {
-		if (poll(pollFds, 2, -1) < 0) {
+		if (updatePollFds) {
+			updatePollFds = false;
+			pollFds.resize(2);
+			memset(pollFds.data(), 0, pollFds.size() * sizeof(pollfd));
+			pollFds[0].fd = dvrPipe[0];
+			pollFds[0].events = POLLIN;
+			pollFds[1].fd = dvrFd;
+			pollFds[1].events = POLLIN;
+
+			if (sectionPipe[0] >= 0) {
+				pollfd pollFd;
+				memset(&pollFd, 0, sizeof(pollFd));
+				pollFd.fd = sectionPipe[0];
+				pollFd.events = POLLIN;
+				pollFds.append(pollFd);
+
+				QMutexLocker locker(&sectionFdsMutex);
+
+				foreach (int fd, sectionFds) {
+					pollFd.fd = fd;
+					pollFds.append(pollFd);
+				}
+			}
+		}
+
+		if (poll(pollFds.data(), nfds_t(pollFds.size()), -1) < 0) {
 			if (errno == EINTR) {
 				continue;
 			}
@@ -1744,11 +2035,37 @@ void DvbLinuxDevice::run()
 			return;
 		}
 
-		if ((pollFds[0].revents & POLLIN) != 0) {
+		if ((pollFds.at(0).revents & POLLIN) != 0) {
 			return;
 		}
 
+		if (pollFds.size() > 2) {
+			if ((pollFds.at(2).revents & POLLIN) != 0) {
+				char data[16];
+
+				if (read(sectionPipe[0], data, sizeof(data)) <= 0) {
+					qCWarning(logDev, "Cannot read from pipe");
+				}
+
+				updatePollFds = true;
+			}
+
+			QList<int> readyFds;
+
+			for (int i = 3; i < pollFds.size(); ++i) {
+				if ((pollFds.at(i).revents & (POLLIN | POLLERR)) != 0) {
+					readyFds.append(pollFds.at(i).fd);
+				}
+			}
+
+			if (!readyFds.isEmpty()) {
+				KAFFEINE_TRACE_SCOPE("DvbLinuxDevice::readSections");
+				readSections(readyFds);
+			}
+		}
+
 		while (true) {
+			KAFFEINE_TRACE_SCOPE("DvbLinuxDevice::read");
 			int bufferSize = dvrBuffer.bufferSize;
 			int dataSize = int(read(dvrFd, dvrBuffer.data, bufferSize));
 
@@ -1761,6 +2078,15 @@ void DvbLinuxDevice::run()
 					continue;
 				}
 
+				if (errno == EOVERFLOW) {
+					// data has been lost, but the next read() returns new data
+					++dvrOverflows;
+					dvrOverflowsCounter->increment();
+					qCWarning(logDev, "Buffer overflow of dvr %s (%d so far)",
+						qPrintable(dvrPath), dvrOverflows);
+					continue;
+				}
+
 				qCWarning(logDev, "Cannot read from dvr %s: error %d", qPrintable(dvrPath), errno);
 				dataSize = int(read(dvrFd, dvrBuffer.data, bufferSize));
 
@@ -21,6 +21,7 @@
 #ifndef DVBDEVICE_LINUX_H
 #define DVBDEVICE_LINUX_H
 
+#include <QMutex>
 #include <QThread>
 #include "dvbbackenddevice.h"
 #include "dvbcam_linux.h"
@@ -32,6 +33,8 @@ extern "C" {
   #include <libdvbv5/dvb-scan.h>
 }
 
+class MetricsCounter;
+
 class DvbLinuxDevice : public QThread, public DvbBackendDevice
 {
 public:
@@ -78,13 +81,21 @@ protected:
 	float getSnr(DvbBackendDevice::Scale &scale) override;
 	bool addPidFilter(int pid) override;
 	void removePidFilter(int pid) override;
+	bool addSectionFilter(int pid, int tableId, int tableIdMask,
+		const QList<int> &tableIdExtensions) override;
+	void removeSectionFilter(int pid) override;
 	void startDescrambling(const QByteArray &pmtSectionData) override;
 	void stopDescrambling(int serviceId) override;
 	void release() override;
+	void setReaderConfig(const DvbReaderConfig &readerConfig_) override;
 
 private:
 	void startDvr();
 	void stopDvr();
+	void wakeUpDvr();
+	int openSectionFilter(int pid, int tableId, int tableIdMask, int tableIdExtension);
+	void readSections(const QList<int> &fds);
+	void applyReaderConfig();
 	void run() override;
 
 	bool ready;
@@ -102,6 +113,14 @@ private:
 	int dvrFd;
 	int dvrPipe[2];
 	DvbDataBuffer dvrBuffer;
+	DvbReaderConfig readerConfig;
+	int dvrOverflows; // only accessed by the dvr thread
+	MetricsCounter *dvrOverflowsCounter;
+
+	// native section filters (pid -> fd); read by the dvr thread
+	QMultiMap<int, int> sectionFds; // pid -> fd (one per table id extension)
+	QMutex sectionFdsMutex;
+	int sectionPipe[2]; // wakes up the dvr thread if sectionFds changes
 
 	DvbLinuxCam cam;
 };
@@ -29,6 +29,7 @@ public:
 
 	char data[5 * 188];
 	int size;
+	qint64 timestamp; // arrival time (ns)
 	DvbDeviceDataBuffer *next;
 };
 
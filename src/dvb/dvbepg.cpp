@@ -19,6 +19,9 @@
  */
 
 #include "../log.h"
+#include "../metrics.h"
+#include "../startupprofiler.h"
+#include "../tracing.h"
 
 #include <KLazyLocalizedString>
 
@@ -45,6 +48,81 @@ bool DvbEpgEntry::validate() const
 	return false;
 }
 
+void DvbEpgEntry::updateDisplayStrings()
+{
+	displayStrings.allLangs.title = joinLangEntries(&DvbEpgLangEntry::title, false);
+	displayStrings.allLangs.subheading = joinLangEntries(&DvbEpgLangEntry::subheading, false);
+	displayStrings.allLangs.details = joinLangEntries(&DvbEpgLangEntry::details, false);
+	displayStrings.firstLang.title = joinLangEntries(&DvbEpgLangEntry::title, true);
+	displayStrings.firstLang.subheading = joinLangEntries(&DvbEpgLangEntry::subheading, true);
+	displayStrings.firstLang.details = joinLangEntries(&DvbEpgLangEntry::details, true);
+	displayStrings.valid = true;
+}
+
+QString DvbEpgEntry::displayString(QString DvbEpgLangEntry::*member, const QString &lang) const
+{
+	bool firstOnly = false;
+
+	if (!lang.isEmpty()) {
+		/*
+		 * Only return the user requested data
+		 * ISO-639-2 code if the string is filled.
+		 *
+		 * If it isn't, show first language
+		 */
+		QHash<QString, DvbEpgLangEntry>::ConstIterator it = langEntry.constFind(lang);
+
+		if ((it != langEntry.constEnd()) && !((*it).*member).isEmpty() &&
+		    (lang != QLatin1String(FIRST_LANG))) {
+			return ((*it).*member);
+		}
+
+		firstOnly = true;
+	}
+
+	if (displayStrings.valid) {
+		if (firstOnly) {
+			return (displayStrings.firstLang.*member);
+		}
+
+		return (displayStrings.allLangs.*member);
+	}
+
+	return joinLangEntries(member, firstOnly);
+}
+
+QString DvbEpgEntry::joinLangEntries(QString DvbEpgLangEntry::*member, bool firstOnly) const
+{
+	QLatin1String separator((member == &DvbEpgLangEntry::details) ?
+		QLatin1String("\n\n") : QLatin1String("/"));
+	QString s;
+
+	for (QHash<QString, DvbEpgLangEntry>::ConstIterator it = langEntry.constBegin();
+	     it != langEntry.constEnd(); ++it) {
+		const QString &string = ((*it).*member);
+
+		if (!string.isEmpty()) {
+			if (!s.isEmpty()) {
+				s += separator;
+			}
+
+			if (!firstOnly && (langEntry.size() > 1) &&
+			    (it.key() != QLatin1String(FIRST_LANG))) {
+				s += it.key();
+				s += QLatin1String(": ");
+			}
+
+			s += string;
+		}
+
+		if (firstOnly) {
+			break;
+		}
+	}
+
+	return s;
+}
+
 bool DvbEpgEntryId::operator<(const DvbEpgEntryId &other) const
 {
 	if (entry->channel != other.entry->channel) {
@@ -57,25 +135,9 @@ bool DvbEpgEntryId::operator<(const DvbEpgEntryId &other) const
 	return false;
 }
 
-DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent),
-	manager(manager_), hasPendingOperation(false)
+void DvbEpgLoader::run()
 {
-	currentDateTimeUtc = QDateTime::currentDateTime().toUTC();
-	startTimer(54000);
-
-	DvbChannelModel *channelModel = manager->getChannelModel();
-	connect(channelModel, SIGNAL(channelAboutToBeUpdated(DvbSharedChannel)),
-		this, SLOT(channelAboutToBeUpdated(DvbSharedChannel)));
-	connect(channelModel, SIGNAL(channelUpdated(DvbSharedChannel)),
-		this, SLOT(channelUpdated(DvbSharedChannel)));
-	connect(channelModel, SIGNAL(channelRemoved(DvbSharedChannel)),
-		this, SLOT(channelRemoved(DvbSharedChannel)));
-	connect(manager->getRecordingModel(), SIGNAL(recordingRemoved(DvbSharedRecording)),
-		this, SLOT(recordingRemoved(DvbSharedRecording)));
-
-	// TODO use SQL to store epg data
-
-	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/epgdata.dvb"));
+	QFile file(fileName);
 
 	if (!file.open(QIODevice::ReadOnly)) {
 		qCWarning(logEpg, "Cannot open %s", qPrintable(file.fileName()));
@@ -84,7 +146,6 @@ DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent
 
 	QDataStream stream(&file);
 	stream.setVersion(QDataStream::Qt_4_4);
-	DvbRecordingModel *recordingModel = manager->getRecordingModel();
 	bool hasRecordingKey = true, hasParental = true, hasMultilang = true;
 	int version;
 	stream >> version;
@@ -101,10 +162,9 @@ DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent
 	}
 
 	while (!stream.atEnd()) {
-		DvbEpgEntry entry;
-		QString channelName;
-		stream >> channelName;
-		entry.channel = channelModel->findChannelByName(channelName);
+		DvbEpgLoadedEntry loadedEntry;
+		DvbEpgEntry &entry = loadedEntry.entry;
+		stream >> loadedEntry.channelName;
 		stream >> entry.begin;
 		entry.begin = entry.begin.toUTC();
 		stream >> entry.duration;
@@ -125,8 +185,8 @@ DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent
 
 				entry.langEntry[code] = langEntry;
 
-				if (!langEntry.title.isEmpty() && !manager->languageCodes.contains(code))
-					manager->languageCodes[code] = true;
+				if (!langEntry.title.isEmpty() && !languageCodes.contains(code))
+					languageCodes.append(code);
 			}
 
 
@@ -141,12 +201,7 @@ DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent
 		}
 
 		if (hasRecordingKey) {
-			SqlKey recordingKey;
-			stream >> recordingKey.sqlKey;
-
-			if (recordingKey.isSqlKeyValid()) {
-				entry.recording = recordingModel->findRecordingByKey(recordingKey);
-			}
+			stream >> loadedEntry.recordingKey.sqlKey;
 		}
 
 		if (hasParental) {
@@ -167,10 +222,44 @@ DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent
 			break;
 		}
 
-		addEntry(entry);
+		loadedEntries.append(loadedEntry);
 	}
 }
 
+DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent),
+	manager(manager_), hasPendingOperation(false), loaderIndex(0), loaded(false)
+{
+	currentDateTimeUtc = QDateTime::currentDateTime().toUTC();
+	startTimer(54000);
+
+	// coalesce new entries, so that views don't relayout for every single eit event
+	addedEntriesTimer.setSingleShot(true);
+	addedEntriesTimer.setInterval(100);
+	connect(&addedEntriesTimer, SIGNAL(timeout()), this, SLOT(emitAddedEntries()));
+
+	entriesGauge = Metrics::instance()->gauge(QLatin1String("kaffeine_epg_entries"),
+		QLatin1String("Entries in the program guide"));
+	channelsGauge = Metrics::instance()->gauge(QLatin1String("kaffeine_epg_channels"),
+		QLatin1String("Channels with program guide entries"));
+
+	DvbChannelModel *channelModel = manager->getChannelModel();
+	connect(channelModel, SIGNAL(channelAboutToBeUpdated(DvbSharedChannel)),
+		this, SLOT(channelAboutToBeUpdated(DvbSharedChannel)));
+	connect(channelModel, SIGNAL(channelUpdated(DvbSharedChannel)),
+		this, SLOT(channelUpdated(DvbSharedChannel)));
+	connect(channelModel, SIGNAL(channelRemoved(DvbSharedChannel)),
+		this, SLOT(channelRemoved(DvbSharedChannel)));
+	connect(manager->getRecordingModel(), SIGNAL(recordingRemoved(DvbSharedRecording)),
+		this, SLOT(recordingRemoved(DvbSharedRecording)));
+
+	// TODO use SQL to store epg data
+
+	StartupProfiler::instance()->beginPhase(QLatin1String("Program guide"));
+	loader = new DvbEpgLoader(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/epgdata.dvb"));
+	connect(loader, SIGNAL(finished()), this, SLOT(addLoadedEntries()));
+	loader->start(QThread::LowPriority);
+}
+
 DvbEpgModel::~DvbEpgModel()
 {
 	if (hasPendingOperation) {
@@ -181,10 +270,16 @@ DvbEpgModel::~DvbEpgModel()
 		qCWarning(logEpg, "filter list not empty");
 	}
 
+	if (loader != NULL) {
+		// the entries which haven't been added yet are written back below
+		loader->wait();
+	}
+
 	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/epgdata.dvb"));
 
 	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
 		qCWarning(logEpg, "Cannot open %s", qPrintable(file.fileName()));
+		delete loader;
 		return;
 	}
 
@@ -200,31 +295,57 @@ DvbEpgModel::~DvbEpgModel()
 			recordingKey = *entry->recording;
 		}
 
-		stream << entry->channel->name;
-		stream << entry->begin;
-		stream << entry->duration;
+		writeEntry(stream, *entry, entry->channel->name, recordingKey);
+	}
+
+	if (loader != NULL) {
+		// quit before the stored entries have been added completely
+		DvbChannelModel *channelModel = manager->getChannelModel();
+
+		for (; loaderIndex < loader->loadedEntries.size(); ++loaderIndex) {
+			DvbEpgLoadedEntry &loadedEntry = loader->loadedEntries[loaderIndex];
+			DvbEpgEntry &entry = loadedEntry.entry;
+			entry.channel = channelModel->findChannelByName(loadedEntry.channelName);
+
+			if (!entry.channel.isValid() || (endTime(&entry) <= currentDateTimeUtc.toMSecsSinceEpoch()) ||
+			    entries.contains(DvbEpgEntryId(&entry))) {
+				continue;
+			}
+
+			writeEntry(stream, entry, loadedEntry.channelName, loadedEntry.recordingKey);
+		}
+
+		delete loader;
+	}
+}
 
-		stream << entry->langEntry.size();
+void DvbEpgModel::writeEntry(QDataStream &stream, const DvbEpgEntry &entry,
+	const QString &channelName, const SqlKey &recordingKey)
+{
+	stream << channelName;
+	stream << entry.begin;
+	stream << entry.duration;
 
-		QHashIterator<QString, DvbEpgLangEntry> i(entry->langEntry);
+	stream << entry.langEntry.size();
 
-		while (i.hasNext()) {
-			i.next();
+	QHashIterator<QString, DvbEpgLangEntry> i(entry.langEntry);
 
-			stream << i.key();
+	while (i.hasNext()) {
+		i.next();
 
-			DvbEpgLangEntry langEntry = i.value();
+		stream << i.key();
 
-			stream << langEntry.title;
-			stream << langEntry.subheading;
-			stream << langEntry.details;
-		}
+		DvbEpgLangEntry langEntry = i.value();
 
-		stream << recordingKey.sqlKey;
-		stream << int(entry->type);
-		stream << entry->content;
-		stream << entry->parental;
+		stream << langEntry.title;
+		stream << langEntry.subheading;
+		stream << langEntry.details;
 	}
+
+	stream << recordingKey.sqlKey;
+	stream << int(entry.type);
+	stream << entry.content;
+	stream << entry.parental;
 }
 
 QMap<DvbSharedRecording, DvbSharedEpgEntry> DvbEpgModel::getRecordings() const
@@ -237,8 +358,10 @@ void DvbEpgModel::setRecordings(const QMap<DvbSharedRecording, DvbSharedEpgEntry
 	recordings = map;
 }
 
-QMap<DvbEpgEntryId, DvbSharedEpgEntry> DvbEpgModel::getEntries() const
+QMap<DvbEpgEntryId, DvbSharedEpgEntry> DvbEpgModel::getEntries()
 {
+	// otherwise the pending entries would be added twice by the caller
+	emitAddedEntries();
 	return entries;
 }
 
@@ -270,6 +393,11 @@ QList<DvbSharedEpgEntry> DvbEpgModel::getCurrentNext(const DvbSharedChannel &cha
 	return result;
 }
 
+qint64 DvbEpgModel::endTime(const DvbEpgEntry *entry)
+{
+	return (entry->begin.toMSecsSinceEpoch() + QTime(0, 0, 0).msecsTo(entry->duration));
+}
+
 void DvbEpgModel::Debug(QString text, const DvbSharedEpgEntry &entry)
 {
 	if (!QLoggingCategory::defaultCategory()->isEnabled(QtDebugMsg))
@@ -285,6 +413,8 @@ void DvbEpgModel::Debug(QString text, const DvbSharedEpgEntry &entry)
 
 DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 {
+	KAFFEINE_TRACE_SCOPE("DvbEpgModel::addEntry");
+
 	if (!entry.validate()) {
 		qCWarning(logEpg, "Invalid entry: channel is %s, begin is %s, duration is %s", entry.channel.isValid() ? "valid" : "invalid", entry.begin.isValid() ? "valid" : "invalid", entry.duration.isValid() ? "valid" : "invalid");
 		return DvbSharedEpgEntry();
@@ -322,10 +452,12 @@ DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 		if (end != enEnd) {
 			Debug("removed", existingEntry);
 			it = removeEntry(it);
+			emitRemovedEntries();
 			break;
 		}
 		// New event data for the same event
 		if (existingEntry->details(FIRST_LANG).isEmpty() && !entry.details(FIRST_LANG).isEmpty()) {
+			emitAddedEntries();
 			emit entryAboutToBeUpdated(existingEntry);
 
 			QHashIterator<QString, DvbEpgLangEntry> i(entry.langEntry);
@@ -337,6 +469,7 @@ DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 
 				const_cast<DvbEpgEntry *>(existingEntry.constData())->langEntry[i.key()].details = langEntry.details;
 			}
+			const_cast<DvbEpgEntry *>(existingEntry.constData())->updateDisplayStrings();
 			emit entryUpdated(existingEntry);
 			Debug("updated", existingEntry);
 		}
@@ -349,6 +482,7 @@ DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 		if (existingEntry.isValid()) {
 			if (existingEntry->details(FIRST_LANG).isEmpty() && !entry.details(FIRST_LANG).isEmpty()) {
 				// needed for atsc
+				emitAddedEntries();
 				emit entryAboutToBeUpdated(existingEntry);
 
 				QHashIterator<QString, DvbEpgLangEntry> i(entry.langEntry);
@@ -360,6 +494,7 @@ DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 
 					const_cast<DvbEpgEntry *>(existingEntry.constData())->langEntry[i.key()].details = langEntry.details;
 				}
+				const_cast<DvbEpgEntry *>(existingEntry.constData())->updateDisplayStrings();
 				emit entryUpdated(existingEntry);
 				Debug("updated2", existingEntry);
 			}
@@ -367,18 +502,28 @@ DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 			return existingEntry;
 		}
 
-		DvbSharedEpgEntry newEntry(new DvbEpgEntry(entry));
+		DvbEpgEntry *epgEntry = new DvbEpgEntry(entry);
+		epgEntry->updateDisplayStrings();
+		DvbSharedEpgEntry newEntry(epgEntry);
 		entries.insert(DvbEpgEntryId(newEntry), newEntry);
+		expiryIndex.insert(endTime(newEntry.constData()), newEntry.constData());
+		entriesGauge->set(entries.size());
 
 		if (newEntry->recording.isValid()) {
 			recordings.insert(newEntry->recording, newEntry);
 		}
 
 		if (++epgChannels[newEntry->channel] == 1) {
+			channelsGauge->set(epgChannels.size());
 			emit epgChannelAdded(newEntry->channel);
 		}
 
-		emit entryAdded(newEntry);
+		addedEntries.append(newEntry);
+
+		if (!addedEntriesTimer.isActive()) {
+			addedEntriesTimer.start();
+		}
+
 		Debug("new", newEntry);
 		return newEntry;
 	}
@@ -400,6 +545,7 @@ void DvbEpgModel::scheduleProgram(const DvbSharedEpgEntry &entry, int extraSecon
 	}
 
 	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
+	emitAddedEntries();
 	emit entryAboutToBeUpdated(entry);
 	DvbSharedRecording oldRecording;
 
@@ -521,6 +667,8 @@ void DvbEpgModel::channelUpdated(const DvbSharedChannel &channel)
 		while ((ConstIterator(it) != entries.constEnd()) && ((*it)->channel == channel)) {
 			it = removeEntry(it);
 		}
+
+		emitRemovedEntries();
 	}
 }
 
@@ -538,6 +686,8 @@ void DvbEpgModel::channelRemoved(const DvbSharedChannel &channel)
 	while ((ConstIterator(it) != entries.constEnd()) && ((*it)->channel == channel)) {
 		it = removeEntry(it);
 	}
+
+	emitRemovedEntries();
 }
 
 void DvbEpgModel::recordingRemoved(const DvbSharedRecording &recording)
@@ -551,6 +701,7 @@ void DvbEpgModel::recordingRemoved(const DvbSharedRecording &recording)
 	DvbSharedEpgEntry entry = recordings.take(recording);
 
 	if (entry.isValid()) {
+		emitAddedEntries();
 		emit entryAboutToBeUpdated(entry);
 		const_cast<DvbEpgEntry *>(entry.constData())->recording = DvbSharedRecording();
 		emit entryUpdated(entry);
@@ -568,19 +719,102 @@ void DvbEpgModel::timerEvent(QTimerEvent *event)
 
 	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
 	currentDateTimeUtc = QDateTime::currentDateTime().toUTC();
-	Iterator it = entries.begin();
+	qint64 now = currentDateTimeUtc.toMSecsSinceEpoch();
 
-	while (ConstIterator(it) != entries.constEnd()) {
-		const DvbSharedEpgEntry &entry = *it;
+	// only touches the entries which actually expired
+	while (!expiryIndex.isEmpty() && (expiryIndex.firstKey() <= now)) {
+		Iterator it = entries.find(DvbEpgEntryId(expiryIndex.first()));
 
-		if (entry->begin.addSecs(QTime(0, 0, 0).secsTo(entry->duration)) > currentDateTimeUtc) {
-			++it;
-		} else {
-			it = removeEntry(it);
+		if ((it == entries.end()) || (it->constData() != expiryIndex.first())) {
+			qCWarning(logEpg, "Expiry index out of sync");
+			expiryIndex.erase(expiryIndex.begin());
+			continue;
 		}
+
+		removeEntry(it);
+	}
+
+	emitRemovedEntries();
+}
+
+void DvbEpgModel::emitRemovedEntries()
+{
+	if (!removedEntries.isEmpty()) {
+		QVector<DvbSharedEpgEntry> oldEntries;
+		oldEntries.swap(removedEntries);
+		emit entriesRemoved(oldEntries);
 	}
 }
 
+void DvbEpgModel::emitAddedEntries()
+{
+	addedEntriesTimer.stop();
+
+	if (!addedEntries.isEmpty()) {
+		QVector<DvbSharedEpgEntry> newEntries;
+		newEntries.swap(addedEntries);
+		emit entriesAdded(newEntries);
+	}
+}
+
+void DvbEpgModel::addLoadedEntries()
+{
+	KAFFEINE_TRACE_SCOPE("DvbEpgModel::addLoadedEntries");
+
+	if (loaderIndex == 0) {
+		foreach (const QString &code, loader->languageCodes) {
+			if (!manager->languageCodes.contains(code)) {
+				manager->languageCodes[code] = true;
+				emit languageAdded(code);
+			}
+		}
+	}
+
+	// add the entries in slices, so that the event loop keeps running
+	DvbChannelModel *channelModel = manager->getChannelModel();
+	DvbRecordingModel *recordingModel = manager->getRecordingModel();
+	int end = qMin(loaderIndex + 2000, int(loader->loadedEntries.size()));
+
+	for (; loaderIndex < end; ++loaderIndex) {
+		DvbEpgLoadedEntry &loadedEntry = loader->loadedEntries[loaderIndex];
+		DvbEpgEntry &entry = loadedEntry.entry;
+		entry.channel = channelModel->findChannelByName(loadedEntry.channelName);
+
+		if (loadedEntry.recordingKey.isSqlKeyValid()) {
+			entry.recording = recordingModel->findRecordingByKey(loadedEntry.recordingKey);
+		}
+
+		// the eit filters may already have added a newer version of this entry
+		Iterator it = entry.channel.isValid() ? entries.find(DvbEpgEntryId(&entry)) :
+			entries.end();
+
+		if (it == entries.end()) {
+			addEntry(entry);
+		} else if (entry.recording.isValid() && !(*it)->recording.isValid()) {
+			// keep the link to the scheduled recording
+			const DvbSharedEpgEntry &existingEntry = *it;
+			emitAddedEntries();
+			emit entryAboutToBeUpdated(existingEntry);
+			const_cast<DvbEpgEntry *>(existingEntry.constData())->recording =
+				entry.recording;
+			recordings.insert(entry.recording, existingEntry);
+			emit entryUpdated(existingEntry);
+		}
+	}
+
+	if (loaderIndex < loader->loadedEntries.size()) {
+		QTimer::singleShot(0, this, SLOT(addLoadedEntries()));
+		return;
+	}
+
+	delete loader;
+	loader = NULL;
+	loaded = true;
+	// dependent loading (xmltv) is part of this phase
+	emit epgLoaded();
+	StartupProfiler::instance()->endPhase(QLatin1String("Program guide"));
+}
+
 DvbEpgModel::Iterator DvbEpgModel::removeEntry(Iterator it)
 {
 	const DvbSharedEpgEntry &entry = *it;
@@ -591,11 +825,16 @@ DvbEpgModel::Iterator DvbEpgModel::removeEntry(Iterator it)
 
 	if (--epgChannels[entry->channel] == 0) {
 		epgChannels.remove(entry->channel);
+		channelsGauge->set(epgChannels.size());
 		emit epgChannelRemoved(entry->channel);
 	}
 
-	emit entryRemoved(entry);
-	return entries.erase(it);
+	emitAddedEntries();
+	expiryIndex.remove(endTime(entry.constData()), entry.constData());
+	removedEntries.append(entry);
+	Iterator nextIt = entries.erase(it);
+	entriesGauge->set(entries.size());
+	return nextIt;
 }
 
 DvbEpgFilter::DvbEpgFilter(DvbManager *manager_, DvbDevice *device_,
@@ -604,9 +843,21 @@ DvbEpgFilter::DvbEpgFilter(DvbManager *manager_, DvbDevice *device_,
 	manager = manager_;
 	source = channel->source;
 	transponder = channel->transponder;
-	device->addSectionFilter(0x12, this);
 	channelModel = manager->getChannelModel();
 	epgModel = manager->getEpgModel();
+
+	// processSection() drops the sections of unknown services anyway; the
+	// table id extension of eit sections is the service id
+	QList<int> serviceIds;
+
+	foreach (const DvbSharedChannel &sourceChannel, channelModel->getChannels()) {
+		if ((sourceChannel->source == source) &&
+		    !serviceIds.contains(sourceChannel->serviceId)) {
+			serviceIds.append(sourceChannel->serviceId);
+		}
+	}
+
+	device->addSectionFilter(0x12, this, DvbDevice::EpgPriority, serviceIds);
 }
 
 DvbEpgFilter::~DvbEpgFilter()
@@ -1146,7 +1397,7 @@ AtscEpgFilter::AtscEpgFilter(DvbManager *manager, DvbDevice *device_,
 {
 	source = channel->source;
 	transponder = channel->transponder;
-	device->addSectionFilter(0x1ffb, &mgtFilter);
+	device->addSectionFilter(0x1ffb, &mgtFilter, DvbDevice::EpgPriority);
 	channelModel = manager->getChannelModel();
 	epgModel = manager->getEpgModel();
 }
@@ -1239,13 +1490,13 @@ void AtscEpgFilter::processMgtSection(const char *data, int size)
 	for (int i = 0; i < newEitPids.size(); ++i) {
 		int pid = newEitPids.at(i);
 		eitPids.append(pid);
-		device->addSectionFilter(pid, &eitFilter);
+		device->addSectionFilter(pid, &eitFilter, DvbDevice::EpgPriority);
 	}
 
 	for (int i = 0; i < newEttPids.size(); ++i) {
 		int pid = newEttPids.at(i);
 		ettPids.append(pid);
-		device->addSectionFilter(pid, &ettFilter);
+		device->addSectionFilter(pid, &ettFilter, DvbDevice::EpgPriority);
 	}
 }
 
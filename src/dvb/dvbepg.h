@@ -21,11 +21,17 @@
 #ifndef DVBEPG_H
 #define DVBEPG_H
 
+#include <QMultiMap>
+#include <QTimer>
+#include <QVector>
 #include "dvbrecording.h"
 
 class AtscEpgFilter;
 class DvbDevice;
 class DvbEpgFilter;
+class DvbEpgLoader;
+class MetricsGauge;
+class QDataStream;
 
 #define FIRST_LANG "first"
 
@@ -37,6 +43,29 @@ public:
 	QString details;
 };
 
+// the cached strings of a DvbEpgEntry; copies start out empty, because the
+// language entries of a copy are usually modified before it is inserted
+
+class DvbEpgDisplayStrings
+{
+public:
+	DvbEpgDisplayStrings() : valid(false) { }
+	DvbEpgDisplayStrings(const DvbEpgDisplayStrings &) : valid(false) { }
+	~DvbEpgDisplayStrings() { }
+
+	DvbEpgDisplayStrings &operator=(const DvbEpgDisplayStrings &)
+	{
+		allLangs = DvbEpgLangEntry();
+		firstLang = DvbEpgLangEntry();
+		valid = false;
+		return *this;
+	}
+
+	DvbEpgLangEntry allLangs; // all languages joined together
+	DvbEpgLangEntry firstLang;
+	bool valid;
+};
+
 class DvbEpgEntry : public SharedData
 {
 public:
@@ -67,137 +96,25 @@ public:
 
 	DvbSharedRecording recording;
 
-	QString title(QString lang = QString()) const {
-		QString s;
-
-		if (!lang.isEmpty()) {
-			/*
-			 * Only return the user requested data
-			 * ISO-639-2 code if the title is filled.
-			 *
-			 * If it isn't, show first language
-			 */
-			if (langEntry[lang].title.isEmpty())
-				lang = FIRST_LANG;
-			else if (lang != FIRST_LANG)
-				return langEntry[lang].title;
-		}
-
-		QHashIterator<QString, DvbEpgLangEntry> i(langEntry);
-		bool first = true;
-
-		while (i.hasNext()) {
-			i.next();
-
-			QString code = i.key();
-			DvbEpgLangEntry entry = i.value();
-
-			if (!entry.title.isEmpty()) {
-				if (first)
-					first = false;
-				else
-					s += "/";
-
-				if (langEntry.size() > 1 && (lang != FIRST_LANG && code != FIRST_LANG)) {
-					s += code;
-					s += ": ";
-				}
-				s += entry.title;
-			}
-
-			if (lang == FIRST_LANG)
-				break;
-		}
-		return s;
+	QString title(const QString &lang = QString()) const
+	{
+		return displayString(&DvbEpgLangEntry::title, lang);
 	}
 
-	QString subheading(QString lang = QString()) const {
-		QString s;
-
-		if (!lang.isEmpty()) {
-			/*
-			 * Only return the user requested data
-			 * ISO-639-2 code if the subheading is filled.
-			 *
-			 * If it isn't, show first language
-			 */
-			if (langEntry[lang].subheading.isEmpty())
-				lang = FIRST_LANG;
-			else if (lang != FIRST_LANG)
-				return langEntry[lang].subheading;
-		}
-
-		QHashIterator<QString, DvbEpgLangEntry> i(langEntry);
-		bool first = true;
-
-		while (i.hasNext()) {
-			i.next();
-
-			QString code = i.key();
-			DvbEpgLangEntry entry = i.value();
-
-			if (!entry.subheading.isEmpty()) {
-				if (first)
-					first = false;
-				else
-					s += "/";
-
-				if (langEntry.size() > 1 && (lang != FIRST_LANG && code != FIRST_LANG)) {
-					s += code;
-					s += ": ";
-				}
-				s += entry.subheading;
-			}
-
-			if (lang == FIRST_LANG)
-				break;
-		}
-		return s;
+	QString subheading(const QString &lang = QString()) const
+	{
+		return displayString(&DvbEpgLangEntry::subheading, lang);
 	}
 
-	QString details(QString lang = QString()) const {
-		QString s;
-
-		if (!lang.isEmpty()) {
-			/*
-			 * Only return the user requested data
-			 * ISO-639-2 code if the details are filled.
-			 *
-			 * If it isn't, show first language
-			 */
-			if (langEntry[lang].details.isEmpty())
-				lang = FIRST_LANG;
-			else if (lang != FIRST_LANG)
-				return langEntry[lang].details;
-		}
-
-		QHashIterator<QString, DvbEpgLangEntry> i(langEntry);
-		bool first = true;
-
-		while (i.hasNext()) {
-			i.next();
-
-			QString code = i.key();
-			DvbEpgLangEntry entry = i.value();
-
-			if (!entry.details.isEmpty()) {
-				if (first)
-					first = false;
-				else
-					s += "\n\n";
+	QString details(const QString &lang = QString()) const
+	{
+		return displayString(&DvbEpgLangEntry::details, lang);
+	}
 
-				if (langEntry.size() > 1 && (lang != FIRST_LANG && code != FIRST_LANG)) {
-					s += code;
-					s += ": ";
-				}
-				s += entry.details;
-			}
+	// precomputes the strings returned by title(), subheading() and details();
+	// has to be called again whenever langEntry is modified
 
-			if (lang == FIRST_LANG)
-				break;
-		}
-		return s;
-	}
+	void updateDisplayStrings();
 
 	// Check only the user-visible elements
 	bool operator==(const DvbEpgEntry &other) const
@@ -215,13 +132,13 @@ public:
 		while (i.hasNext()) {
 			i.next();
 
-			QString code = i.key();
+			const QString &code = i.key();
 
 			if (!other.langEntry.contains(code))
 				return false;
 
-			DvbEpgLangEntry thisEntry = i.value();
-			DvbEpgLangEntry otherEntry = other.langEntry[code];
+			const DvbEpgLangEntry &thisEntry = i.value();
+			const DvbEpgLangEntry &otherEntry = *other.langEntry.constFind(code);
 
 			if (thisEntry.title != otherEntry.title)
 				return false;
@@ -236,6 +153,12 @@ public:
 
 		return true;
 	}
+
+private:
+	QString displayString(QString DvbEpgLangEntry::*member, const QString &lang) const;
+	QString joinLangEntries(QString DvbEpgLangEntry::*member, bool firstOnly) const;
+
+	DvbEpgDisplayStrings displayStrings;
 };
 
 typedef ExplicitlySharedDataPointer<const DvbEpgEntry> DvbSharedEpgEntry;
@@ -266,7 +189,13 @@ public:
 	DvbEpgModel(DvbManager *manager_, QObject *parent);
 	~DvbEpgModel();
 
-	QMap<DvbEpgEntryId, DvbSharedEpgEntry> getEntries() const;
+	// the stored entries are read on a worker thread after construction
+	bool isLoaded() const
+	{
+		return loaded;
+	}
+
+	QMap<DvbEpgEntryId, DvbSharedEpgEntry> getEntries(); // emits pending entriesAdded()
 	QMap<DvbSharedRecording, DvbSharedEpgEntry> getRecordings() const;
 	void setRecordings(const QMap<DvbSharedRecording, DvbSharedEpgEntry> map);
 	QHash<DvbSharedChannel, int> getEpgChannels() const;
@@ -280,36 +209,56 @@ public:
 	void stopEventFilter(DvbDevice *device, const DvbSharedChannel &channel);
 
 signals:
-	void entryAdded(const DvbSharedEpgEntry &entry);
+	// new entries are emitted in batches; pending entries are always emitted
+	// before any of the other entry signals
+	void entriesAdded(const QVector<DvbSharedEpgEntry> &entries);
 	// updating doesn't change the entry pointer (modifies existing content)
 	void entryAboutToBeUpdated(const DvbSharedEpgEntry &entry);
 	void entryUpdated(const DvbSharedEpgEntry &entry);
-	void entryRemoved(const DvbSharedEpgEntry &entry);
+	void entriesRemoved(const QVector<DvbSharedEpgEntry> &entries);
 	void epgChannelAdded(const DvbSharedChannel &channel);
 	void epgChannelRemoved(const DvbSharedChannel &channel);
 	void languageAdded(const QString lang);
+	// the stored entries have been added
+	void epgLoaded();
 
 private slots:
 	void channelAboutToBeUpdated(const DvbSharedChannel &channel);
 	void channelUpdated(const DvbSharedChannel &channel);
 	void channelRemoved(const DvbSharedChannel &channel);
 	void recordingRemoved(const DvbSharedRecording &recording);
+	void emitAddedEntries();
+	void addLoadedEntries();
 
 private:
 	void timerEvent(QTimerEvent *event) override;
 	void Debug(QString text, const DvbSharedEpgEntry &entry);
 
+	// the removed entries are emitted by emitRemovedEntries()
 	Iterator removeEntry(Iterator it);
+	void emitRemovedEntries();
+	static qint64 endTime(const DvbEpgEntry *entry); // ms since epoch
+	static void writeEntry(QDataStream &stream, const DvbEpgEntry &entry,
+		const QString &channelName, const SqlKey &recordingKey);
 
 	DvbManager *manager;
 	QDateTime currentDateTimeUtc;
 	QMap<DvbEpgEntryId, DvbSharedEpgEntry> entries;
 	QMap<DvbSharedRecording, DvbSharedEpgEntry> recordings;
 	QHash<DvbSharedChannel, int> epgChannels;
+	QVector<DvbSharedEpgEntry> addedEntries;
+	QVector<DvbSharedEpgEntry> removedEntries;
+	QMultiMap<qint64, const DvbEpgEntry *> expiryIndex; // end time -> entry
+	QTimer addedEntriesTimer;
 	QList<QExplicitlySharedDataPointer<DvbEpgFilter> > dvbEpgFilters;
 	QList<QExplicitlySharedDataPointer<AtscEpgFilter> > atscEpgFilters;
 	DvbChannel updatingChannel;
 	bool hasPendingOperation;
+	DvbEpgLoader *loader;
+	int loaderIndex; // next entry to be added from the loader
+	bool loaded;
+	MetricsGauge *entriesGauge;
+	MetricsGauge *channelsGauge;
 };
 
 #endif /* DVBEPG_H */
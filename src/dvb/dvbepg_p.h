@@ -21,6 +21,7 @@
 #ifndef DVBEPG_P_H
 #define DVBEPG_P_H
 
+#include <QThread>
 #include "dvbbackenddevice.h"
 #include "dvbepg.h"
 #include "dvbsi.h"
@@ -29,6 +30,38 @@ class DvbContentDescriptor;
 class DvbParentalRatingDescriptor;
 class DvbEpgLangEntry;
 
+class DvbEpgLoadedEntry
+{
+public:
+	DvbEpgLoadedEntry() { }
+	~DvbEpgLoadedEntry() { }
+
+	DvbEpgEntry entry; // channel and recording aren't resolved yet
+	QString channelName;
+	SqlKey recordingKey;
+};
+
+/*
+ * reads epgdata.dvb; the channels and recordings are resolved by DvbEpgModel
+ * on the main thread after the loader has finished
+ */
+
+class DvbEpgLoader : public QThread
+{
+public:
+	explicit DvbEpgLoader(const QString &fileName_) : fileName(fileName_) { }
+	~DvbEpgLoader() { }
+
+	// only valid after the thread has finished
+	QList<DvbEpgLoadedEntry> loadedEntries;
+	QStringList languageCodes;
+
+private:
+	void run() override;
+
+	QString fileName;
+};
+
 class DvbEpgFilter : public QSharedData, public DvbSectionFilter
 {
 public:
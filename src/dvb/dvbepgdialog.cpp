@@ -414,14 +414,14 @@ void DvbEpgTableModel::setEpgModel(DvbEpgModel *epgModel_)
 	}
 
 	epgModel = epgModel_;
-	connect(epgModel, SIGNAL(entryAdded(DvbSharedEpgEntry)),
-		this, SLOT(entryAdded(DvbSharedEpgEntry)));
+	connect(epgModel, SIGNAL(entriesAdded(QVector<DvbSharedEpgEntry>)),
+		this, SLOT(entriesAdded(QVector<DvbSharedEpgEntry>)));
 	connect(epgModel, SIGNAL(entryAboutToBeUpdated(DvbSharedEpgEntry)),
 		this, SLOT(entryAboutToBeUpdated(DvbSharedEpgEntry)));
 	connect(epgModel, SIGNAL(entryUpdated(DvbSharedEpgEntry)),
 		this, SLOT(entryUpdated(DvbSharedEpgEntry)));
-	connect(epgModel, SIGNAL(entryRemoved(DvbSharedEpgEntry)),
-		this, SLOT(entryRemoved(DvbSharedEpgEntry)));
+	connect(epgModel, SIGNAL(entriesRemoved(QVector<DvbSharedEpgEntry>)),
+		this, SLOT(entriesRemoved(QVector<DvbSharedEpgEntry>)));
 }
 
 void DvbEpgTableModel::setChannelFilter(const DvbSharedChannel &channel)
@@ -507,9 +507,9 @@ void DvbEpgTableModel::setContentFilter(const QString &pattern)
 	}
 }
 
-void DvbEpgTableModel::entryAdded(const DvbSharedEpgEntry &entry)
+void DvbEpgTableModel::entriesAdded(const QVector<DvbSharedEpgEntry> &entries)
 {
-	insert(entry);
+	insertItems(entries);
 }
 
 void DvbEpgTableModel::entryAboutToBeUpdated(const DvbSharedEpgEntry &entry)
@@ -522,9 +522,9 @@ void DvbEpgTableModel::entryUpdated(const DvbSharedEpgEntry &entry)
 	update(entry);
 }
 
-void DvbEpgTableModel::entryRemoved(const DvbSharedEpgEntry &entry)
+void DvbEpgTableModel::entriesRemoved(const QVector<DvbSharedEpgEntry> &entries)
 {
-	remove(entry);
+	removeItems(entries);
 }
 
 void DvbEpgTableModel::customEvent(QEvent *event)
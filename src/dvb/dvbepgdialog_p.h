@@ -137,10 +137,10 @@ public slots:
 	void setContentFilter(const QString &pattern);
 
 private slots:
-	void entryAdded(const DvbSharedEpgEntry &entry);
+	void entriesAdded(const QVector<DvbSharedEpgEntry> &entries);
 	void entryAboutToBeUpdated(const DvbSharedEpgEntry &entry);
 	void entryUpdated(const DvbSharedEpgEntry &entry);
-	void entryRemoved(const DvbSharedEpgEntry &entry);
+	void entriesRemoved(const QVector<DvbSharedEpgEntry> &entries);
 
 private:
 	void customEvent(QEvent *event) override;
@@ -0,0 +1,512 @@
+/*
+ * dvbepgharvester.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../log.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+#include "dvbdevice.h"
+#include "dvbepg.h"
+#include "dvbepgharvester.h"
+#include "dvbmanager.h"
+#include "dvbrecording.h"
+#include "dvbsi.h"
+
+// a visited transponder isn't visited again before its schedule became stale
+static const int RevisitInterval = 6 * 3600; // seconds
+
+static const int IdleInterval = 60000; // ms
+static const int MaxIdleInterval = 1800000; // ms; picks up newly scanned channels
+static const int NextVisitDelay = 5000; // ms
+static const int TuneTimeout = 30000; // ms
+static const int NoScheduleTimeout = 20000; // ms
+static const int MaxScheduleDwellTime = 300000; // ms
+static const int AtscDwellTime = 90000; // ms
+
+DvbEitScheduleService::DvbEitScheduleService() : lastTableId(-1), sections(16 * 256)
+{
+	for (int i = 0; i < 16; ++i) {
+		versions[i] = -1;
+		lastSectionNumbers[i] = -1;
+	}
+
+	for (int i = 0; i < (16 * 32); ++i) {
+		segmentLastSectionNumbers[i] = -1;
+	}
+}
+
+bool DvbEitScheduleService::isComplete() const
+{
+	if (lastTableId < 0) {
+		return false;
+	}
+
+	for (int table = 0; table <= lastTableId; ++table) {
+		int lastSectionNumber = lastSectionNumbers[table];
+
+		if (lastSectionNumber < 0) {
+			return false;
+		}
+
+		// the sections are organised in segments of eight sections each
+
+		for (int segment = 0; segment <= (lastSectionNumber / 8); ++segment) {
+			int segmentLastSectionNumber = segmentLastSectionNumbers[table * 32 + segment];
+
+			if (segmentLastSectionNumber < 0) {
+				return false;
+			}
+
+			segmentLastSectionNumber =
+				qBound(segment * 8, segmentLastSectionNumber, segment * 8 + 7);
+
+			for (int section = segment * 8; section <= segmentLastSectionNumber; ++section) {
+				if (!sections.testBit(table * 256 + section)) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void DvbEitScheduleTracker::reset()
+{
+	services.clear();
+	sectionCount = 0;
+}
+
+bool DvbEitScheduleTracker::isComplete() const
+{
+	if (services.isEmpty()) {
+		return false;
+	}
+
+	foreach (const DvbEitScheduleService &service, services) {
+		if (!service.isComplete()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+QSet<QPair<int, int> > DvbEitScheduleTracker::getOtherTransportStreams() const
+{
+	QSet<QPair<int, int> > transportStreams;
+	QSet<QPair<int, int> > incompleteTransportStreams;
+
+	for (QHash<quint64, DvbEitScheduleService>::ConstIterator it = services.constBegin();
+	     it != services.constEnd(); ++it) {
+		if ((it.key() >> 48) == 0) {
+			continue;
+		}
+
+		QPair<int, int> transportStream(int((it.key() >> 32) & 0xffff),
+			int((it.key() >> 16) & 0xffff));
+
+		if (it->isComplete()) {
+			transportStreams.insert(transportStream);
+		} else {
+			incompleteTransportStreams.insert(transportStream);
+		}
+	}
+
+	return transportStreams.subtract(incompleteTransportStreams);
+}
+
+void DvbEitScheduleTracker::processSection(const char *data, int size)
+{
+	unsigned char tableId = data[0];
+
+	if ((tableId < 0x50) || (tableId > 0x6f)) {
+		return;
+	}
+
+	DvbEitSection eitSection(data, size);
+
+	if (!eitSection.isValid()) {
+		return;
+	}
+
+	quint64 key = ((quint64((tableId >= 0x60) ? 1 : 0) << 48) |
+		(quint64(eitSection.originalNetworkId()) << 32) |
+		(quint64(eitSection.transportStreamId()) << 16) |
+		quint64(eitSection.serviceId()));
+	DvbEitScheduleService &service = services[key];
+	int table = (tableId & 0x0f);
+
+	if (service.versions[table] != eitSection.versionNumber()) {
+		service.versions[table] = eitSection.versionNumber();
+		service.lastSectionNumbers[table] = -1;
+
+		for (int i = 0; i < 32; ++i) {
+			service.segmentLastSectionNumbers[table * 32 + i] = -1;
+		}
+
+		service.sections.fill(false, table * 256, (table + 1) * 256);
+	}
+
+	int sectionNumber = eitSection.sectionNumber();
+	service.lastTableId = (eitSection.lastTableId() & 0x0f);
+	service.lastSectionNumbers[table] = eitSection.lastSectionNumber();
+	service.segmentLastSectionNumbers[table * 32 + sectionNumber / 8] =
+		eitSection.segmentLastSectionNumber();
+	service.sections.setBit(table * 256 + sectionNumber);
+	++sectionCount;
+}
+
+static QString transponderKey(const DvbSharedChannel &channel)
+{
+	return (channel->source + QLatin1Char('\n') + channel->transponder.toString());
+}
+
+class DvbEpgHarvesterCandidate
+{
+public:
+	DvbEpgHarvesterCandidate() : channelsWithoutEpg(0), carriesOtherTs(false) { }
+	~DvbEpgHarvesterCandidate() { }
+
+	// the transponders which give the best coverage per visit come first
+	bool operator<(const DvbEpgHarvesterCandidate &other) const
+	{
+		if (carriesOtherTs != other.carriesOtherTs) {
+			return carriesOtherTs;
+		}
+
+		if (channelsWithoutEpg != other.channelsWithoutEpg) {
+			return (channelsWithoutEpg > other.channelsWithoutEpg);
+		}
+
+		if (lastVisit.isValid() != other.lastVisit.isValid()) {
+			return !lastVisit.isValid();
+		}
+
+		return (lastVisit < other.lastVisit);
+	}
+
+	DvbSharedChannel channel;
+	int channelsWithoutEpg;
+	bool carriesOtherTs;
+	QDateTime lastVisit;
+};
+
+DvbEpgHarvester::DvbEpgHarvester(DvbManager *manager_, QObject *parent) : QObject(parent),
+	manager(manager_), enabled(false), dirty(false), device(NULL)
+{
+	idleTimer.setSingleShot(true);
+	connect(&idleTimer, SIGNAL(timeout()), this, SLOT(startVisit()));
+	visitTimer.setInterval(2000);
+	connect(&visitTimer, SIGNAL(timeout()), this, SLOT(checkVisit()));
+	load();
+}
+
+DvbEpgHarvester::~DvbEpgHarvester()
+{
+	enabled = false;
+
+	if (device != NULL) {
+		stopVisit(VisitAborted);
+	}
+
+	if (dirty) {
+		save();
+	}
+}
+
+void DvbEpgHarvester::setEnabled(bool enabled_)
+{
+	enabled = enabled_;
+
+	if (!enabled) {
+		idleTimer.stop();
+
+		if (device != NULL) {
+			stopVisit(VisitAborted);
+		}
+	} else if ((device == NULL) && !idleTimer.isActive()) {
+		scheduleVisit(IdleInterval);
+	}
+}
+
+QList<DvbEpgHarvesterCandidate> DvbEpgHarvester::getStaleTransponders(int *secsUntilStale) const
+{
+	QDateTime currentDateTime = QDateTime::currentDateTime().toUTC();
+	QHash<DvbSharedChannel, int> epgChannels = manager->getEpgModel()->getEpgChannels();
+	QHash<QString, DvbEpgHarvesterCandidate> candidateMap;
+
+	foreach (const DvbSharedChannel &currentChannel,
+		 manager->getChannelModel()->getChannels()) {
+		DvbEpgHarvesterCandidate &candidate = candidateMap[transponderKey(currentChannel)];
+
+		if (!candidate.channel.isValid()) {
+			candidate.channel = currentChannel;
+		}
+
+		if (!epgChannels.contains(currentChannel)) {
+			++candidate.channelsWithoutEpg;
+		}
+	}
+
+	QList<DvbEpgHarvesterCandidate> candidates;
+	*secsUntilStale = RevisitInterval;
+
+	for (QHash<QString, DvbEpgHarvesterCandidate>::Iterator it = candidateMap.begin();
+	     it != candidateMap.end(); ++it) {
+		const DvbEpgHarvesterTransponder transponder = transponders.value(it.key());
+
+		if (transponder.lastVisit.isValid()) {
+			qint64 secs = transponder.lastVisit.secsTo(currentDateTime);
+
+			if (secs < RevisitInterval) {
+				*secsUntilStale = qMin(*secsUntilStale, int(RevisitInterval - secs));
+				continue;
+			}
+		}
+
+		it->carriesOtherTs = transponder.carriesOtherTs;
+		it->lastVisit = transponder.lastVisit;
+		candidates.append(*it);
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	return candidates;
+}
+
+void DvbEpgHarvester::scheduleVisit(int delay)
+{
+	int secsUntilStale;
+
+	if (getStaleTransponders(&secsUntilStale).isEmpty()) {
+		// sleep until the first schedule becomes stale
+		delay = qBound(delay, secsUntilStale * 1000, MaxIdleInterval);
+	}
+
+	idleTimer.start(delay);
+}
+
+void DvbEpgHarvester::startVisit()
+{
+	if (!enabled || (device != NULL)) {
+		return;
+	}
+
+	if (manager->disableEpg()) {
+		idleTimer.start(IdleInterval);
+		return;
+	}
+
+	int secsUntilStale;
+	QList<DvbEpgHarvesterCandidate> candidates = getStaleTransponders(&secsUntilStale);
+
+	if (candidates.isEmpty()) {
+		idleTimer.start(qBound(IdleInterval, secsUntilStale * 1000, MaxIdleInterval));
+		return;
+	}
+
+	foreach (const DvbEpgHarvesterCandidate &candidate, candidates) {
+		device = manager->requestDevice(candidate.channel->source,
+			candidate.channel->transponder, DvbManager::Speculative);
+
+		if (device != NULL) {
+			channel = candidate.channel;
+			break;
+		}
+	}
+
+	if (device == NULL) {
+		// no idle device
+		idleTimer.start(IdleInterval);
+		return;
+	}
+
+	qCDebug(logEpg, "Harvesting epg on transponder %s of source %s",
+		qPrintable(channel->transponder.toString()), qPrintable(channel->source));
+	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+	scheduleTracker.reset();
+
+	if (channel->transponder.getTransmissionType() != DvbTransponderBase::Atsc) {
+		device->addSectionFilter(0x12, &scheduleTracker, DvbDevice::EpgPriority);
+	}
+
+	manager->getEpgModel()->startEventFilter(device, channel);
+	visitTime.start();
+	visitTimer.start();
+}
+
+void DvbEpgHarvester::checkVisit()
+{
+	qint64 elapsed = visitTime.elapsed();
+
+	if (device->getDeviceState() != DvbDevice::DeviceTuned) {
+		if (elapsed >= TuneTimeout) {
+			qCDebug(logEpg, "Harvesting epg: cannot tune to %s",
+				qPrintable(channel->transponder.toString()));
+			stopVisit(VisitFailed);
+		}
+
+		return;
+	}
+
+	if (channel->transponder.getTransmissionType() == DvbTransponderBase::Atsc) {
+		// the atsc tables don't tell when the guide is complete
+		if (elapsed >= AtscDwellTime) {
+			stopVisit(VisitFinished);
+		}
+
+		return;
+	}
+
+	if (scheduleTracker.isComplete() ||
+	    ((scheduleTracker.getSectionCount() == 0) && (elapsed >= NoScheduleTimeout)) ||
+	    (elapsed >= MaxScheduleDwellTime)) {
+		stopVisit(VisitFinished);
+	}
+}
+
+void DvbEpgHarvester::deviceStateChanged()
+{
+	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
+		// the device has been taken over by another request; don't release it
+		qCDebug(logEpg, "Harvesting epg: yielding device");
+		stopVisit(VisitInterrupted);
+	}
+}
+
+void DvbEpgHarvester::stopVisit(VisitResult result)
+{
+	visitTimer.stop();
+	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+
+	if (channel->transponder.getTransmissionType() != DvbTransponderBase::Atsc) {
+		device->removeSectionFilter(0x12, &scheduleTracker);
+	}
+
+	manager->getEpgModel()->stopEventFilter(device, channel);
+
+	if (result != VisitInterrupted) {
+		manager->releaseDevice(device, DvbManager::Speculative);
+	}
+
+	if ((result == VisitFinished) || (result == VisitFailed)) {
+		QDateTime currentDateTime = QDateTime::currentDateTime().toUTC();
+		DvbEpgHarvesterTransponder &transponder = transponders[transponderKey(channel)];
+		transponder.lastVisit = currentDateTime;
+		dirty = true;
+
+		if (result == VisitFinished) {
+			QSet<QPair<int, int> > otherTransportStreams =
+				scheduleTracker.getOtherTransportStreams();
+			transponder.carriesOtherTs = !otherTransportStreams.isEmpty();
+
+			// the schedules of these transponders have been collected as well
+
+			foreach (const DvbSharedChannel &otherChannel,
+				 manager->getChannelModel()->getChannels()) {
+				if ((otherChannel->source == channel->source) &&
+				    otherTransportStreams.contains(qMakePair(otherChannel->networkId,
+					otherChannel->transportStreamId))) {
+					transponders[transponderKey(otherChannel)].lastVisit =
+						currentDateTime;
+				}
+			}
+
+			qCDebug(logEpg, "Harvesting epg: %d schedule sections after %d s",
+				scheduleTracker.getSectionCount(), int(visitTime.elapsed() / 1000));
+
+			// let the recording rules see the new entries
+			DvbRecordingModel *recordingModel = manager->getRecordingModel();
+			recordingModel->findNewRecordings();
+			recordingModel->removeDuplicates();
+			recordingModel->disableConflicts();
+		}
+	}
+
+	device = NULL;
+	channel = DvbSharedChannel();
+	scheduleTracker.reset();
+
+	if (enabled) {
+		scheduleVisit((result == VisitFinished) ? NextVisitDelay : IdleInterval);
+	}
+}
+
+void DvbEpgHarvester::load()
+{
+	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/epgharvester.dvb"));
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	int version;
+	stream >> version;
+
+	if (version != 0x20260101) {
+		qCWarning(logEpg, "Wrong version for: %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	while (!stream.atEnd()) {
+		QString key;
+		DvbEpgHarvesterTransponder transponder;
+		stream >> key;
+		stream >> transponder.lastVisit;
+		stream >> transponder.carriesOtherTs;
+
+		if (stream.status() != QDataStream::Ok) {
+			qCWarning(logEpg, "Corrupt data %s", qPrintable(file.fileName()));
+			break;
+		}
+
+		transponders.insert(key, transponder);
+	}
+}
+
+void DvbEpgHarvester::save() const
+{
+	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/epgharvester.dvb"));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(logEpg, "Cannot open %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	int version = 0x20260101;
+	stream << version;
+
+	for (QHash<QString, DvbEpgHarvesterTransponder>::ConstIterator it =
+	     transponders.constBegin(); it != transponders.constEnd(); ++it) {
+		stream << it.key();
+		stream << it->lastVisit;
+		stream << it->carriesOtherTs;
+	}
+}
+
+#include "moc_dvbepgharvester.cpp"
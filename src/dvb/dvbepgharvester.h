@@ -0,0 +1,147 @@
+/*
+ * dvbepgharvester.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBEPGHARVESTER_H
+#define DVBEPGHARVESTER_H
+
+#include <QBitArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QTimer>
+#include "dvbbackenddevice.h"
+#include "dvbchannel.h"
+
+class DvbDevice;
+class DvbEpgHarvesterCandidate;
+class DvbManager;
+
+class DvbEitScheduleService
+{
+public:
+	DvbEitScheduleService();
+	~DvbEitScheduleService() { }
+
+	bool isComplete() const;
+
+	// indexes are relative to the first table id (0x50 or 0x60)
+
+	int lastTableId; // -1 = no section received yet
+	int versions[16];
+	int lastSectionNumbers[16];
+	int segmentLastSectionNumbers[16 * 32];
+	QBitArray sections; // 16 * 256 bits
+};
+
+/*
+ * keeps track of the eit schedule sections (table ids 0x50 - 0x6f) of a
+ * transport stream; the schedule of a service is complete once all sections
+ * announced by last_table_id, last_section_number and
+ * segment_last_section_number have been received
+ */
+
+class DvbEitScheduleTracker : public DvbSectionFilter
+{
+public:
+	DvbEitScheduleTracker() : sectionCount(0) { }
+	~DvbEitScheduleTracker() { }
+
+	void reset();
+	bool isComplete() const;
+
+	int getSectionCount() const
+	{
+		return sectionCount;
+	}
+
+	// (original network id, transport stream id) of the complete other ts schedules
+	QSet<QPair<int, int> > getOtherTransportStreams() const;
+
+private:
+	void processSection(const char *data, int size) override;
+
+	QHash<quint64, DvbEitScheduleService> services;
+	int sectionCount;
+};
+
+class DvbEpgHarvesterTransponder
+{
+public:
+	DvbEpgHarvesterTransponder() : carriesOtherTs(false) { }
+	~DvbEpgHarvesterTransponder() { }
+
+	QDateTime lastVisit; // UTC; invalid means never visited
+	bool carriesOtherTs;
+};
+
+/*
+ * collects epg data on idle devices: the transponders are visited one after
+ * another (the ones carrying other ts schedules and the ones with the most
+ * channels without epg first) and the device stays tuned until the eit
+ * schedule is complete; devices are requested speculatively, so that any
+ * other request (e.g. a recording) takes them over immediately; a transponder
+ * is only revisited once its schedule became stale and the visit times are
+ * kept across restarts
+ */
+
+class DvbEpgHarvester : public QObject
+{
+	Q_OBJECT
+public:
+	DvbEpgHarvester(DvbManager *manager_, QObject *parent);
+	~DvbEpgHarvester();
+
+	void setEnabled(bool enabled_);
+
+private slots:
+	void startVisit();
+	void checkVisit();
+	void deviceStateChanged();
+
+private:
+	enum VisitResult {
+		VisitFinished,
+		VisitFailed,
+		VisitInterrupted, // the device has been taken over
+		VisitAborted
+	};
+
+	// the transponders whose schedule is stale, best candidate first
+	QList<DvbEpgHarvesterCandidate> getStaleTransponders(int *secsUntilStale) const;
+	void scheduleVisit(int delay);
+	void stopVisit(VisitResult result);
+	void load();
+	void save() const;
+
+	DvbManager *manager;
+	bool enabled;
+	bool dirty;
+	QHash<QString, DvbEpgHarvesterTransponder> transponders;
+	QTimer idleTimer;
+	QTimer visitTimer;
+	QElapsedTimer visitTime;
+	DvbDevice *device;
+	DvbSharedChannel channel; // one of the channels on the visited transponder
+	DvbEitScheduleTracker scheduleTracker;
+};
+
+#endif /* DVBEPGHARVESTER_H */
@@ -0,0 +1,163 @@
+/*
+ * dvbhealthdialog.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../log.h"
+
+#include <QBoxLayout>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLocale>
+#include <QSet>
+#include <QTreeWidget>
+
+#include "dvbhealthdialog.h"
+#include "dvbtsanalyzer.h"
+
+DvbHealthDialog::DvbHealthDialog(DvbManager *manager_, QWidget *parent) : QDialog(parent),
+	manager(manager_)
+{
+	setWindowTitle(i18nc("@title:window", "Stream Health"));
+
+	QBoxLayout *mainLayout = new QVBoxLayout;
+	setLayout(mainLayout);
+
+	QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+	connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+	connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+	treeWidget = new QTreeWidget(this);
+	treeWidget->setHeaderLabels(QStringList() << i18nc("@title:column", "Name") <<
+		i18nc("@title:column", "Packets") <<
+		i18nc("@title:column", "Continuity Errors") <<
+		i18nc("@title:column", "Transport Errors") <<
+		i18nc("@title:column", "Scrambled") <<
+		i18nc("@title:column", "PCR Interval Errors") <<
+		i18nc("@title:column", "Max. PCR Interval (ms)") <<
+		i18nc("@title:column", "Max. PCR Jitter (µs)") <<
+		i18nc("@title:column", "Bitrate (kbit/s)"));
+	treeWidget->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+	treeWidget->setToolTip(i18n("Transport errors are caused by bad reception; continuity errors without transport errors point to lost data in the computer."));
+
+	mainLayout->addWidget(treeWidget);
+	mainLayout->addWidget(buttonBox);
+
+	connect(&updateTimer, SIGNAL(timeout()), this, SLOT(updateReport()));
+	updateTimer.start(1000);
+	updateReport();
+
+	resize(120 * fontMetrics().averageCharWidth(), 25 * fontMetrics().height());
+}
+
+DvbHealthDialog::~DvbHealthDialog()
+{
+}
+
+void DvbHealthDialog::showDialog(DvbManager *manager_, QWidget *parent)
+{
+	QDialog *dialog = new DvbHealthDialog(manager_, parent);
+	dialog->setAttribute(Qt::WA_DeleteOnClose, true);
+	dialog->setModal(false);
+	dialog->show();
+}
+
+void DvbHealthDialog::updateReport()
+{
+	// the tree is rebuilt, so remember which items were expanded
+	QSet<QString> expandedItems;
+
+	for (int i = 0; i < treeWidget->topLevelItemCount(); ++i) {
+		QTreeWidgetItem *deviceItem = treeWidget->topLevelItem(i);
+
+		for (int j = 0; j < deviceItem->childCount(); ++j) {
+			if (deviceItem->child(j)->isExpanded()) {
+				expandedItems.insert(deviceItem->text(0) + QLatin1Char('/') +
+					deviceItem->child(j)->text(0));
+			}
+		}
+	}
+
+	treeWidget->clear();
+	QVariantMap report = DvbTsAnalyzer::createReport(manager);
+
+	for (QVariantMap::ConstIterator it = report.constBegin(); it != report.constEnd(); ++it) {
+		QVariantMap deviceReport = it->toMap();
+		QTreeWidgetItem *deviceItem = new QTreeWidgetItem(treeWidget);
+		deviceItem->setText(0, it.key());
+		deviceItem->setToolTip(0, deviceReport.value(QLatin1String("Source")).toString());
+		setColumns(deviceItem, deviceReport.value(QLatin1String("Mux")).toMap());
+
+		QTreeWidgetItem *servicesItem = new QTreeWidgetItem(deviceItem);
+		servicesItem->setText(0, i18nc("@item", "Services"));
+		QVariantMap services = deviceReport.value(QLatin1String("Services")).toMap();
+
+		for (QVariantMap::ConstIterator serviceIt = services.constBegin();
+		     serviceIt != services.constEnd(); ++serviceIt) {
+			QTreeWidgetItem *item = new QTreeWidgetItem(servicesItem);
+			item->setText(0, serviceIt.key());
+			setColumns(item, serviceIt->toMap());
+		}
+
+		QTreeWidgetItem *pidsItem = new QTreeWidgetItem(deviceItem);
+		pidsItem->setText(0, i18nc("@item", "PIDs"));
+		QVariantMap pids = deviceReport.value(QLatin1String("Pids")).toMap();
+		QMap<int, QVariantMap> sortedPids;
+
+		for (QVariantMap::ConstIterator pidIt = pids.constBegin(); pidIt != pids.constEnd();
+		     ++pidIt) {
+			sortedPids.insert(pidIt.key().toInt(), pidIt->toMap());
+		}
+
+		for (QMap<int, QVariantMap>::ConstIterator pidIt = sortedPids.constBegin();
+		     pidIt != sortedPids.constEnd(); ++pidIt) {
+			QTreeWidgetItem *item = new QTreeWidgetItem(pidsItem);
+			item->setText(0, QString::number(pidIt.key()));
+			setColumns(item, *pidIt);
+		}
+
+		deviceItem->setExpanded(true);
+		servicesItem->setExpanded(expandedItems.contains(it.key() + QLatin1Char('/') +
+			servicesItem->text(0)));
+		pidsItem->setExpanded(expandedItems.contains(it.key() + QLatin1Char('/') +
+			pidsItem->text(0)));
+	}
+}
+
+void DvbHealthDialog::setColumns(QTreeWidgetItem *item, const QVariantMap &statistics) const
+{
+	static const char *const keys[] = { "Packets", "ContinuityErrors", "TransportErrors",
+		"ScrambledPackets", "PcrIntervalErrors", "MaxPcrIntervalMs", "MaxPcrJitterUs" };
+	QLocale locale;
+
+	for (unsigned int i = 0; i < (sizeof(keys) / sizeof(keys[0])); ++i) {
+		item->setText(i + 1,
+			locale.toString(statistics.value(QLatin1String(keys[i])).toLongLong()));
+		item->setTextAlignment(i + 1, Qt::AlignRight | Qt::AlignVCenter);
+	}
+
+	int column = (sizeof(keys) / sizeof(keys[0])) + 1;
+	item->setText(column,
+		locale.toString(statistics.value(QLatin1String("Bitrate")).toLongLong() / 1000));
+	item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+
+	if ((statistics.value(QLatin1String("ContinuityErrors")).toLongLong() > 0) ||
+	    (statistics.value(QLatin1String("TransportErrors")).toLongLong() > 0)) {
+		item->setForeground(0, Qt::red);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ * dvbhealthdialog.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBHEALTHDIALOG_H
+#define DVBHEALTHDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+#include <QVariantMap>
+
+class QTreeWidget;
+class QTreeWidgetItem;
+class DvbManager;
+
+class DvbHealthDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	DvbHealthDialog(DvbManager *manager_, QWidget *parent);
+	~DvbHealthDialog();
+
+	static void showDialog(DvbManager *manager_, QWidget *parent);
+
+private slots:
+	void updateReport();
+
+private:
+	void setColumns(QTreeWidgetItem *item, const QVariantMap &statistics) const;
+
+	DvbManager *manager;
+	QTreeWidget *treeWidget;
+	QTimer updateTimer;
+};
+
+#endif /* DVBHEALTHDIALOG_H */
@@ -33,6 +33,8 @@
 #include <sys/types.h>  // bsd compatibility
 #include <unistd.h>
 
+#include "../metrics.h"
+#include "../zaplatency.h"
 #include "dvbdevice.h"
 #include "dvbliveview.h"
 #include "dvbliveview_p.h"
@@ -161,9 +163,11 @@ DvbLiveView::DvbLiveView(DvbManager *manager_, QObject *parent) :
 	internal->mediaWidget = mediaWidget;
 
 	connect(&internal->pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
-		this, SLOT(pmtSectionChanged(QByteArray)));
+		this, SLOT(pmtReceived(QByteArray)));
 	connect(&patPmtTimer, SIGNAL(timeout()), this, SLOT(insertPatPmt()));
 	connect(&osdTimer, SIGNAL(timeout()), this, SLOT(osdTimeout()));
+	predictionTimer.setSingleShot(true);
+	connect(&predictionTimer, SIGNAL(timeout()), this, SLOT(startPrediction()));
 
 	connect(internal, SIGNAL(currentAudioStreamChanged(int)),
 		this, SLOT(currentAudioStreamChanged(int)));
@@ -179,6 +183,7 @@ DvbLiveView::DvbLiveView(DvbManager *manager_, QObject *parent) :
 
 DvbLiveView::~DvbLiveView()
 {
+	qDeleteAll(preTunedChannels);
 }
 
 void DvbLiveView::replay()
@@ -205,6 +210,12 @@ void DvbLiveView::replay()
 		return;
 	}
 
+	ZapLatency::instance()->mark(ZapLatency::DeviceRequested);
+
+	if (device->getDeviceState() == DvbDevice::DeviceTuned) {
+		ZapLatency::instance()->mark(ZapLatency::DeviceTuned);
+	}
+
 	internal->channelName = channel->name;
 	internal->resetPipe();
 	mediaWidget->play(internal);
@@ -242,18 +253,121 @@ DvbDevice *DvbLiveView::getDevice() const
 void DvbLiveView::playChannel(const DvbSharedChannel &channel_)
 {
 	DvbDevice *newDevice = NULL;
+	DvbPreTunedChannel *preTunedChannel = NULL;
+
+	for (int i = 0; i < preTunedChannels.size(); ++i) {
+		if ((preTunedChannels.at(i)->channel == channel_) &&
+		    preTunedChannels.at(i)->isReady()) {
+			preTunedChannel = preTunedChannels.takeAt(i);
+			break;
+		}
+	}
 
-	if ((channel.constData() != NULL) && (channel->source == channel_->source) &&
+	if (preTunedChannel != NULL) {
+		// shares the device before the speculative use is given up
+		newDevice = manager->requestDevice(channel_->source, channel_->transponder,
+			DvbManager::Shared);
+	} else if ((channel.constData() != NULL) && (channel->source == channel_->source) &&
 	    (channel->transponder.corresponds(channel_->transponder))) {
 		newDevice = manager->requestDevice(channel->source, channel->transponder,
 			DvbManager::Shared);
 	}
 
-	playbackStatusChanged(MediaWidget::Idle);
+	// the other pre-tuned channels are kept across the zap
+	resetPlayback();
 	channel = channel_;
 	device = newDevice;
 
 	replay();
+
+	if (preTunedChannel != NULL) {
+		if ((device != NULL) && (channel == channel_)) {
+			// the pre-tuned channel has already received the pmt
+			ZapLatency::instance()->mark(ZapLatency::PmtReceived);
+
+			if (preTunedChannel->pmtSectionData != internal->pmtSectionData) {
+				pmtSectionChanged(preTunedChannel->pmtSectionData);
+			}
+
+			internal->injectPackets(preTunedChannel->packets, pids);
+		}
+
+		delete preTunedChannel;
+	}
+}
+
+void DvbLiveView::predictChannels(const QList<DvbSharedChannel> &channels)
+{
+	predictedChannels = channels;
+
+	// don't waste tuners while the user is zapping quickly
+	predictionTimer.start(2000);
+}
+
+void DvbLiveView::startPrediction()
+{
+	if (!manager->isPredictiveZap() || (device == NULL)) {
+		stopPrediction();
+		return;
+	}
+
+	for (int i = 0; i < preTunedChannels.size(); ++i) {
+		DvbPreTunedChannel *preTunedChannel = preTunedChannels.at(i);
+
+		if (!predictedChannels.contains(preTunedChannel->channel)) {
+			preTunedChannels.removeAt(i);
+			delete preTunedChannel;
+			--i;
+		}
+	}
+
+	foreach (const DvbSharedChannel &predictedChannel, predictedChannels) {
+		if (!predictedChannel.isValid() || (predictedChannel == channel)) {
+			continue;
+		}
+
+		bool found = false;
+
+		foreach (DvbPreTunedChannel *preTunedChannel, preTunedChannels) {
+			if (preTunedChannel->channel == predictedChannel) {
+				found = true;
+				break;
+			}
+		}
+
+		if (found) {
+			continue;
+		}
+
+		DvbPreTunedChannel *preTunedChannel =
+			new DvbPreTunedChannel(manager, predictedChannel, this);
+
+		if (preTunedChannel->start()) {
+			connect(preTunedChannel, SIGNAL(released()),
+				this, SLOT(preTunedChannelReleased()));
+			preTunedChannels.append(preTunedChannel);
+		} else {
+			delete preTunedChannel;
+		}
+	}
+}
+
+void DvbLiveView::preTunedChannelReleased()
+{
+	DvbPreTunedChannel *preTunedChannel = qobject_cast<DvbPreTunedChannel *>(sender());
+
+	if (preTunedChannels.removeOne(preTunedChannel)) {
+		// called from within the device state change
+		preTunedChannel->deleteLater();
+	}
+}
+
+void DvbLiveView::stopPrediction()
+{
+	predictionTimer.stop();
+	predictedChannels.clear();
+	qDeleteAll(preTunedChannels);
+	preTunedChannels.clear();
 }
 
 void DvbLiveView::toggleOsd()
@@ -283,12 +397,23 @@ void DvbLiveView::toggleOsd()
 	}
 }
 
+void DvbLiveView::pmtReceived(const QByteArray &pmtSectionData)
+{
+	// replay() starts with the cached pmt, which doesn't count
+	ZapLatency::instance()->mark(ZapLatency::PmtReceived);
+
+	if (pmtSectionData != internal->pmtSectionData) {
+		pmtSectionChanged(pmtSectionData);
+	}
+}
+
 void DvbLiveView::pmtSectionChanged(const QByteArray &pmtSectionData)
 {
 	internal->pmtSectionData = pmtSectionData;
 	DvbPmtSection pmtSection(internal->pmtSectionData);
 	DvbPmtParser pmtParser(pmtSection);
 	videoPid = pmtParser.videoPid;
+	ZapLatency::instance()->setHasVideo(videoPid != -1);
 
 	for (int i = 0;; ++i) {
 		if (i == pmtParser.audioPids.size()) {
@@ -378,11 +503,13 @@ void DvbLiveView::deviceStateChanged()
 			osdWidget->showText(i18nc("message box", "No available device found."), 2500);
 		}
 
+		break;
+	case DvbDevice::DeviceTuned:
+		ZapLatency::instance()->mark(ZapLatency::DeviceTuned);
 		break;
 	case DvbDevice::DeviceIdle:
 	case DvbDevice::DeviceRotorMoving:
 	case DvbDevice::DeviceTuning:
-	case DvbDevice::DeviceTuned:
 		break;
 	}
 }
@@ -409,29 +536,36 @@ void DvbLiveView::currentSubtitleChanged(int currentSubtitle)
 	updatePids();
 }
 
+void DvbLiveView::resetPlayback()
+{
+	if (device != NULL) {
+		stopDevice();
+		manager->releaseDevice(device, DvbManager::Shared);
+		device = NULL;
+	}
+
+	pids.clear();
+	patPmtTimer.stop();
+	osdTimer.stop();
+
+	internal->pmtSectionData.clear();
+	internal->patGenerator = DvbSectionGenerator();
+	internal->pmtGenerator = DvbSectionGenerator();
+	internal->buffer.clear();
+	internal->timeShiftFile.close();
+	internal->retryCounter = 0;
+	internal->updateUrl();
+	internal->dvbOsd.init(manager, DvbOsd::Off, QString(), QList<DvbSharedEpgEntry>());
+	osdWidget->hideObject();
+}
+
 void DvbLiveView::playbackStatusChanged(MediaWidget::PlaybackStatus playbackStatus)
 {
 	switch (playbackStatus) {
 	case MediaWidget::Idle:
-		if (device != NULL) {
-			stopDevice();
-			manager->releaseDevice(device, DvbManager::Shared);
-			device = NULL;
-		}
-
-		pids.clear();
-		patPmtTimer.stop();
-		osdTimer.stop();
-
-		internal->pmtSectionData.clear();
-		internal->patGenerator = DvbSectionGenerator();
-		internal->pmtGenerator = DvbSectionGenerator();
-		internal->buffer.clear();
-		internal->timeShiftFile.close();
-		internal->retryCounter = 0;
-		internal->updateUrl();
-		internal->dvbOsd.init(manager, DvbOsd::Off, QString(), QList<DvbSharedEpgEntry>());
-		osdWidget->hideObject();
+		resetPlayback();
+		stopPrediction();
+		ZapLatency::instance()->reset();
 		break;
 	case MediaWidget::Playing:
 		if (internal->timeShiftFile.isOpen()) {
@@ -499,10 +633,11 @@ void DvbLiveView::osdTimeout()
 void DvbLiveView::startDevice()
 {
 	foreach (int pid, pids) {
-		device->addPidFilter(pid, internal);
+		device->addPidFilter(pid, internal, DvbDevice::LiveViewPriority);
 	}
 
-	device->addSectionFilter(channel->pmtPid, &internal->pmtFilter);
+	device->addSectionFilter(channel->pmtPid, &internal->pmtFilter,
+		DvbDevice::PmtPriority);
 	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
 
 	if (channel->isScrambled && !internal->pmtSectionData.isEmpty()) {
@@ -578,7 +713,7 @@ void DvbLiveView::updatePids(bool forcePatPmtUpdate)
 	}
 
 	foreach (int pid, newPids) {
-		device->addPidFilter(pid, internal);
+		device->addPidFilter(pid, internal, DvbDevice::LiveViewPriority);
 		pids.append(pid);
 		updatePatPmt = true;
 	}
@@ -589,11 +724,162 @@ void DvbLiveView::updatePids(bool forcePatPmtUpdate)
 	}
 }
 
+DvbPreTunedChannel::DvbPreTunedChannel(DvbManager *manager_, const DvbSharedChannel &channel_,
+	QObject *parent) : QObject(parent), channel(channel_), manager(manager_), device(NULL),
+	videoPid(-1), hasRandomAccessPoint(false)
+{
+	connect(&pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
+		this, SLOT(pmtSectionChanged(QByteArray)));
+}
+
+DvbPreTunedChannel::~DvbPreTunedChannel()
+{
+	if (device != NULL) {
+		stopDevice();
+		manager->releaseDevice(device, DvbManager::Speculative);
+	}
+}
+
+bool DvbPreTunedChannel::start()
+{
+	device = manager->requestDevice(channel->source, channel->transponder,
+		DvbManager::Speculative);
+
+	if (device == NULL) {
+		return false;
+	}
+
+	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+	pmtFilter.setProgramNumber(channel->serviceId);
+	device->addSectionFilter(channel->pmtPid, &pmtFilter, DvbDevice::PmtPriority);
+	return true;
+}
+
+bool DvbPreTunedChannel::isReady() const
+{
+	return ((device != NULL) && (device->getDeviceState() == DvbDevice::DeviceTuned) &&
+		!pmtSectionData.isEmpty());
+}
+
+void DvbPreTunedChannel::pmtSectionChanged(const QByteArray &pmtSectionData_)
+{
+	if (device == NULL) {
+		return;
+	}
+
+	if (channel->isScrambled && !pmtSectionData.isEmpty()) {
+		device->stopDescrambling(pmtSectionData, this);
+	}
+
+	pmtSectionData = pmtSectionData_;
+	DvbPmtSection pmtSection(pmtSectionData);
+	DvbPmtParser pmtParser(pmtSection);
+	QSet<int> newPids;
+	videoPid = pmtParser.videoPid;
+
+	if (videoPid != -1) {
+		newPids.insert(videoPid);
+	}
+
+	for (int i = 0; i < pmtParser.audioPids.size(); ++i) {
+		newPids.insert(pmtParser.audioPids.at(i).first);
+	}
+
+	for (int i = 0; i < pmtParser.subtitlePids.size(); ++i) {
+		newPids.insert(pmtParser.subtitlePids.at(i).first);
+	}
+
+	if (pmtParser.teletextPid != -1) {
+		newPids.insert(pmtParser.teletextPid);
+	}
+
+	if (pmtSection.pcrPid() != 0x1fff) {
+		newPids.insert(pmtSection.pcrPid());
+	}
+
+	foreach (int pid, pids) {
+		if (!newPids.remove(pid)) {
+			device->removePidFilter(pid, this);
+			pids.removeAll(pid);
+		}
+	}
+
+	foreach (int pid, newPids) {
+		device->addPidFilter(pid, this, DvbDevice::LiveViewPriority);
+		pids.append(pid);
+	}
+
+	// packets are only buffered from a video random access point on
+	packets.clear();
+	hasRandomAccessPoint = false;
+
+	if (channel->isScrambled) {
+		device->startDescrambling(pmtSectionData, this);
+	}
+}
+
+void DvbPreTunedChannel::deviceStateChanged()
+{
+	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
+		// the device has been taken over by another request; don't release it
+		stopDevice();
+		device = NULL;
+		pmtSectionData.clear();
+		packets.clear();
+		emit released();
+	}
+}
+
+void DvbPreTunedChannel::processData(const char data[188])
+{
+	int pid = ((static_cast<unsigned char>(data[1]) << 8) |
+		static_cast<unsigned char>(data[2])) & ((1 << 13) - 1);
+
+	if ((pid == videoPid) && ((data[3] & 0x20) != 0) &&
+	    (static_cast<unsigned char>(data[4]) > 0) && ((data[5] & 0x40) != 0)) {
+		// random access indicator - playback can start here
+		packets.clear();
+		hasRandomAccessPoint = true;
+	}
+
+	if (!hasRandomAccessPoint) {
+		return;
+	}
+
+	if (packets.size() >= (16 * 1024 * 188)) {
+		// no random access point for too long
+		packets.clear();
+		hasRandomAccessPoint = false;
+		return;
+	}
+
+	packets.append(data, 188);
+}
+
+void DvbPreTunedChannel::stopDevice()
+{
+	if (channel->isScrambled && !pmtSectionData.isEmpty()) {
+		device->stopDescrambling(pmtSectionData, this);
+	}
+
+	foreach (int pid, pids) {
+		device->removePidFilter(pid, this);
+	}
+
+	pids.clear();
+	device->removeSectionFilter(channel->pmtPid, &pmtFilter);
+	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+}
+
 DvbLiveViewInternal::DvbLiveViewInternal(QObject *parent) :
 	QObject(parent), mediaWidget(NULL), emptyBuffer(true), timeshift(false),
 	currentAudioStream(-1), currentSubtitle(-1), retryCounter(0),
 	readFd(-1), writeFd(-1), notifier(NULL)
 {
+	pipeBacklogGauge = Metrics::instance()->gauge(
+		QLatin1String("kaffeine_dvb_live_pipe_backlog_bytes"),
+		QLatin1String("Live stream bytes waiting to be written to the player pipe"));
+
 	fileName = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation) + QLatin1String("/dvbpipe.m2t");
 	QFile::remove(fileName);
 
@@ -627,6 +913,8 @@ DvbLiveViewInternal::DvbLiveViewInternal(QObject *parent) :
 
 DvbLiveViewInternal::~DvbLiveViewInternal()
 {
+	pipeBacklogGauge->set(0);
+
 	if (writeFd >= 0) {
 		close(writeFd);
 	}
@@ -644,6 +932,7 @@ void DvbLiveViewInternal::resetPipe()
 	if (!buffers.isEmpty()) {
 		buffer = buffers.at(0);
 		buffers.clear();
+		updatePipeBacklog();
 	}
 
 	if (readFd >= 0) {
@@ -659,6 +948,19 @@ void DvbLiveViewInternal::resetPipe()
 	buffer.clear();
 }
 
+void DvbLiveViewInternal::injectPackets(const QByteArray &packets, const QList<int> &pids)
+{
+	for (int i = 0; (i + 188) <= packets.size(); i += 188) {
+		const char *packet = (packets.constData() + i);
+		int pid = ((static_cast<unsigned char>(packet[1]) << 8) |
+			static_cast<unsigned char>(packet[2])) & ((1 << 13) - 1);
+
+		if (pids.contains(pid)) {
+			processData(packet);
+		}
+	}
+}
+
 void DvbLiveViewInternal::writeToPipe()
 {
 	if (buffers.isEmpty()) {
@@ -679,6 +981,7 @@ void DvbLiveViewInternal::writeToPipe()
 			if (++retryCounter > 50) {
 				// Too much failures. Warn the user
 				qCWarning(logDvb, "Stream seems to be too havy to be displayed");
+				updatePipeBacklog();
 				return;
 			}
 
@@ -700,12 +1003,25 @@ void DvbLiveViewInternal::writeToPipe()
 		break;
 	} while (!buffers.isEmpty());
 
+	updatePipeBacklog();
+
 	if (!buffers.isEmpty()) {
 		// Wait for a notification that writeFd is ready to write
 		notifier->setEnabled(true);
 	}
 }
 
+void DvbLiveViewInternal::updatePipeBacklog()
+{
+	qint64 backlog = 0;
+
+	foreach (const QByteArray &pendingBuffer, buffers) {
+		backlog += pendingBuffer.size();
+	}
+
+	pipeBacklogGauge->set(backlog);
+}
+
 void DvbLiveViewInternal::validateCurrentTotalTime(int &currentTime, int &totalTime) const
 {
 	if (emptyBuffer)
@@ -735,6 +1051,7 @@ void DvbLiveViewInternal::processData(const char data[188])
 			if (emptyBuffer) {
 				startTime = QTime::currentTime();
 				emptyBuffer = false;
+				ZapLatency::instance()->mark(ZapLatency::FirstPacketWritten);
 			}
 		}
 	} else {
@@ -743,6 +1060,7 @@ void DvbLiveViewInternal::processData(const char data[188])
 		if (emptyBuffer) {
 			startTime = QTime::currentTime();
 			emptyBuffer = false;
+			ZapLatency::instance()->mark(ZapLatency::FirstPacketWritten);
 		}
 	}
 
@@ -28,6 +28,7 @@
 class DvbDevice;
 class DvbLiveViewInternal;
 class DvbManager;
+class DvbPreTunedChannel;
 
 class DvbLiveView : public QObject
 {
@@ -41,6 +42,9 @@ public:
 
 	void playChannel(const DvbSharedChannel &channel_);
 
+	// channels which are likely to be played next (see DvbManager::isPredictiveZap())
+	void predictChannels(const QList<DvbSharedChannel> &channels);
+
 public slots:
 	void toggleOsd();
 
@@ -49,11 +53,14 @@ signals:
 	void next();
 
 private slots:
+	void pmtReceived(const QByteArray &pmtSectionData);
 	void pmtSectionChanged(const QByteArray &pmtSectionData);
 	void insertPatPmt();
 	void deviceStateChanged();
 	void showOsd();
 	void osdTimeout();
+	void startPrediction();
+	void preTunedChannelReleased();
 
 	void currentAudioStreamChanged(int currentAudioStream);
 	void currentSubtitleChanged(int currentSubtitle);
@@ -65,6 +72,8 @@ private:
 	void startDevice();
 	void stopDevice();
 	void updatePids(bool forcePatPmtUpdate = false);
+	void resetPlayback();
+	void stopPrediction();
 
 	DvbManager *manager;
 	MediaWidget *mediaWidget;
@@ -76,6 +85,9 @@ private:
 	QList<int> pids;
 	QTimer patPmtTimer;
 	QTimer osdTimer;
+	QTimer predictionTimer;
+	QList<DvbSharedChannel> predictedChannels;
+	QList<DvbPreTunedChannel *> preTunedChannels;
 
 	int videoPid;
 	int audioPid;
@@ -29,6 +29,8 @@
 #include "dvbmanager.h"
 
 class QSocketNotifier;
+class DvbDevice;
+class MetricsGauge;
 
 class DvbOsd : public OsdObject
 {
@@ -64,6 +66,7 @@ public:
 	~DvbLiveViewInternal();
 
 	void resetPipe();
+	void injectPackets(const QByteArray &packets, const QList<int> &pids);
 
 	bool overrideAudioStreams() const override { return !audioStreams.isEmpty(); }
 	QStringList getAudioStreams() const override { return audioStreams; }
@@ -133,12 +136,53 @@ private slots:
 
 private:
 	void processData(const char data[188]) override;
+	void updatePipeBacklog();
 
 	QUrl url;
 	int readFd;
 	int writeFd;
 	QSocketNotifier *notifier;
 	QList<QByteArray> buffers;
+	MetricsGauge *pipeBacklogGauge;
+};
+
+// keeps a channel tuned on an otherwise idle device, so that zapping to it is instant
+
+class DvbPreTunedChannel : public QObject, public DvbPidFilter
+{
+	Q_OBJECT
+public:
+	DvbPreTunedChannel(DvbManager *manager_, const DvbSharedChannel &channel_,
+		QObject *parent);
+	~DvbPreTunedChannel();
+
+	bool start();
+
+	// the device is tuned and the pmt section has been received
+	bool isReady() const;
+
+	DvbSharedChannel channel;
+	QByteArray pmtSectionData;
+	QByteArray packets; // starting with the last random access point (if any)
+
+signals:
+	// the device has been taken over by another request
+	void released();
+
+private slots:
+	void pmtSectionChanged(const QByteArray &pmtSectionData_);
+	void deviceStateChanged();
+
+private:
+	void processData(const char data[188]) override;
+	void stopDevice();
+
+	DvbManager *manager;
+	DvbDevice *device;
+	DvbPmtFilter pmtFilter;
+	QList<int> pids;
+	int videoPid;
+	bool hasRandomAccessPoint;
 };
 
 #endif /* DVBLIVEVIEW_P_H */
@@ -19,23 +19,29 @@
  */
 
 #include "../log.h"
+#include "../startupprofiler.h"
 
 #include <config-kaffeine.h>
 #include <KConfigGroup>
 #include <KSharedConfig>
+#include <QDateTime>
 #include <QDir>
 #include <QPluginLoader>
-#include <QRegularExpressionMatch>
 #include <QStandardPaths>
 
 #include "dvbconfig.h"
 #include "dvbdevice.h"
 #include "dvbdevice_linux.h"
 #include "dvbepg.h"
+#include "dvbepgharvester.h"
 #include "dvbliveview.h"
 #include "dvbmanager.h"
 #include "dvbmanager_p.h"
+#include "dvbmuxrecording.h"
+#include "dvbscanindex.h"
 #include "dvbsi.h"
+#include "dvbstreamserver.h"
+#include "dvbtuningcache.h"
 #include "xmltv.h"
 
 DvbManager::DvbManager(MediaWidget *mediaWidget_, QWidget *parent_) : QObject(parent_),
@@ -44,8 +50,12 @@ DvbManager::DvbManager(MediaWidget *mediaWidget_, QWidget *parent_) : QObject(pa
 	channelModel = DvbChannelModel::createSqlModel(this);
 	recordingModel = new DvbRecordingModel(this, this);
 	epgModel = new DvbEpgModel(this, this);
+	epgHarvester = new DvbEpgHarvester(this, this);
 	liveView = new DvbLiveView(this, this);
 	xmlTv = new XmlTv(this);
+	tuningCache = new DvbTuningCache();
+	scanIndex = new DvbScanIndex();
+	streamServer = new DvbStreamServer(this, this);
 
 	readDeviceConfigs();
 	updateSourceMapping();
@@ -54,10 +64,11 @@ DvbManager::DvbManager(MediaWidget *mediaWidget_, QWidget *parent_) : QObject(pa
 
 	DvbSiText::setOverride6937(override6937Charset());
 
-	QString xmlFile = getXmltvFileName();
+	// the xmltv data is merged into the program guide, so it has to wait for it
+	connect(epgModel, SIGNAL(epgLoaded()), this, SLOT(loadXmlTv()));
 
-	if (!xmlFile.isEmpty())
-		xmlTv->addFile(xmlFile);
+	streamServer->listen(getStreamServerPort(), isStreamServerRemote());
+	epgHarvester->setEnabled(isEpgHarvesting());
 }
 
 DvbManager::~DvbManager()
@@ -66,14 +77,28 @@ DvbManager::~DvbManager()
 
 	// we need an explicit deletion order (device users ; devices ; device manager)
 
+	delete epgHarvester;
 	delete xmlTv;
 	delete epgModel;
 	epgModel = NULL;
 	delete recordingModel;
+	delete streamServer;
+
+	// the extractions of stopped recordings aren't waited for; they stop after
+	// the current chunk and keep the mux files (see DvbMuxExtractor::run())
+	foreach (DvbMuxExtractor *muxExtractor, muxExtractors) {
+		muxExtractor->requestInterruption();
+	}
+
+	qDeleteAll(muxExtractors);
+	muxRecorders.clear();
 
 	foreach (const DvbDeviceConfig &deviceConfig, deviceConfigs) {
 		delete deviceConfig.device;
 	}
+
+	delete tuningCache;
+	delete scanIndex;
 }
 
 DvbDevice *DvbManager::requestDevice(const QString &source, const DvbTransponder &transponder,
@@ -95,6 +120,8 @@ DvbDevice *DvbManager::requestDevice(const QString &source, const DvbTransponder
 
 			if (requestType == Prioritized) {
 				++deviceConfigs[i].prioritizedUseCount;
+			} else if (requestType == Speculative) {
+				++deviceConfigs[i].speculativeUseCount;
 			}
 
 			return it.device;
@@ -120,6 +147,8 @@ DvbDevice *DvbManager::requestDevice(const QString &source, const DvbTransponder
 
 				if (requestType == Prioritized) {
 					deviceConfigs[i].prioritizedUseCount = 1;
+				} else if (requestType == Speculative) {
+					deviceConfigs[i].speculativeUseCount = 1;
 				}
 
 				deviceConfigs[i].source = source;
@@ -130,6 +159,36 @@ DvbDevice *DvbManager::requestDevice(const QString &source, const DvbTransponder
 		}
 	}
 
+	if (requestType == Speculative) {
+		return NULL;
+	}
+
+	// devices which are only used speculatively are given up silently
+
+	for (int i = 0; i < deviceConfigs.size(); ++i) {
+		const DvbDeviceConfig &it = deviceConfigs.at(i);
+
+		if ((it.device == NULL) || (it.useCount < 1) ||
+		    (it.useCount != it.speculativeUseCount)) {
+			continue;
+		}
+
+		foreach (const DvbConfig &config, it.configs) {
+			if (config->name == source) {
+				deviceConfigs[i].useCount = 1;
+				deviceConfigs[i].prioritizedUseCount = ((requestType == Prioritized) ? 1 : 0);
+				deviceConfigs[i].speculativeUseCount = 0;
+				deviceConfigs[i].source = source;
+				deviceConfigs[i].transponder = transponder;
+
+				DvbDevice *device = it.device;
+				device->reacquire(config.constData());
+				device->tune(transponder);
+				return device;
+			}
+		}
+	}
+
 	if (requestType != Prioritized) {
 		return NULL;
 	}
@@ -145,6 +204,7 @@ DvbDevice *DvbManager::requestDevice(const QString &source, const DvbTransponder
 			if (config->name == source) {
 				deviceConfigs[i].useCount = 1;
 				deviceConfigs[i].prioritizedUseCount = 1;
+				deviceConfigs[i].speculativeUseCount = 0;
 				deviceConfigs[i].source = source;
 				deviceConfigs[i].transponder = transponder;
 
@@ -184,6 +244,31 @@ DvbDevice *DvbManager::requestExclusiveDevice(const QString &source)
 		}
 	}
 
+	// devices which are only used speculatively are given up silently
+
+	for (int i = 0; i < deviceConfigs.size(); ++i) {
+		const DvbDeviceConfig &it = deviceConfigs.at(i);
+
+		if ((it.device == NULL) || (it.useCount < 1) ||
+		    (it.useCount != it.speculativeUseCount)) {
+			continue;
+		}
+
+		foreach (const DvbConfig &config, it.configs) {
+			if (config->name == source) {
+				deviceConfigs[i].useCount = -1;
+				deviceConfigs[i].prioritizedUseCount = 0;
+				deviceConfigs[i].speculativeUseCount = 0;
+				deviceConfigs[i].source.clear();
+
+				// the speculative users see DeviceReleased and drop the device
+				DvbDevice *device = it.device;
+				device->reacquire(config.constData());
+				return device;
+			}
+		}
+	}
+
 	return NULL;
 }
 
@@ -199,6 +284,12 @@ void DvbManager::releaseDevice(DvbDevice *device, RequestType requestType)
 				Q_ASSERT(it.prioritizedUseCount >= 0);
 			// fall through
 			case Shared:
+			case Speculative:
+				if (requestType == Speculative) {
+					--deviceConfigs[i].speculativeUseCount;
+					Q_ASSERT(it.speculativeUseCount >= 0);
+				}
+
 				--deviceConfigs[i].useCount;
 				Q_ASSERT(it.useCount >= 0);
 				Q_ASSERT(it.useCount >= it.prioritizedUseCount);
@@ -211,6 +302,7 @@ void DvbManager::releaseDevice(DvbDevice *device, RequestType requestType)
 			case Exclusive:
 				Q_ASSERT(it.useCount == -1);
 				Q_ASSERT(it.prioritizedUseCount == 0);
+				Q_ASSERT(it.speculativeUseCount == 0);
 				deviceConfigs[i].useCount = 0;
 				it.device->release();
 				break;
@@ -221,6 +313,62 @@ void DvbManager::releaseDevice(DvbDevice *device, RequestType requestType)
 	}
 }
 
+QExplicitlySharedDataPointer<DvbMuxRecorder> DvbManager::attachMuxRecorder(DvbDevice *device)
+{
+	QExplicitlySharedDataPointer<DvbMuxRecorder> muxRecorder = muxRecorders.value(device);
+
+	if (muxRecorder.constData() == NULL) {
+		QString fileName = getRecordingFolder() + QLatin1String("/.kaffeine-mux-") +
+			QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+
+		for (int attempt = 1; QFile::exists(fileName + QLatin1String(".m2t")); ++attempt) {
+			fileName = fileName.section(QLatin1Char('~'), 0, 0) + QLatin1Char('~') +
+				QString::number(attempt);
+		}
+
+		muxRecorder = new DvbMuxRecorder(device, fileName);
+
+		if (!muxRecorder->isValid()) {
+			return QExplicitlySharedDataPointer<DvbMuxRecorder>();
+		}
+
+		muxRecorders.insert(device, muxRecorder);
+	}
+
+	muxRecorder->attach();
+	return muxRecorder;
+}
+
+void DvbManager::detachMuxRecorder(const QExplicitlySharedDataPointer<DvbMuxRecorder> &muxRecorder)
+{
+	if (muxRecorder->detach()) {
+		// the file is kept until all extractions using it are finished
+		muxRecorder->stop();
+		muxRecorders.remove(muxRecorders.key(muxRecorder));
+	}
+}
+
+void DvbManager::extractMuxService(DvbMuxExtractor *muxExtractor)
+{
+	muxExtractors.append(muxExtractor);
+	connect(muxExtractor, SIGNAL(finished()), this, SLOT(muxExtractorFinished()));
+	muxExtractor->start(QThread::LowPriority);
+}
+
+void DvbManager::muxExtractorFinished()
+{
+	DvbMuxExtractor *muxExtractor = static_cast<DvbMuxExtractor *>(sender());
+
+	if (!muxExtractor->isDone()) {
+		// finish() was called while a pass of the running recording was active
+		muxExtractor->start(QThread::LowPriority);
+		return;
+	}
+
+	muxExtractors.removeAll(muxExtractor);
+	muxExtractor->deleteLater();
+}
+
 QList<DvbDeviceConfig> DvbManager::getDeviceConfigs() const
 {
 	return deviceConfigs;
@@ -268,7 +416,7 @@ QDate DvbManager::getScanDataDate()
 
 QStringList DvbManager::getScanSources(TransmissionType type)
 {
-	if (scanData.isEmpty()) {
+	if (!scanDataDate.isValid()) {
 		readScanData();
 	}
 
@@ -293,7 +441,7 @@ QString DvbManager::getAutoScanSource(const QString &source) const
 
 QList<DvbTransponder> DvbManager::getTransponders(DvbDevice *device, const QString &source)
 {
-	if (scanData.isEmpty()) {
+	if (!scanDataDate.isValid()) {
 		readScanData();
 	}
 
@@ -314,7 +462,46 @@ QList<DvbTransponder> DvbManager::getTransponders(DvbDevice *device, const QStri
 		scanSource.first = DvbT2;
 	}
 
-	return scanData.value(scanSource);
+	QMap<QPair<TransmissionType, QString>, QList<DvbTransponder> >::ConstIterator it =
+		scanData.constFind(scanSource);
+
+	if (it != scanData.constEnd()) {
+		return *it;
+	}
+
+	int index = scanSourceIndexes.value(scanSource, -1);
+
+	if (index < 0) {
+		return QList<DvbTransponder>();
+	}
+
+	QList<DvbTransponder> transponders;
+
+	foreach (const QByteArray &line, scanIndex->getTransponderLines(index).split('\n')) {
+		if (line.isEmpty()) {
+			continue;
+		}
+
+		DvbTransponder transponder = DvbTransponder::fromString(QString::fromLatin1(line));
+
+		if (!transponder.isValid()) {
+			qCWarning(logDvb, "Error parsing line : '%s'", line.constData());
+			continue;
+		}
+
+		// the DVB-S and DVB-T lists don't contain the second generation transponders
+		if (((scanSource.first == DvbS) &&
+		     (transponder.getTransmissionType() == DvbTransponderBase::DvbS2)) ||
+		    ((scanSource.first == DvbT) &&
+		     (transponder.getTransmissionType() == DvbTransponderBase::DvbT2))) {
+			continue;
+		}
+
+		transponders.append(transponder);
+	}
+
+	scanData.insert(scanSource, transponders);
+	return transponders;
 }
 
 bool DvbManager::updateScanData(const QByteArray &data)
@@ -341,6 +528,9 @@ bool DvbManager::updateScanData(const QByteArray &data)
 	file.write(uncompressed);
 	file.close();
 
+	// the index may have the same date and size by chance
+	QFile::remove(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/scanfile.idx"));
+
 	readScanData();
 	return true;
 }
@@ -405,6 +595,37 @@ bool DvbManager::isScanWhenIdle() const
 	return KSharedConfig::openConfig()->group("DVB").readEntry("ScanWhenIdle", false);
 }
 
+bool DvbManager::isPredictiveZap() const
+{
+	return KSharedConfig::openConfig()->group("DVB").readEntry("PredictiveZap", false);
+}
+
+bool DvbManager::isEpgHarvesting() const
+{
+	return KSharedConfig::openConfig()->group("DVB").readEntry("EpgHarvesting", false);
+}
+
+bool DvbManager::isMuxRecording() const
+{
+	return KSharedConfig::openConfig()->group("DVB").readEntry("MuxRecording", false);
+}
+
+int DvbManager::getStreamServerPort() const
+{
+	return KSharedConfig::openConfig()->group("DVB").readEntry("StreamServerPort", 0);
+}
+
+bool DvbManager::isStreamServerRemote() const
+{
+	return KSharedConfig::openConfig()->group("DVB").readEntry("StreamServerRemote", false);
+}
+
+QStringList DvbManager::getStreamServerRtpDestinations() const
+{
+	return KSharedConfig::openConfig()->group("DVB").readEntry("StreamServerRtpDestinations",
+		QStringList());
+}
+
 bool DvbManager::createInfoFile() const
 {
 	return KSharedConfig::openConfig()->group("DVB").readEntry("CreateInfoFile", false);
@@ -518,6 +739,32 @@ void DvbManager::setScanWhenIdle(bool scanWhenIdle)
 	KSharedConfig::openConfig()->group("DVB").writeEntry("ScanWhenIdle", scanWhenIdle);
 }
 
+void DvbManager::setPredictiveZap(bool predictiveZap)
+{
+	KSharedConfig::openConfig()->group("DVB").writeEntry("PredictiveZap", predictiveZap);
+}
+
+void DvbManager::setEpgHarvesting(bool epgHarvesting)
+{
+	KSharedConfig::openConfig()->group("DVB").writeEntry("EpgHarvesting", epgHarvesting);
+	epgHarvester->setEnabled(epgHarvesting);
+}
+
+void DvbManager::setMuxRecording(bool muxRecording)
+{
+	KSharedConfig::openConfig()->group("DVB").writeEntry("MuxRecording", muxRecording);
+}
+
+void DvbManager::setStreamServer(int port, bool allowRemote)
+{
+	if ((port != getStreamServerPort()) || (allowRemote != isStreamServerRemote())) {
+		KSharedConfig::openConfig()->group("DVB").writeEntry("StreamServerPort", port);
+		KSharedConfig::openConfig()->group("DVB").writeEntry("StreamServerRemote",
+			allowRemote);
+		streamServer->listen(port, allowRemote);
+	}
+}
+
 void DvbManager::setCreateInfoFile(bool createInfoFile)
 {
 	KSharedConfig::openConfig()->group("DVB").writeEntry("CreateInfoFile", createInfoFile);
@@ -550,7 +797,7 @@ void DvbManager::requestBuiltinDeviceManager(QObject *&builtinDeviceManager)
 
 void DvbManager::deviceAdded(DvbBackendDevice *backendDevice)
 {
-	DvbDevice *device = new DvbDevice(backendDevice, this);
+	DvbDevice *device = new DvbDevice(backendDevice, tuningCache, this);
 	QString deviceId = device->getDeviceId();
 	QString frontendName = device->getFrontendName();
 
@@ -569,6 +816,7 @@ void DvbManager::deviceAdded(DvbBackendDevice *backendDevice)
 		if ((it.deviceId.isEmpty() || deviceId.isEmpty() || (it.deviceId == deviceId)) &&
 		    (it.frontendName == frontendName) && (it.device == NULL)) {
 			deviceConfigs[i].device = device;
+			device->setReaderConfig(it.readerConfig);
 			break;
 		}
 	}
@@ -583,6 +831,7 @@ void DvbManager::deviceRemoved(DvbBackendDevice *backendDevice)
 			if (it.useCount != 0) {
 				it.useCount = 0;
 				it.prioritizedUseCount = 0;
+				it.speculativeUseCount = 0;
 				it.device->release();
 			}
 
@@ -593,6 +842,19 @@ void DvbManager::deviceRemoved(DvbBackendDevice *backendDevice)
 	}
 }
 
+void DvbManager::loadXmlTv()
+{
+	QString xmlFile = getXmltvFileName();
+
+	if (xmlFile.isEmpty()) {
+		return;
+	}
+
+	StartupProfiler::instance()->beginPhase(QLatin1String("XMLTV"));
+	xmlTv->addFile(xmlFile);
+	StartupProfiler::instance()->endPhase(QLatin1String("XMLTV"));
+}
+
 void DvbManager::loadDeviceManager()
 {
 	QDir dir(QString::fromUtf8(KAFFEINE_LIB_INSTALL_DIR "/"));
@@ -647,7 +909,39 @@ void DvbManager::readDeviceConfigs()
 	DvbDeviceConfigReader reader(&file);
 
 	while (!reader.atEnd()) {
-		if (reader.readLine() != QLatin1String("[device]")) {
+		QString line = reader.readLine();
+
+		if ((line == QLatin1String("[reader]")) && !deviceConfigs.isEmpty()) {
+			// optional, follows the configs of the device
+			DvbReaderConfig &readerConfig = deviceConfigs.last().readerConfig;
+			readerConfig.schedulingPolicy = reader.readEnum(
+				QLatin1String("schedulingPolicy"), DvbReaderConfig::SchedulingPolicyMax);
+			readerConfig.realtimePriority = reader.readInt(QLatin1String("realtimePriority"));
+			readerConfig.niceness = reader.readSignedInt(QLatin1String("niceness"));
+			QStringList cpuAffinity = reader.readString(QLatin1String("cpuAffinity")).split(
+				QLatin1Char(','), Qt::SkipEmptyParts);
+			readerConfig.cpuAffinity.clear();
+
+			foreach (const QString &cpu, cpuAffinity) {
+				bool ok;
+				int value = cpu.toInt(&ok);
+
+				if (ok && (value >= 0)) {
+					readerConfig.cpuAffinity.append(value);
+				}
+			}
+
+			readerConfig.dvrBufferSize = reader.readInt(QLatin1String("dvrBufferSize"));
+
+			if (!reader.isValid()) {
+				errMsg = "reader section invalid";
+				break;
+			}
+
+			continue;
+		}
+
+		if (line != QLatin1String("[device]")) {
 			continue;
 		}
 
@@ -751,6 +1045,21 @@ void DvbManager::writeDeviceConfigs()
 				}
 			}
 		}
+
+		// older versions skip this section
+		const DvbReaderConfig &readerConfig = deviceConfig.readerConfig;
+		QStringList cpuAffinity;
+
+		foreach (int cpu, readerConfig.cpuAffinity) {
+			cpuAffinity.append(QString::number(cpu));
+		}
+
+		writer.write(QLatin1String("[reader]"));
+		writer.write(QLatin1String("schedulingPolicy"), readerConfig.schedulingPolicy);
+		writer.write(QLatin1String("realtimePriority"), readerConfig.realtimePriority);
+		writer.write(QLatin1String("niceness"), readerConfig.niceness);
+		writer.write(QLatin1String("cpuAffinity"), cpuAffinity.join(QLatin1Char(',')));
+		writer.write(QLatin1String("dvrBufferSize"), readerConfig.dvrBufferSize);
 	}
 }
 
@@ -791,10 +1100,27 @@ void DvbManager::updateSourceMapping()
 	sources = sourceMapping.keys();
 }
 
+static bool openScanIndex(DvbScanIndex *scanIndex, const QString &fileName, const QDate &date,
+	qint64 scanFileSize)
+{
+	if (!scanIndex->open(fileName)) {
+		return false;
+	}
+
+	if ((scanIndex->getDate() != date) || (scanIndex->getScanFileSize() != scanFileSize)) {
+		scanIndex->close();
+		return false;
+	}
+
+	return true;
+}
+
 void DvbManager::readScanData()
 {
 	scanSources.clear();
+	scanSourceIndexes.clear();
 	scanData.clear();
+	scanIndex->close();
 
 	QFile globalFile(QString::fromUtf8(KAFFEINE_DATA_INSTALL_DIR "/kaffeine/scanfile.dvb"));
 	QDate globalDate;
@@ -812,12 +1138,10 @@ void DvbManager::readScanData()
 	}
 
 	QFile localFile(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/scanfile.dvb"));
-	QByteArray localData;
 	QDate localDate;
 
 	if (localFile.open(QIODevice::ReadOnly)) {
-		localData = localFile.readAll();
-		localDate = DvbScanData(localData).readDate();
+		localDate = DvbScanData(localFile.read(1024)).readDate();
 
 		if (localDate.isNull()) {
 			qCWarning(logDvb, "Cannot parse %s", qPrintable(localFile.fileName()));
@@ -827,8 +1151,6 @@ void DvbManager::readScanData()
 	}
 
 	if (localDate < globalDate) {
-		localData.clear();
-
 		if (localFile.exists() && !localFile.remove()) {
 			qCWarning(logDvb, "Cannot remove %s", qPrintable(localFile.fileName()));
 		}
@@ -837,145 +1159,96 @@ void DvbManager::readScanData()
 			qCWarning(logDvb, "Cannot copy %s to %s", qPrintable(globalFile.fileName()), qPrintable(localFile.fileName()));
 		}
 
-		if (localFile.open(QIODevice::ReadOnly)) {
-			localData = localFile.readAll();
-			localFile.close();
-		} else {
-			qCWarning(logDvb, "Cannot open %s", qPrintable(localFile.fileName()));
-			scanDataDate = QDate(1900, 1, 1);
-			return;
-		}
-	}
-
-	DvbScanData data(localData);
-	scanDataDate = data.readDate();
-
-	if (!scanDataDate.isValid()) {
-		qCWarning(logDvb, "Cannot parse %s", qPrintable(localFile.fileName()));
-		scanDataDate = QDate(1900, 1, 1);
-		return;
+		localDate = globalDate;
 	}
 
-	// Parse scan file
+	// the installed index is valid as long as the scan file hasn't been updated;
+	// otherwise the index is built once from the local scan file and kept next to it
 
-	QRegularExpression rejex = QRegularExpression("\\[(\\S+)/(\\S+)\\]");
-	QRegularExpressionMatch match;
-	TransmissionType type;
-
-	while (!data.checkEnd()) {
-		const char *line = data.readLine();
-
-		// Discard empty lines
-		if (*line == 0)
-			continue;
-
-		QString qLine(line);
-
-		if (!qLine.contains(rejex, &match)) {
-			qCWarning(logDvb, "Unrecognized line: '%s'", line);
-			continue;
+	QString globalIndexFileName = QString::fromUtf8(KAFFEINE_DATA_INSTALL_DIR "/kaffeine/scanfile.idx");
+	QString localIndexFileName = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/scanfile.idx");
+	qint64 localSize = localFile.size();
 
+	if (!openScanIndex(scanIndex, globalIndexFileName, localDate, localSize) &&
+	    !openScanIndex(scanIndex, localIndexFileName, localDate, localSize)) {
+		if (!localFile.open(QIODevice::ReadOnly)) {
+			qCWarning(logDvb, "Cannot open %s", qPrintable(localFile.fileName()));
+			scanDataDate = QDate(1900, 1, 1);
+			return;
 		}
 
-		QString typeStr = match.captured(1);
-		QString name = match.captured(2);
+		QString errorMessage;
+		QByteArray index = DvbScanIndex::build(localFile.readAll(), &errorMessage);
+		localFile.close();
 
-		if (!typeStr.compare("dvb-c", Qt::CaseInsensitive))
-			type = DvbC;
-		else if (!typeStr.compare("dvb-s", Qt::CaseInsensitive))
-			type = DvbS;
-		else if (!typeStr.compare("dvb-t", Qt::CaseInsensitive))
-			type = DvbT;
-		else if (!typeStr.compare("atsc", Qt::CaseInsensitive))
-			type = Atsc;
-		else if (!typeStr.compare("isdb-t", Qt::CaseInsensitive))
-			type = IsdbT;
-		else {
-			qCWarning(logDvb, "Transmission type '%s' unknown", qPrintable(typeStr));
-			continue;
+		if (index.isEmpty()) {
+			qCWarning(logDvb, "Cannot parse %s: %s", qPrintable(localFile.fileName()), qPrintable(errorMessage));
+			scanDataDate = QDate(1900, 1, 1);
+			return;
 		}
 
-		QList<DvbTransponder> transponders;
-		bool containsDvbS1 = false;
-		bool containsDvbT1 = false;
-
-		while (!data.checkEnd()) {
-			line = data.getLine();
-
-			if ((*line == '[') || (*line == 0)) {
-				break;
-			}
+		if (!errorMessage.isEmpty()) {
+			qCWarning(logDvb, "Some data at the scan file were not parsed: %s", qPrintable(errorMessage));
+		}
 
-			line = data.readLine();
+		QFile indexFile(localIndexFileName);
 
-			// Ignore lines with empty strings
-			if (*line == 0)
-				continue;
-
-			DvbTransponder transponder =
-				DvbTransponder::fromString(QString::fromLatin1(line));
+		if (indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			indexFile.write(index);
+			indexFile.close();
+		} else {
+			qCWarning(logDvb, "Cannot open %s", qPrintable(indexFile.fileName()));
+		}
 
-			if (!transponder.isValid()) {
-				qCWarning(logDvb, "Error parsing line : '%s'", qPrintable(line));
-			} else {
-				transponders.append(transponder);
+		scanIndex->setData(index);
+	}
 
-				if (transponder.getTransmissionType() ==
-				    DvbTransponderBase::DvbS) {
-					containsDvbS1 = true;
-				}
-				if (transponder.getTransmissionType() ==
-				    DvbTransponderBase::DvbT) {
-					containsDvbT1 = true;
-				}
-			}
-		}
+	scanDataDate = scanIndex->getDate();
 
-		if (type == DvbS || type == DvbS2) {
-			scanSources[DvbS2].append(name);
-			scanData.insert(qMakePair(DvbS2, name), transponders);
-
-			if (containsDvbS1) {
-				for (int i = 0; i < transponders.size(); ++i) {
-					if (transponders.at(i).getTransmissionType() ==
-					    DvbTransponderBase::DvbS2) {
-						transponders.removeAt(i);
-						--i;
-					}
-				}
+	for (int i = 0; i < scanIndex->getSourceCount(); ++i) {
+		QString name = scanIndex->getSourceName(i);
+		int flags = scanIndex->getSourceFlags(i);
+		TransmissionType type;
 
+		switch (scanIndex->getSourceType(i)) {
+		case DvbScanIndex::DvbC:
+			type = DvbC;
+			break;
+		case DvbScanIndex::DvbS:
+			// DVB-S only appears if there are first generation transponders
+			if ((flags & DvbScanIndex::ContainsDvbS1) != 0) {
 				scanSources[DvbS].append(name);
-				scanData.insert(qMakePair(DvbS, name), transponders);
+				scanSourceIndexes.insert(qMakePair(DvbS, name), i);
 			}
-		} else if (type == DvbT || type == DvbT2) {
-			scanSources[DvbT2].append(name);
-			scanData.insert(qMakePair(DvbT2, name), transponders);
-
-			if (containsDvbT1) {
-				for (int i = 0; i < transponders.size(); ++i) {
-					if (transponders.at(i).getTransmissionType() ==
-					    DvbTransponderBase::DvbT2) {
-						transponders.removeAt(i);
-						--i;
-					}
-				}
 
+			type = DvbS2;
+			break;
+		case DvbScanIndex::DvbT:
+			if ((flags & DvbScanIndex::ContainsDvbT1) != 0) {
 				scanSources[DvbT].append(name);
-				scanData.insert(qMakePair(DvbT, name), transponders);
+				scanSourceIndexes.insert(qMakePair(DvbT, name), i);
 			}
-		} else {
-			scanSources[type].append(name);
-			scanData.insert(qMakePair(type, name), transponders);
+
+			type = DvbT2;
+			break;
+		case DvbScanIndex::Atsc:
+			type = Atsc;
+			break;
+		case DvbScanIndex::IsdbT:
+			type = IsdbT;
+			break;
+		default:
+			continue;
 		}
-	}
 
-	if (!data.checkEnd())
-		qCWarning(logDvb, "Some data at the scan file were not parsed");
+		scanSources[type].append(name);
+		scanSourceIndexes.insert(qMakePair(type, name), i);
+	}
 }
 
 DvbDeviceConfig::DvbDeviceConfig(const QString &deviceId_, const QString &frontendName_,
 	DvbDevice *device_) : deviceId(deviceId_), frontendName(frontendName_), device(device_),
-	useCount(0), prioritizedUseCount(0)
+	useCount(0), prioritizedUseCount(0), speculativeUseCount(0)
 {
 }
 
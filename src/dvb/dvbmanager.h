@@ -25,7 +25,9 @@
 #include <QDate>
 #include <QMap>
 #include <QPair>
+#include <QSharedData>
 #include <QStringList>
+#include "dvbbackenddevice.h"
 #include "dvbtransponder.h"
 
 class QTreeView;
@@ -35,10 +37,16 @@ class DvbConfig;
 class DvbDevice;
 class DvbDeviceConfig;
 class DvbDeviceConfigUpdate;
+class DvbEpgHarvester;
 class DvbEpgModel;
 class DvbLiveView;
+class DvbMuxExtractor;
+class DvbMuxRecorder;
 class DvbRecordingModel;
 class DvbScanData;
+class DvbScanIndex;
+class DvbStreamServer;
+class DvbTuningCache;
 class MediaWidget;
 class XmlTv;
 
@@ -49,7 +57,8 @@ public:
 	enum RequestType {
 		Shared,
 		Exclusive, // you can freely tune() and stop(), because the device isn't shared
-		Prioritized // takes precedence over 'Shared' and 'Exclusive'
+		Prioritized, // takes precedence over 'Shared' and 'Exclusive'
+		Speculative // like 'Shared', but only uses idle devices and gives them up first
 	};
 
 	enum TransmissionType {
@@ -115,6 +124,11 @@ public:
 	DvbDevice *requestExclusiveDevice(const QString &source);
 	void releaseDevice(DvbDevice *device, RequestType requestType);
 
+	// one full transport stream recorder per device, shared by the recordings
+	QExplicitlySharedDataPointer<DvbMuxRecorder> attachMuxRecorder(DvbDevice *device);
+	void detachMuxRecorder(const QExplicitlySharedDataPointer<DvbMuxRecorder> &muxRecorder);
+	void extractMuxService(DvbMuxExtractor *muxExtractor); // takes ownership
+
 	QList<DvbDeviceConfig> getDeviceConfigs() const;
 	void updateDeviceConfigs(const QList<DvbDeviceConfigUpdate> &configUpdates);
 
@@ -140,6 +154,13 @@ public:
 	bool createInfoFile() const;
 	bool disableEpg() const;
 	bool isScanWhenIdle() const;
+	bool isPredictiveZap() const;
+	bool isEpgHarvesting() const;
+	bool isMuxRecording() const;
+	int getStreamServerPort() const; // 0 = disabled
+	bool isStreamServerRemote() const;
+	// rtp destinations which are accepted besides the client itself and multicast groups
+	QStringList getStreamServerRtpDestinations() const;
 	void setRecordingFolder(const QString &path);
 	void setTimeShiftFolder(const QString &path);
 	void setXmltvFileName(const QString &path);
@@ -158,6 +179,10 @@ public:
 	void setCreateInfoFile(bool createInfoFile);
 	void setDisableEpg(bool disableEpg);
 	void setScanWhenIdle(bool scanWhenIdle);
+	void setPredictiveZap(bool predictiveZap);
+	void setEpgHarvesting(bool epgHarvesting);
+	void setMuxRecording(bool muxRecording);
+	void setStreamServer(int port, bool allowRemote);
 	void writeDeviceConfigs();
 
 	void enableDvbDump();
@@ -167,6 +192,8 @@ private slots:
 	void requestBuiltinDeviceManager(QObject *&builtinDeviceManager);
 	void deviceAdded(DvbBackendDevice *backendDevice);
 	void deviceRemoved(DvbBackendDevice *backendDevice);
+	void muxExtractorFinished();
+	void loadXmlTv();
 
 private:
 	void loadDeviceManager();
@@ -182,10 +209,15 @@ private:
 	DvbChannelModel *channelModel;
 	QTreeView *channelView;
 	DvbEpgModel *epgModel;
+	DvbEpgHarvester *epgHarvester;
 	XmlTv *xmlTv;
 	DvbLiveView *liveView;
 	DvbRecordingModel *recordingModel;
+	DvbTuningCache *tuningCache;
+	DvbStreamServer *streamServer;
 	bool reacquireDevice;
+	QMap<DvbDevice *, QExplicitlySharedDataPointer<DvbMuxRecorder> > muxRecorders;
+	QList<DvbMuxExtractor *> muxExtractors;
 
 	QList<DvbDeviceConfig> deviceConfigs;
 	bool dvbDumpEnabled;
@@ -193,7 +225,10 @@ private:
 	QStringList sources;
 
 	QDate scanDataDate;
+	DvbScanIndex *scanIndex;
 	QMap<TransmissionType, QStringList> scanSources;
+	QMap<QPair<TransmissionType, QString>, int> scanSourceIndexes;
+	// only the sources which have been requested are decoded
 	QMap<QPair<TransmissionType, QString>, QList<DvbTransponder> > scanData;
 };
 
@@ -210,9 +245,11 @@ public:
 	QList<DvbConfig> configs;
 	int useCount; // -1 means exclusive use
 	int prioritizedUseCount;
+	int speculativeUseCount;
 	int numberOfTuners;
 	QString source;
 	DvbTransponder transponder;
+	DvbReaderConfig readerConfig;
 };
 
 class DvbDeviceConfigUpdate
@@ -84,6 +84,19 @@ public:
 	}
 
 
+	int readSignedInt(const QString &entry)
+	{
+		QString string = readString(entry);
+		bool ok;
+		int value = string.toInt(&ok);
+
+		if (!ok) {
+			valid = false;
+		}
+
+		return value;
+	}
+
 	int readDouble(const QString &entry)
 	{
 		QString string = readString(entry);
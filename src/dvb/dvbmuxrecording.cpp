@@ -0,0 +1,467 @@
+/*
+ * dvbmuxrecording.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../log.h"
+
+#include <QSet>
+
+#include "dvbdevice.h"
+#include "dvbmuxrecording.h"
+
+class DvbMuxIndexEntry
+{
+public:
+	DvbMuxIndexEntry() : time(0), offset(0) { }
+	~DvbMuxIndexEntry() { }
+
+	qint64 time; // ms since the start of the recorder
+	qint64 offset;
+	QList<int> pids; // pids which appeared since the previous entry
+};
+
+static const int muxIndexVersion = 0x20260201;
+static const int muxIndexInterval = 500; // ms
+
+DvbMuxRecorder::DvbMuxRecorder(DvbDevice *device_, const QString &fileName) : device(NULL),
+	nextIndexTime(0), offset(0), seenPids(8192), users(0), removeFiles(true)
+{
+	file.setFileName(fileName + QLatin1String(".m2t"));
+	indexFile.setFileName(fileName + QLatin1String(".idx"));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(logDvb, "Cannot open file %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(logDvb, "Cannot open file %s", qPrintable(indexFile.fileName()));
+		return;
+	}
+
+	indexStream.setDevice(&indexFile);
+	indexStream.setVersion(QDataStream::Qt_4_4);
+	indexStream << muxIndexVersion;
+
+	if (!device_->addPidFilter(DvbDevice::FullTsPid, this,
+	    DvbDevice::RecordingPriority)) {
+		qCWarning(logDvb, "Device cannot deliver the full transport stream");
+		return;
+	}
+
+	device = device_;
+	buffer.reserve(348 * 188);
+	timer.start();
+	mark();
+}
+
+DvbMuxRecorder::~DvbMuxRecorder()
+{
+	stop();
+
+	if (removeFiles) {
+		file.remove();
+		indexFile.remove();
+	}
+}
+
+qint64 DvbMuxRecorder::mark()
+{
+	if (device == NULL) {
+		return -1;
+	}
+
+	flush();
+	file.flush();
+	qint64 time = timer.elapsed();
+	writeIndexEntry(time);
+	indexFile.flush();
+	return time;
+}
+
+void DvbMuxRecorder::attach()
+{
+	++users;
+}
+
+bool DvbMuxRecorder::detach()
+{
+	--users;
+	return (users <= 0);
+}
+
+void DvbMuxRecorder::stop()
+{
+	if (device != NULL) {
+		device->removePidFilter(DvbDevice::FullTsPid, this);
+		mark();
+		device = NULL;
+	}
+
+	file.close();
+	indexFile.close();
+}
+
+void DvbMuxRecorder::processData(const char data[188])
+{
+	int pid = ((static_cast<unsigned char>(data[1]) << 8) |
+		static_cast<unsigned char>(data[2])) & ((1 << 13) - 1);
+	seenPids.setBit(pid);
+	buffer.append(data, 188);
+
+	if (buffer.size() >= (348 * 188)) {
+		flush();
+		qint64 time = timer.elapsed();
+
+		if (time >= nextIndexTime) {
+			writeIndexEntry(time);
+		}
+	}
+}
+
+void DvbMuxRecorder::flush()
+{
+	if (buffer.isEmpty()) {
+		return;
+	}
+
+	if (file.write(buffer) != buffer.size()) {
+		qCWarning(logDvb, "Cannot write to %s", qPrintable(file.fileName()));
+	}
+
+	offset += buffer.size();
+	buffer.clear();
+	buffer.reserve(348 * 188);
+}
+
+void DvbMuxRecorder::writeIndexEntry(qint64 time)
+{
+	QList<int> pids;
+
+	for (int pid = 0; pid < seenPids.size(); ++pid) {
+		if (seenPids.testBit(pid)) {
+			pids.append(pid);
+		}
+	}
+
+	indexStream << time << offset << pids;
+	seenPids.fill(false);
+	nextIndexTime = (time + muxIndexInterval);
+}
+
+DvbMuxExtractor::DvbMuxExtractor(const QString &fileName_, int transportStreamId_,
+	int serviceId_, int pmtPid_) : fileName(fileName_), transportStreamId(transportStreamId_),
+	serviceId(serviceId_), pmtPid(pmtPid_), finishing(false), done(false),
+	outputCreated(false), currentSegment(0), extractedTime(-1)
+{
+}
+
+DvbMuxExtractor::~DvbMuxExtractor()
+{
+	// stops after the current chunk; the mux files are kept (see run())
+	requestInterruption();
+	wait();
+}
+
+void DvbMuxExtractor::update(const QList<DvbMuxSegment> &segments_)
+{
+	QMutexLocker locker(&mutex);
+
+	if (!finishing) {
+		pendingSegments = segments_;
+	}
+}
+
+void DvbMuxExtractor::finish(const QList<DvbMuxSegment> &segments_,
+	const QString &tailFileName_)
+{
+	QMutexLocker locker(&mutex);
+	pendingSegments = segments_;
+	pendingTailFileName = tailFileName_;
+	finishing = true;
+}
+
+bool DvbMuxExtractor::isDone()
+{
+	QMutexLocker locker(&mutex);
+	return done;
+}
+
+bool DvbMuxExtractor::completeSegments(QList<DvbMuxSegment> &segments)
+{
+	// segments which were recorded before the first pmt arrived use the
+	// first pmt; the others keep the previous one
+	int firstIndex = -1;
+
+	for (int i = 0; i < segments.size(); ++i) {
+		if (!segments.at(i).pmtSectionData.isEmpty()) {
+			firstIndex = i;
+			break;
+		}
+	}
+
+	if (firstIndex < 0) {
+		return false;
+	}
+
+	for (int i = 0; i < segments.size(); ++i) {
+		if (segments.at(i).pmtSectionData.isEmpty()) {
+			const DvbMuxSegment &source = segments.at((i < firstIndex) ? firstIndex : (i - 1));
+			segments[i].pmtSectionData = source.pmtSectionData;
+			segments[i].pids = source.pids;
+		}
+	}
+
+	return true;
+}
+
+void DvbMuxExtractor::run()
+{
+	mutex.lock();
+	QList<DvbMuxSegment> segments = pendingSegments;
+	QString tailFileName = pendingTailFileName;
+	bool finished = finishing;
+	mutex.unlock();
+
+	if (finished && !completeSegments(segments)) {
+		qCWarning(logDvb, "No PMT for service %d, copying the whole transport stream to %s",
+			serviceId, qPrintable(fileName));
+	}
+
+	QFile outputFile(fileName);
+	QIODevice::OpenMode openMode = QIODevice::WriteOnly;
+
+	if (outputCreated) {
+		openMode |= QIODevice::Append;
+	} else {
+		openMode |= QIODevice::Truncate;
+	}
+
+	if (!outputFile.open(openMode)) {
+		qCWarning(logDvb, "Cannot open file %s", qPrintable(fileName));
+	} else {
+		outputCreated = true;
+
+		while ((currentSegment < segments.size()) && !isInterruptionRequested()) {
+			const DvbMuxSegment &segment = segments.at(currentSegment);
+
+			// the pmt may still arrive
+			if (!finished && segment.pmtSectionData.isEmpty()) {
+				break;
+			}
+
+			if (!extractSegment(outputFile, segment, !finished) && !finished) {
+				break;
+			}
+
+			++currentSegment;
+			extractedTime = -1;
+		}
+	}
+
+	if (isInterruptionRequested()) {
+		// keep everything which is needed to finish the file by hand
+		for (int i = currentSegment; i < segments.size(); ++i) {
+			segments.at(i).recorder->keepFiles();
+			qCWarning(logDvb, "Extraction of %s interrupted, keeping %s",
+				qPrintable(fileName), qPrintable(segments.at(i).recorder->getFileName()));
+		}
+
+		return;
+	}
+
+	if (!finished) {
+		return;
+	}
+
+	if (outputFile.isOpen()) {
+		if (!tailFileName.isEmpty()) {
+			appendTail(outputFile, tailFileName);
+		}
+
+		qCDebug(logDvb, "Extracted service %d to %s", serviceId, qPrintable(fileName));
+	}
+
+	mutex.lock();
+	done = true;
+	mutex.unlock();
+}
+
+void DvbMuxExtractor::appendTail(QFile &outputFile, const QString &tailFileName)
+{
+	QFile tailFile(tailFileName);
+
+	if (!tailFile.open(QIODevice::ReadOnly)) {
+		qCWarning(logDvb, "Cannot open file %s", qPrintable(tailFileName));
+		return;
+	}
+
+	while (!tailFile.atEnd()) {
+		QByteArray buffer = tailFile.read(348 * 188);
+
+		if (buffer.isEmpty() || (outputFile.write(buffer) != buffer.size())) {
+			// the tail file is kept, so that nothing is lost
+			qCWarning(logDvb, "Cannot append %s to %s", qPrintable(tailFileName),
+				qPrintable(fileName));
+			return;
+		}
+	}
+
+	tailFile.close();
+	tailFile.remove();
+}
+
+// returns true if the segment has been extracted completely
+bool DvbMuxExtractor::extractSegment(QFile &outputFile, const DvbMuxSegment &segment,
+	bool recording)
+{
+	QFile indexFile(segment.recorder->getIndexFileName());
+	QFile inputFile(segment.recorder->getFileName());
+
+	if (!indexFile.open(QIODevice::ReadOnly) || !inputFile.open(QIODevice::ReadOnly)) {
+		qCWarning(logDvb, "Cannot open mux recording %s", qPrintable(inputFile.fileName()));
+		return true;
+	}
+
+	QDataStream stream(&indexFile);
+	stream.setVersion(QDataStream::Qt_4_4);
+	int version;
+	stream >> version;
+
+	if (version != muxIndexVersion) {
+		qCWarning(logDvb, "Wrong version for: %s", qPrintable(indexFile.fileName()));
+		return true;
+	}
+
+	QList<DvbMuxIndexEntry> entries;
+
+	while (!stream.atEnd()) {
+		DvbMuxIndexEntry entry;
+		stream >> entry.time;
+		stream >> entry.offset;
+		stream >> entry.pids;
+
+		if (stream.status() != QDataStream::Ok) {
+			// the recorder may still be appending entries
+			break;
+		}
+
+		entries.append(entry);
+
+		if ((segment.end >= 0) && (entry.time >= segment.end)) {
+			break;
+		}
+	}
+
+	qint64 begin = segment.begin;
+
+	if (extractedTime >= 0) {
+		begin = extractedTime;
+	}
+
+	int beginIndex = 0;
+
+	while (((beginIndex + 1) < entries.size()) &&
+	       (entries.at(beginIndex + 1).time <= begin)) {
+		++beginIndex;
+	}
+
+	// an empty pmt means that the whole transport stream is copied
+	bool copyAll = segment.pmtSectionData.isEmpty();
+
+	if (!copyAll && (extractedTime < 0)) {
+		patGenerator.initPat(transportStreamId, serviceId, pmtPid);
+		pmtGenerator.initPmt(pmtPid, DvbPmtSection(segment.pmtSectionData), segment.pids);
+	}
+
+	QSet<int> servicePids(segment.pids.constBegin(), segment.pids.constEnd());
+	servicePids.remove(0x00);
+	servicePids.remove(pmtPid);
+	QByteArray inputBuffer;
+	QByteArray outputBuffer;
+	outputBuffer.reserve(348 * 188);
+
+	for (int i = beginIndex; (i + 1) < entries.size(); ++i) {
+		if (isInterruptionRequested()) {
+			return false;
+		}
+
+		const DvbMuxIndexEntry &entry = entries.at(i);
+		const DvbMuxIndexEntry &nextEntry = entries.at(i + 1);
+
+		// while recording, the data may not have reached the file yet
+		if (recording && (nextEntry.offset > inputFile.size())) {
+			return false;
+		}
+
+		bool containsService = copyAll;
+
+		if (!copyAll) {
+			outputFile.write(patGenerator.generatePackets());
+			outputFile.write(pmtGenerator.generatePackets());
+
+			foreach (int pid, nextEntry.pids) {
+				if (servicePids.contains(pid)) {
+					containsService = true;
+					break;
+				}
+			}
+		}
+
+		extractedTime = nextEntry.time;
+
+		if (!containsService) {
+			continue;
+		}
+
+		inputFile.seek(entry.offset);
+		qint64 size = (nextEntry.offset - entry.offset);
+
+		while (size > 0) {
+			inputBuffer = inputFile.read(qMin<qint64>(size, 348 * 188));
+
+			if (inputBuffer.isEmpty()) {
+				qCWarning(logDvb, "Unexpected end of %s", qPrintable(inputFile.fileName()));
+				return true;
+			}
+
+			size -= inputBuffer.size();
+
+			if (copyAll) {
+				outputFile.write(inputBuffer);
+				continue;
+			}
+
+			for (int j = 0; (j + 188) <= inputBuffer.size(); j += 188) {
+				const char *packet = (inputBuffer.constData() + j);
+				int pid = ((static_cast<unsigned char>(packet[1]) << 8) |
+					static_cast<unsigned char>(packet[2])) & ((1 << 13) - 1);
+
+				if (servicePids.contains(pid)) {
+					outputBuffer.append(packet, 188);
+				}
+			}
+
+			outputFile.write(outputBuffer);
+			outputBuffer.clear();
+		}
+	}
+
+	return ((segment.end >= 0) && !entries.isEmpty() && (entries.last().time >= segment.end));
+}
@@ -0,0 +1,175 @@
+/*
+ * dvbmuxrecording.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBMUXRECORDING_H
+#define DVBMUXRECORDING_H
+
+#include <QBitArray>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QSharedData>
+#include <QThread>
+#include "dvbbackenddevice.h"
+#include "dvbsi.h"
+
+class DvbDevice;
+
+/*
+ * records the whole transport stream of a device into a single file, so that
+ * several recordings on the same transponder only cause one sequential stream;
+ * a second file contains an index (time, offset, pids seen in the interval)
+ * which is used to extract the services later
+ */
+
+class DvbMuxRecorder : public QSharedData, private DvbPidFilter
+{
+public:
+	DvbMuxRecorder(DvbDevice *device_, const QString &fileName);
+	~DvbMuxRecorder(); // removes the files (unless keepFiles() was called)
+
+	bool isValid() const
+	{
+		return (device != NULL);
+	}
+
+	DvbDevice *getDevice() const
+	{
+		return device;
+	}
+
+	QString getFileName() const
+	{
+		return file.fileName();
+	}
+
+	QString getIndexFileName() const
+	{
+		return indexFile.fileName();
+	}
+
+	/*
+	 * flushes the data and inserts an index entry, so that the returned
+	 * time (ms since the start of the recorder) can be located exactly
+	 */
+
+	qint64 mark();
+
+	void attach();
+	bool detach(); // returns true if there are no users left
+	void stop();
+
+	// an extraction was interrupted; the data is needed to recover the recording
+	void keepFiles()
+	{
+		removeFiles = false;
+	}
+
+private:
+	void processData(const char data[188]) override;
+	void flush();
+	void writeIndexEntry(qint64 time);
+
+	DvbDevice *device;
+	QFile file;
+	QFile indexFile;
+	QDataStream indexStream;
+	QElapsedTimer timer;
+	qint64 nextIndexTime;
+	qint64 offset;
+	QByteArray buffer;
+	QBitArray seenPids;
+	int users;
+	bool removeFiles;
+};
+
+class DvbMuxSegment
+{
+public:
+	DvbMuxSegment() : begin(-1), end(-1) { }
+	DvbMuxSegment(const QExplicitlySharedDataPointer<DvbMuxRecorder> &recorder_, qint64 begin_) :
+		recorder(recorder_), begin(begin_), end(-1) { }
+	~DvbMuxSegment() { }
+
+	QExplicitlySharedDataPointer<DvbMuxRecorder> recorder;
+	qint64 begin; // ms since the start of the recorder
+	qint64 end; // -1 while the segment is being recorded
+	QByteArray pmtSectionData; // empty if no valid pmt has been seen yet
+	QList<int> pids;
+};
+
+/*
+ * writes the packets of a single service to a file, together with a freshly
+ * generated PAT / PMT (each segment has its own PMT); the mux recordings are
+ * read in a separate thread
+ *
+ * while the recording is running, the extractor is started periodically and
+ * appends the new data, so that the file can be played like any other
+ * recording; after finish() the rest is extracted and a service recording
+ * (tail file) is appended and removed afterwards
+ *
+ * if no segment has a PMT, the whole transport stream is copied instead
+ */
+
+class DvbMuxExtractor : public QThread
+{
+public:
+	DvbMuxExtractor(const QString &fileName_, int transportStreamId_, int serviceId_,
+		int pmtPid_);
+	~DvbMuxExtractor(); // interrupts the extraction
+
+	QString getFileName() const
+	{
+		return fileName;
+	}
+
+	// thread-safe; the extractor has to be (re)started afterwards
+	void update(const QList<DvbMuxSegment> &segments_);
+	void finish(const QList<DvbMuxSegment> &segments_, const QString &tailFileName_);
+
+	bool isDone(); // thread-safe; true once the data passed to finish() is extracted
+
+private:
+	void run() override;
+	bool extractSegment(QFile &outputFile, const DvbMuxSegment &segment, bool recording);
+	void appendTail(QFile &outputFile, const QString &tailFileName);
+	static bool completeSegments(QList<DvbMuxSegment> &segments);
+
+	QString fileName;
+	int transportStreamId;
+	int serviceId;
+	int pmtPid;
+
+	QMutex mutex;
+	QList<DvbMuxSegment> pendingSegments;
+	QString pendingTailFileName;
+	bool finishing;
+	bool done;
+
+	// only accessed by the thread itself
+	bool outputCreated;
+	int currentSegment;
+	qint64 extractedTime; // within the current segment (-1 = nothing yet)
+	DvbSectionGenerator patGenerator;
+	DvbSectionGenerator pmtGenerator;
+};
+
+#endif /* DVBMUXRECORDING_H */
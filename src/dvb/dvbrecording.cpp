@@ -136,7 +136,7 @@ DvbRecordingModel::~DvbRecordingModel()
 		qCWarning(logDvb, "Illegal recursive call");
 	}
 
-	sqlFlush();
+	sqlSync();
 }
 
 bool DvbRecordingModel::hasRecordings() const
@@ -297,6 +297,31 @@ void DvbRecordingModel::executeActionAfterRecording(DvbRecording recording)
 
 }
 
+void DvbRecordingModel::executeActionAfterExtraction(DvbMuxExtractor *muxExtractor,
+	const DvbRecording &recording)
+{
+	pendingActions.insert(muxExtractor, recording);
+	connect(muxExtractor, SIGNAL(finished()), this, SLOT(muxExtractorFinished()));
+}
+
+void DvbRecordingModel::muxExtractorFinished()
+{
+	DvbMuxExtractor *muxExtractor = static_cast<DvbMuxExtractor *>(sender());
+
+	if (!muxExtractor->isDone()) {
+		// a pass of the running recording has ended; DvbManager restarts it
+		return;
+	}
+
+	QMap<QObject *, DvbRecording>::iterator it = pendingActions.find(muxExtractor);
+
+	if (it != pendingActions.end()) {
+		DvbRecording recording = *it;
+		pendingActions.erase(it);
+		executeActionAfterRecording(recording);
+	}
+}
+
 void DvbRecordingModel::removeDuplicates()
 {
 	QList<DvbSharedRecording> recordingList = QList<DvbSharedRecording>();
@@ -565,7 +590,7 @@ void DvbRecordingModel::timerEvent(QTimerEvent *event)
 	}
 }
 
-void DvbRecordingModel::bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index) const
+void DvbRecordingModel::appendSqlValues(SqlKey sqlKey, QVariantList &values) const
 {
 	DvbSharedRecording recording = recordings.value(sqlKey);
 
@@ -574,18 +599,18 @@ void DvbRecordingModel::bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int inde
 		return;
 	}
 
-	query.bindValue(index++, recording->name);
-	query.bindValue(index++, recording->channel->name);
-	query.bindValue(index++, recording->begin.toString(Qt::ISODate) + QLatin1Char('Z'));
-	query.bindValue(index++, recording->duration.toString(Qt::ISODate));
-	query.bindValue(index++, recording->repeat);
-	query.bindValue(index++, recording->subheading);
-	query.bindValue(index++, recording->details);
-	query.bindValue(index++, recording->beginEPG.toString(Qt::ISODate));
-	query.bindValue(index++, recording->endEPG.toString(Qt::ISODate));
-	query.bindValue(index++, recording->durationEPG.toString(Qt::ISODate));
-	query.bindValue(index++, recording->priority);
-	query.bindValue(index++, recording->disabled);
+	values.append(recording->name);
+	values.append(recording->channel->name);
+	values.append(recording->begin.toString(Qt::ISODate) + QLatin1Char('Z'));
+	values.append(recording->duration.toString(Qt::ISODate));
+	values.append(recording->repeat);
+	values.append(recording->subheading);
+	values.append(recording->details);
+	values.append(recording->beginEPG.toString(Qt::ISODate));
+	values.append(recording->endEPG.toString(Qt::ISODate));
+	values.append(recording->durationEPG.toString(Qt::ISODate));
+	values.append(recording->priority);
+	values.append(recording->disabled);
 }
 
 bool DvbRecordingModel::insertFromSqlQuery(SqlKey sqlKey, const QSqlQuery &query, int index)
@@ -761,11 +786,12 @@ bool DvbRecordingModel::updateStatus(DvbRecording &recording)
 }
 
 DvbRecordingFile::DvbRecordingFile(DvbManager *manager_) : manager(manager_), device(NULL),
-	pmtValid(false)
+	pmtValid(false), muxExtractor(NULL)
 {
 	connect(&pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
 		this, SLOT(pmtSectionChanged(QByteArray)));
 	connect(&patPmtTimer, SIGNAL(timeout()), this, SLOT(insertPatPmt()));
+	connect(&muxExtractionTimer, SIGNAL(timeout()), this, SLOT(extractMuxSegments()));
 }
 
 DvbRecordingFile::~DvbRecordingFile()
@@ -895,7 +921,7 @@ bool DvbRecordingFile::start(DvbRecording &recording)
 
 		connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
 		pmtFilter.setProgramNumber(channel->serviceId);
-		device->addSectionFilter(channel->pmtPid, &pmtFilter);
+		device->addSectionFilter(channel->pmtPid, &pmtFilter, DvbDevice::PmtPriority);
 		pmtSectionData = channel->pmtSectionData;
 		patGenerator.initPat(channel->transportStreamId, channel->serviceId,
 			channel->pmtPid);
@@ -903,6 +929,14 @@ bool DvbRecordingFile::start(DvbRecording &recording)
 		if (channel->isScrambled && !pmtSectionData.isEmpty()) {
 			device->startDescrambling(pmtSectionData, this);
 		}
+
+		if (manager->isMuxRecording()) {
+			attachMuxRecorder();
+
+			if ((muxRecorder.constData() != NULL) && !pmtSectionData.isEmpty()) {
+				pmtSectionChanged(pmtSectionData);
+			}
+		}
 	}
 
 	manager->getRecordingModel()->setCurrentRecording(recording);
@@ -917,8 +951,12 @@ void DvbRecordingFile::stop()
 			device->stopDescrambling(pmtSectionData, this);
 		}
 
-		foreach (int pid, pids) {
-			device->removePidFilter(pid, this);
+		if (usesMuxRecorder()) {
+			detachMuxRecorder();
+		} else {
+			foreach (int pid, pids) {
+				device->removePidFilter(pid, this);
+			}
 		}
 
 		device->removeSectionFilter(channel->pmtPid, &pmtFilter);
@@ -927,6 +965,44 @@ void DvbRecordingFile::stop()
 		device = NULL;
 	}
 
+	DvbRecordingModel *recordingModel = manager->getRecordingModel();
+	bool extracting = false;
+
+	if (!muxSegments.isEmpty()) {
+		file.close();
+		QString tailFileName;
+
+		if (!serviceFileName.isEmpty()) {
+			tailFileName = file.fileName();
+		}
+
+		bool hasPmt = false;
+
+		foreach (const DvbMuxSegment &segment, muxSegments) {
+			if (!segment.pmtSectionData.isEmpty()) {
+				hasPmt = true;
+				break;
+			}
+		}
+
+		if (!hasPmt) {
+			// the extractor copies the unfiltered transport stream instead
+			qCWarning(logDvb, "Never received a valid PMT for %s",
+				qPrintable(muxExtractor->getFileName()));
+		}
+
+		muxExtractionTimer.stop();
+		muxExtractor->finish(muxSegments, tailFileName);
+		// the file is complete once the extractor has finished
+		recordingModel->executeActionAfterExtraction(muxExtractor,
+			recordingModel->getCurrentRecording());
+		manager->extractMuxService(muxExtractor);
+		muxExtractor = NULL;
+		extracting = true;
+		muxSegments.clear();
+		serviceFileName.clear();
+	}
+
 	pmtValid = false;
 	patPmtTimer.stop();
 	patGenerator.reset();
@@ -937,17 +1013,24 @@ void DvbRecordingFile::stop()
 	file.close();
 	channel = DvbSharedChannel();
 
-	manager->getRecordingModel()->executeActionAfterRecording(manager->getRecordingModel()->getCurrentRecording());
-	manager->getRecordingModel()->findNewRecordings();
-	manager->getRecordingModel()->removeDuplicates();
-	manager->getRecordingModel()->disableConflicts();
+	if (!extracting) {
+		recordingModel->executeActionAfterRecording(recordingModel->getCurrentRecording());
+	}
+
+	recordingModel->findNewRecordings();
+	recordingModel->removeDuplicates();
+	recordingModel->disableConflicts();
 }
 
 void DvbRecordingFile::deviceStateChanged()
 {
 	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
-		foreach (int pid, pids) {
-			device->removePidFilter(pid, this);
+		if (usesMuxRecorder()) {
+			detachMuxRecorder();
+		} else {
+			foreach (int pid, pids) {
+				device->removePidFilter(pid, this);
+			}
 		}
 
 		device->removeSectionFilter(channel->pmtPid, &pmtFilter);
@@ -962,10 +1045,15 @@ void DvbRecordingFile::deviceStateChanged()
 
 		if (device != NULL) {
 			connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
-			device->addSectionFilter(channel->pmtPid, &pmtFilter);
+			device->addSectionFilter(channel->pmtPid, &pmtFilter,
+				DvbDevice::PmtPriority);
 
-			foreach (int pid, pids) {
-				device->addPidFilter(pid, this);
+			if (usesMuxRecorder()) {
+				attachMuxRecorder();
+			} else {
+				foreach (int pid, pids) {
+					device->addPidFilter(pid, this, DvbDevice::RecordingPriority);
+				}
 			}
 
 			if (channel->isScrambled && !pmtSectionData.isEmpty()) {
@@ -1014,17 +1102,35 @@ void DvbRecordingFile::pmtSectionChanged(const QByteArray &pmtSectionData_)
 		int pid = pids.at(i);
 
 		if (!newPids.remove(pid)) {
-			device->removePidFilter(pid, this);
+			if (!usesMuxRecorder()) {
+				device->removePidFilter(pid, this);
+			}
+
 			pids.removeAt(i);
 			--i;
 		}
 	}
 
 	foreach (int pid, newPids) {
-		device->addPidFilter(pid, this);
+		if (!usesMuxRecorder()) {
+			device->addPidFilter(pid, this, DvbDevice::RecordingPriority);
+		}
+
 		pids.append(pid);
 	}
 
+	if (usesMuxRecorder()) {
+		// the service is extracted from the mux recording (see extractMuxSegments())
+		updateMuxSegment();
+		pmtValid = true;
+
+		if (channel->isScrambled) {
+			device->startDescrambling(pmtSectionData, this);
+		}
+
+		return;
+	}
+
 	pmtGenerator.initPmt(channel->pmtPid, pmtSection, pids);
 
 	if (!pmtValid) {
@@ -1058,6 +1164,105 @@ void DvbRecordingFile::insertPatPmt()
 	file.write(pmtGenerator.generatePackets());
 }
 
+bool DvbRecordingFile::usesMuxRecorder() const
+{
+	return (!muxSegments.isEmpty() && serviceFileName.isEmpty());
+}
+
+void DvbRecordingFile::attachMuxRecorder()
+{
+	muxRecorder = manager->attachMuxRecorder(device);
+
+	if (muxRecorder.constData() == NULL) {
+		if (muxSegments.isEmpty()) {
+			qCWarning(logDvb, "Cannot record the full transport stream, recording the service only");
+		} else {
+			qCWarning(logDvb, "Cannot resume the full transport stream recording, recording the service only");
+			recordTail();
+		}
+
+		return;
+	}
+
+	DvbMuxSegment segment(muxRecorder, muxRecorder->mark());
+
+	if (pmtValid) {
+		segment.pmtSectionData = pmtSectionData;
+		segment.pids = pids;
+	}
+
+	muxSegments.append(segment);
+
+	if (muxExtractor == NULL) {
+		muxExtractor = new DvbMuxExtractor(file.fileName(), channel->transportStreamId,
+			channel->serviceId, channel->pmtPid);
+		muxExtractionTimer.start(5000);
+	}
+}
+
+void DvbRecordingFile::updateMuxSegment()
+{
+	if (muxRecorder.constData() == NULL) {
+		return;
+	}
+
+	// a changed pmt starts a new segment, so that every part of the recording
+	// is extracted with the pmt which was valid at that time
+	if (!muxSegments.last().pmtSectionData.isEmpty() &&
+	    (muxSegments.last().pmtSectionData != pmtSectionData)) {
+		qint64 time = muxRecorder->mark();
+		muxSegments.last().end = time;
+		muxSegments.append(DvbMuxSegment(muxRecorder, time));
+	}
+
+	muxSegments.last().pmtSectionData = pmtSectionData;
+	muxSegments.last().pids = pids;
+}
+
+void DvbRecordingFile::extractMuxSegments()
+{
+	// appends the data recorded so far, so that the file can already be played
+	muxExtractor->update(muxSegments);
+
+	if (!muxExtractor->isRunning()) {
+		muxExtractor->start(QThread::LowPriority);
+	}
+}
+
+void DvbRecordingFile::recordTail()
+{
+	// the segments recorded so far are still extracted after stop(); the
+	// extractor appends the tail file afterwards
+	serviceFileName = file.fileName();
+	file.close();
+	file.setFileName(serviceFileName + QLatin1String(".tail"));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(logDvb, "Cannot open file %s", qPrintable(file.fileName()));
+	}
+
+	pmtValid = false;
+
+	foreach (int pid, pids) {
+		device->addPidFilter(pid, this, DvbDevice::RecordingPriority);
+	}
+
+	if (!pmtSectionData.isEmpty()) {
+		pmtSectionChanged(pmtSectionData);
+	}
+}
+
+void DvbRecordingFile::detachMuxRecorder()
+{
+	if (muxRecorder.constData() == NULL) {
+		return;
+	}
+
+	muxSegments.last().end = muxRecorder->mark();
+	manager->detachMuxRecorder(muxRecorder);
+	muxRecorder.reset();
+}
+
 void DvbRecordingFile::processData(const char data[188])
 {
 	if (!pmtValid) {
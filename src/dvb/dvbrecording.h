@@ -26,6 +26,7 @@
 #include "dvbchannel.h"
 
 class DvbManager;
+class DvbMuxExtractor;
 class DvbRecordingFile;
 class DvbEpgEntry;
 
@@ -88,6 +89,9 @@ public:
 	void findNewRecordings();
 	void removeDuplicates();
 	void executeActionAfterRecording(DvbRecording recording);
+	// must be called before the extractor is started
+	void executeActionAfterExtraction(DvbMuxExtractor *muxExtractor,
+		const DvbRecording &recording);
 	DvbRecording getCurrentRecording();
 	void setCurrentRecording(DvbRecording _currentRecording);
 	void disableLessImportant(DvbSharedRecording &recording1, DvbSharedRecording &recording2);
@@ -109,10 +113,13 @@ signals:
 	void recordingUpdated(const DvbSharedRecording &recording);
 	void recordingRemoved(const DvbSharedRecording &recording);
 
+private slots:
+	void muxExtractorFinished();
+
 private:
 	void timerEvent(QTimerEvent *event) override;
 
-	void bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index) const override;
+	void appendSqlValues(SqlKey sqlKey, QVariantList &values) const override;
 	bool insertFromSqlQuery(SqlKey sqlKey, const QSqlQuery &query, int index) override;
 	bool updateStatus(DvbRecording &recording);
 	bool existsSimilarRecording(DvbEpgEntry recording);
@@ -123,6 +130,7 @@ private:
 	QMap<SqlKey, QExplicitlySharedDataPointer<DvbRecordingFile> > recordingFiles;
 	bool hasPendingOperation;
 	DvbRecording currentRecording;
+	QMap<QObject *, DvbRecording> pendingActions; // mux extractor -> recording
 };
 
 void delay(int seconds);
@@ -24,6 +24,7 @@
 #include <QFile>
 #include <QTimer>
 #include "dvbchannel.h"
+#include "dvbmuxrecording.h"
 #include "dvbsi.h"
 
 class DvbDevice;
@@ -45,9 +46,15 @@ private slots:
 	void deviceStateChanged();
 	void pmtSectionChanged(const QByteArray &pmtSectionData_);
 	void insertPatPmt();
+	void extractMuxSegments();
 
 private:
 	void processData(const char data[188]) override;
+	bool usesMuxRecorder() const;
+	void attachMuxRecorder();
+	void detachMuxRecorder();
+	void updateMuxSegment();
+	void recordTail();
 
 	DvbManager *manager;
 	DvbSharedChannel channel;
@@ -61,6 +68,13 @@ private:
 	DvbSectionGenerator pmtGenerator;
 	QTimer patPmtTimer;
 	bool pmtValid;
+	QExplicitlySharedDataPointer<DvbMuxRecorder> muxRecorder;
+	QList<DvbMuxSegment> muxSegments;
+	// extracts the service while recording; handed to the manager by stop()
+	DvbMuxExtractor *muxExtractor;
+	QTimer muxExtractionTimer;
+	// set if the rest of a mux recording is recorded per pid into 'file'
+	QString serviceFileName;
 };
 
 #endif /* DVBRECORDING_P_H */
@@ -100,7 +100,7 @@ bool DvbScanFilter::startFilter(int pid_, DvbScan::FilterType type_)
 	type = type_;
 	multipleSections.clear();
 
-	if (!scan->device->addSectionFilter(pid, this)) {
+	if (!scan->device->addSectionFilter(pid, this, DvbDevice::PmtPriority)) {
 		pid = -1;
 		return false;
 	}
@@ -543,6 +543,7 @@ void DvbScanDialog::updateStatus()
 void DvbScanDialog::addSelectedChannels()
 {
 	QSet<int> selectedRows;
+	QList<DvbChannel> newChannels;
 
 	foreach (const QModelIndex &modelIndex,
 		 scanResultsView->selectionModel()->selectedIndexes()) {
@@ -551,14 +552,17 @@ void DvbScanDialog::addSelectedChannels()
 			const DvbChannel *channel = scanResultsView->model()->data(modelIndex,
 				DvbPreviewChannelTableModel::DvbPreviewChannelRole).
 				value<const DvbPreviewChannel *>();
-			DvbChannel newChannel(*channel);
-			channelModel->addChannel(newChannel);
+			newChannels.append(*channel);
 		}
 	}
+
+	channelModel->addChannels(newChannels);
 }
 
 void DvbScanDialog::addFilteredChannels()
 {
+	QList<DvbChannel> newChannels;
+
 	foreach (const DvbPreviewChannel &channel, previewModel->getChannels()) {
 		if (ftaCheckBox->isChecked()) {
 			// only fta channels
@@ -590,9 +594,10 @@ void DvbScanDialog::addFilteredChannels()
 			}
 		}
 
-		DvbChannel newChannel(channel);
-		channelModel->addChannel(newChannel);
+		newChannels.append(channel);
 	}
+
+	channelModel->addChannels(newChannels);
 }
 
 void DvbScanDialog::setDevice(DvbDevice *newDevice)
@@ -0,0 +1,309 @@
+/*
+ * dvbscanindex.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QList>
+#include <QtEndian>
+
+#include "dvbscanindex.h"
+
+// this file is also used by tools/indexscanfile.cpp, so it must only depend on QtCore
+
+static const quint32 indexMagic = 0x5843534b; // "KSCX"
+static const quint32 indexVersion = 1;
+static const int headerSize = 6 * 4;
+static const int entrySize = 5 * 4;
+
+class DvbScanIndexSource
+{
+public:
+	DvbScanIndexSource() : type(DvbScanIndex::DvbC), flags(0) { }
+	~DvbScanIndexSource() { }
+
+	DvbScanIndex::SourceType type;
+	int flags;
+	QByteArray name;
+	QByteArray transponderLines;
+};
+
+static bool parseSourceType(const QByteArray &string, DvbScanIndex::SourceType *type)
+{
+	QByteArray lowerString = string.toLower();
+
+	if (lowerString == "dvb-c") {
+		*type = DvbScanIndex::DvbC;
+	} else if (lowerString == "dvb-s") {
+		*type = DvbScanIndex::DvbS;
+	} else if (lowerString == "dvb-t") {
+		*type = DvbScanIndex::DvbT;
+	} else if (lowerString == "atsc") {
+		*type = DvbScanIndex::Atsc;
+	} else if (lowerString == "isdb-t") {
+		*type = DvbScanIndex::IsdbT;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+static void writeUInt(QByteArray &array, int offset, quint32 value)
+{
+	qToLittleEndian<quint32>(value, array.data() + offset);
+}
+
+DvbScanIndex::DvbScanIndex() : indexData(NULL), indexSize(0)
+{
+}
+
+DvbScanIndex::~DvbScanIndex()
+{
+}
+
+QByteArray DvbScanIndex::build(const QByteArray &scanFileData, QString *errorMessage)
+{
+	QList<QByteArray> lines = scanFileData.split('\n');
+	QList<DvbScanIndexSource> sources;
+	QDate date;
+	int skippedLines = 0;
+	bool skipSection = false;
+
+	for (int i = 0; i < lines.size(); ++i) {
+		QByteArray line = lines.at(i).trimmed();
+
+		if (line.isEmpty() || line.startsWith('#')) {
+			continue;
+		}
+
+		if (!date.isValid()) {
+			// the first line has to be the date
+			if ((line != "[date]") || ((i + 1) >= lines.size())) {
+				break;
+			}
+
+			++i;
+			date = QDate::fromString(QString::fromLatin1(lines.at(i).trimmed()), Qt::ISODate);
+
+			if (!date.isValid()) {
+				break;
+			}
+
+			continue;
+		}
+
+		if (line.startsWith('[')) {
+			// [<type>/<name>]
+			int bracketIndex = line.indexOf(']');
+			int slashIndex = line.lastIndexOf('/', bracketIndex);
+			DvbScanIndexSource source;
+
+			if ((bracketIndex < 0) || (slashIndex < 2) || (bracketIndex <= (slashIndex + 1)) ||
+			    !parseSourceType(line.mid(1, slashIndex - 1), &source.type)) {
+				++skippedLines;
+				skipSection = true;
+				continue;
+			}
+
+			source.name = line.mid(slashIndex + 1, bracketIndex - slashIndex - 1);
+			sources.append(source);
+			skipSection = false;
+			continue;
+		}
+
+		if (sources.isEmpty() || skipSection) {
+			++skippedLines;
+			continue;
+		}
+
+		DvbScanIndexSource &source = sources.last();
+
+		if ((line.size() >= 2) && (line.at(1) != '2')) {
+			if (line.at(0) == 'S') {
+				source.flags |= ContainsDvbS1;
+			} else if (line.at(0) == 'T') {
+				source.flags |= ContainsDvbT1;
+			}
+		}
+
+		if (!source.transponderLines.isEmpty()) {
+			source.transponderLines.append('\n');
+		}
+
+		source.transponderLines.append(line);
+	}
+
+	if (!date.isValid()) {
+		*errorMessage = QLatin1String("the scan data doesn't start with a valid date");
+		return QByteArray();
+	}
+
+	if (skippedLines > 0) {
+		*errorMessage = QString::fromLatin1("%1 unrecognized lines").arg(skippedLines);
+	}
+
+	QByteArray index(headerSize + sources.size() * entrySize, 0);
+	writeUInt(index, 0, indexMagic);
+	writeUInt(index, 4, indexVersion);
+	writeUInt(index, 8, quint32(date.toJulianDay()));
+	writeUInt(index, 12, quint32(scanFileData.size()));
+	writeUInt(index, 16, quint32(sources.size()));
+
+	for (int i = 0; i < sources.size(); ++i) {
+		const DvbScanIndexSource &source = sources.at(i);
+		int entryOffset = (headerSize + i * entrySize);
+		writeUInt(index, entryOffset, quint32(source.type) | (quint32(source.flags) << 8));
+		writeUInt(index, entryOffset + 4, quint32(index.size()));
+		writeUInt(index, entryOffset + 8, quint32(source.name.size()));
+		index.append(source.name);
+		writeUInt(index, entryOffset + 12, quint32(index.size()));
+		writeUInt(index, entryOffset + 16, quint32(source.transponderLines.size()));
+		index.append(source.transponderLines);
+	}
+
+	return index;
+}
+
+bool DvbScanIndex::open(const QString &fileName)
+{
+	close();
+	file.setFileName(fileName);
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	indexSize = file.size();
+	indexData = file.map(0, indexSize);
+
+	if (indexData == NULL) {
+		data = file.readAll();
+		file.close();
+		indexData = reinterpret_cast<const uchar *>(data.constData());
+		indexSize = data.size();
+	}
+
+	if (!validate()) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+bool DvbScanIndex::setData(const QByteArray &data_)
+{
+	close();
+	data = data_;
+	indexData = reinterpret_cast<const uchar *>(data.constData());
+	indexSize = data.size();
+
+	if (!validate()) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void DvbScanIndex::close()
+{
+	// closing the file also unmaps it
+	file.close();
+	data.clear();
+	indexData = NULL;
+	indexSize = 0;
+}
+
+QDate DvbScanIndex::getDate() const
+{
+	return QDate::fromJulianDay(readUInt(8));
+}
+
+qint64 DvbScanIndex::getScanFileSize() const
+{
+	return readUInt(12);
+}
+
+int DvbScanIndex::getSourceCount() const
+{
+	return int(readUInt(16));
+}
+
+DvbScanIndex::SourceType DvbScanIndex::getSourceType(int index) const
+{
+	return static_cast<SourceType>(readUInt(headerSize + index * entrySize) & 0xff);
+}
+
+int DvbScanIndex::getSourceFlags(int index) const
+{
+	return int(readUInt(headerSize + index * entrySize) >> 8);
+}
+
+QString DvbScanIndex::getSourceName(int index) const
+{
+	qint64 entryOffset = (headerSize + index * entrySize);
+	return QString::fromLatin1(reinterpret_cast<const char *>(indexData) +
+		readUInt(entryOffset + 4), readUInt(entryOffset + 8));
+}
+
+QByteArray DvbScanIndex::getTransponderLines(int index) const
+{
+	qint64 entryOffset = (headerSize + index * entrySize);
+	// no copy; only valid as long as the index is open
+	return QByteArray::fromRawData(reinterpret_cast<const char *>(indexData) +
+		readUInt(entryOffset + 12), readUInt(entryOffset + 16));
+}
+
+bool DvbScanIndex::validate()
+{
+	if ((indexData == NULL) || (indexSize < headerSize) || (readUInt(0) != indexMagic) ||
+	    (readUInt(4) != indexVersion)) {
+		return false;
+	}
+
+	qint64 sourceCount = readUInt(16);
+
+	if ((headerSize + sourceCount * entrySize) > indexSize) {
+		return false;
+	}
+
+	for (qint64 i = 0; i < sourceCount; ++i) {
+		qint64 entryOffset = (headerSize + i * entrySize);
+
+		if ((readUInt(entryOffset) & 0xff) > IsdbT) {
+			return false;
+		}
+
+		for (int j = 4; j < entrySize; j += 8) {
+			qint64 offset = readUInt(entryOffset + j);
+			qint64 size = readUInt(entryOffset + j + 4);
+
+			if ((offset > indexSize) || (size > (indexSize - offset))) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+quint32 DvbScanIndex::readUInt(qint64 offset) const
+{
+	return qFromLittleEndian<quint32>(indexData + offset);
+}
@@ -0,0 +1,93 @@
+/*
+ * dvbscanindex.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBSCANINDEX_H
+#define DVBSCANINDEX_H
+
+#include <QByteArray>
+#include <QDate>
+#include <QFile>
+#include <QString>
+
+/*
+ * precompiled form of scanfile.dvb; a header, one fixed size entry per source
+ * and the names and transponder lines of all sources, so that the index can
+ * be mapped and only the transponders of the requested source need to be
+ * parsed (all integers are little endian quint32)
+ *
+ * header: magic, version, date (julian day), size of scanfile.dvb, number
+ *         of sources, reserved
+ * entry: type | (flags << 8), name offset, name length, data offset,
+ *        data length (transponder lines separated by '\n')
+ */
+
+class DvbScanIndex
+{
+public:
+	enum SourceType {
+		DvbC = 0,
+		DvbS = 1,
+		DvbT = 2,
+		Atsc = 3,
+		IsdbT = 4
+	};
+
+	enum SourceFlag {
+		ContainsDvbS1 = 0x01,
+		ContainsDvbT1 = 0x02
+	};
+
+	DvbScanIndex();
+	~DvbScanIndex();
+
+	// returns an empty array and sets errorMessage if scanFileData is malformed
+	static QByteArray build(const QByteArray &scanFileData, QString *errorMessage);
+
+	// the file is mapped (or read if mapping isn't possible)
+	bool open(const QString &fileName);
+	bool setData(const QByteArray &data_);
+	void close();
+
+	bool isValid() const
+	{
+		return (indexData != NULL);
+	}
+
+	QDate getDate() const;
+	qint64 getScanFileSize() const;
+	int getSourceCount() const;
+	SourceType getSourceType(int index) const;
+	int getSourceFlags(int index) const;
+	QString getSourceName(int index) const;
+	QByteArray getTransponderLines(int index) const;
+
+private:
+	Q_DISABLE_COPY(DvbScanIndex)
+
+	bool validate();
+	quint32 readUInt(qint64 offset) const;
+
+	QFile file;
+	QByteArray data;
+	const uchar *indexData;
+	qint64 indexSize;
+};
+
+#endif /* DVBSCANINDEX_H */
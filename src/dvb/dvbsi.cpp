@@ -492,34 +492,89 @@ QString AtscHuffmanString::convertText(const char *data_, int length, int table)
 	return huffmanstring.result;
 }
 
-AtscHuffmanString::AtscHuffmanString(const char *data_, int length, int table) : data(data_),
-	bitsLeft(8 * length)
+/*
+ * for every context (previous character) and every possible next byte of input,
+ * the result of walking the huffman tree for up to eight bits:
+ * 0x8000 | (consumed bits << 8) | character if a leaf is reached,
+ * otherwise the tree node reached after eight bits
+ */
+
+class AtscHuffmanLookup
 {
+public:
+	AtscHuffmanLookup(const unsigned short *offsets, const unsigned char *tableBase);
+	~AtscHuffmanLookup() { }
+
+	quint16 entries[128 * 256];
+};
+
+AtscHuffmanLookup::AtscHuffmanLookup(const unsigned short *offsets,
+	const unsigned char *tableBase)
+{
+	for (int context = 0; context < 128; ++context) {
+		const unsigned char *table = (tableBase + offsets[context]);
+
+		for (int value = 0; value < 256; ++value) {
+			int index = 0;
+			quint16 entry = 0;
+
+			for (int bit = 0; bit < 8; ++bit) {
+				index = table[2 * index + ((value >> (7 - bit)) & 0x1)];
+
+				if (index >= 128) {
+					entry = (0x8000 | ((bit + 1) << 8) | (index & 0x7f));
+					break;
+				}
+
+				entry = index;
+			}
+
+			entries[(context << 8) | value] = entry;
+		}
+	}
+}
+
+AtscHuffmanString::AtscHuffmanString(const char *data_, int length_, int table) :
+	data(reinterpret_cast<const unsigned char *>(data_)), length(length_), bitPosition(0),
+	bitCount(8 * length_)
+{
+	// built on first use (thread-safe)
 	if (table == 1) {
+		static const AtscHuffmanLookup huffman1Lookup(Huffman1Offsets, Huffman1Tables);
 		offsets = Huffman1Offsets;
 		tableBase = Huffman1Tables;
+		lookup = huffman1Lookup.entries;
 	} else {
+		static const AtscHuffmanLookup huffman2Lookup(Huffman2Offsets, Huffman2Tables);
 		offsets = Huffman2Offsets;
 		tableBase = Huffman2Tables;
+		lookup = huffman2Lookup.entries;
 	}
 }
 
 AtscHuffmanString::~AtscHuffmanString() { }
 
-bool AtscHuffmanString::hasBits()
+unsigned char AtscHuffmanString::peekByte() const
 {
-	return bitsLeft > 0;
+	int byteIndex = (bitPosition >> 3);
+	int value = 0;
+
+	if (byteIndex < length) {
+		value = (data[byteIndex] << 8);
+
+		if ((byteIndex + 1) < length) {
+			value |= data[byteIndex + 1];
+		}
+	}
+
+	return ((value >> (8 - (bitPosition & 0x7))) & 0xff);
 }
 
 unsigned char AtscHuffmanString::getBit()
 {
-	if (bitsLeft >= 1) {
-		int shift = (--bitsLeft % 8);
-		unsigned char value = (data[0] >> shift) & 0x1;
-
-		if (shift == 0) {
-			data++;
-		}
+	if (bitPosition < bitCount) {
+		unsigned char value = ((data[bitPosition >> 3] >> (7 - (bitPosition & 0x7))) & 0x1);
+		++bitPosition;
 		return value;
 	}
 
@@ -528,15 +583,9 @@ unsigned char AtscHuffmanString::getBit()
 
 unsigned char AtscHuffmanString::getByte()
 {
-	if (bitsLeft >= 8) {
-		int shift = ((bitsLeft - 1) % 8);
-		// Note this takes advantage of the fact that there is always
-		// at least one byte remaining (to avoid a read-past end
-		// condition)
-		unsigned char value = ((((data[0] << 8) | quint8(data[1])) >> (shift + 1)) & 0xff);
-
-		bitsLeft -= 8;
-		data++;
+	if ((bitCount - bitPosition) >= 8) {
+		unsigned char value = peekByte();
+		bitPosition += 8;
 		return value;
 	}
 
@@ -545,16 +594,31 @@ unsigned char AtscHuffmanString::getByte()
 
 void AtscHuffmanString::decompress()
 {
-	const unsigned char *table = tableBase;
+	// missing input bits are treated as zero
+	int context = 0;
 
-	while (hasBits()) {
-		int index = 0;
+	// the usual compression ratio is about 2:1
+	result.reserve(2 * length + 16);
 
-		do {
-			index = table[2 * index + getBit()];
-		} while (index < 128);
+	while (bitPosition < bitCount) {
+		quint16 entry = lookup[(context << 8) | peekByte()];
+		int index;
 
-		index &= 0x7f;
+		if ((entry & 0x8000) != 0) {
+			bitPosition += ((entry >> 8) & 0xf);
+			index = (entry & 0x7f);
+		} else {
+			// code longer than eight bits
+			const unsigned char *table = (tableBase + offsets[context]);
+			bitPosition += 8;
+			index = entry;
+
+			do {
+				index = table[2 * index + getBit()];
+			} while (index < 128);
+
+			index &= 0x7f;
+		}
 
 		if (index == 27) {
 			// escape --> uncompressed character(s)
@@ -575,7 +639,7 @@ void AtscHuffmanString::decompress()
 		}
 
 		result += QChar(index);
-		table = tableBase + offsets[index];
+		context = index;
 	}
 }
 
@@ -242,22 +242,26 @@ private:
 // ATSC Huffman compressed string support, conforming to A/65C Annex C
 class AtscHuffmanString
 {
+	friend class AtscHuffmanTest;
 public:
 	static QString convertText(const char *data_, int size, int table);
 private:
 	AtscHuffmanString(const char *data_, int size, int table);
 	~AtscHuffmanString();
-	bool hasBits();
+	unsigned char peekByte() const; // zero padded
 	unsigned char getBit();
 	unsigned char getByte();
 	void decompress();
 
-	const char *data;
-	int bitsLeft;
+	const unsigned char *data;
+	int length;
+	int bitPosition;
+	int bitCount;
 
 	QString result;
 	const unsigned short *offsets;
 	const unsigned char *tableBase;
+	const quint16 *lookup; // see AtscHuffmanLookup
 
 	static const unsigned short Huffman1Offsets[128];
 	static const unsigned char Huffman1Tables[];
@@ -273,9 +277,11 @@ public:
 	DvbPmtFilter() : programNumber(-1) { }
 	~DvbPmtFilter() { }
 
+	// the first matching pmt is always reported, even if it's unchanged
 	void setProgramNumber(int programNumber_)
 	{
 		programNumber = programNumber_;
+		lastPmtSectionData.clear();
 	}
 
 signals:
@@ -1238,6 +1244,16 @@ public:
 		return (at(10) << 8) | at(11);
 	}
 
+	int segmentLastSectionNumber() const
+	{
+		return at(12);
+	}
+
+	int lastTableId() const
+	{
+		return at(13);
+	}
+
 	DvbEitSectionEntry entries() const
 	{
 		return DvbEitSectionEntry(getData() + 14, getLength() - 18);
@@ -0,0 +1,570 @@
+/*
+ * dvbstreamserver.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../log.h"
+
+#include <QRandomGenerator>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include "dvbdevice.h"
+#include "dvbmanager.h"
+#include "dvbstreamserver.h"
+#include "dvbstreamserver_p.h"
+
+// multiple of 7 * 188 (the payload of a rtp packet)
+static const int chunkSize = (8 * 7 * 188);
+// clients which fall behind by more than this amount are dropped
+static const int maxQueuedBytes = (4 * 1024 * 1024);
+static const int maxSocketBytes = (64 * 1024);
+
+// returns false if the destination isn't of the form address:port
+static bool parseRtpDestination(const QString &destination, QHostAddress &address, quint16 &port)
+{
+	int index = destination.lastIndexOf(QLatin1Char(':'));
+	bool ok = false;
+	int value = destination.mid(index + 1).toInt(&ok);
+
+	if ((index <= 0) || !ok || (value <= 0) || (value > 65535)) {
+		return false;
+	}
+
+	QString host = destination.left(index);
+
+	if (host.startsWith(QLatin1Char('[')) && host.endsWith(QLatin1Char(']'))) {
+		host = host.mid(1, host.size() - 2);
+	}
+
+	port = quint16(value);
+	return address.setAddress(host);
+}
+
+static void sendResponse(QTcpSocket *socket, const char *status, const char *contentType,
+	const QByteArray &content)
+{
+	socket->write(QByteArray("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType +
+		"\r\nContent-Length: " + QByteArray::number(content.size()) +
+		"\r\nConnection: close\r\n\r\n" + content);
+	socket->disconnectFromHost();
+}
+
+DvbStreamClient::DvbStreamClient(QTcpSocket *socket_) : socket(socket_), streaming(false),
+	isClosed(false), queuedBytes(0), udpSocket(NULL), rtpPort(0), rtpSequenceNumber(0),
+	rtpSsrc(QRandomGenerator::global()->generate())
+{
+	socket->setParent(this);
+	connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+	connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(writeChunks()));
+	connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+}
+
+DvbStreamClient::~DvbStreamClient()
+{
+}
+
+void DvbStreamClient::setRtpDestination(const QHostAddress &address, quint16 port)
+{
+	rtpAddress = address;
+	rtpPort = port;
+	udpSocket = new QUdpSocket(this);
+	rtpTimer.start();
+}
+
+void DvbStreamClient::startStreaming(const QString &serviceName_)
+{
+	serviceName = serviceName_;
+	streaming = true;
+
+	if (udpSocket != NULL) {
+		// the connection stays open as long as the rtp stream should be sent
+		socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\n");
+	} else {
+		socket->write("HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\n"
+			"Transfer-Encoding: chunked\r\nCache-Control: no-cache\r\n\r\n");
+	}
+}
+
+void DvbStreamClient::sendChunk(const QByteArray &chunk)
+{
+	if (!streaming || isClosed) {
+		return;
+	}
+
+	if (udpSocket != NULL) {
+		sendRtpPackets(chunk);
+		return;
+	}
+
+	if ((queuedBytes + chunk.size()) > maxQueuedBytes) {
+		qCWarning(logDvb, "Dropping slow stream client %s",
+			qPrintable(socket->peerAddress().toString()));
+		close();
+		return;
+	}
+
+	chunks.append(chunk);
+	queuedBytes += chunk.size();
+	writeChunks();
+}
+
+void DvbStreamClient::close()
+{
+	socket->abort();
+	socketDisconnected();
+}
+
+void DvbStreamClient::readRequest()
+{
+	if (streaming) {
+		socket->readAll();
+		return;
+	}
+
+	request.append(socket->readAll());
+	int end = request.indexOf("\r\n\r\n");
+
+	if (end < 0) {
+		if (request.size() > 8192) {
+			close();
+		}
+
+		return;
+	}
+
+	QList<QByteArray> lines = request.left(end).split('\n');
+	QList<QByteArray> requestLine = lines.at(0).trimmed().split(' ');
+
+	if ((requestLine.size() != 3) || (requestLine.at(0) != "GET")) {
+		sendResponse(socket, "405 Method Not Allowed", "text/plain", QByteArray());
+		return;
+	}
+
+	// further data is ignored
+	streaming = true;
+	emit requestReceived(this, QString::fromLatin1(requestLine.at(1)));
+}
+
+void DvbStreamClient::writeChunks()
+{
+	while (!chunks.isEmpty() && (socket->bytesToWrite() < maxSocketBytes)) {
+		QByteArray chunk = chunks.takeFirst();
+		queuedBytes -= chunk.size();
+		socket->write(QByteArray::number(chunk.size(), 16) + "\r\n");
+		socket->write(chunk);
+		socket->write("\r\n");
+	}
+}
+
+void DvbStreamClient::socketDisconnected()
+{
+	if (!isClosed) {
+		isClosed = true;
+		chunks.clear();
+		queuedBytes = 0;
+		emit closed(this);
+	}
+}
+
+void DvbStreamClient::sendRtpPackets(const QByteArray &chunk)
+{
+	quint32 timestamp = quint32(rtpTimer.elapsed() * 90);
+	QByteArray packet;
+
+	for (int i = 0; i < chunk.size(); i += (7 * 188)) {
+		int size = qMin(7 * 188, chunk.size() - i);
+		packet.resize(12 + size);
+		char *data = packet.data();
+		data[0] = char(0x80); // version 2
+		data[1] = char(33); // payload type MP2T
+		data[2] = char(rtpSequenceNumber >> 8);
+		data[3] = char(rtpSequenceNumber);
+		data[4] = char(timestamp >> 24);
+		data[5] = char(timestamp >> 16);
+		data[6] = char(timestamp >> 8);
+		data[7] = char(timestamp);
+		data[8] = char(rtpSsrc >> 24);
+		data[9] = char(rtpSsrc >> 16);
+		data[10] = char(rtpSsrc >> 8);
+		data[11] = char(rtpSsrc);
+		memcpy(data + 12, chunk.constData() + i, size);
+		udpSocket->writeDatagram(packet, rtpAddress, rtpPort);
+		++rtpSequenceNumber;
+	}
+}
+
+DvbStreamService::DvbStreamService(DvbManager *manager_, const DvbSharedChannel &channel_) :
+	manager(manager_), channel(channel_), device(NULL)
+{
+	connect(&pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
+		this, SLOT(pmtSectionChanged(QByteArray)));
+	connect(&patPmtTimer, SIGNAL(timeout()), this, SLOT(insertPatPmt()));
+	chunk.reserve(chunkSize);
+}
+
+DvbStreamService::~DvbStreamService()
+{
+	if (device != NULL) {
+		stopDevice();
+		manager->releaseDevice(device, DvbManager::Shared);
+	}
+}
+
+bool DvbStreamService::start()
+{
+	device = manager->requestDevice(channel->source, channel->transponder,
+		DvbManager::Shared);
+
+	if (device == NULL) {
+		return false;
+	}
+
+	pmtFilter.setProgramNumber(channel->serviceId);
+	patGenerator.initPat(channel->transportStreamId, channel->serviceId, channel->pmtPid);
+	startDevice();
+
+	if (!channel->pmtSectionData.isEmpty()) {
+		pmtSectionChanged(channel->pmtSectionData);
+	}
+
+	patPmtTimer.start(500);
+	return true;
+}
+
+void DvbStreamService::addClient(DvbStreamClient *client)
+{
+	clients.append(client);
+}
+
+void DvbStreamService::removeClient(DvbStreamClient *client)
+{
+	clients.removeAll(client);
+}
+
+void DvbStreamService::pmtSectionChanged(const QByteArray &pmtSectionData_)
+{
+	pmtSectionData = pmtSectionData_;
+	DvbPmtSection pmtSection(pmtSectionData);
+	DvbPmtParser pmtParser(pmtSection);
+	int pcrPid = pmtSection.pcrPid();
+	QSet<int> newPids;
+
+	if (pmtParser.videoPid != -1) {
+		newPids.insert(pmtParser.videoPid);
+	}
+
+	for (int i = 0; i < pmtParser.audioPids.size(); ++i) {
+		newPids.insert(pmtParser.audioPids.at(i).first);
+	}
+
+	for (int i = 0; i < pmtParser.subtitlePids.size(); ++i) {
+		newPids.insert(pmtParser.subtitlePids.at(i).first);
+	}
+
+	if (pmtParser.teletextPid != -1) {
+		newPids.insert(pmtParser.teletextPid);
+	}
+
+	if (pcrPid != 0x1fff) {
+		newPids.insert(pcrPid);
+	}
+
+	for (int i = 0; i < pids.size(); ++i) {
+		int pid = pids.at(i);
+
+		if (!newPids.remove(pid)) {
+			device->removePidFilter(pid, this);
+			pids.removeAt(i);
+			--i;
+		}
+	}
+
+	foreach (int pid, newPids) {
+		device->addPidFilter(pid, this, DvbDevice::LiveViewPriority);
+		pids.append(pid);
+	}
+
+	pmtGenerator.initPmt(channel->pmtPid, pmtSection, pids);
+	insertPatPmt();
+
+	if (channel->isScrambled) {
+		device->startDescrambling(pmtSectionData, this);
+	}
+}
+
+void DvbStreamService::insertPatPmt()
+{
+	if (pmtSectionData.isEmpty()) {
+		return;
+	}
+
+	chunk.append(patGenerator.generatePackets());
+	chunk.append(pmtGenerator.generatePackets());
+}
+
+void DvbStreamService::deviceStateChanged()
+{
+	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
+		stopDevice();
+		device = manager->requestDevice(channel->source, channel->transponder,
+			DvbManager::Shared);
+
+		if (device != NULL) {
+			startDevice();
+		} else {
+			// the server deletes this service after the last client is gone
+			foreach (DvbStreamClient *client, QList<DvbStreamClient *>(clients)) {
+				client->close();
+			}
+		}
+	}
+}
+
+void DvbStreamService::processData(const char data[188])
+{
+	chunk.append(data, 188);
+
+	if (chunk.size() >= chunkSize) {
+		sendChunk();
+	}
+}
+
+void DvbStreamService::startDevice()
+{
+	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+	device->addSectionFilter(channel->pmtPid, &pmtFilter, DvbDevice::PmtPriority);
+
+	foreach (int pid, pids) {
+		device->addPidFilter(pid, this, DvbDevice::LiveViewPriority);
+	}
+
+	if (channel->isScrambled && !pmtSectionData.isEmpty()) {
+		device->startDescrambling(pmtSectionData, this);
+	}
+}
+
+void DvbStreamService::stopDevice()
+{
+	if (channel->isScrambled && !pmtSectionData.isEmpty()) {
+		device->stopDescrambling(pmtSectionData, this);
+	}
+
+	foreach (int pid, pids) {
+		device->removePidFilter(pid, this);
+	}
+
+	device->removeSectionFilter(channel->pmtPid, &pmtFilter);
+	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+}
+
+void DvbStreamService::sendChunk()
+{
+	// the clients only keep references to the data
+	QByteArray data = chunk;
+	chunk = QByteArray();
+	chunk.reserve(chunkSize);
+
+	// clients may be dropped meanwhile
+	foreach (DvbStreamClient *client, QList<DvbStreamClient *>(clients)) {
+		client->sendChunk(data);
+	}
+}
+
+DvbStreamServer::DvbStreamServer(DvbManager *manager_, QObject *parent) : QObject(parent),
+	manager(manager_)
+{
+	tcpServer = new QTcpServer(this);
+	connect(tcpServer, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+
+DvbStreamServer::~DvbStreamServer()
+{
+	qDeleteAll(services);
+}
+
+void DvbStreamServer::listen(int port, bool allowRemote)
+{
+	tcpServer->close();
+
+	if (port <= 0) {
+		return;
+	}
+
+	if (!tcpServer->listen(allowRemote ? QHostAddress::Any : QHostAddress::LocalHost,
+	     quint16(port))) {
+		qCWarning(logDvb, "Cannot listen on port %d: %s", port,
+			qPrintable(tcpServer->errorString()));
+	}
+}
+
+void DvbStreamServer::newConnection()
+{
+	while (tcpServer->hasPendingConnections()) {
+		DvbStreamClient *client = new DvbStreamClient(tcpServer->nextPendingConnection());
+		client->setParent(this);
+		connect(client, SIGNAL(requestReceived(DvbStreamClient*,QString)),
+			this, SLOT(requestReceived(DvbStreamClient*,QString)));
+		connect(client, SIGNAL(closed(DvbStreamClient*)),
+			this, SLOT(clientClosed(DvbStreamClient*)));
+	}
+}
+
+void DvbStreamServer::requestReceived(DvbStreamClient *client, const QString &path)
+{
+	QTcpSocket *socket = client->getSocket();
+	QString decodedPath = QUrl::fromPercentEncoding(path.section(QLatin1Char('?'), 0, 0).toLatin1());
+	QUrlQuery query(path.section(QLatin1Char('?'), 1));
+
+	if ((decodedPath == QLatin1String("/")) || (decodedPath == QLatin1String("/playlist.m3u"))) {
+		QHostAddress address = socket->localAddress();
+		bool isIpv4;
+		quint32 ipv4Address = address.toIPv4Address(&isIpv4);
+		QString host;
+
+		if (isIpv4) {
+			host = QHostAddress(ipv4Address).toString();
+		} else {
+			host = QLatin1Char('[') + address.toString() + QLatin1Char(']');
+		}
+
+		host += QLatin1Char(':') + QString::number(socket->localPort());
+		sendResponse(socket, "200 OK", "audio/x-mpegurl", getPlaylist(host));
+		return;
+	}
+
+	if (!decodedPath.startsWith(QLatin1String("/channel/"))) {
+		sendResponse(socket, "404 Not Found", "text/plain", QByteArray());
+		return;
+	}
+
+	QString nameOrNumber = decodedPath.mid(9);
+	bool ok;
+	int number = nameOrNumber.toInt(&ok);
+	DvbSharedChannel channel;
+
+	if (ok) {
+		channel = manager->getChannelModel()->findChannelByNumber(number);
+	} else {
+		channel = manager->getChannelModel()->findChannelByName(nameOrNumber);
+	}
+
+	if (!channel.isValid()) {
+		sendResponse(socket, "404 Not Found", "text/plain", QByteArray());
+		return;
+	}
+
+	if (query.hasQueryItem(QLatin1String("rtp"))) {
+		QHostAddress rtpAddress;
+		quint16 rtpPort = 0;
+
+		if (!parseRtpDestination(query.queryItemValue(QLatin1String("rtp")), rtpAddress,
+		     rtpPort)) {
+			sendResponse(socket, "400 Bad Request", "text/plain", QByteArray());
+			return;
+		}
+
+		if (!isRtpDestinationAllowed(rtpAddress, socket->peerAddress())) {
+			// otherwise anybody could make us send streams to third parties
+			qCWarning(logDvb, "Rejecting rtp destination %s requested by %s",
+				qPrintable(rtpAddress.toString()),
+				qPrintable(socket->peerAddress().toString()));
+			sendResponse(socket, "403 Forbidden", "text/plain", QByteArray());
+			return;
+		}
+
+		client->setRtpDestination(rtpAddress, rtpPort);
+	}
+
+	DvbStreamService *service = services.value(channel->name);
+
+	if (service == NULL) {
+		service = new DvbStreamService(manager, channel);
+
+		if (!service->start()) {
+			delete service;
+			sendResponse(socket, "503 Service Unavailable", "text/plain",
+				QByteArray("No available device found.\n"));
+			return;
+		}
+
+		services.insert(channel->name, service);
+	}
+
+	qCDebug(logDvb, "Streaming %s to %s", qPrintable(channel->name),
+		qPrintable(socket->peerAddress().toString()));
+	service->addClient(client);
+	client->startStreaming(channel->name);
+}
+
+bool DvbStreamServer::isRtpDestinationAllowed(const QHostAddress &address,
+	const QHostAddress &peerAddress) const
+{
+	if (address.isMulticast() ||
+	    address.isEqual(peerAddress, QHostAddress::TolerantConversion)) {
+		return true;
+	}
+
+	foreach (const QString &destination, manager->getStreamServerRtpDestinations()) {
+		if (address.isEqual(QHostAddress(destination.trimmed()),
+		    QHostAddress::TolerantConversion)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void DvbStreamServer::clientClosed(DvbStreamClient *client)
+{
+	DvbStreamService *service = services.value(client->getServiceName());
+
+	if (service != NULL) {
+		service->removeClient(client);
+
+		if (!service->hasClients()) {
+			services.remove(client->getServiceName());
+			// may be called from within the service
+			service->deleteLater();
+		}
+	}
+
+	client->deleteLater();
+}
+
+QByteArray DvbStreamServer::getPlaylist(const QString &host) const
+{
+	QString playlist = QLatin1String("#EXTM3U\n");
+	QMap<int, DvbSharedChannel> channels = manager->getChannelModel()->getChannels();
+
+	for (QMap<int, DvbSharedChannel>::ConstIterator it = channels.constBegin();
+	     it != channels.constEnd(); ++it) {
+		playlist += QLatin1String("#EXTINF:-1,") + (*it)->name + QLatin1Char('\n');
+		playlist += QLatin1String("http://") + host + QLatin1String("/channel/") +
+			QString::number(it.key()) + QLatin1Char('\n');
+	}
+
+	return playlist.toUtf8();
+}
+
+#include "moc_dvbstreamserver_p.cpp"
+#include "moc_dvbstreamserver.cpp"
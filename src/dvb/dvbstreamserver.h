@@ -0,0 +1,68 @@
+/*
+ * dvbstreamserver.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBSTREAMSERVER_H
+#define DVBSTREAMSERVER_H
+
+#include <QMap>
+#include <QObject>
+
+class QHostAddress;
+class QTcpServer;
+class DvbManager;
+class DvbStreamClient;
+class DvbStreamService;
+
+/*
+ * serves the channels over http (chunked transport stream); a client may ask
+ * for rtp over udp (also multicast) instead by appending ?rtp=address:port, in
+ * this case the tcp connection is only used to control the lifetime; only the
+ * client itself, multicast groups and the configured destinations are accepted
+ *
+ * GET /playlist.m3u        all channels
+ * GET /channel/<number>    a channel (the name is accepted as well)
+ */
+
+class DvbStreamServer : public QObject
+{
+	Q_OBJECT
+public:
+	DvbStreamServer(DvbManager *manager_, QObject *parent);
+	~DvbStreamServer();
+
+	// port 0 stops the server
+	void listen(int port, bool allowRemote);
+
+private slots:
+	void newConnection();
+	void requestReceived(DvbStreamClient *client, const QString &path);
+	void clientClosed(DvbStreamClient *client);
+
+private:
+	QByteArray getPlaylist(const QString &host) const;
+	bool isRtpDestinationAllowed(const QHostAddress &address,
+		const QHostAddress &peerAddress) const;
+
+	DvbManager *manager;
+	QTcpServer *tcpServer;
+	QMap<QString, DvbStreamService *> services; // key = channel name
+};
+
+#endif /* DVBSTREAMSERVER_H */
@@ -0,0 +1,135 @@
+/*
+ * dvbstreamserver_p.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBSTREAMSERVER_P_H
+#define DVBSTREAMSERVER_P_H
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTimer>
+#include "dvbchannel.h"
+#include "dvbsi.h"
+
+class QTcpSocket;
+class QUdpSocket;
+class DvbDevice;
+class DvbManager;
+
+/*
+ * a connected client; the chunks are implicitly shared between all clients of
+ * a service, so that queueing them doesn't copy any data
+ */
+
+class DvbStreamClient : public QObject
+{
+	Q_OBJECT
+public:
+	explicit DvbStreamClient(QTcpSocket *socket_);
+	~DvbStreamClient();
+
+	QTcpSocket *getSocket() const
+	{
+		return socket;
+	}
+
+	QString getServiceName() const
+	{
+		return serviceName;
+	}
+
+	// the destination has to be checked by the caller
+	void setRtpDestination(const QHostAddress &address, quint16 port);
+	void startStreaming(const QString &serviceName_);
+	void sendChunk(const QByteArray &chunk);
+	void close();
+
+signals:
+	void requestReceived(DvbStreamClient *client, const QString &path);
+	void closed(DvbStreamClient *client);
+
+private slots:
+	void readRequest();
+	void writeChunks();
+	void socketDisconnected();
+
+private:
+	void sendRtpPackets(const QByteArray &chunk);
+
+	QTcpSocket *socket;
+	QByteArray request;
+	QString serviceName;
+	bool streaming;
+	bool isClosed;
+	QList<QByteArray> chunks;
+	qint64 queuedBytes;
+
+	QUdpSocket *udpSocket;
+	QHostAddress rtpAddress;
+	quint16 rtpPort;
+	quint16 rtpSequenceNumber;
+	quint32 rtpSsrc;
+	QElapsedTimer rtpTimer;
+};
+
+/*
+ * demultiplexes a single service once for all its clients
+ */
+
+class DvbStreamService : public QObject, private DvbPidFilter
+{
+	Q_OBJECT
+public:
+	DvbStreamService(DvbManager *manager_, const DvbSharedChannel &channel_);
+	~DvbStreamService();
+
+	bool start(); // requests the device
+	void addClient(DvbStreamClient *client);
+	void removeClient(DvbStreamClient *client);
+
+	bool hasClients() const
+	{
+		return !clients.isEmpty();
+	}
+
+private slots:
+	void pmtSectionChanged(const QByteArray &pmtSectionData_);
+	void insertPatPmt();
+	void deviceStateChanged();
+
+private:
+	void processData(const char data[188]) override;
+	void startDevice();
+	void stopDevice();
+	void sendChunk();
+
+	DvbManager *manager;
+	DvbSharedChannel channel;
+	DvbDevice *device;
+	QList<int> pids;
+	DvbPmtFilter pmtFilter;
+	QByteArray pmtSectionData;
+	DvbSectionGenerator patGenerator;
+	DvbSectionGenerator pmtGenerator;
+	QTimer patPmtTimer;
+	QByteArray chunk;
+	QList<DvbStreamClient *> clients;
+};
+
+#endif /* DVBSTREAMSERVER_P_H */
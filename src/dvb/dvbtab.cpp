@@ -35,10 +35,12 @@
 #include <QToolButton>
 
 #include "../osdwidget.h"
+#include "../zaplatency.h"
 #include "dvbchanneldialog.h"
 #include "dvbconfigdialog.h"
 #include "dvbepg.h"
 #include "dvbepgdialog.h"
+#include "dvbhealthdialog.h"
 #include "dvbliveview.h"
 #include "dvbmanager.h"
 #include "dvbrecordingdialog.h"
@@ -93,9 +95,12 @@ DvbTab::DvbTab(QMenu *menu, KActionCollection *collection, MediaWidget *mediaWid
 	connect(channelsAction, SIGNAL(triggered(bool)), this, SLOT(showChannelDialog()));
 	menu->addAction(collection->addAction(QLatin1String("dvb_channels"), channelsAction));
 
-	QAction *epgAction = new QAction(QIcon::fromTheme(QLatin1String("view-list-details"), QIcon(":view-list-details")), i18n("Program Guide"), this);
+	epgAction = new QAction(QIcon::fromTheme(QLatin1String("view-list-details"), QIcon(":view-list-details")), i18n("Program Guide"), this);
 	epgAction->setShortcut(Qt::Key_G);
 	connect(epgAction, SIGNAL(triggered(bool)), this, SLOT(toggleEpgDialog()));
+	// enabled once the stored program guide has been loaded
+	epgAction->setEnabled(manager->getEpgModel()->isLoaded());
+	connect(manager->getEpgModel(), SIGNAL(epgLoaded()), this, SLOT(epgLoaded()));
 	menu->addAction(collection->addAction(QLatin1String("dvb_epg"), epgAction));
 
 	QAction *osdAction = new QAction(QIcon::fromTheme(QLatin1String("dialog-information"), QIcon(":dialog-information")), i18n("OSD"), this);
@@ -109,6 +114,11 @@ DvbTab::DvbTab(QMenu *menu, KActionCollection *collection, MediaWidget *mediaWid
 	connect(recordingsAction, SIGNAL(triggered(bool)), this, SLOT(showRecordingDialog()));
 	menu->addAction(collection->addAction(QLatin1String("dvb_recordings"), recordingsAction));
 
+	QAction *healthAction = new QAction(QIcon::fromTheme(QLatin1String("network-wireless"), QIcon(":dialog-information")),
+		i18nc("dialog", "Stream Health"), this);
+	connect(healthAction, SIGNAL(triggered(bool)), this, SLOT(showHealthDialog()));
+	menu->addAction(collection->addAction(QLatin1String("dvb_health"), healthAction));
+
 	menu->addSeparator();
 
 	instantRecordAction = new QAction(documentSaveIcon, i18n("Instant Record"), this);
@@ -424,6 +434,11 @@ void DvbTab::showRecordingDialog()
 	DvbRecordingDialog::showDialog(manager, this);
 }
 
+void DvbTab::showHealthDialog()
+{
+	DvbHealthDialog::showDialog(manager, this);
+}
+
 void DvbTab::toggleEpgDialog()
 {
 	if (epgDialog.isNull()) {
@@ -556,6 +571,11 @@ void DvbTab::cleanTimeShiftFiles()
 	timeShiftCleaner->remove(dir.path(), entries);
 }
 
+void DvbTab::epgLoaded()
+{
+	epgAction->setEnabled(true);
+}
+
 void DvbTab::activate()
 {
 	mediaLayout->addWidget(mediaWidget);
@@ -573,6 +593,8 @@ void DvbTab::playChannel(const DvbSharedChannel &channel, const QModelIndex &ind
 		return;
 	}
 
+	ZapLatency::instance()->start(channel->name);
+
 	if (!currentChannel.isEmpty()) {
 		lastChannel = currentChannel;
 	}
@@ -595,6 +617,19 @@ void DvbTab::playChannel(const DvbSharedChannel &channel, const QModelIndex &ind
 	currentChannel = channel->name;
 	manager->getLiveView()->playChannel(channel);
 
+	// the channels previousChannel(), nextChannel() and playLastChannel() would switch to
+	QList<DvbSharedChannel> predictedChannels;
+
+	if (index.isValid()) {
+		predictedChannels.append(channelProxyModel->value(
+			index.sibling(index.row() + 1, index.column())));
+		predictedChannels.append(channelProxyModel->value(
+			index.sibling(index.row() - 1, index.column())));
+	}
+
+	predictedChannels.append(manager->getChannelModel()->findChannelByName(lastChannel));
+	manager->getLiveView()->predictChannels(predictedChannels);
+
 	if (!epgDialog.isNull()) {
 		epgDialog->setCurrentChannel(manager->getLiveView()->getChannel());
 	}
@@ -71,6 +71,7 @@ private slots:
 	void showChannelDialog();
 	void toggleEpgDialog();
 	void showRecordingDialog();
+	void showHealthDialog();
 	void instantRecord(bool checked);
 	void recordingRemoved(const DvbSharedRecording &recording);
 	void configureDvb();
@@ -80,6 +81,7 @@ private slots:
 	void nextChannel();
 	void cleanTimeShiftFiles();
 	void channelPidsUpdated(const DvbSharedChannel &updatedChannel);
+	void epgLoaded();
 
 private:
 	void activate() override;
@@ -89,6 +91,7 @@ private:
 	MediaWidget *mediaWidget;
 	DvbManager *manager;
 	QAction *instantRecordAction;
+	QAction *epgAction;
 	QList<DvbSharedRecording> instantRecordings;
 	DvbSharedRecording instantRecording;
 	QSplitter *splitter;
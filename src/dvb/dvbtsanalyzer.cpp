@@ -0,0 +1,265 @@
+/*
+ * dvbtsanalyzer.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbdevice.h"
+#include "dvbmanager.h"
+#include "dvbsi.h"
+#include "dvbtsanalyzer.h"
+
+void DvbTsStatistics::add(const DvbTsStatistics &other)
+{
+	packets += other.packets;
+	continuityErrors += other.continuityErrors;
+	transportErrors += other.transportErrors;
+	scrambledPackets += other.scrambledPackets;
+	pcrCount += other.pcrCount;
+	pcrIntervalErrors += other.pcrIntervalErrors;
+	maxPcrInterval = qMax(maxPcrInterval, other.maxPcrInterval);
+	maxPcrJitter = qMax(maxPcrJitter, other.maxPcrJitter);
+	bitrate += other.bitrate;
+}
+
+QVariantMap DvbTsStatistics::toVariantMap() const
+{
+	QVariantMap map;
+	map.insert(QLatin1String("Packets"), packets);
+	map.insert(QLatin1String("ContinuityErrors"), continuityErrors);
+	map.insert(QLatin1String("TransportErrors"), transportErrors);
+	map.insert(QLatin1String("ScrambledPackets"), scrambledPackets);
+	map.insert(QLatin1String("PcrCount"), pcrCount);
+	map.insert(QLatin1String("PcrIntervalErrors"), pcrIntervalErrors);
+	map.insert(QLatin1String("MaxPcrIntervalMs"), maxPcrInterval);
+	map.insert(QLatin1String("MaxPcrJitterUs"), maxPcrJitter);
+	map.insert(QLatin1String("Bitrate"), bitrate);
+	return map;
+}
+
+DvbTsAnalyzer::DvbTsAnalyzer() : windowStart(-1)
+{
+}
+
+DvbTsAnalyzer::~DvbTsAnalyzer()
+{
+}
+
+void DvbTsAnalyzer::reset()
+{
+	states.clear();
+	activePids.clear();
+	windowStart = -1;
+}
+
+void DvbTsAnalyzer::processPacket(const char packet[188], qint64 timestamp)
+{
+	if (states.isEmpty()) {
+		states.resize(8192);
+	}
+
+	int pid = ((static_cast<unsigned char>(packet[1]) << 8) |
+		static_cast<unsigned char>(packet[2])) & ((1 << 13) - 1);
+	DvbTsPidState &state = states[pid];
+
+	if (state.statistics.packets == 0) {
+		activePids.append(pid);
+	}
+
+	++state.statistics.packets;
+
+	if (windowStart < 0) {
+		windowStart = timestamp;
+	} else if ((timestamp - windowStart) >= 1000000000) {
+		updateBitrates(timestamp);
+	}
+
+	if ((packet[1] & 0x80) != 0) {
+		// the rest of the packet can't be trusted
+		++state.statistics.transportErrors;
+		return;
+	}
+
+	if ((packet[3] & 0xc0) != 0) {
+		++state.statistics.scrambledPackets;
+	}
+
+	if (pid == 0x1fff) {
+		// stuffing
+		return;
+	}
+
+	int adaptationFieldControl = ((packet[3] >> 4) & 0x03);
+	int continuityCounter = (packet[3] & 0x0f);
+	bool hasAdaptationField = ((adaptationFieldControl & 0x02) != 0);
+	int adaptationFieldLength = (hasAdaptationField ? static_cast<unsigned char>(packet[4]) : 0);
+	bool discontinuity = ((adaptationFieldLength > 0) && ((packet[5] & 0x80) != 0));
+
+	if ((state.continuityCounter >= 0) && !discontinuity) {
+		if ((adaptationFieldControl & 0x01) != 0) {
+			if (continuityCounter == ((state.continuityCounter + 1) & 0x0f)) {
+				state.duplicate = false;
+			} else if ((continuityCounter == state.continuityCounter) && !state.duplicate) {
+				// one duplicate packet is allowed
+				state.duplicate = true;
+			} else {
+				++state.statistics.continuityErrors;
+				state.duplicate = false;
+			}
+		} else if (continuityCounter != state.continuityCounter) {
+			// the counter must not change for packets without payload
+			++state.statistics.continuityErrors;
+		}
+	}
+
+	state.continuityCounter = continuityCounter;
+
+	if ((adaptationFieldLength >= 7) && ((packet[5] & 0x10) != 0)) {
+		const unsigned char *data = reinterpret_cast<const unsigned char *>(packet + 6);
+		qint64 pcrBase = ((qint64(data[0]) << 25) | (data[1] << 17) | (data[2] << 9) |
+			(data[3] << 1) | (data[4] >> 7));
+		qint64 pcr = ((pcrBase * 300) + (((data[4] & 0x01) << 8) | data[5]));
+		++state.statistics.pcrCount;
+
+		if ((state.pcr >= 0) && !discontinuity) {
+			qint64 interval = (timestamp - state.pcrTime); // ns
+			// the pcr wraps around after 2^33 * 300 ticks
+			qint64 pcrInterval = (pcr - state.pcr + (Q_INT64_C(300) << 33)) %
+				(Q_INT64_C(300) << 33);
+			pcrInterval = ((pcrInterval * 1000) / 27); // ns
+			int intervalMs = int(interval / 1000000);
+			int jitter = int(qAbs(interval - pcrInterval) / 1000);
+
+			if (intervalMs > 40) {
+				++state.statistics.pcrIntervalErrors;
+			}
+
+			state.statistics.maxPcrInterval = qMax(state.statistics.maxPcrInterval, intervalMs);
+			state.statistics.maxPcrJitter = qMax(state.statistics.maxPcrJitter, jitter);
+		}
+
+		state.pcr = pcr;
+		state.pcrTime = timestamp;
+	}
+}
+
+QMap<int, DvbTsStatistics> DvbTsAnalyzer::getStatistics() const
+{
+	QMap<int, DvbTsStatistics> statistics;
+
+	foreach (int pid, activePids) {
+		statistics.insert(pid, states.at(pid).statistics);
+	}
+
+	return statistics;
+}
+
+void DvbTsAnalyzer::updateBitrates(qint64 timestamp)
+{
+	qint64 window = (timestamp - windowStart);
+
+	foreach (int pid, activePids) {
+		DvbTsPidState &state = states[pid];
+		state.statistics.bitrate =
+			(((state.statistics.packets - state.windowPackets) * 188 * 8 * 1000000000) /
+			window);
+		state.windowPackets = state.statistics.packets;
+	}
+
+	windowStart = timestamp;
+}
+
+QVariantMap DvbTsAnalyzer::createReport(DvbManager *manager)
+{
+	QVariantMap report;
+	QMap<int, DvbSharedChannel> channels = manager->getChannelModel()->getChannels();
+
+	foreach (const DvbDeviceConfig &deviceConfig, manager->getDeviceConfigs()) {
+		if ((deviceConfig.device == NULL) ||
+		    ((deviceConfig.device->getDeviceState() != DvbDevice::DeviceTuning) &&
+		     (deviceConfig.device->getDeviceState() != DvbDevice::DeviceTuned))) {
+			continue;
+		}
+
+		QMap<int, DvbTsStatistics> pidStatistics =
+			deviceConfig.device->getTsAnalyzer().getStatistics();
+		DvbTsStatistics muxStatistics;
+		QVariantMap pids;
+
+		for (QMap<int, DvbTsStatistics>::ConstIterator it = pidStatistics.constBegin();
+		     it != pidStatistics.constEnd(); ++it) {
+			muxStatistics.add(*it);
+			pids.insert(QString::number(it.key()), it->toVariantMap());
+		}
+
+		QVariantMap services;
+
+		foreach (const DvbSharedChannel &channel, channels) {
+			if ((channel->source != deviceConfig.source) ||
+			    !channel->transponder.corresponds(deviceConfig.transponder)) {
+				continue;
+			}
+
+			DvbPmtSection pmtSection(channel->pmtSectionData);
+			DvbPmtParser pmtParser(pmtSection);
+			QList<int> servicePids;
+			servicePids.append(channel->pmtPid);
+
+			if (pmtParser.videoPid != -1) {
+				servicePids.append(pmtParser.videoPid);
+			}
+
+			for (int i = 0; i < pmtParser.audioPids.size(); ++i) {
+				servicePids.append(pmtParser.audioPids.at(i).first);
+			}
+
+			for (int i = 0; i < pmtParser.subtitlePids.size(); ++i) {
+				servicePids.append(pmtParser.subtitlePids.at(i).first);
+			}
+
+			if (pmtParser.teletextPid != -1) {
+				servicePids.append(pmtParser.teletextPid);
+			}
+
+			if (pmtSection.isValid() && (pmtSection.pcrPid() != 0x1fff) &&
+			    !servicePids.contains(pmtSection.pcrPid())) {
+				servicePids.append(pmtSection.pcrPid());
+			}
+
+			DvbTsStatistics serviceStatistics;
+
+			foreach (int pid, servicePids) {
+				serviceStatistics.add(pidStatistics.value(pid));
+			}
+
+			if (serviceStatistics.packets > 0) {
+				services.insert(channel->name, serviceStatistics.toVariantMap());
+			}
+		}
+
+		QVariantMap deviceReport;
+		deviceReport.insert(QLatin1String("Source"), deviceConfig.source);
+		deviceReport.insert(QLatin1String("Transponder"), deviceConfig.transponder.toString());
+		deviceReport.insert(QLatin1String("Mux"), muxStatistics.toVariantMap());
+		deviceReport.insert(QLatin1String("Services"), services);
+		deviceReport.insert(QLatin1String("Pids"), pids);
+		report.insert(deviceConfig.frontendName + QLatin1String(" (") + deviceConfig.deviceId +
+			QLatin1Char(')'), deviceReport);
+	}
+
+	return report;
+}
@@ -0,0 +1,101 @@
+/*
+ * dvbtsanalyzer.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBTSANALYZER_H
+#define DVBTSANALYZER_H
+
+#include <QList>
+#include <QMap>
+#include <QVariantMap>
+#include <QVector>
+
+class DvbManager;
+
+/*
+ * transport stream health counters (in the spirit of ETSI TR 101 290)
+ */
+
+class DvbTsStatistics
+{
+public:
+	DvbTsStatistics() : packets(0), continuityErrors(0), transportErrors(0),
+		scrambledPackets(0), pcrCount(0), pcrIntervalErrors(0), maxPcrInterval(0),
+		maxPcrJitter(0), bitrate(0) { }
+	~DvbTsStatistics() { }
+
+	void add(const DvbTsStatistics &other); // aggregation
+	QVariantMap toVariantMap() const;
+
+	qint64 packets;
+	qint64 continuityErrors;
+	qint64 transportErrors; // transport error indicator set (i.e. bad reception)
+	qint64 scrambledPackets;
+	qint64 pcrCount;
+	qint64 pcrIntervalErrors; // more than 40 ms between two PCRs
+	int maxPcrInterval; // ms
+	int maxPcrJitter; // us (arrival time versus PCR value)
+	qint64 bitrate; // bit/s, measured over the last second
+};
+
+class DvbTsPidState
+{
+public:
+	DvbTsPidState() : continuityCounter(-1), duplicate(false), pcr(-1), pcrTime(0),
+		windowPackets(0) { }
+	~DvbTsPidState() { }
+
+	DvbTsStatistics statistics;
+	int continuityCounter; // -1 = unknown
+	bool duplicate;
+	qint64 pcr; // 27 MHz; -1 = unknown
+	qint64 pcrTime;
+	qint64 windowPackets;
+};
+
+class DvbTsAnalyzer
+{
+public:
+	DvbTsAnalyzer();
+	~DvbTsAnalyzer();
+
+	void reset();
+
+	// timestamp = arrival time in ns (monotonic)
+	void processPacket(const char packet[188], qint64 timestamp);
+
+	QMap<int, DvbTsStatistics> getStatistics() const; // key = pid
+
+	/*
+	 * collects the statistics of all tuned devices; for each device there are
+	 * the totals ("Mux"), the sums over the pids of each channel ("Services")
+	 * and the per pid values ("Pids")
+	 */
+
+	static QVariantMap createReport(DvbManager *manager);
+
+private:
+	void updateBitrates(qint64 timestamp);
+
+	QVector<DvbTsPidState> states; // index = pid
+	QList<int> activePids;
+	qint64 windowStart;
+};
+
+#endif /* DVBTSANALYZER_H */
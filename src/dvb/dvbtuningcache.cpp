@@ -0,0 +1,301 @@
+/*
+ * dvbtuningcache.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../log.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+#include "dvbtuningcache.h"
+
+// the order of these arrays is the order in which the values used to be tried
+
+static const DvbTTransponder::FecRate fecRates[] = {
+	DvbTTransponder::Fec2_3,
+	DvbTTransponder::Fec3_4,
+	DvbTTransponder::Fec1_2,
+	DvbTTransponder::Fec5_6,
+	DvbTTransponder::Fec7_8
+};
+
+static const DvbTTransponder::GuardInterval guardIntervals[] = {
+	DvbTTransponder::GuardInterval1_8,
+	DvbTTransponder::GuardInterval1_32,
+	DvbTTransponder::GuardInterval1_4,
+	DvbTTransponder::GuardInterval1_16
+};
+
+static const DvbTTransponder::Modulation modulations[] = {
+	DvbTTransponder::Qam64,
+	DvbTTransponder::Qam16,
+	DvbTTransponder::Qpsk
+};
+
+static const DvbTTransponder::TransmissionMode transmissionModes[] = {
+	DvbTTransponder::TransmissionMode8k,
+	DvbTTransponder::TransmissionMode2k
+};
+
+class DvbTuningCandidate
+{
+public:
+	DvbTuningCandidate(const DvbTransponder &transponder_, int score_) :
+		transponder(transponder_), score(score_) { }
+	~DvbTuningCandidate() { }
+
+	bool operator<(const DvbTuningCandidate &other) const
+	{
+		return (score > other.score);
+	}
+
+	DvbTransponder transponder;
+	int score;
+};
+
+DvbTuningCache::DvbTuningCache()
+{
+	load();
+}
+
+DvbTuningCache::~DvbTuningCache()
+{
+}
+
+QList<DvbTransponder> DvbTuningCache::getCandidates(const QString &source,
+	const DvbTransponder &transponder, DvbDeviceBase::Capabilities capabilities) const
+{
+	QList<DvbTransponder> result;
+	const DvbTTransponder *tTransponder = transponder.as<DvbTTransponder>();
+
+	if (tTransponder == NULL) {
+		result.append(transponder);
+		return result;
+	}
+
+	bool iterateFec = ((capabilities & DvbDeviceBase::DvbTFecAuto) == 0);
+	bool iterateGuardInterval = ((capabilities & DvbDeviceBase::DvbTGuardIntervalAuto) == 0);
+	bool iterateModulation = ((capabilities & DvbDeviceBase::DvbTModulationAuto) == 0);
+	bool iterateTransmissionMode =
+		((capabilities & DvbDeviceBase::DvbTTransmissionModeAuto) == 0);
+
+	// count how often each value occured within this source
+
+	int fecCount[16] = { 0 };
+	int guardIntervalCount[8] = { 0 };
+	int modulationCount[4] = { 0 };
+	int transmissionModeCount[4] = { 0 };
+	const QMap<int, DvbTuningCacheEntry> sourceEntries = entries.value(source);
+	const DvbTTransponder *cached = NULL;
+
+	for (QMap<int, DvbTuningCacheEntry>::ConstIterator it = sourceEntries.constBegin();
+	     it != sourceEntries.constEnd(); ++it) {
+		const DvbTTransponder *entry = it->transponder.as<DvbTTransponder>();
+
+		if (entry == NULL) {
+			continue;
+		}
+
+		if (it.key() == tTransponder->frequency) {
+			cached = entry;
+		}
+
+		++fecCount[entry->fecRateHigh & 15];
+		++guardIntervalCount[entry->guardInterval & 7];
+		++modulationCount[entry->modulation & 3];
+		++transmissionModeCount[entry->transmissionMode & 3];
+	}
+
+	QList<DvbTuningCandidate> candidates;
+
+	for (unsigned int i = 0; i < (iterateTransmissionMode ?
+	     (sizeof(transmissionModes) / sizeof(transmissionModes[0])) : 1); ++i) {
+		for (unsigned int j = 0; j < (iterateModulation ?
+		     (sizeof(modulations) / sizeof(modulations[0])) : 1); ++j) {
+			for (unsigned int k = 0; k < (iterateGuardInterval ?
+			     (sizeof(guardIntervals) / sizeof(guardIntervals[0])) : 1); ++k) {
+				for (unsigned int l = 0; l < (iterateFec ?
+				     (sizeof(fecRates) / sizeof(fecRates[0])) : 1); ++l) {
+					DvbTransponder candidate = transponder;
+					DvbTTransponder *tCandidate = candidate.as<DvbTTransponder>();
+					int score = 0;
+
+					if (iterateTransmissionMode) {
+						tCandidate->transmissionMode = transmissionModes[i];
+						score += transmissionModeCount[transmissionModes[i]];
+					}
+
+					if (iterateModulation) {
+						tCandidate->modulation = modulations[j];
+						score += modulationCount[modulations[j]];
+					}
+
+					if (iterateGuardInterval) {
+						tCandidate->guardInterval = guardIntervals[k];
+						score += guardIntervalCount[guardIntervals[k]];
+					}
+
+					if (iterateFec) {
+						tCandidate->fecRateHigh = fecRates[l];
+						score += fecCount[fecRates[l]];
+					}
+
+					candidates.append(DvbTuningCandidate(candidate, score));
+				}
+			}
+		}
+	}
+
+	// stable, so that the traditional order is kept if there's no data
+	std::stable_sort(candidates.begin(), candidates.end());
+
+	if (cached != NULL) {
+		DvbTransponder candidate = transponder;
+		DvbTTransponder *tCandidate = candidate.as<DvbTTransponder>();
+
+		if (iterateTransmissionMode) {
+			tCandidate->transmissionMode = cached->transmissionMode;
+		}
+
+		if (iterateModulation) {
+			tCandidate->modulation = cached->modulation;
+		}
+
+		if (iterateGuardInterval) {
+			tCandidate->guardInterval = cached->guardInterval;
+		}
+
+		if (iterateFec) {
+			tCandidate->fecRateHigh = cached->fecRateHigh;
+		}
+
+		result.append(candidate);
+	}
+
+	foreach (const DvbTuningCandidate &candidate, candidates) {
+		if ((cached != NULL) &&
+		    (candidate.transponder.toString() == result.at(0).toString())) {
+			continue;
+		}
+
+		result.append(candidate.transponder);
+	}
+
+	return result;
+}
+
+int DvbTuningCache::getTimeout(const QString &source, int defaultTimeout) const
+{
+	const QMap<int, DvbTuningCacheEntry> sourceEntries = entries.value(source);
+
+	// don't trust a too small sample
+	if (sourceEntries.size() < 3) {
+		return defaultTimeout;
+	}
+
+	int maxLockTime = 0;
+
+	foreach (const DvbTuningCacheEntry &entry, sourceEntries) {
+		maxLockTime = qMax(maxLockTime, entry.lockTime);
+	}
+
+	// only ever shortens the configured timeout
+	return qMin(defaultTimeout, qMax(1500, 3 * maxLockTime));
+}
+
+void DvbTuningCache::insert(const QString &source, int frequency,
+	const DvbTransponder &transponder, int lockTime)
+{
+	DvbTuningCacheEntry &entry = entries[source][frequency];
+	entry.transponder = transponder;
+	entry.lockTime = lockTime;
+
+	// the file is small; don't lose the session's results on a crash
+	save();
+}
+
+void DvbTuningCache::load()
+{
+	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/tuningcache.dvb"));
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	int version;
+	stream >> version;
+
+	if (version != 0x20260101) {
+		qCWarning(logDvb, "Wrong version for: %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	while (!stream.atEnd()) {
+		QString source;
+		int frequency;
+		QString transponderString;
+		DvbTuningCacheEntry entry;
+		stream >> source;
+		stream >> frequency;
+		stream >> transponderString;
+		stream >> entry.lockTime;
+
+		if (stream.status() != QDataStream::Ok) {
+			qCWarning(logDvb, "Corrupt data %s", qPrintable(file.fileName()));
+			break;
+		}
+
+		entry.transponder = DvbTransponder::fromString(transponderString);
+
+		if (entry.transponder.isValid()) {
+			entries[source].insert(frequency, entry);
+		}
+	}
+}
+
+void DvbTuningCache::save() const
+{
+	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/tuningcache.dvb"));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(logDvb, "Cannot open %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	int version = 0x20260101;
+	stream << version;
+
+	for (QMap<QString, QMap<int, DvbTuningCacheEntry> >::ConstIterator it = entries.constBegin();
+	     it != entries.constEnd(); ++it) {
+		for (QMap<int, DvbTuningCacheEntry>::ConstIterator entryIt = it->constBegin();
+		     entryIt != it->constEnd(); ++entryIt) {
+			stream << it.key();
+			stream << entryIt.key();
+			stream << entryIt->transponder.toString();
+			stream << entryIt->lockTime;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * dvbtuningcache.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBTUNINGCACHE_H
+#define DVBTUNINGCACHE_H
+
+#include <QList>
+#include <QMap>
+#include <QString>
+#include "dvbbackenddevice.h"
+#include "dvbtransponder.h"
+
+class DvbTuningCacheEntry
+{
+public:
+	DvbTuningCacheEntry() : lockTime(-1) { }
+	~DvbTuningCacheEntry() { }
+
+	DvbTransponder transponder; // as returned by getProps()
+	int lockTime; // ms
+};
+
+/*
+ * remembers the tuning parameters which lead to a lock for a given
+ * (scan source, frequency) pair, so that auto-tuning doesn't have to iterate
+ * over all parameter combinations again; the cache is written to disk
+ * after every update
+ */
+
+class DvbTuningCache
+{
+public:
+	DvbTuningCache();
+	~DvbTuningCache();
+
+	/*
+	 * returns the parameter combinations which should be tried in order;
+	 * the cached parameters come first, the remaining combinations are
+	 * ordered by how often their values occured within the same source
+	 */
+
+	QList<DvbTransponder> getCandidates(const QString &source,
+		const DvbTransponder &transponder,
+		DvbDeviceBase::Capabilities capabilities) const;
+
+	// returns a (possibly shorter) timeout based on the observed lock times
+	int getTimeout(const QString &source, int defaultTimeout) const;
+
+	void insert(const QString &source, int frequency, const DvbTransponder &transponder,
+		int lockTime);
+
+private:
+	void load();
+	void save() const;
+
+	QMap<QString, QMap<int, DvbTuningCacheEntry> > entries;
+};
+
+#endif /* DVBTUNINGCACHE_H */
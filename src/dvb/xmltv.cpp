@@ -29,6 +29,7 @@
 #include "dvbepg.h"
 #include "dvbmanager.h"
 #include "iso-codes.h"
+#include "tracing.h"
 #include "xmltv.h"
 
 #include <QEventLoop>
@@ -574,6 +575,7 @@ bool XmlTv::parseProgram(void)
 
 bool XmlTv::load(QString file)
 {
+	KAFFEINE_TRACE_SCOPE("XmlTv::load");
 	bool parseError = false;
 
 	watcher.removePath(file);
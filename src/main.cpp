@@ -45,6 +45,7 @@ extern "C" {
 #include "configurationdialog.h"
 #include "mainwindow.h"
 #include "sqlhelper.h"
+#include "startupprofiler.h"
 
 void verboseMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
@@ -153,10 +154,14 @@ KaffeineApplication::KaffeineApplication(int &argc, char **argv) : QApplication(
 	if (!dir.exists())
 		dir.mkpath(path);
 
+	StartupProfiler::instance()->beginPhase(QLatin1String("SQL database"));
+
 	if (!SqlHelper::createInstance()) {
 		return;
 	}
 
+	StartupProfiler::instance()->endPhase(QLatin1String("SQL database"));
+
 	aboutData.addAuthor("Mauro Carvalho Chehab",
 		i18n("Maintainer"),
 		QStringLiteral("mchehab+samsung@kernel.org"));
@@ -194,10 +199,15 @@ KaffeineApplication::~KaffeineApplication()
 {
 	// unlike qt, kde sets Qt::WA_DeleteOnClose and needs it to work properly
 	delete mainWindow; // QPointer; needed if kaffeine is closed via QCoreApplication::quit()
+	// the models are gone now; wait until the writer thread has committed their data
+	SqlHelper::deleteInstance();
 }
 
 int main(int argc, char *argv[])
 {
+	// starts the clock for --profile-startup
+	StartupProfiler::instance();
+
 	qInstallMessageHandler(verboseMessageHandler);
 
 #if LIBVLC_VERSION_MAJOR <= 3
@@ -49,7 +49,9 @@
 #include "dbusobjects.h"
 #include "dvb/dvbtab.h"
 #include "mainwindow.h"
+#include "metrics.h"
 #include "playlist/playlisttab.h"
+#include "startupprofiler.h"
 
 // log categories. Should match log.h
 
@@ -195,10 +197,17 @@ void MainWindow::run()
 		QLoggingCategory::setFilterRules(QStringLiteral("kaffeine.*.debug=false"));
 	}
 
+	StartupProfiler *startupProfiler = StartupProfiler::instance();
+	startupProfiler->setEnabled(parser->isSet("profile-startup"));
+	startupProfiler->beginPhase(QLatin1String("Menus and bars"));
+
 	readSettings();
 
 	setAttribute(Qt::WA_DeleteOnClose, true);
 
+	// the metrics registry lives in the main thread (text file export timer)
+	Metrics::instance();
+
 	// menu structure
 
 	QMenuBar *menuBar = QMainWindow::menuBar();
@@ -300,8 +309,11 @@ void MainWindow::run()
 	cursorHideTimer->setSingleShot(true);
 	connect(cursorHideTimer, SIGNAL(timeout()), this, SLOT(hideCursor()));
 
+	startupProfiler->endPhase(QLatin1String("Menus and bars"));
+
 	// main area
 
+	startupProfiler->beginPhase(QLatin1String("Media widget"));
 	QWidget *widget = new QWidget(this);
 	stackedLayout = new StackedLayout(widget);
 	setCentralWidget(widget);
@@ -309,6 +321,7 @@ void MainWindow::run()
 	mediaWidget = new MediaWidget(playerMenu, controlBar, collection, widget);
 	connect(mediaWidget, SIGNAL(displayModeChanged()), this, SLOT(displayModeChanged()));
 	connect(mediaWidget, SIGNAL(changeCaption(QString)), this, SLOT(setWindowTitle(QString)));
+	startupProfiler->endPhase(QLatin1String("Media widget"));
 
 	// tabs - keep in sync with TabIndex enum!
 
@@ -321,16 +334,20 @@ void MainWindow::run()
 	tabs.append(playerTab);
 	stackedLayout->addWidget(playerTab);
 
+	startupProfiler->beginPhase(QLatin1String("Playlist tab"));
 	playlistTab = new PlaylistTab(playlistMenu, collection, mediaWidget);
 	tabs.append(playlistTab);
 	stackedLayout->addWidget(playlistTab);
+	startupProfiler->endPhase(QLatin1String("Playlist tab"));
 
 #if HAVE_DVB == 1
+	startupProfiler->beginPhase(QLatin1String("Television tab"));
 	dvbTab = new DvbTab(dvbMenu, collection, mediaWidget);
 	connect(this, SIGNAL(mayCloseApplication(bool*,QWidget*)),
 		dvbTab, SLOT(mayCloseApplication(bool*,QWidget*)));
 	tabs.append(dvbTab);
 	stackedLayout->addWidget(dvbTab);
+	startupProfiler->endPhase(QLatin1String("Television tab"));
 #endif /* HAVE_DVB == 1 */
 
 	currentTabIndex = StartTabId;
@@ -342,6 +359,7 @@ void MainWindow::run()
 	collection->readSettings();
 
 	// Tray menu
+	startupProfiler->beginPhase(QLatin1String("Tray icon and D-Bus"));
 	menu = new QMenu(i18n("Kaffeine"), this);
 
 	action = new QAction(i18n("Play &File"), this);
@@ -400,14 +418,20 @@ void MainWindow::run()
 		QDBusConnection::ExportAllContents);
 	QDBusConnection::sessionBus().registerObject(QLatin1String("/TrackList"),
 		new MprisTrackListObject(playlistTab, this), QDBusConnection::ExportAllContents);
+	QDBusConnection::sessionBus().registerObject(QLatin1String("/Metrics"),
+		new DBusMetricsObject(this), QDBusConnection::ExportAllContents);
 #if HAVE_DVB == 1
 	QDBusConnection::sessionBus().registerObject(QLatin1String("/Television"),
 		new DBusTelevisionObject(dvbTab, this), QDBusConnection::ExportAllContents);
 #endif /* HAVE_DVB == 1 */
 	QDBusConnection::sessionBus().registerService(QLatin1String("org.mpris.kaffeine"));
+	startupProfiler->endPhase(QLatin1String("Tray icon and D-Bus"));
 
+	// the program guide, xmltv data and playlist archive are loaded after
+	// this point; they signal when they are ready
 	parseArgs();
 	show();
+	startupProfiler->windowShown();
 }
 
 MainWindow::~MainWindow()
@@ -482,6 +506,7 @@ MainWindow::MainWindow(KAboutData *aboutData, QCommandLineParser *parser)
 	parser->addOption(QCommandLineOption(QStringList() << QLatin1String("audiocd"), i18n("Play Audio CD")));
 	parser->addOption(QCommandLineOption(QStringList() << QLatin1String("videocd"), i18n("Play Video CD")));
 	parser->addOption(QCommandLineOption(QStringList() << QLatin1String("dvd"), i18n("Play DVD")));
+	parser->addOption(QCommandLineOption(QStringList() << QLatin1String("profile-startup"), i18n("Log how long each initialisation phase takes")));
 	parser->addOption(QCommandLineOption(QStringList() << QLatin1String("aspectratio"), "Force starting with an specific aspect ratio", QLatin1String("aspect ratio")));
 
 #if HAVE_DVB == 1
@@ -0,0 +1,258 @@
+/*
+ * metrics.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "log.h"
+
+#include <KConfigGroup>
+#include <KSharedConfig>
+#include <QSaveFile>
+#include <QTimer>
+
+#include "metrics.h"
+
+MetricsHistogram::MetricsHistogram(const QList<qint64> &bounds_) : bounds(bounds_), count(0),
+	sum(0)
+{
+	buckets = new QAtomicInteger<qint64>[bounds.size() + 1];
+
+	for (int i = 0; i <= bounds.size(); ++i) {
+		buckets[i].storeRelaxed(0);
+	}
+}
+
+MetricsHistogram::~MetricsHistogram()
+{
+	delete[] buckets;
+}
+
+void MetricsHistogram::observe(qint64 value)
+{
+	int bucket = 0;
+
+	while ((bucket < bounds.size()) && (value > bounds.at(bucket))) {
+		++bucket;
+	}
+
+	buckets[bucket].fetchAndAddRelaxed(1);
+	count.fetchAndAddRelaxed(1);
+	sum.fetchAndAddRelaxed(value);
+}
+
+QList<qint64> MetricsHistogram::getBuckets() const
+{
+	QList<qint64> result;
+
+	for (int i = 0; i <= bounds.size(); ++i) {
+		result.append(buckets[i].loadRelaxed());
+	}
+
+	return result;
+}
+
+Metrics::Metrics() : textFileTimer(NULL)
+{
+	setTextFile(KSharedConfig::openConfig()->group("Metrics").readEntry("TextFile", QString()));
+}
+
+Metrics::~Metrics()
+{
+}
+
+Metrics *Metrics::instance()
+{
+	// never deleted, because metrics may be updated until the very end
+	static Metrics *metrics = new Metrics();
+	return metrics;
+}
+
+MetricsCounter *Metrics::counter(const QString &name, const QString &help)
+{
+	QMutexLocker locker(&mutex);
+	MetricsCounter *&counter = counters[name];
+
+	if (counter == NULL) {
+		counter = new MetricsCounter();
+		helpTexts.insert(name, help);
+	}
+
+	return counter;
+}
+
+MetricsGauge *Metrics::gauge(const QString &name, const QString &help)
+{
+	QMutexLocker locker(&mutex);
+	MetricsGauge *&gauge = gauges[name];
+
+	if (gauge == NULL) {
+		gauge = new MetricsGauge();
+		helpTexts.insert(name, help);
+	}
+
+	return gauge;
+}
+
+MetricsHistogram *Metrics::histogram(const QString &name, const QString &help,
+	const QList<qint64> &bounds)
+{
+	QMutexLocker locker(&mutex);
+	MetricsHistogram *&histogram = histograms[name];
+
+	if (histogram == NULL) {
+		histogram = new MetricsHistogram(bounds);
+		helpTexts.insert(name, help);
+	}
+
+	return histogram;
+}
+
+QVariantMap Metrics::snapshot()
+{
+	QMutexLocker locker(&mutex);
+	QVariantMap result;
+
+	for (QMap<QString, MetricsCounter *>::ConstIterator it = counters.constBegin();
+	     it != counters.constEnd(); ++it) {
+		result.insert(it.key(), (*it)->getValue());
+	}
+
+	for (QMap<QString, MetricsGauge *>::ConstIterator it = gauges.constBegin();
+	     it != gauges.constEnd(); ++it) {
+		result.insert(it.key(), (*it)->getValue());
+	}
+
+	for (QMap<QString, MetricsHistogram *>::ConstIterator it = histograms.constBegin();
+	     it != histograms.constEnd(); ++it) {
+		QVariantMap histogramMap;
+		QVariantList bounds;
+		QVariantList buckets;
+
+		foreach (qint64 bound, (*it)->getBounds()) {
+			bounds.append(bound);
+		}
+
+		foreach (qint64 bucket, (*it)->getBuckets()) {
+			buckets.append(bucket);
+		}
+
+		histogramMap.insert(QLatin1String("Bounds"), bounds);
+		histogramMap.insert(QLatin1String("Buckets"), buckets);
+		histogramMap.insert(QLatin1String("Count"), (*it)->getCount());
+		histogramMap.insert(QLatin1String("Sum"), (*it)->getSum());
+		result.insert(it.key(), histogramMap);
+	}
+
+	return result;
+}
+
+QString Metrics::toPrometheusText()
+{
+	QMutexLocker locker(&mutex);
+	QString text;
+
+	for (QMap<QString, MetricsCounter *>::ConstIterator it = counters.constBegin();
+	     it != counters.constEnd(); ++it) {
+		text += QLatin1String("# HELP ") + it.key() + QLatin1Char(' ') +
+			helpTexts.value(it.key()) + QLatin1Char('\n');
+		text += QLatin1String("# TYPE ") + it.key() + QLatin1String(" counter\n");
+		text += it.key() + QLatin1Char(' ') + QString::number((*it)->getValue()) +
+			QLatin1Char('\n');
+	}
+
+	for (QMap<QString, MetricsGauge *>::ConstIterator it = gauges.constBegin();
+	     it != gauges.constEnd(); ++it) {
+		text += QLatin1String("# HELP ") + it.key() + QLatin1Char(' ') +
+			helpTexts.value(it.key()) + QLatin1Char('\n');
+		text += QLatin1String("# TYPE ") + it.key() + QLatin1String(" gauge\n");
+		text += it.key() + QLatin1Char(' ') + QString::number((*it)->getValue()) +
+			QLatin1Char('\n');
+	}
+
+	for (QMap<QString, MetricsHistogram *>::ConstIterator it = histograms.constBegin();
+	     it != histograms.constEnd(); ++it) {
+		text += QLatin1String("# HELP ") + it.key() + QLatin1Char(' ') +
+			helpTexts.value(it.key()) + QLatin1Char('\n');
+		text += QLatin1String("# TYPE ") + it.key() + QLatin1String(" histogram\n");
+
+		// prometheus buckets are cumulative
+		QList<qint64> bounds = (*it)->getBounds();
+		QList<qint64> buckets = (*it)->getBuckets();
+		qint64 cumulative = 0;
+
+		for (int i = 0; i < buckets.size(); ++i) {
+			QString bound = QLatin1String("+Inf");
+
+			if (i < bounds.size()) {
+				bound = QString::number(bounds.at(i));
+			}
+
+			cumulative += buckets.at(i);
+			text += it.key() + QLatin1String("_bucket{le=\"") + bound +
+				QLatin1String("\"} ") + QString::number(cumulative) + QLatin1Char('\n');
+		}
+
+		text += it.key() + QLatin1String("_sum ") + QString::number((*it)->getSum()) +
+			QLatin1Char('\n');
+		text += it.key() + QLatin1String("_count ") + QString::number(cumulative) +
+			QLatin1Char('\n');
+	}
+
+	return text;
+}
+
+void Metrics::setTextFile(const QString &textFile_)
+{
+	if (textFile != textFile_) {
+		textFile = textFile_;
+		KSharedConfig::openConfig()->group("Metrics").writeEntry("TextFile", textFile);
+	}
+
+	if (textFile.isEmpty()) {
+		delete textFileTimer;
+		textFileTimer = NULL;
+		return;
+	}
+
+	if (textFileTimer == NULL) {
+		textFileTimer = new QTimer(this);
+		connect(textFileTimer, SIGNAL(timeout()), this, SLOT(writeTextFile()));
+		textFileTimer->start(15000);
+	}
+
+	writeTextFile();
+}
+
+void Metrics::writeTextFile()
+{
+	// QSaveFile replaces the file atomically, so scrapers never see partial data
+	QSaveFile file(textFile);
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		qCWarning(logConfig, "Cannot open %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	file.write(toPrometheusText().toUtf8());
+
+	if (!file.commit()) {
+		qCWarning(logConfig, "Cannot write %s", qPrintable(file.fileName()));
+	}
+}
+
+#include "moc_metrics.cpp"
@@ -0,0 +1,167 @@
+/*
+ * metrics.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QAtomicInteger>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QVariantMap>
+
+class QTimer;
+
+/*
+ * process-wide counters, gauges and histograms; the metric objects are
+ * created once and never deleted, so callers on hot paths should look them
+ * up once and keep the pointer; updating a metric is lock-free
+ */
+
+class MetricsCounter
+{
+public:
+	MetricsCounter() : value(0) { }
+	~MetricsCounter() { }
+
+	void increment(qint64 delta = 1)
+	{
+		value.fetchAndAddRelaxed(delta);
+	}
+
+	qint64 getValue() const
+	{
+		return value.loadRelaxed();
+	}
+
+private:
+	Q_DISABLE_COPY(MetricsCounter)
+
+	QAtomicInteger<qint64> value;
+};
+
+class MetricsGauge
+{
+public:
+	MetricsGauge() : value(0) { }
+	~MetricsGauge() { }
+
+	void set(qint64 newValue)
+	{
+		value.storeRelaxed(newValue);
+	}
+
+	void add(qint64 delta)
+	{
+		value.fetchAndAddRelaxed(delta);
+	}
+
+	qint64 getValue() const
+	{
+		return value.loadRelaxed();
+	}
+
+private:
+	Q_DISABLE_COPY(MetricsGauge)
+
+	QAtomicInteger<qint64> value;
+};
+
+class MetricsHistogram
+{
+public:
+	explicit MetricsHistogram(const QList<qint64> &bounds_);
+	~MetricsHistogram();
+
+	void observe(qint64 value);
+
+	QList<qint64> getBounds() const
+	{
+		return bounds;
+	}
+
+	// non-cumulative counts; the last bucket is unbounded
+	QList<qint64> getBuckets() const;
+
+	qint64 getCount() const
+	{
+		return count.loadRelaxed();
+	}
+
+	qint64 getSum() const
+	{
+		return sum.loadRelaxed();
+	}
+
+private:
+	Q_DISABLE_COPY(MetricsHistogram)
+
+	const QList<qint64> bounds;
+	QAtomicInteger<qint64> *buckets;
+	QAtomicInteger<qint64> count;
+	QAtomicInteger<qint64> sum;
+};
+
+class Metrics : public QObject
+{
+	Q_OBJECT
+private:
+	Metrics();
+	~Metrics();
+
+public:
+	static Metrics *instance(); // thread-safe
+
+	/*
+	 * returns the metric with the given name, creating it on first use;
+	 * names follow the prometheus conventions (e.g. kaffeine_dvb_packets_total)
+	 */
+
+	MetricsCounter *counter(const QString &name, const QString &help);
+	MetricsGauge *gauge(const QString &name, const QString &help);
+	MetricsHistogram *histogram(const QString &name, const QString &help,
+		const QList<qint64> &bounds);
+
+	QVariantMap snapshot();
+	QString toPrometheusText();
+
+	// the prometheus text is periodically written to this file (empty = disabled)
+	QString getTextFile() const
+	{
+		return textFile;
+	}
+
+	void setTextFile(const QString &textFile_);
+
+private slots:
+	void writeTextFile();
+
+private:
+	QMutex mutex;
+	QMap<QString, MetricsCounter *> counters;
+	QMap<QString, MetricsGauge *> gauges;
+	QMap<QString, MetricsHistogram *> histograms;
+	QMap<QString, QString> helpTexts;
+	QString textFile;
+	QTimer *textFileTimer;
+};
+
+#endif /* METRICS_H */
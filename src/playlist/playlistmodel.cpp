@@ -22,12 +22,17 @@
 
 #include <QDir>
 #include <QDomDocument>
+#include <QElapsedTimer>
 #include <QLocale>
 #include <QMimeData>
+#include <QMutex>
 #include <QSet>
 #include <QTextStream>
+#include <QThread>
+#include <QWaitCondition>
 #include <QXmlStreamWriter>
 
+#include "../backend-vlc/vlcmetadataprober.h"
 #include "playlistmodel.h"
 
 bool Playlist::load(const QUrl &url_, Format format)
@@ -504,13 +509,305 @@ void Playlist::saveXSPFPlaylist(QIODevice *device) const
 	stream.writeEndDocument();
 }
 
+static Playlist::Format playlistFormat(const QString &fileName)
+{
+	if (fileName.endsWith(QLatin1String(".kaffeine"), Qt::CaseInsensitive)) {
+		return Playlist::Kaffeine;
+	} else if (fileName.endsWith(QLatin1String(".m3u"), Qt::CaseInsensitive) ||
+		   fileName.endsWith(QLatin1String(".m3u8"), Qt::CaseInsensitive)) {
+		return Playlist::M3U;
+	} else if (fileName.endsWith(QLatin1String(".pls"), Qt::CaseInsensitive)) {
+		return Playlist::PLS;
+	} else if (fileName.endsWith(QLatin1String(".xspf"), Qt::CaseInsensitive)) {
+		return Playlist::XSPF;
+	}
+
+	return Playlist::Invalid;
+}
+
+class PlaylistIngesterJob
+{
+public:
+	PlaylistIngesterJob() : id(-1) { }
+	~PlaylistIngesterJob() { }
+
+	int id;
+	QList<QUrl> urls;
+};
+
+class PlaylistIngesterResult
+{
+public:
+	PlaylistIngesterResult() : job(-1), playlist(NULL), processedFiles(0), finished(false) { }
+	~PlaylistIngesterResult() { }
+
+	int job;
+	QList<QUrl> urls;
+	Playlist *playlist; // nested playlist, owned by the receiver
+	int processedFiles;
+	bool finished;
+};
+
+/*
+ * expands directories (recursively) and reads nested playlists, so that a
+ * large or slow (network) directory tree doesn't block the event loop; the
+ * urls are handed over in batches and PlaylistModel::processIngesterResults()
+ * is invoked whenever new batches become available
+ */
+
+class PlaylistIngester : public QThread
+{
+public:
+	PlaylistIngester(QObject *receiver_, const QStringList &nameFilters_);
+	~PlaylistIngester();
+
+	int submit(const QList<QUrl> &urls);
+	void cancel(int job);
+	QList<PlaylistIngesterResult> takeResults();
+	void stop();
+
+private:
+	void run() override;
+	void ingestDirectory(const QString &path, QSet<QString> &visitedDirs);
+	void appendUrl(const QUrl &url);
+	void appendPlaylist(Playlist *playlist);
+	void flush(bool finished);
+	bool isCancelled();
+
+	static const int maxBatchSize = 512;
+	static const int maxBatchDelay = 100; // ms
+
+	QObject *receiver;
+	QStringList nameFilters;
+	QMutex mutex;
+	QWaitCondition condition;
+	QList<PlaylistIngesterJob> pendingJobs;
+	QList<PlaylistIngesterResult> results;
+	int nextJob;
+	int currentJob;
+	bool currentJobCancelled;
+	bool stopping;
+
+	// only accessed by the thread itself
+	PlaylistIngesterResult pendingResult;
+	QElapsedTimer batchTimer;
+};
+
+PlaylistIngester::PlaylistIngester(QObject *receiver_, const QStringList &nameFilters_) :
+	receiver(receiver_), nameFilters(nameFilters_), nextJob(0), currentJob(-1),
+	currentJobCancelled(false), stopping(false)
+{
+	setObjectName(QLatin1String("PlaylistIngester"));
+}
+
+PlaylistIngester::~PlaylistIngester()
+{
+	stop();
+
+	foreach (const PlaylistIngesterResult &result, results) {
+		delete result.playlist;
+	}
+}
+
+int PlaylistIngester::submit(const QList<QUrl> &urls)
+{
+	QMutexLocker locker(&mutex);
+	PlaylistIngesterJob job;
+	job.id = nextJob++;
+	job.urls = urls;
+	pendingJobs.append(job);
+	condition.wakeOne();
+	return job.id;
+}
+
+void PlaylistIngester::cancel(int job)
+{
+	QMutexLocker locker(&mutex);
+
+	for (int i = 0; i < pendingJobs.size(); ++i) {
+		if (pendingJobs.at(i).id == job) {
+			pendingJobs.removeAt(i);
+			return;
+		}
+	}
+
+	if (currentJob == job) {
+		currentJobCancelled = true;
+	}
+}
+
+QList<PlaylistIngesterResult> PlaylistIngester::takeResults()
+{
+	QMutexLocker locker(&mutex);
+	QList<PlaylistIngesterResult> takenResults;
+	takenResults.swap(results);
+	return takenResults;
+}
+
+void PlaylistIngester::stop()
+{
+	mutex.lock();
+	stopping = true;
+	condition.wakeOne();
+	mutex.unlock();
+	wait();
+}
+
+void PlaylistIngester::run()
+{
+	while (true) {
+		mutex.lock();
+		currentJob = -1;
+		currentJobCancelled = false;
+
+		while (pendingJobs.isEmpty() && !stopping) {
+			condition.wait(&mutex);
+		}
+
+		if (stopping) {
+			mutex.unlock();
+			break;
+		}
+
+		PlaylistIngesterJob job = pendingJobs.takeFirst();
+		currentJob = job.id;
+		mutex.unlock();
+
+		pendingResult = PlaylistIngesterResult();
+		pendingResult.job = job.id;
+		batchTimer.start();
+		QSet<QString> visitedDirs;
+
+		foreach (const QUrl &url, job.urls) {
+			if (isCancelled()) {
+				break;
+			}
+
+			Playlist::Format format = playlistFormat(url.fileName());
+
+			if (format != Playlist::Invalid) {
+				Playlist *nestedPlaylist = new Playlist();
+
+				if (nestedPlaylist->load(url, format)) {
+					appendPlaylist(nestedPlaylist);
+				} else {
+					delete nestedPlaylist;
+				}
+
+				continue;
+			}
+
+			QString localFile = url.toLocalFile();
+
+			if (!localFile.isEmpty() && QFileInfo(localFile).isDir()) {
+				ingestDirectory(localFile, visitedDirs);
+			} else {
+				appendUrl(url);
+			}
+		}
+
+		if (!isCancelled()) {
+			flush(true);
+		}
+	}
+}
+
+void PlaylistIngester::ingestDirectory(const QString &path, QSet<QString> &visitedDirs)
+{
+	QDir dir(path);
+
+	// symbolic links may form a loop
+	QString canonicalPath = dir.canonicalPath();
+
+	if (visitedDirs.contains(canonicalPath)) {
+		return;
+	}
+
+	visitedDirs.insert(canonicalPath);
+
+	// files first, then the sub directories; both sorted like a file manager would
+
+	QStringList entries = dir.entryList(nameFilters, QDir::Files, QDir::Name | QDir::LocaleAware);
+
+	foreach (const QString &entry, entries) {
+		if (isCancelled()) {
+			return;
+		}
+
+		appendUrl(QUrl::fromLocalFile(dir.filePath(entry)));
+	}
+
+	entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::LocaleAware);
+
+	foreach (const QString &entry, entries) {
+		if (isCancelled()) {
+			return;
+		}
+
+		ingestDirectory(dir.filePath(entry), visitedDirs);
+	}
+}
+
+void PlaylistIngester::appendUrl(const QUrl &url)
+{
+	pendingResult.urls.append(url);
+	++pendingResult.processedFiles;
+
+	if ((pendingResult.urls.size() >= maxBatchSize) ||
+	    batchTimer.hasExpired(maxBatchDelay)) {
+		flush(false);
+	}
+}
+
+void PlaylistIngester::appendPlaylist(Playlist *playlist)
+{
+	// keep the order between the urls and the nested playlists
+	if (!pendingResult.urls.isEmpty()) {
+		flush(false);
+	}
+
+	pendingResult.playlist = playlist;
+	++pendingResult.processedFiles;
+	flush(false);
+}
+
+void PlaylistIngester::flush(bool finished)
+{
+	pendingResult.finished = finished;
+
+	mutex.lock();
+	bool notify = results.isEmpty();
+	results.append(pendingResult);
+	mutex.unlock();
+
+	if (notify) {
+		QMetaObject::invokeMethod(receiver, "processIngesterResults", Qt::QueuedConnection);
+	}
+
+	pendingResult.urls.clear();
+	pendingResult.playlist = NULL;
+	batchTimer.start();
+}
+
+bool PlaylistIngester::isCancelled()
+{
+	QMutexLocker locker(&mutex);
+	return (currentJobCancelled || stopping);
+}
+
 PlaylistModel::PlaylistModel(Playlist *visiblePlaylist_, QObject *parent) :
 	QAbstractTableModel(parent), visiblePlaylist(visiblePlaylist_)
 {
+	QString extensionFilter = MediaWidget::extensionFilter();
+	extensionFilter.truncate(extensionFilter.indexOf(QLatin1Char('|')));
+	ingester = new PlaylistIngester(this, extensionFilter.split(QLatin1Char(' ')));
+	prober = new VlcMetadataProber(this, "processProberResults");
 }
 
 PlaylistModel::~PlaylistModel()
 {
+	delete prober;
+	delete ingester;
 }
 
 void PlaylistModel::setVisiblePlaylist(Playlist *visiblePlaylist_)
@@ -541,6 +838,13 @@ void PlaylistModel::removeRows(Playlist *playlist, int row, int count)
 	QList<PlaylistTrack>::Iterator begin = playlist->tracks.begin() + row;
 	playlist->tracks.erase(begin, begin + count);
 
+	for (QMap<int, PlaylistIngestionJob>::Iterator it = ingestionJobs.begin();
+	     it != ingestionJobs.end(); ++it) {
+		if ((it->playlist == playlist) && (it->row > row)) {
+			it->row -= qMin(count, it->row - row);
+		}
+	}
+
 	if (playlist->currentTrack >= row) {
 		if (playlist->currentTrack >= (row + count)) {
 			playlist->currentTrack -= count;
@@ -643,6 +947,7 @@ void PlaylistModel::updateTrackMetadata(Playlist *playlist,
 
 void PlaylistModel::clearVisiblePlaylist()
 {
+	cancelIngestion(visiblePlaylist);
 	QAbstractItemModel::beginResetModel();
 
 	visiblePlaylist->tracks.clear();
@@ -658,78 +963,315 @@ void PlaylistModel::clearVisiblePlaylist()
 void PlaylistModel::insertUrls(Playlist *playlist, int row, const QList<QUrl> &urls,
 	bool playImmediately)
 {
-	QList<QUrl> processedUrls;
+	// plain files are inserted right away; only directories and nested
+	// playlists are expanded by the ingester (one job per position)
+	QList<PlaylistTrack> tracks;
+	QList<QUrl> plainUrls;
+	QList<int> jobRows;
+	QList<QList<QUrl> > jobUrls;
 
 	foreach (const QUrl &url, urls) {
-		QString fileName = url.fileName();
-		Playlist::Format format = Playlist::Invalid;
-
-		if (fileName.endsWith(QLatin1String(".kaffeine"), Qt::CaseInsensitive)) {
-			format = Playlist::Kaffeine;
-		} else if (fileName.endsWith(QLatin1String(".m3u"), Qt::CaseInsensitive) ||
-			   fileName.endsWith(QLatin1String(".m3u8"), Qt::CaseInsensitive)) {
-			format = Playlist::M3U;
-		} else if (fileName.endsWith(QLatin1String(".pls"), Qt::CaseInsensitive)) {
-			format = Playlist::PLS;
-		} else if (fileName.endsWith(QLatin1String(".xspf"), Qt::CaseInsensitive)) {
-			format = Playlist::XSPF;
-		}
-
-		if (format != Playlist::Invalid) {
-			Playlist *nestdPlaylist = new Playlist();
-
-			if (nestdPlaylist->load(url, format)) {
-				emit appendPlaylist(nestdPlaylist, playImmediately);
-				playImmediately = false;
-			} else {
-				delete nestdPlaylist;
+		QString localFile = url.toLocalFile();
+
+		if ((playlistFormat(url.fileName()) != Playlist::Invalid) ||
+		    (!localFile.isEmpty() && QFileInfo(localFile).isDir())) {
+			int jobRow = (row + tracks.size());
+
+			if (jobRows.isEmpty() || (jobRows.last() != jobRow)) {
+				jobRows.append(jobRow);
+				jobUrls.append(QList<QUrl>());
 			}
 
+			jobUrls.last().append(url);
 			continue;
 		}
 
-		QString localFile = url.toLocalFile();
+		PlaylistTrack track;
+		track.url = url;
+		track.title = url.fileName();
+		tracks.append(track);
+		plainUrls.append(url);
+	}
+
+	// whichever comes first is played
+	bool playJob = (playImmediately && !jobRows.isEmpty() && (jobRows.first() == row));
+
+	if (!tracks.isEmpty()) {
+		insertTracks(playlist, row, tracks);
+		probeTracks(playlist, row, plainUrls);
+
+		if (playImmediately && !playJob) {
+			emit playTrack(playlist, row);
+		}
+	}
+
+	if (jobRows.isEmpty()) {
+		return;
+	}
+
+	if (!ingester->isRunning()) {
+		ingester->start();
+	}
+
+	for (int i = 0; i < jobRows.size(); ++i) {
+		PlaylistIngestionJob job;
+		job.playlist = playlist;
+		job.row = jobRows.at(i);
+		job.playImmediately = (playJob && (i == 0));
+		ingestionJobs.insert(ingester->submit(jobUrls.at(i)), job);
+	}
+
+	emit ingestionProgress(processedFiles(), false);
+}
+
+void PlaylistModel::insertTracks(Playlist *playlist, int row, const QList<PlaylistTrack> &tracks)
+{
+	if (playlist == visiblePlaylist) {
+		beginInsertRows(QModelIndex(), row, row + tracks.size() - 1);
+	}
 
-		if (!localFile.isEmpty() && QFileInfo(localFile).isDir()) {
-			QDir dir(localFile);
-			QString extensionFilter = MediaWidget::extensionFilter();
-			extensionFilter.truncate(extensionFilter.indexOf(QLatin1Char('|')));
-			QStringList entries = dir.entryList(extensionFilter.split(QLatin1Char(' ')),
-				QDir::Files, QDir::Name | QDir::LocaleAware);
+	for (int i = 0; i < tracks.size(); ++i) {
+		playlist->tracks.insert(row + i, tracks.at(i));
+	}
+
+	if (playlist->currentTrack >= row) {
+		playlist->currentTrack += tracks.size();
+	}
+
+	for (QMap<int, PlaylistIngestionJob>::Iterator it = ingestionJobs.begin();
+	     it != ingestionJobs.end(); ++it) {
+		if ((it->playlist == playlist) && (it->row >= row)) {
+			it->row += tracks.size();
+		}
+	}
+
+	if (playlist == visiblePlaylist) {
+		endInsertRows();
+	}
+}
+
+int PlaylistModel::processedFiles() const
+{
+	int count = 0;
+
+	foreach (const PlaylistIngestionJob &job, ingestionJobs) {
+		count += job.processedFiles;
+	}
 
-			for (int i = 0; i < entries.size(); ++i) {
-				const QString &entry = entries.at(i);
-				processedUrls.append(QUrl::fromLocalFile(dir.filePath(entry)));
+	return count;
+}
+
+void PlaylistModel::processIngesterResults()
+{
+	foreach (const PlaylistIngesterResult &result, ingester->takeResults()) {
+		QMap<int, PlaylistIngestionJob>::Iterator it = ingestionJobs.find(result.job);
+
+		if (it == ingestionJobs.end()) {
+			// cancelled
+			delete result.playlist;
+			continue;
+		}
+
+		// the slots connected to the signals below may modify ingestionJobs
+		Playlist *playlist = it->playlist;
+		bool playImmediately = it->playImmediately;
+		it->processedFiles = result.processedFiles;
+
+		if (result.playlist != NULL) {
+			it->playImmediately = false;
+			emit appendPlaylist(result.playlist, playImmediately);
+		} else if (!result.urls.isEmpty()) {
+			int row = qMin(it->row, int(playlist->tracks.size()));
+			it->playImmediately = false;
+			QList<PlaylistTrack> tracks;
+
+			foreach (const QUrl &url, result.urls) {
+				PlaylistTrack track;
+				track.url = url;
+				track.title = url.fileName();
+				tracks.append(track);
 			}
-		} else {
-			processedUrls.append(url);
+
+			insertTracks(playlist, row, tracks);
+			probeTracks(playlist, row, result.urls);
+
+			if (playImmediately) {
+				emit playTrack(playlist, row);
+			}
+		}
+
+		if (result.finished) {
+			ingestionJobs.remove(result.job);
 		}
 	}
 
-	if (!processedUrls.isEmpty()) {
-		if (playlist == visiblePlaylist) {
-			beginInsertRows(QModelIndex(), row, row + processedUrls.size() - 1);
+	emit ingestionProgress(processedFiles(), ingestionJobs.isEmpty());
+}
+
+void PlaylistModel::probeTracks(Playlist *playlist, int row, const QList<QUrl> &urls)
+{
+	QList<QUrl> localUrls;
+
+	for (int i = 0; i < urls.size(); ++i) {
+		const QUrl &url = urls.at(i);
+
+		if (url.isLocalFile()) {
+			localUrls.append(url);
+			probedTracks.insert(url, PlaylistProbedTrack(playlist, row + i));
 		}
+	}
 
-		for (int i = 0; i < processedUrls.size(); ++i) {
-			PlaylistTrack track;
-			track.url = processedUrls.at(i);
-			track.title = track.url.fileName();
-			playlist->tracks.insert(row + i, track);
+	if (localUrls.isEmpty()) {
+		return;
+	}
+
+	if (!prober->isRunning()) {
+		prober->start();
+	}
+
+	prober->probe(localUrls);
+}
+
+static bool applyProbedMetadata(PlaylistTrack &track, const VlcProbedMetadata &metadata)
+{
+	bool changed = false;
+
+	if (!metadata.title.isEmpty() && (track.title != metadata.title)) {
+		track.title = metadata.title;
+		changed = true;
+	}
+
+	if (!metadata.artist.isEmpty() && (track.artist != metadata.artist)) {
+		track.artist = metadata.artist;
+		changed = true;
+	}
+
+	if (!metadata.album.isEmpty() && (track.album != metadata.album)) {
+		track.album = metadata.album;
+		changed = true;
+	}
+
+	if ((metadata.trackNumber >= 0) && (track.trackNumber != metadata.trackNumber)) {
+		track.trackNumber = metadata.trackNumber;
+		changed = true;
+	}
+
+	if ((metadata.length > 0) && !track.length.isValid()) {
+		track.length = QTime(0, 0, 0).addMSecs(metadata.length);
+		changed = true;
+	}
+
+	return changed;
+}
+
+void PlaylistModel::processProberResults()
+{
+	// only the rows of this batch are looked at; the rows recorded by
+	// probeTracks() are used unless the playlist has been modified since
+	QHash<Playlist *, QList<int> > changedRows;
+	QHash<Playlist *, QMultiHash<QUrl, int> > rowIndexes; // built on demand
+
+	foreach (const VlcProbedMetadata &metadata, prober->takeResults()) {
+		QList<PlaylistProbedTrack> probedTrackList = probedTracks.values(metadata.url);
+		probedTracks.remove(metadata.url);
+
+		foreach (const PlaylistProbedTrack &probedTrack, probedTrackList) {
+			Playlist *playlist = probedTrack.playlist;
+			QList<int> rows;
+
+			if ((probedTrack.row < playlist->tracks.size()) &&
+			    (playlist->tracks.at(probedTrack.row).url == metadata.url)) {
+				rows.append(probedTrack.row);
+			} else {
+				QHash<Playlist *, QMultiHash<QUrl, int> >::Iterator it =
+					rowIndexes.find(playlist);
+
+				if (it == rowIndexes.end()) {
+					it = rowIndexes.insert(playlist, QMultiHash<QUrl, int>());
+
+					for (int row = 0; row < playlist->tracks.size(); ++row) {
+						it->insert(playlist->tracks.at(row).url, row);
+					}
+				}
+
+				rows = it->values(metadata.url);
+			}
+
+			foreach (int row, rows) {
+				if (applyProbedMetadata(playlist->tracks[row], metadata)) {
+					changedRows[playlist].append(row);
+				}
+			}
 		}
+	}
+
+	// consecutive rows are reported as one range
 
-		if (playlist->currentTrack >= row) {
-			playlist->currentTrack += processedUrls.size();
+	if (changedRows.contains(visiblePlaylist)) {
+		QList<int> &rows = changedRows[visiblePlaylist];
+		std::sort(rows.begin(), rows.end());
+		int firstRow = rows.at(0);
+
+		for (int i = 1; i <= rows.size(); ++i) {
+			if ((i < rows.size()) && (rows.at(i) <= (rows.at(i - 1) + 1))) {
+				continue;
+			}
+
+			emit dataChanged(index(firstRow, 0), index(rows.at(i - 1), 4));
+
+			if (i < rows.size()) {
+				firstRow = rows.at(i);
+			}
 		}
+	}
 
-		if (playlist == visiblePlaylist) {
-			endInsertRows();
+	if (prober->isIdle()) {
+		probedTracks.clear();
+	}
+}
+
+void PlaylistModel::cancelIngestion(Playlist *playlist)
+{
+	bool cancelled = false;
+
+	for (QMultiHash<QUrl, PlaylistProbedTrack>::Iterator it = probedTracks.begin();
+	     it != probedTracks.end();) {
+		if (it->playlist == playlist) {
+			it = probedTracks.erase(it);
+		} else {
+			++it;
 		}
+	}
 
-		if (playImmediately) {
-			emit playTrack(playlist, row);
+	for (QMap<int, PlaylistIngestionJob>::Iterator it = ingestionJobs.begin();
+	     it != ingestionJobs.end();) {
+		if (it->playlist == playlist) {
+			ingester->cancel(it.key());
+			it = ingestionJobs.erase(it);
+			cancelled = true;
+		} else {
+			++it;
 		}
 	}
+
+	if (cancelled) {
+		emit ingestionProgress(processedFiles(), ingestionJobs.isEmpty());
+	}
+}
+
+void PlaylistModel::cancelIngestion()
+{
+	if (ingestionJobs.isEmpty()) {
+		return;
+	}
+
+	for (QMap<int, PlaylistIngestionJob>::ConstIterator it = ingestionJobs.constBegin();
+	     it != ingestionJobs.constEnd(); ++it) {
+		ingester->cancel(it.key());
+	}
+
+	ingestionJobs.clear();
+	emit ingestionProgress(0, true);
 }
 
 int PlaylistModel::columnCount(const QModelIndex &parent) const
@@ -888,21 +1430,16 @@ void PlaylistModel::sort(int column, Qt::SortOrder order)
 
 	emit layoutAboutToBeChanged();
 
-	for (int i = 0; i < mapping.size();) {
-		int target = mapping.at(i);
+	// building a new list moves every track once instead of swapping them
+	QList<PlaylistTrack> sortedTracks;
+	sortedTracks.reserve(mapping.size());
 
-		if (i != target) {
-			qSwap(mapping[i], mapping[target]);
-#if QT_VERSION < 0x050c00
-			visiblePlaylist->tracks.swap(i, target);
-#else
-			visiblePlaylist->tracks.swapItemsAt(i, target);
-#endif
-		} else {
-			++i;
-		}
+	for (int i = 0; i < mapping.size(); ++i) {
+		sortedTracks.append(visiblePlaylist->tracks.at(mapping.at(i)));
 	}
 
+	visiblePlaylist->tracks.swap(sortedTracks);
+
 	if (visiblePlaylist->currentTrack >= 0) {
 		visiblePlaylist->currentTrack =
 			reverseMapping.value(visiblePlaylist->currentTrack);
@@ -916,6 +1453,15 @@ void PlaylistModel::sort(int column, Qt::SortOrder order)
 	}
 
 	changePersistentIndexList(oldIndexes, newIndexes);
+
+	// the insertion position doesn't make sense anymore
+	for (QMap<int, PlaylistIngestionJob>::Iterator it = ingestionJobs.begin();
+	     it != ingestionJobs.end(); ++it) {
+		if (it->playlist == visiblePlaylist) {
+			it->row = visiblePlaylist->tracks.size();
+		}
+	}
+
 	emit layoutChanged();
 }
 
@@ -974,17 +1520,7 @@ bool PlaylistModel::dropMimeData(const QMimeData *data, Qt::DropAction action, i
 	QList<PlaylistTrack> tracks = data->property("tracks").value<QList<PlaylistTrack> >();
 
 	if (!tracks.isEmpty()) {
-		beginInsertRows(QModelIndex(), row, row + tracks.size() - 1);
-
-		for (int i = 0; i < tracks.size(); ++i) {
-			visiblePlaylist->tracks.insert(row + i, tracks.at(i));
-		}
-
-		if (visiblePlaylist->currentTrack >= row) {
-			visiblePlaylist->currentTrack += tracks.size();
-		}
-
-		endInsertRows();
+		insertTracks(visiblePlaylist, row, tracks);
 		return true;
 	}
 
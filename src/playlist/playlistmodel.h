@@ -22,6 +22,7 @@
 #define PLAYLISTMODEL_H
 
 #include <QAbstractTableModel>
+#include <QMultiHash>
 #include <QTime>
 #include "../mediawidget.h"
 
@@ -84,6 +85,33 @@ private:
 	void saveXSPFPlaylist(QIODevice *device) const;
 };
 
+class PlaylistIngester;
+class VlcMetadataProber;
+
+class PlaylistIngestionJob
+{
+public:
+	PlaylistIngestionJob() : playlist(NULL), row(0), playImmediately(false),
+		processedFiles(0) { }
+	~PlaylistIngestionJob() { }
+
+	Playlist *playlist;
+	int row; // where the next batch is inserted
+	bool playImmediately;
+	int processedFiles;
+};
+
+class PlaylistProbedTrack
+{
+public:
+	PlaylistProbedTrack() : playlist(NULL), row(-1) { }
+	PlaylistProbedTrack(Playlist *playlist_, int row_) : playlist(playlist_), row(row_) { }
+	~PlaylistProbedTrack() { }
+
+	Playlist *playlist;
+	int row; // when the probe was requested; may be outdated
+};
+
 class PlaylistModel : public QAbstractTableModel
 {
 	Q_OBJECT
@@ -101,16 +129,34 @@ public:
 	void updateTrackMetadata(Playlist *playlist,
 		const QMap<MediaWidget::MetadataType, QString> &metadata);
 
+	// drops the urls which haven't been added to the playlist yet and
+	// stops updating the metadata of its tracks (e.g. before deleting it)
+	void cancelIngestion(Playlist *playlist);
+
 public slots:
 	void clearVisiblePlaylist();
+	void cancelIngestion();
 
 signals:
 	void appendPlaylist(Playlist *playlist, bool playImmediately);
 	void playTrack(Playlist *playlist, int track);
+	void ingestionProgress(int processedFiles, bool finished);
+
+private slots:
+	void processIngesterResults();
+	void processProberResults();
 
 private:
+	/*
+	 * directories and playlists are expanded by a worker thread; the
+	 * resulting tracks are inserted in batches as they become available
+	 */
 	void insertUrls(Playlist *playlist, int row, const QList<QUrl> &urls,
 		bool playImmediately);
+	void insertTracks(Playlist *playlist, int row, const QList<PlaylistTrack> &tracks);
+	int processedFiles() const;
+	// reads the metadata of the tracks without playing them
+	void probeTracks(Playlist *playlist, int row, const QList<QUrl> &urls);
 
 	int columnCount(const QModelIndex &parent) const override;
 	int rowCount(const QModelIndex &parent) const override;
@@ -127,6 +173,10 @@ private:
 		const QModelIndex &parent) override;
 
 	Playlist *visiblePlaylist;
+	PlaylistIngester *ingester;
+	QMap<int, PlaylistIngestionJob> ingestionJobs; // job id -> job
+	VlcMetadataProber *prober;
+	QMultiHash<QUrl, PlaylistProbedTrack> probedTracks; // until the prober is idle
 };
 
 #endif /* PLAYLISTMODEL_H */
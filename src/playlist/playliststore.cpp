@@ -0,0 +1,371 @@
+/*
+ * playliststore.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../log.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+#include "playlistmodel.h"
+#include "playliststore.h"
+
+static const quint32 indexVersion = 0x20261019;
+static const quint32 tracksVersion = 0x20261020;
+
+PlaylistStore::PlaylistStore() : nextId(1)
+{
+	path = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/playlists");
+}
+
+PlaylistStore::~PlaylistStore()
+{
+}
+
+bool PlaylistStore::readIndex(QList<Playlist *> &playlists)
+{
+	QFile file(path + QLatin1String("/index"));
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	quint32 version;
+	stream >> version;
+
+	if (version != indexVersion) {
+		qCWarning(logPlaylist, "Wrong version for: %s", qPrintable(file.fileName()));
+		return false;
+	}
+
+	while (!stream.atEnd()) {
+		PlaylistStoreEntry entry;
+		QString title;
+		QString urlString;
+		stream >> entry.id;
+		stream >> title;
+		stream >> urlString;
+
+		if (stream.status() != QDataStream::Ok) {
+			qCWarning(logPlaylist, "Corrupt data %s", qPrintable(file.fileName()));
+			break;
+		}
+
+		Playlist *playlist = new Playlist();
+		playlist->title = title;
+		playlist->url = urlString;
+		entries.insert(playlist, entry);
+		playlists.append(playlist);
+		nextId = qMax(nextId, entry.id + 1);
+	}
+
+	return true;
+}
+
+void PlaylistStore::ensureLoaded(Playlist *playlist)
+{
+	QHash<Playlist *, PlaylistStoreEntry>::Iterator it = entries.find(playlist);
+
+	if ((it == entries.end()) || it->loaded) {
+		return;
+	}
+
+	// a playlist which couldn't be read stays unloaded, so that save()
+	// doesn't replace the file with an empty playlist
+	QFile file(path + QLatin1Char('/') + QString::number(it->id));
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		qCWarning(logPlaylist, "Cannot open file %s", qPrintable(file.fileName()));
+		return;
+	}
+
+	QByteArray data = file.readAll();
+
+	if (readTracks(data, playlist)) {
+		it->loaded = true;
+		it->hash = qHash(data);
+	} else {
+		qCWarning(logPlaylist, "Cannot read file %s", qPrintable(file.fileName()));
+	}
+}
+
+void PlaylistStore::remove(Playlist *playlist)
+{
+	// the file is removed by the next save()
+	entries.remove(playlist);
+}
+
+void PlaylistStore::save(const QList<Playlist *> &playlists)
+{
+	if (!QDir().mkpath(path)) {
+		qCWarning(logPlaylist, "Cannot create directory %s", qPrintable(path));
+		return;
+	}
+
+	QSaveFile indexFile(path + QLatin1String("/index"));
+
+	if (!indexFile.open(QIODevice::WriteOnly)) {
+		qCWarning(logPlaylist, "Cannot open file %s", qPrintable(indexFile.fileName()));
+		return;
+	}
+
+	QDataStream indexStream(&indexFile);
+	indexStream.setVersion(QDataStream::Qt_4_4);
+	indexStream << indexVersion;
+	QSet<QString> fileNames;
+
+	foreach (Playlist *playlist, playlists) {
+		QHash<Playlist *, PlaylistStoreEntry>::Iterator it = entries.find(playlist);
+
+		if (it == entries.end()) {
+			PlaylistStoreEntry entry;
+			entry.id = nextId++;
+			entry.loaded = true;
+			it = entries.insert(playlist, entry);
+		}
+
+		QString fileName = QString::number(it->id);
+		fileNames.insert(fileName);
+
+		// playlists which haven't been used can't have changed
+		if (it->loaded) {
+			QByteArray data = writeTracks(playlist);
+			size_t hash = qHash(data);
+
+			if ((hash != it->hash) || !QFile::exists(path + QLatin1Char('/') + fileName)) {
+				QSaveFile file(path + QLatin1Char('/') + fileName);
+
+				if (file.open(QIODevice::WriteOnly) && (file.write(data) == data.size()) &&
+				    file.commit()) {
+					it->hash = hash;
+				} else {
+					qCWarning(logPlaylist, "Cannot write file %s",
+						qPrintable(file.fileName()));
+				}
+			}
+		}
+
+		indexStream << it->id;
+		indexStream << playlist->title;
+		indexStream << playlist->url.url();
+	}
+
+	if (!indexFile.commit()) {
+		qCWarning(logPlaylist, "Cannot write file %s", qPrintable(indexFile.fileName()));
+		return;
+	}
+
+	// files of removed playlists
+
+	foreach (const QString &fileName, QDir(path).entryList(QDir::Files)) {
+		if ((fileName != QLatin1String("index")) && !fileNames.contains(fileName)) {
+			QFile::remove(path + QLatin1Char('/') + fileName);
+		}
+	}
+}
+
+bool PlaylistStore::readTracks(const QByteArray &data, Playlist *playlist)
+{
+	QDataStream stream(data);
+	stream.setVersion(QDataStream::Qt_4_4);
+	quint32 version;
+	stream >> version;
+
+	if (version != tracksVersion) {
+		return false;
+	}
+
+	QStringList strings;
+	quint32 count;
+	QVector<quint32> urls;
+	QVector<quint32> titles;
+	QVector<quint32> artists;
+	QVector<quint32> albums;
+	QVector<qint32> trackNumbers;
+	QVector<qint32> lengths;
+	QVector<quint32> subtitleCounts;
+	QVector<quint32> subtitles;
+	QVector<qint32> currentSubtitles;
+	stream >> strings;
+	stream >> count;
+	stream >> urls;
+	stream >> titles;
+	stream >> artists;
+	stream >> albums;
+	stream >> trackNumbers;
+	stream >> lengths;
+	stream >> subtitleCounts;
+	stream >> subtitles;
+	stream >> currentSubtitles;
+
+	if ((stream.status() != QDataStream::Ok) || (quint32(urls.size()) != count) ||
+	    (quint32(titles.size()) != count) || (quint32(artists.size()) != count) ||
+	    (quint32(albums.size()) != count) || (quint32(trackNumbers.size()) != count) ||
+	    (quint32(lengths.size()) != count) || (quint32(subtitleCounts.size()) != count) ||
+	    (quint32(currentSubtitles.size()) != count)) {
+		return false;
+	}
+
+	quint32 stringCount = strings.size();
+	int subtitleIndex = 0;
+	QList<PlaylistTrack> tracks;
+	tracks.reserve(count);
+
+	for (quint32 i = 0; i < count; ++i) {
+		if ((urls.at(i) >= stringCount) || (titles.at(i) >= stringCount) ||
+		    (artists.at(i) >= stringCount) || (albums.at(i) >= stringCount) ||
+		    (subtitleCounts.at(i) > quint32(subtitles.size() - subtitleIndex))) {
+			return false;
+		}
+
+		PlaylistTrack track;
+		track.url = strings.at(urls.at(i));
+		track.title = strings.at(titles.at(i));
+		track.artist = intern(strings.at(artists.at(i)));
+		track.album = intern(strings.at(albums.at(i)));
+		track.trackNumber = trackNumbers.at(i);
+
+		if (lengths.at(i) >= 0) {
+			track.length = QTime(0, 0, 0).addMSecs(lengths.at(i));
+		}
+
+		for (quint32 j = 0; j < subtitleCounts.at(i); ++j) {
+			quint32 subtitle = subtitles.at(subtitleIndex++);
+
+			if (subtitle >= stringCount) {
+				return false;
+			}
+
+			track.subtitles.append(QUrl(strings.at(subtitle)));
+		}
+
+		track.currentSubtitle = currentSubtitles.at(i);
+		tracks.append(track);
+	}
+
+	// nothing is appended if the data is corrupt
+	playlist->tracks.append(tracks);
+	return true;
+}
+
+class PlaylistStringTable
+{
+public:
+	PlaylistStringTable() { }
+	~PlaylistStringTable() { }
+
+	quint32 indexOf(const QString &string)
+	{
+		QHash<QString, quint32>::ConstIterator it = indexes.constFind(string);
+
+		if (it != indexes.constEnd()) {
+			return it.value();
+		}
+
+		quint32 index = strings.size();
+		indexes.insert(string, index);
+		strings.append(string);
+		return index;
+	}
+
+	QStringList strings;
+
+private:
+	QHash<QString, quint32> indexes;
+};
+
+QByteArray PlaylistStore::writeTracks(const Playlist *playlist) const
+{
+	PlaylistStringTable stringTable;
+	quint32 count = playlist->tracks.size();
+	QVector<quint32> urls;
+	QVector<quint32> titles;
+	QVector<quint32> artists;
+	QVector<quint32> albums;
+	QVector<qint32> trackNumbers;
+	QVector<qint32> lengths;
+	QVector<quint32> subtitleCounts;
+	QVector<quint32> subtitles;
+	QVector<qint32> currentSubtitles;
+	urls.reserve(count);
+	titles.reserve(count);
+	artists.reserve(count);
+	albums.reserve(count);
+	trackNumbers.reserve(count);
+	lengths.reserve(count);
+	subtitleCounts.reserve(count);
+	currentSubtitles.reserve(count);
+
+	foreach (const PlaylistTrack &track, playlist->tracks) {
+		urls.append(stringTable.indexOf(track.url.url()));
+		titles.append(stringTable.indexOf(track.title));
+		artists.append(stringTable.indexOf(track.artist));
+		albums.append(stringTable.indexOf(track.album));
+		trackNumbers.append(track.trackNumber);
+
+		if (track.length.isValid()) {
+			lengths.append(QTime(0, 0, 0).msecsTo(track.length));
+		} else {
+			lengths.append(-1);
+		}
+
+		subtitleCounts.append(track.subtitles.size());
+
+		foreach (const QUrl &subtitle, track.subtitles) {
+			subtitles.append(stringTable.indexOf(subtitle.url()));
+		}
+
+		currentSubtitles.append(track.currentSubtitle);
+	}
+
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_4_4);
+	stream << tracksVersion;
+	stream << stringTable.strings;
+	stream << count;
+	stream << urls;
+	stream << titles;
+	stream << artists;
+	stream << albums;
+	stream << trackNumbers;
+	stream << lengths;
+	stream << subtitleCounts;
+	stream << subtitles;
+	stream << currentSubtitles;
+	return data;
+}
+
+QString PlaylistStore::intern(const QString &string)
+{
+	QSet<QString>::ConstIterator it = internedStrings.constFind(string);
+
+	if (it != internedStrings.constEnd()) {
+		return *it;
+	}
+
+	internedStrings.insert(string);
+	return string;
+}
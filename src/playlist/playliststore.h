@@ -0,0 +1,77 @@
+/*
+ * playliststore.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PLAYLISTSTORE_H
+#define PLAYLISTSTORE_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+class Playlist;
+
+class PlaylistStoreEntry
+{
+public:
+	PlaylistStoreEntry() : id(0), loaded(false), hash(0) { }
+	~PlaylistStoreEntry() { }
+
+	quint32 id;
+	bool loaded; // whether the tracks have been read
+	size_t hash; // of the stored data
+};
+
+/*
+ * stores every playlist in its own file (playlists/<id>) and the titles in
+ * playlists/index; the tracks of a playlist are only read when the playlist
+ * is used and only playlists which have changed are written back
+ *
+ * a playlist file consists of a table of distinct strings followed by the
+ * track columns (indexes into the string table); repeated artists and
+ * albums are shared in memory as well
+ */
+
+class PlaylistStore
+{
+public:
+	PlaylistStore();
+	~PlaylistStore();
+
+	// returns false if there's no index (e.g. playlists in the old format)
+	bool readIndex(QList<Playlist *> &playlists);
+	void ensureLoaded(Playlist *playlist);
+	void remove(Playlist *playlist);
+
+	// playlists which aren't known yet are stored as well
+	void save(const QList<Playlist *> &playlists);
+
+private:
+	bool readTracks(const QByteArray &data, Playlist *playlist);
+	QByteArray writeTracks(const Playlist *playlist) const;
+	QString intern(const QString &string);
+
+	QString path;
+	QHash<Playlist *, PlaylistStoreEntry> entries;
+	QSet<QString> internedStrings;
+	quint32 nextId;
+};
+
+#endif /* PLAYLISTSTORE_H */
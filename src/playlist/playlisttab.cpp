@@ -26,6 +26,7 @@
 #include <QBoxLayout>
 #include <QFileDialog>
 #include <QKeyEvent>
+#include <QLabel>
 #include <QListView>
 #include <QMenu>
 #include <QSplitter>
@@ -37,15 +38,47 @@
 #  include <QRandomGenerator>
 #endif
 
+#include "../startupprofiler.h"
 #include "playlistmodel.h"
+#include "playliststore.h"
 #include "playlisttab.h"
 
 PlaylistBrowserModel::PlaylistBrowserModel(PlaylistModel *playlistModel_,
 	Playlist *temporaryPlaylist, QObject *parent) : QAbstractListModel(parent),
-	playlistModel(playlistModel_), currentPlaylist(-1)
+	playlistModel(playlistModel_), currentPlaylist(-1), loaded(false)
 {
 	playlists.append(temporaryPlaylist);
+	store = new PlaylistStore();
+}
+
+void PlaylistBrowserModel::load()
+{
+	if (loaded) {
+		return;
+	}
+
+	StartupProfiler::instance()->beginPhase(QLatin1String("Playlist archive"));
+	QList<Playlist *> storedPlaylists;
+
+	if (!store->readIndex(storedPlaylists)) {
+		// compatibility code
+		readPlaylists(storedPlaylists);
+	}
+
+	if (!storedPlaylists.isEmpty()) {
+		beginInsertRows(QModelIndex(), playlists.size(),
+			playlists.size() + storedPlaylists.size() - 1);
+		playlists.append(storedPlaylists);
+		endInsertRows();
+	}
 
+	loaded = true;
+	StartupProfiler::instance()->endPhase(QLatin1String("Playlist archive"));
+	emit playlistsLoaded();
+}
+
+void PlaylistBrowserModel::readPlaylists(QList<Playlist *> &storedPlaylists)
+{
 	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/playlistsK4"));
 
 	if (!file.open(QIODevice::ReadOnly)) {
@@ -121,51 +154,18 @@ PlaylistBrowserModel::PlaylistBrowserModel(PlaylistModel *playlistModel_,
 			break;
 		}
 
-		playlists.append(playlist);
+		storedPlaylists.append(playlist);
 	}
 }
 
 PlaylistBrowserModel::~PlaylistBrowserModel()
 {
-	QFile file(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/playlistsK4"));
-
-	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-		qCWarning(logPlaylist, "Cannot open file %s", qPrintable(file.fileName()));
-		return;
-	}
-
-	QDataStream stream(&file);
-	stream.setVersion(QDataStream::Qt_4_4);
-
-	int version = 0x361c4a3c;
-	stream << version;
-
-	for (int i = 1; i < playlists.size(); ++i) {
-		const Playlist *playlist = playlists.at(i);
-		stream << playlist->title;
-		stream << playlist->url.url();
-		stream << playlist->tracks.size();
-
-		foreach (const PlaylistTrack &track, playlist->tracks) {
-			stream << track.url.url();
-			stream << track.title;
-			stream << track.artist;
-			stream << track.album;
-			stream << track.trackNumber;
-			stream << track.length;
-
-			QStringList subtitleStrings;
-
-			for (int j = 0; j < track.subtitles.size(); ++j) {
-				const QUrl &url = track.subtitles.at(j);
-				subtitleStrings.append(url.url());
-			}
-
-			stream << subtitleStrings;
-			stream << track.currentSubtitle;
-		}
+	// don't overwrite the stored playlists if they haven't been read
+	if (loaded) {
+		store->save(playlists.mid(1));
 	}
 
+	delete store;
 	qDeleteAll(playlists);
 }
 
@@ -209,11 +209,14 @@ bool PlaylistBrowserModel::removeRows(int row, int count, const QModelIndex &par
 	Playlist *visiblePlaylist = playlistModel->getVisiblePlaylist();
 
 	for (int i = row; i < (row + count); ++i) {
+		playlistModel->cancelIngestion(playlists.at(i));
+		store->remove(playlists.at(i));
+
 		if (playlists.at(i) == visiblePlaylist) {
 			if ((row + count) < playlists.size()) {
-				playlistModel->setVisiblePlaylist(playlists.at(row + count));
+				playlistModel->setVisiblePlaylist(getPlaylist(row + count));
 			} else {
-				playlistModel->setVisiblePlaylist(playlists.at(row - 1));
+				playlistModel->setVisiblePlaylist(getPlaylist(row - 1));
 			}
 		}
 	}
@@ -265,9 +268,11 @@ void PlaylistBrowserModel::append(Playlist *playlist)
 	endInsertRows();
 }
 
-Playlist *PlaylistBrowserModel::getPlaylist(int row) const
+Playlist *PlaylistBrowserModel::getPlaylist(int row)
 {
-	return playlists.at(row);
+	Playlist *playlist = playlists.at(row);
+	store->ensureLoaded(playlist);
+	return playlist;
 }
 
 void PlaylistBrowserModel::setCurrentPlaylist(Playlist *playlist)
@@ -410,6 +415,13 @@ PlaylistTab::PlaylistTab(QMenu *menu, KActionCollection *collection, MediaWidget
 		new QAction(QIcon::fromTheme(QLatin1String("edit-delete"), QIcon(":edit-delete")), i18nc("@action", "Remove"), this);
 	collection->addAction(QLatin1String("playlist_remove_track"), removeTrackAction);
 
+	cancelIngestionAction = new QAction(QIcon::fromTheme(QLatin1String("dialog-cancel"), QIcon(":dialog-cancel")),
+		i18nc("@action", "Stop Adding"), this);
+	cancelIngestionAction->setVisible(false);
+	connect(cancelIngestionAction, SIGNAL(triggered(bool)), playlistModel, SLOT(cancelIngestion()));
+	connect(playlistModel, SIGNAL(ingestionProgress(int,bool)),
+		this, SLOT(ingestionProgress(int,bool)));
+
 	QAction *clearAction = new QAction(QIcon::fromTheme(QLatin1String("edit-clear-list"), QIcon(":edit-clear-list")),
 		i18nc("remove all items from a list", "Clear"), this);
 	connect(clearAction, SIGNAL(triggered(bool)), playlistModel, SLOT(clearVisiblePlaylist()));
@@ -492,6 +504,11 @@ PlaylistTab::PlaylistTab(QMenu *menu, KActionCollection *collection, MediaWidget
 		this, SLOT(playlistActivated(QModelIndex)));
 	sideLayout->addWidget(playlistBrowserView);
 
+	// the stored playlists are loaded after the main window is shown
+	playlistBrowserView->setEnabled(false);
+	connect(playlistBrowserModel, SIGNAL(playlistsLoaded()), this, SLOT(playlistsLoaded()));
+	QTimer::singleShot(0, playlistBrowserModel, SLOT(load()));
+
 	// KFileWidget creates a local event loop which can cause bad side
 	// effects (because the main window isn't fully constructed yet)
 	fileWidgetSplitter = verticalSplitter;
@@ -526,6 +543,15 @@ PlaylistTab::PlaylistTab(QMenu *menu, KActionCollection *collection, MediaWidget
 	boxLayout->addWidget(toolButton);
 
 	boxLayout->addStretch();
+
+	ingestionLabel = new QLabel(widget);
+	ingestionLabel->hide();
+	boxLayout->addWidget(ingestionLabel);
+
+	toolButton = new QToolButton(widget);
+	toolButton->setDefaultAction(cancelIngestionAction);
+	toolButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+	boxLayout->addWidget(toolButton);
 	sideLayout->addLayout(boxLayout);
 
 	playlistView = new PlaylistView(widget);
@@ -842,6 +868,18 @@ void PlaylistTab::updateTrackMetadata(const QMap<MediaWidget::MetadataType, QStr
 	playlistModel->updateTrackMetadata(playlistBrowserModel->getCurrentPlaylist(), metadata);
 }
 
+void PlaylistTab::playlistsLoaded()
+{
+	playlistBrowserView->setEnabled(true);
+}
+
+void PlaylistTab::ingestionProgress(int processedFiles, bool finished)
+{
+	ingestionLabel->setText(i18np("Adding %1 file", "Adding %1 files", processedFiles));
+	ingestionLabel->setVisible(!finished);
+	cancelIngestionAction->setVisible(!finished);
+}
+
 QString PlaylistTab::subtitleExtensionFilter()
 {
 	return QString(QLatin1String("*.asc *.smi *.srt *.ssa *.sub *.txt|")) +
@@ -25,10 +25,12 @@
 #include "../mediawidget.h"
 #include "../tabbase.h"
 
+class QLabel;
 class QSplitter;
 class Playlist;
 class PlaylistBrowserView;
 class PlaylistModel;
+class PlaylistStore;
 
 class PlaylistView : public QTreeView
 {
@@ -54,23 +56,36 @@ public:
 	~PlaylistBrowserModel();
 
 	void append(Playlist *playlist);
-	Playlist *getPlaylist(int row) const;
+	Playlist *getPlaylist(int row); // reads the tracks if necessary
 	void setCurrentPlaylist(Playlist *playlist);
 	Playlist *getCurrentPlaylist() const;
 	bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
 
+	bool isLoaded() const
+	{
+		return loaded;
+	}
+
+public slots:
+	// reads the stored playlists; called after the main window is shown
+	void load();
+
 signals:
 	void playTrack(Playlist *playlist, int track);
+	void playlistsLoaded();
 
 private:
+	void readPlaylists(QList<Playlist *> &storedPlaylists);
 	int rowCount(const QModelIndex &parent) const override;
 	QVariant data(const QModelIndex &index, int role) const override;
 	Qt::ItemFlags flags(const QModelIndex &index) const override;
 	bool setData(const QModelIndex &index, const QVariant &value, int role) override;
 
 	PlaylistModel *playlistModel;
+	PlaylistStore *store;
 	QList<Playlist *> playlists;
 	int currentPlaylist;
+	bool loaded;
 };
 
 class PlaylistTab : public TabBase
@@ -109,6 +124,8 @@ private slots:
 	void appendPlaylist(Playlist *playlist, bool playImmediately);
 	void updateTrackLength(int length);
 	void updateTrackMetadata(const QMap<MediaWidget::MetadataType, QString> &metadata);
+	void playlistsLoaded();
+	void ingestionProgress(int processedFiles, bool finished);
 
 private:
 	static QString subtitleExtensionFilter(); // usable for KFileDialog::setFilter()
@@ -124,6 +141,8 @@ private:
 	PlaylistView *playlistView;
 	QAction *randomAction;
 	QAction *repeatAction;
+	QAction *cancelIngestionAction;
+	QLabel *ingestionLabel;
 };
 
 #endif /* PLAYLISTTAB_H */
@@ -19,18 +19,297 @@
  */
 
 #include "log.h"
+#include "metrics.h"
 
 #include <KMessageBox>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QSqlError>
+#include <QSqlQuery>
 #include <QStandardPaths>
+#include <QThread>
+#include <QWaitCondition>
 
 #include "sqlhelper.h"
 #include "sqlinterface.h"
+#include "tracing.h"
+
+// SQLite's default limit of host parameters per statement
+static const int maxSqlParameters = 999;
+
+/*
+ * executes the submitted batches on its own connection, so that a slow
+ * file system (sd card, nfs home) doesn't block the event loop; batches
+ * which arrive while a transaction is running are merged into the next one
+ */
+
+class SqlWriter : public QThread
+{
+public:
+	explicit SqlWriter(const QString &databaseName_);
+	~SqlWriter();
+
+	void submit(const QList<SqlTableBatch> &batches);
+	void waitForIdle();
+	void stop();
+
+private:
+	void run() override;
+	void writeBatch(const SqlTableBatch &batch);
+	QSqlQuery &prepare(const QString &statement);
+	bool exec(QSqlQuery &query);
+	bool exec(const QString &statement);
+
+	QString databaseName;
+	QSqlDatabase database;
+	QHash<QString, QSqlQuery> preparedQueries;
+	QMutex mutex;
+	QWaitCondition condition;
+	QWaitCondition idleCondition;
+	QList<SqlTableBatch> pendingBatches;
+	bool busy;
+	bool stopping;
+	MetricsHistogram *commitDurationHistogram;
+	MetricsCounter *transactionsCounter;
+};
+
+SqlWriter::SqlWriter(const QString &databaseName_) : databaseName(databaseName_), busy(false),
+	stopping(false)
+{
+	setObjectName(QLatin1String("SqlWriter"));
+	commitDurationHistogram = Metrics::instance()->histogram(
+		QLatin1String("kaffeine_sql_commit_duration_ms"),
+		QLatin1String("Time between begin and commit of a database transaction"),
+		QList<qint64>() << 1 << 5 << 20 << 100 << 500 << 2000 << 10000);
+	transactionsCounter = Metrics::instance()->counter(
+		QLatin1String("kaffeine_sql_transactions_total"),
+		QLatin1String("Database transactions committed"));
+}
+
+SqlWriter::~SqlWriter()
+{
+	stop();
+}
+
+void SqlWriter::submit(const QList<SqlTableBatch> &batches)
+{
+	QMutexLocker locker(&mutex);
+	pendingBatches.append(batches);
+	condition.wakeOne();
+}
+
+void SqlWriter::waitForIdle()
+{
+	QMutexLocker locker(&mutex);
+
+	while ((!pendingBatches.isEmpty() || busy) && isRunning()) {
+		idleCondition.wait(&mutex);
+	}
+}
+
+void SqlWriter::stop()
+{
+	mutex.lock();
+	stopping = true;
+	condition.wakeOne();
+	mutex.unlock();
+	wait();
+}
+
+void SqlWriter::run()
+{
+	QString connectionName = QLatin1String("kaffeine-writer");
+
+	{
+		database = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), connectionName);
+		database.setDatabaseName(databaseName);
+		database.setConnectOptions(QLatin1String("QSQLITE_BUSY_TIMEOUT=10000"));
+
+		if (database.open()) {
+			exec(QLatin1String("PRAGMA journal_mode=WAL"));
+			exec(QLatin1String("PRAGMA synchronous=NORMAL"));
+		} else {
+			qCWarning(logSql, "Cannot open the database for writing '%s'",
+				qPrintable(database.lastError().text()));
+		}
+
+		QList<SqlTableBatch> batches;
+
+		while (true) {
+			mutex.lock();
+			busy = false;
+			idleCondition.wakeAll();
+
+			while (pendingBatches.isEmpty() && !stopping) {
+				condition.wait(&mutex);
+			}
+
+			if (pendingBatches.isEmpty()) {
+				mutex.unlock();
+				break;
+			}
+
+			batches.swap(pendingBatches);
+			busy = true;
+			mutex.unlock();
+
+			if (!database.isOpen()) {
+				qCWarning(logSql, "Discarding %d batches", int(batches.size()));
+				batches.clear();
+				continue;
+			}
+
+			QElapsedTimer elapsedTimer;
+			elapsedTimer.start();
+			exec(QLatin1String("BEGIN"));
+
+			foreach (const SqlTableBatch &batch, batches) {
+				writeBatch(batch);
+			}
+
+			exec(QLatin1String("COMMIT"));
+			qint64 duration = elapsedTimer.elapsed();
+			commitDurationHistogram->observe(duration);
+			transactionsCounter->increment();
+			qCDebug(logSql, "Committed %d batches in %lld ms", int(batches.size()), duration);
+			batches.clear();
+		}
+
+		preparedQueries.clear();
+		database.close();
+		database = QSqlDatabase();
+	}
+
+	QSqlDatabase::removeDatabase(connectionName);
+}
+
+void SqlWriter::writeBatch(const SqlTableBatch &batch)
+{
+	if (!batch.createStatement.isEmpty()) {
+		exec(batch.createStatement);
+	}
+
+	// only Id is unique, so deleting first and inserting afterwards is
+	// equivalent to the per-row order (RemoveAndInsert)
+
+	for (int i = 0; i < batch.removedKeys.size(); i += maxSqlParameters) {
+		int count = qMin(maxSqlParameters, int(batch.removedKeys.size()) - i);
+		QString statement = QLatin1String("DELETE FROM ") + batch.tableName +
+			QLatin1String(" WHERE Id IN (?");
+
+		for (int j = 1; j < count; ++j) {
+			statement.append(QLatin1String(", ?"));
+		}
+
+		statement.append(QLatin1Char(')'));
+		QSqlQuery &query = prepare(statement);
+
+		for (int j = 0; j < count; ++j) {
+			query.bindValue(j, batch.removedKeys.at(i + j));
+		}
+
+		exec(query);
+	}
+
+	int rowSize = (batch.columnNames.size() + 1);
+	QString rowPlaceholders = QLatin1String("(?");
+
+	for (int i = 1; i < rowSize; ++i) {
+		rowPlaceholders.append(QLatin1String(", ?"));
+	}
+
+	rowPlaceholders.append(QLatin1Char(')'));
+	int maxRows = qMax(1, maxSqlParameters / rowSize);
+
+	for (int i = 0; i < batch.insertedRows.size(); i += maxRows) {
+		int count = qMin(maxRows, int(batch.insertedRows.size()) - i);
+		QString statement = QLatin1String("INSERT INTO ") + batch.tableName +
+			QLatin1String(" (Id, ") + batch.columnNames.join(QLatin1String(", ")) +
+			QLatin1String(") VALUES ") + rowPlaceholders;
+
+		for (int j = 1; j < count; ++j) {
+			statement.append(QLatin1String(", "));
+			statement.append(rowPlaceholders);
+		}
+
+		QSqlQuery &query = prepare(statement);
+		int index = 0;
+
+		for (int j = 0; j < count; ++j) {
+			foreach (const QVariant &value, batch.insertedRows.at(i + j)) {
+				query.bindValue(index++, value);
+			}
+		}
+
+		exec(query);
+	}
+
+	if (!batch.updatedRows.isEmpty()) {
+		QString statement = QLatin1String("UPDATE ") + batch.tableName +
+			QLatin1String(" SET ") + batch.columnNames.join(QLatin1String(" = ?, ")) +
+			QLatin1String(" = ? WHERE Id = ?");
+		QSqlQuery &query = prepare(statement);
+
+		foreach (const QVariantList &row, batch.updatedRows) {
+			for (int i = 1; i < row.size(); ++i) {
+				query.bindValue(i - 1, row.at(i));
+			}
+
+			query.bindValue(row.size() - 1, row.at(0));
+			exec(query);
+		}
+	}
+}
+
+QSqlQuery &SqlWriter::prepare(const QString &statement)
+{
+	QHash<QString, QSqlQuery>::Iterator it = preparedQueries.find(statement);
+
+	if (it == preparedQueries.end()) {
+		QSqlQuery query(database);
+		query.setForwardOnly(true);
+
+		if (!query.prepare(statement)) {
+			qCWarning(logSql, "Error while preparing statement '%s'", qPrintable(query.lastError().text()));
+		}
+
+		it = preparedQueries.insert(statement, query);
+	}
+
+	return *it;
+}
+
+bool SqlWriter::exec(QSqlQuery &query)
+{
+	if (!query.exec()) {
+		qCWarning(logSql, "Error while executing statement '%s'", qPrintable(query.lastError().text()));
+		return false;
+	}
+
+	return true;
+}
+
+bool SqlWriter::exec(const QString &statement)
+{
+	QSqlQuery query(database);
+	query.setForwardOnly(true);
+
+	if (!query.exec(statement)) {
+		qCWarning(logSql, "Error while executing statement '%s'", qPrintable(query.lastError().text()));
+		return false;
+	}
+
+	return true;
+}
 
 SqlHelper::SqlHelper()
 {
+	QString databaseName = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/sqlite.db");
 	database = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), QLatin1String("kaffeine"));
-	database.setDatabaseName(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QLatin1String("/sqlite.db"));
+	database.setDatabaseName(databaseName);
+	database.setConnectOptions(QLatin1String("QSQLITE_BUSY_TIMEOUT=10000"));
+	writer = new SqlWriter(databaseName);
 
 	timer.setInterval(5000);
 	connect(&timer, SIGNAL(timeout()), this, SLOT(collectSubmissions()));
@@ -38,6 +317,9 @@ SqlHelper::SqlHelper()
 
 SqlHelper::~SqlHelper()
 {
+	collectSubmissions();
+	// commits the remaining batches
+	delete writer;
 }
 
 bool SqlHelper::createInstance()
@@ -66,6 +348,11 @@ bool SqlHelper::createInstance()
 		return false;
 	}
 
+	// the journal mode is persistent; it has to be switched before the
+	// writer thread opens its connection
+	instance->exec(QLatin1String("PRAGMA journal_mode=WAL"));
+	instance->exec(QLatin1String("PRAGMA synchronous=NORMAL"));
+	instance->writer->start();
 	return true;
 }
 
@@ -74,16 +361,10 @@ SqlHelper *SqlHelper::getInstance()
 	return instance;
 }
 
-QSqlQuery SqlHelper::prepare(const QString &statement)
+void SqlHelper::deleteInstance()
 {
-	QSqlQuery query(database);
-	query.setForwardOnly(true);
-
-	if (!query.prepare(statement)) {
-		qCWarning(logSql, "Error while preparing statement '%s'", qPrintable(query.lastError().text()));
-	}
-
-	return query;
+	delete instance;
+	instance = NULL;
 }
 
 QSqlQuery SqlHelper::exec(const QString &statement)
@@ -98,13 +379,6 @@ QSqlQuery SqlHelper::exec(const QString &statement)
 	return query;
 }
 
-void SqlHelper::exec(QSqlQuery &query)
-{
-	if (!query.exec()) {
-		qCWarning(logSql, "Error while executing statement '%s'", qPrintable(query.lastError().text()));
-	}
-}
-
 void SqlHelper::requestSubmission(SqlInterface *object)
 {
 	if (!timer.isActive()) {
@@ -114,17 +388,26 @@ void SqlHelper::requestSubmission(SqlInterface *object)
 	objects.append(object);
 }
 
+void SqlHelper::waitForWriter()
+{
+	writer->waitForIdle();
+}
+
 void SqlHelper::collectSubmissions()
 {
-	exec(QLatin1String("BEGIN"));
+	KAFFEINE_TRACE_SCOPE("SqlHelper::collectSubmissions");
+	QList<SqlTableBatch> batches;
 
 	for (int i = 0; i < objects.size(); ++i) {
-		objects.at(i)->sqlSubmit();
+		batches.append(objects.at(i)->sqlSubmit());
 	}
 
-	exec(QLatin1String("COMMIT"));
 	timer.stop();
 	objects.clear();
+
+	if (!batches.isEmpty()) {
+		writer->submit(batches);
+	}
 }
 
 SqlHelper *SqlHelper::instance = NULL;
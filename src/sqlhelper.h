@@ -23,9 +23,31 @@
 
 #include <QSharedData>
 #include <QSqlDatabase>
+#include <QStringList>
 #include <QTimer>
+#include <QVariant>
 
 class SqlInterface;
+class SqlWriter;
+
+/*
+ * snapshot of the pending statements of one table; it only contains plain
+ * values, so that it can be handed over to the writer thread
+ */
+
+class SqlTableBatch
+{
+public:
+	SqlTableBatch() { }
+	~SqlTableBatch() { }
+
+	QString tableName;
+	QStringList columnNames;
+	QString createStatement; // empty if the table already exists
+	QList<quint32> removedKeys;
+	QList<QVariantList> insertedRows; // Id followed by the column values
+	QList<QVariantList> updatedRows; // Id followed by the column values
+};
 
 class SqlHelper : public QObject, public QSharedData
 {
@@ -37,14 +59,19 @@ public:
 
 	static bool createInstance();
 	static SqlHelper *getInstance();
+	// commits the remaining batches; must be called after all sql models are gone
+	static void deleteInstance();
 
-	QSqlQuery prepare(const QString &statement);
+	// only used for reading the tables at startup
 	QSqlQuery exec(const QString &statement);
-	void exec(QSqlQuery &query);
 
 	void requestSubmission(SqlInterface *object);
 
+	// waits until the writer thread has committed everything
+	void waitForWriter();
+
 public slots:
+	// doesn't block; the statements are executed by the writer thread
 	void collectSubmissions();
 
 private:
@@ -53,6 +80,7 @@ private:
 	QSqlDatabase database;
 	QTimer timer;
 	QList<SqlInterface *> objects;
+	SqlWriter *writer;
 };
 
 #endif /* SQLHELPER_H */
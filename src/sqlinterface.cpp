@@ -19,6 +19,7 @@
  */
 
 #include "log.h"
+#include "metrics.h"
 
 #include <QAbstractItemModel>
 #include <QStringList>
@@ -26,10 +27,17 @@
 #include "sqlhelper.h"
 #include "sqlinterface.h"
 
-SqlInterface::SqlInterface() : createTable(false), hasPendingStatements(false),
-	sqlColumnCount(0)
+SqlInterface::SqlInterface() : createTable(false), hasPendingStatements(false)
 {
 	sqlHelper = SqlHelper::getInstance();
+
+	// shared between all tables
+	pendingStatementsGauge = Metrics::instance()->gauge(
+		QLatin1String("kaffeine_sql_pending_statements"),
+		QLatin1String("Database statements waiting to be submitted"));
+	submittedStatementsCounter = Metrics::instance()->counter(
+		QLatin1String("kaffeine_sql_statements_total"),
+		QLatin1String("Database statements submitted"));
 }
 
 SqlInterface::~SqlInterface()
@@ -37,6 +45,7 @@ SqlInterface::~SqlInterface()
 	if (hasPendingStatements) {
 		qCWarning(logSql, "Pending statements at destruction");
 		/* data isn't valid anymore */
+		pendingStatementsGauge->add(-pendingStatements.size());
 		pendingStatements.clear();
 		createTable = false;
 		/* make sure we don't get called after destruction */
@@ -51,54 +60,27 @@ void SqlInterface::sqlFlush()
 	}
 }
 
+void SqlInterface::sqlSync()
+{
+	sqlFlush();
+	sqlHelper->waitForWriter();
+}
+
 void SqlInterface::sqlInit(const QString &tableName, const QStringList &columnNames)
 {
 	QString existsStatement = QLatin1String("SELECT name FROM sqlite_master WHERE name='") + tableName +
 		QLatin1String("' AND type = 'table'");
-	createStatement = QLatin1String("CREATE TABLE ") + tableName + QLatin1String(" (Id INTEGER PRIMARY KEY, ");
-	QString selectStatement = QLatin1String("SELECT Id, ");
-	insertStatement = QLatin1String("INSERT INTO ") + tableName + QLatin1String(" (Id, ");
-	updateStatement = QLatin1String("UPDATE ") + tableName + QLatin1String(" SET ");
-	deleteStatement = QLatin1String("DELETE FROM ") + tableName + QLatin1String(" WHERE Id = ?");
-
-	sqlColumnCount = columnNames.size();
-
-	for (int i = 0; i < sqlColumnCount; ++i) {
-		if (i > 0) {
-			createStatement.append(QLatin1String(", "));
-			selectStatement.append(QLatin1String(", "));
-			insertStatement.append(QLatin1String(", "));
-			updateStatement.append(QLatin1String(" = ?, "));
-		}
-
-		const QString &columnName = columnNames.at(i);
-		createStatement.append(columnName);
-		selectStatement.append(columnName);
-		insertStatement.append(columnName);
-		updateStatement.append(columnName);
-	}
-
-	createStatement.append(QLatin1Char(')'));
-	selectStatement.append(QLatin1String(" FROM "));
-	selectStatement.append(tableName);
-	insertStatement.append(QLatin1String(") VALUES (?"));
-	updateStatement.append(QLatin1String(" = ? WHERE Id = ?"));
-
-	for (int i = 0; i < sqlColumnCount; ++i) {
-		insertStatement.append(QLatin1String(", ?"));
-	}
-
-	insertStatement.append(QLatin1Char(')'));
+	createStatement = QLatin1String("CREATE TABLE ") + tableName + QLatin1String(" (Id INTEGER PRIMARY KEY, ") +
+		columnNames.join(QLatin1String(", ")) + QLatin1Char(')');
+	QString selectStatement = QLatin1String("SELECT Id, ") + columnNames.join(QLatin1String(", ")) +
+		QLatin1String(" FROM ") + tableName;
+	sqlTableName = tableName;
+	sqlColumnNames = columnNames;
 
 	if (!sqlHelper->exec(existsStatement).next()) {
 		createTable = true;
 		requestSubmission();
 	} else {
-		// queries can only be prepared if the table exists
-		insertQuery = sqlHelper->prepare(insertStatement);
-		updateQuery = sqlHelper->prepare(updateStatement);
-		deleteQuery = sqlHelper->prepare(deleteStatement);
-
 		for (QSqlQuery query = sqlHelper->exec(selectStatement); query.next();) {
 			qint64 fullKey = query.value(0).toLongLong();
 			SqlKey sqlKey(static_cast<int>(fullKey));
@@ -110,6 +92,7 @@ void SqlInterface::sqlInit(const QString &tableName, const QStringList &columnNa
 
 			if (!insertFromSqlQuery(sqlKey, query, 1)) {
 				pendingStatements.insert(sqlKey, Remove);
+				pendingStatementsGauge->add(1);
 				requestSubmission();
 			}
 		}
@@ -123,6 +106,7 @@ void SqlInterface::sqlInsert(SqlKey key)
 	switch (pendingStatement) {
 	case Nothing:
 		pendingStatements.insert(key, Insert);
+		pendingStatementsGauge->add(1);
 		requestSubmission();
 		return;
 	case Remove:
@@ -145,6 +129,7 @@ void SqlInterface::sqlUpdate(SqlKey key)
 	switch (pendingStatement) {
 	case Nothing:
 		pendingStatements.insert(key, Update);
+		pendingStatementsGauge->add(1);
 		requestSubmission();
 		return;
 	case RemoveAndInsert:
@@ -166,11 +151,16 @@ void SqlInterface::sqlRemove(SqlKey key)
 	case Nothing:
 	case RemoveAndInsert:
 	case Update:
+		if (pendingStatement == Nothing) {
+			pendingStatementsGauge->add(1);
+		}
+
 		pendingStatements.insert(key, Remove);
 		requestSubmission();
 		return;
 	case Insert:
 		pendingStatements.remove(key);
+		pendingStatementsGauge->add(-1);
 		return;
 	case Remove:
 		break;
@@ -187,48 +177,55 @@ void SqlInterface::requestSubmission()
 	}
 }
 
-void SqlInterface::sqlSubmit()
+SqlTableBatch SqlInterface::sqlSubmit()
 {
+	SqlTableBatch batch;
+	batch.tableName = sqlTableName;
+	batch.columnNames = sqlColumnNames;
+
 	if (createTable) {
 		createTable = false;
-		sqlHelper->exec(createStatement);
-
-		// queries can only be prepared if the table exists
-		insertQuery = sqlHelper->prepare(insertStatement);
-		updateQuery = sqlHelper->prepare(updateStatement);
-		deleteQuery = sqlHelper->prepare(deleteStatement);
+		batch.createStatement = createStatement;
 	}
 
 	for (QMap<SqlKey, PendingStatement>::ConstIterator it = pendingStatements.constBegin();
 	     it != pendingStatements.constEnd(); ++it) {
 		PendingStatement pendingStatement = it.value();
+		QVariantList row;
 
 		switch (pendingStatement) {
 		case Nothing:
 			break;
 		case RemoveAndInsert:
-			deleteQuery.bindValue(0, it.key().sqlKey);
-			sqlHelper->exec(deleteQuery);
+			batch.removedKeys.append(it.key().sqlKey);
 			// fall through
 		case Insert:
-			bindToSqlQuery(it.key(), insertQuery, 1);
-			insertQuery.bindValue(0, it.key().sqlKey);
-			sqlHelper->exec(insertQuery);
-			continue;
 		case Update:
-			bindToSqlQuery(it.key(), updateQuery, 0);
-			updateQuery.bindValue(sqlColumnCount, it.key().sqlKey);
-			sqlHelper->exec(updateQuery);
+			row.append(it.key().sqlKey);
+			appendSqlValues(it.key(), row);
+
+			if (row.size() != (sqlColumnNames.size() + 1)) {
+				continue;
+			}
+
+			if (pendingStatement == Update) {
+				batch.updatedRows.append(row);
+			} else {
+				batch.insertedRows.append(row);
+			}
+
 			continue;
 		case Remove:
-			deleteQuery.bindValue(0, it.key().sqlKey);
-			sqlHelper->exec(deleteQuery);
+			batch.removedKeys.append(it.key().sqlKey);
 			continue;
 		}
 
 		qCWarning(logSql, "Invalid pending statement %d", pendingStatement);
 	}
 
+	pendingStatementsGauge->add(-pendingStatements.size());
+	submittedStatementsCounter->increment(pendingStatements.size());
 	pendingStatements.clear();
 	hasPendingStatements = false;
+	return batch;
 }
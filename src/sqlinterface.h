@@ -24,12 +24,17 @@
 #include <QExplicitlySharedDataPointer>
 #include <QMap>
 #include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
 
 #if QT_VERSION >= 0x050a00
 #  include <QRandomGenerator>
 #endif
 
+class MetricsCounter;
+class MetricsGauge;
 class SqlHelper;
+class SqlTableBatch;
 
 class SqlKey
 {
@@ -77,10 +82,13 @@ public:
 	void sqlInsert(SqlKey key);
 	void sqlUpdate(SqlKey key);
 	void sqlRemove(SqlKey key);
+	// hands the pending statements over to the writer thread
 	void sqlFlush();
+	// like sqlFlush(), but waits until the statements are committed
+	void sqlSync();
 
 	/* for SqlHelper */
-	void sqlSubmit();
+	SqlTableBatch sqlSubmit();
 
 	template<class Container> SqlKey sqlFindFreeKey(const Container &container) const
 	{
@@ -103,7 +111,8 @@ public:
 	}
 
 protected:
-	virtual void bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index) const = 0;
+	// appends the column values in the order passed to sqlInit()
+	virtual void appendSqlValues(SqlKey sqlKey, QVariantList &values) const = 0;
 	virtual bool insertFromSqlQuery(SqlKey sqlKey, const QSqlQuery &query, int index) = 0;
 
 private:
@@ -121,15 +130,12 @@ private:
 	QMap<SqlKey, PendingStatement> pendingStatements;
 	bool createTable;
 	bool hasPendingStatements;
+	MetricsGauge *pendingStatementsGauge;
+	MetricsCounter *submittedStatementsCounter;
 
-	int sqlColumnCount;
+	QString sqlTableName;
+	QStringList sqlColumnNames;
 	QString createStatement;
-	QString insertStatement;
-	QString updateStatement;
-	QString deleteStatement;
-	QSqlQuery insertQuery;
-	QSqlQuery updateQuery;
-	QSqlQuery deleteQuery;
 };
 
 #endif /* SQLINTERFACE_H */
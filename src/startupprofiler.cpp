@@ -0,0 +1,120 @@
+/*
+ * startupprofiler.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "log.h"
+
+#include "startupprofiler.h"
+
+StartupProfiler::StartupProfiler() : windowShownTime(-1), enabled(false), reported(false)
+{
+	timer.start();
+}
+
+StartupProfiler::~StartupProfiler()
+{
+}
+
+StartupProfiler *StartupProfiler::instance()
+{
+	static StartupProfiler startupProfiler;
+	return &startupProfiler;
+}
+
+void StartupProfiler::setEnabled(bool enabled_)
+{
+	// phases are always recorded, because some of them end before the
+	// command line has been parsed
+	enabled = enabled_;
+}
+
+void StartupProfiler::beginPhase(const QString &name)
+{
+	if (reported) {
+		return;
+	}
+
+	Phase phase;
+	phase.name = name;
+	phase.begin = timer.elapsed();
+	phases.append(phase);
+}
+
+void StartupProfiler::endPhase(const QString &name)
+{
+	if (reported) {
+		return;
+	}
+
+	for (int i = (phases.size() - 1); i >= 0; --i) {
+		Phase &phase = phases[i];
+
+		if ((phase.end < 0) && (phase.name == name)) {
+			phase.end = timer.elapsed();
+			report();
+			return;
+		}
+	}
+
+	qCWarning(logConfig, "Startup phase '%s' wasn't started", qPrintable(name));
+}
+
+void StartupProfiler::windowShown()
+{
+	if (windowShownTime < 0) {
+		windowShownTime = timer.elapsed();
+		report();
+	}
+}
+
+void StartupProfiler::report()
+{
+	if (reported || (windowShownTime < 0)) {
+		return;
+	}
+
+	qint64 readyTime = windowShownTime;
+
+	foreach (const Phase &phase, phases) {
+		if (phase.end < 0) {
+			return;
+		}
+
+		readyTime = qMax(readyTime, phase.end);
+	}
+
+	reported = true;
+
+	if (!enabled) {
+		phases.clear();
+		return;
+	}
+
+	qCInfo(logConfig, "Startup profile (ms since the start of kaffeine):");
+
+	foreach (const Phase &phase, phases) {
+		qCInfo(logConfig, "  %-32s %6lld .. %6lld  %6lld ms%s", qPrintable(phase.name),
+			phase.begin, phase.end, phase.end - phase.begin,
+			(phase.end > windowShownTime) ? "  (after the window was shown)" : "");
+	}
+
+	qCInfo(logConfig, "  window shown after %lld ms, all subsystems ready after %lld ms",
+		windowShownTime, readyTime);
+	phases.clear();
+}
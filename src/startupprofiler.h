@@ -0,0 +1,70 @@
+/*
+ * startupprofiler.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+/*
+ * records how long each initialisation phase takes (--profile-startup);
+ * phases may end after the window has been shown (deferred loading), so
+ * the profile is logged once the window is shown and no phase is running;
+ * must only be used from the main thread
+ */
+
+class StartupProfiler
+{
+private:
+	StartupProfiler();
+	~StartupProfiler();
+
+public:
+	static StartupProfiler *instance();
+
+	void setEnabled(bool enabled_);
+	void beginPhase(const QString &name);
+	void endPhase(const QString &name);
+	void windowShown();
+
+private:
+	class Phase
+	{
+	public:
+		Phase() : begin(0), end(-1) { }
+		~Phase() { }
+
+		QString name;
+		qint64 begin;
+		qint64 end; // -1 = running
+	};
+
+	void report();
+
+	QElapsedTimer timer;
+	QList<Phase> phases;
+	qint64 windowShownTime; // -1 = not yet
+	bool enabled;
+	bool reported;
+};
+
+#endif /* STARTUPPROFILER_H */
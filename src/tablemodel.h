@@ -22,6 +22,10 @@
 #define TABLEMODEL_H
 
 #include <QAbstractTableModel>
+#include <algorithm>
+#include <iterator>
+#include "chunkedlist.h"
+#include "tracing.h"
 
 template<class T> class TableModel : public QAbstractTableModel
 {
@@ -84,37 +88,41 @@ public:
 protected:
 	template<class U> void reset(const U &container)
 	{
+		KAFFEINE_TRACE_SCOPE("TableModel::reset");
 		beginLayoutChange();
-		items.clear();
+		QList<ItemType> newItems;
 
 		for (typename U::ConstIterator it = container.constBegin();
 		     it != container.constEnd(); ++it) {
 			const ItemType &item = *it;
 
 			if (helper.filterAcceptsItem(item)) {
-				items.append(item);
+				newItems.append(item);
 			}
 		}
 
-		std::sort(items.begin(), items.end(), lessThan);
+		std::sort(newItems.begin(), newItems.end(), lessThan);
+		items.assign(newItems);
 		endLayoutChange();
 	}
 
 	template<class U> void resetFromKeys(const U &container)
 	{
+		KAFFEINE_TRACE_SCOPE("TableModel::resetFromKeys");
 		beginLayoutChange();
-		items.clear();
+		QList<ItemType> newItems;
 
 		for (typename U::ConstIterator it = container.constBegin();
 		     it != container.constEnd(); ++it) {
 			const ItemType &item = it.key();
 
 			if (helper.filterAcceptsItem(item)) {
-				items.append(item);
+				newItems.append(item);
 			}
 		}
 
-		std::sort(items.begin(), items.end(), lessThan);
+		std::sort(newItems.begin(), newItems.end(), lessThan);
+		items.assign(newItems);
 		endLayoutChange();
 	}
 
@@ -128,6 +136,67 @@ protected:
 		}
 	}
 
+	// inserts the whole batch as a few row ranges instead of row by row
+	template<class U> void insertItems(const U &container)
+	{
+		KAFFEINE_TRACE_SCOPE("TableModel::insertItems");
+		QList<ItemType> newItems;
+
+		for (typename U::ConstIterator it = container.constBegin();
+		     it != container.constEnd(); ++it) {
+			const ItemType &item = *it;
+
+			if (item.isValid() && helper.filterAcceptsItem(item)) {
+				newItems.append(item);
+			}
+		}
+
+		if (newItems.isEmpty()) {
+			return;
+		}
+
+		std::stable_sort(newItems.begin(), newItems.end(), lessThan);
+
+		// the new items which go to the same row form one contiguous range
+		QList<int> rows;
+		QList<int> ends; // index after the last new item of the range
+
+		for (int i = 0; i < newItems.size(); ++i) {
+			int row = upperBound(newItems.at(i));
+
+			if (rows.isEmpty() || (rows.last() != row)) {
+				rows.append(row);
+				ends.append(i + 1);
+			} else {
+				ends.last() = (i + 1);
+			}
+		}
+
+		if (rows.size() > MaxInsertRanges) {
+			// cheaper for the views than many separate insertions; unlike a
+			// model reset, this keeps the selection and the scroll position
+			beginLayoutChange();
+			QList<ItemType> oldItems = items.toList();
+			QList<ItemType> mergedItems;
+			mergedItems.reserve(oldItems.size() + newItems.size());
+			std::merge(oldItems.constBegin(), oldItems.constEnd(),
+				newItems.constBegin(), newItems.constEnd(),
+				std::back_inserter(mergedItems), lessThan);
+			items.assign(mergedItems);
+			endLayoutChange();
+			return;
+		}
+
+		// starting at the end, so that the rows of the other ranges stay valid
+		for (int i = rows.size() - 1; i >= 0; --i) {
+			int begin = ((i > 0) ? ends.at(i - 1) : 0);
+			int row = rows.at(i);
+			beginInsertRows(QModelIndex(), row, row + ends.at(i) - begin - 1);
+			items.insert(row, newItems.mid(begin, ends.at(i) - begin));
+			endInsertRows();
+		}
+	}
+
 	void aboutToUpdate(const ItemType &item)
 	{
 		updatingRow = -1;
@@ -185,27 +254,74 @@ protected:
 		}
 	}
 
+	template<class U> void removeItems(const U &container)
+	{
+		QList<int> rows;
+
+		for (typename U::ConstIterator it = container.constBegin();
+		     it != container.constEnd(); ++it) {
+			const ItemType &item = *it;
+
+			if (!item.isValid()) {
+				continue;
+			}
+
+			// items which compare equal may be adjacent; look for the exact one
+			for (int row = binaryFind(item);
+			     (row < items.size()) && !lessThan(item, items.at(row)); ++row) {
+				if (items.at(row) == item) {
+					rows.append(row);
+					break;
+				}
+			}
+		}
+
+		std::sort(rows.begin(), rows.end());
+
+		// remove contiguous ranges, starting at the end
+		int index = rows.size() - 1;
+
+		while (index >= 0) {
+			int lastRow = rows.at(index);
+			int firstRow = lastRow;
+
+			while ((index > 0) && (rows.at(index - 1) == (firstRow - 1))) {
+				--index;
+				--firstRow;
+			}
+
+			--index;
+			beginRemoveRows(QModelIndex(), firstRow, lastRow);
+			items.remove(firstRow, lastRow - firstRow + 1);
+			endRemoveRows();
+		}
+	}
+
 	void internalSort(SortOrder sortOrder)
 	{
 		if (lessThan.getSortOrder() != sortOrder) {
 			beginLayoutChange();
 			lessThan.setSortOrder(sortOrder);
-			std::sort(items.begin(), items.end(), lessThan);
+			QList<ItemType> sortedItems = items.toList();
+			std::sort(sortedItems.begin(), sortedItems.end(), lessThan);
+			items.assign(sortedItems);
 			endLayoutChange();
 		}
 	}
 
 private:
+	// insertItems() merges the items in one layout change instead of
+	// inserting more ranges (like reset())
+	enum { MaxInsertRanges = 64 };
+
 	int binaryFind(const ItemType &item) const
 	{
-		return (std::lower_bound(items.constBegin(), items.constEnd(), item, lessThan) -
-			items.constBegin());
+		return items.lowerBound(item, lessThan);
 	}
 
 	int upperBound(const ItemType &item) const
 	{
-		return (std::upper_bound(items.constBegin(), items.constEnd(), item, lessThan) -
-			items.constBegin());
+		return items.upperBound(item, lessThan);
 	}
 
 	void beginLayoutChange()
@@ -246,7 +362,7 @@ private:
 	}
 
 private:
-	QList<ItemType> items;
+	ChunkedList<ItemType> items; // insertions and removals don't move all rows
 	LessThanType lessThan;
 	ItemType sharedNull;
 	QModelIndexList oldPersistentIndexes;
@@ -0,0 +1,256 @@
+/*
+ * tracing.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "log.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "tracing.h"
+
+class TraceEvent
+{
+public:
+	TraceEvent() : name(NULL), threadId(0), begin(0), duration(0) { }
+	~TraceEvent() { }
+
+	const char *name; // NULL = thread name metadata
+	int threadId;
+	qint64 begin; // ns
+	qint64 duration; // ns
+	QByteArray threadName;
+};
+
+Q_DECLARE_TYPEINFO(TraceEvent, Q_MOVABLE_TYPE);
+
+class Tracer : public QThread
+{
+public:
+	static Tracer *instance();
+
+	qint64 now() const
+	{
+		return timer.nsecsElapsed();
+	}
+
+	void addSpan(const char *name, qint64 begin, qint64 end);
+
+private:
+	Tracer();
+	~Tracer();
+
+	static void shutdown();
+
+	int currentThreadId();
+	void run() override;
+	void writeEvents(const QVector<TraceEvent> &eventsToWrite);
+
+	QElapsedTimer timer;
+	QFile file;
+	QMutex mutex;
+	QWaitCondition condition;
+	QVector<TraceEvent> events;
+	QAtomicInt nextThreadId;
+	bool stopping;
+	bool firstEvent;
+};
+
+Tracer::Tracer() : nextThreadId(1), stopping(false), firstEvent(true)
+{
+	timer.start();
+	QString fileName = QString::fromLocal8Bit(qgetenv("KAFFEINE_TRACE_FILE"));
+
+	if (fileName.isEmpty()) {
+		fileName = QDir::tempPath() + QLatin1String("/kaffeine-") +
+			QString::number(QCoreApplication::applicationPid()) +
+			QLatin1String(".trace.json");
+	}
+
+	file.setFileName(fileName);
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCWarning(logConfig, "Cannot open trace file %s", qPrintable(file.fileName()));
+		stopping = true;
+		return;
+	}
+
+	// the closing bracket is optional in the trace event format,
+	// so that the trace stays usable if kaffeine crashes
+	file.write("[\n");
+	qCInfo(logConfig, "Writing trace to %s", qPrintable(file.fileName()));
+
+	if (QCoreApplication::instance() != NULL) {
+		qAddPostRoutine(shutdown);
+	}
+
+	start(QThread::LowPriority);
+}
+
+Tracer::~Tracer()
+{
+}
+
+Tracer *Tracer::instance()
+{
+	// never deleted, because spans may end during static destruction
+	static Tracer *tracer = new Tracer();
+	return tracer;
+}
+
+void Tracer::shutdown()
+{
+	Tracer *tracer = instance();
+
+	tracer->mutex.lock();
+	tracer->stopping = true;
+	tracer->condition.wakeOne();
+	tracer->mutex.unlock();
+	tracer->wait();
+}
+
+int Tracer::currentThreadId()
+{
+	static thread_local int threadId = 0;
+
+	if (threadId == 0) {
+		threadId = nextThreadId.fetchAndAddRelaxed(1);
+		QThread *thread = QThread::currentThread();
+		QByteArray threadName = thread->objectName().toUtf8();
+
+		if (threadName.isEmpty()) {
+			if ((QCoreApplication::instance() != NULL) &&
+			    (thread == QCoreApplication::instance()->thread())) {
+				threadName = "Main";
+			} else {
+				threadName = thread->metaObject()->className();
+			}
+		}
+
+		TraceEvent event;
+		event.threadId = threadId;
+		event.threadName = threadName;
+		QMutexLocker locker(&mutex);
+		events.append(event);
+	}
+
+	return threadId;
+}
+
+void Tracer::addSpan(const char *name, qint64 begin, qint64 end)
+{
+	TraceEvent event;
+	event.name = name;
+	event.threadId = currentThreadId();
+	event.begin = begin;
+	event.duration = (end - begin);
+
+	QMutexLocker locker(&mutex);
+
+	if (!stopping) {
+		events.append(event);
+	}
+}
+
+void Tracer::run()
+{
+	QVector<TraceEvent> eventsToWrite;
+
+	while (true) {
+		mutex.lock();
+
+		if (!stopping) {
+			condition.wait(&mutex, 1000);
+		}
+
+		bool stop = stopping;
+		eventsToWrite.swap(events);
+		mutex.unlock();
+
+		writeEvents(eventsToWrite);
+		eventsToWrite.clear();
+
+		if (stop) {
+			break;
+		}
+	}
+
+	file.write("\n]\n");
+	file.close();
+}
+
+void Tracer::writeEvents(const QVector<TraceEvent> &eventsToWrite)
+{
+	QByteArray data;
+	QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+	foreach (const TraceEvent &event, eventsToWrite) {
+		if (!firstEvent) {
+			data.append(",\n");
+		}
+
+		firstEvent = false;
+
+		if (event.name == NULL) {
+			data.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":");
+			data.append(pid);
+			data.append(",\"tid\":");
+			data.append(QByteArray::number(event.threadId));
+			data.append(",\"args\":{\"name\":\"");
+			data.append(event.threadName);
+			data.append("\"}}");
+			continue;
+		}
+
+		// timestamps are in microseconds
+		data.append("{\"name\":\"");
+		data.append(event.name);
+		data.append("\",\"ph\":\"X\",\"pid\":");
+		data.append(pid);
+		data.append(",\"tid\":");
+		data.append(QByteArray::number(event.threadId));
+		data.append(",\"ts\":");
+		data.append(QByteArray::number(event.begin / 1000.0, 'f', 3));
+		data.append(",\"dur\":");
+		data.append(QByteArray::number(event.duration / 1000.0, 'f', 3));
+		data.append('}');
+	}
+
+	if (!data.isEmpty()) {
+		file.write(data);
+		file.flush();
+	}
+}
+
+TraceScope::TraceScope(const char *name_) : name(name_)
+{
+	begin = Tracer::instance()->now();
+}
+
+TraceScope::~TraceScope()
+{
+	Tracer *tracer = Tracer::instance();
+	tracer->addSpan(name, begin, tracer->now());
+}
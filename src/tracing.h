@@ -0,0 +1,66 @@
+/*
+ * tracing.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QtGlobal>
+#include <config-kaffeine.h>
+
+/*
+ * trace spans in the chrome trace event format (viewable with perfetto or
+ * chrome://tracing); enabled with the BUILD_TRACING cmake option, otherwise
+ * the macros compile to nothing
+ *
+ * the trace is written by a background thread to $KAFFEINE_TRACE_FILE or to
+ * kaffeine-<pid>.trace.json in the temporary directory
+ */
+
+#ifndef HAVE_TRACING
+#error HAVE_TRACING must be defined
+#endif /* HAVE_TRACING */
+
+#if HAVE_TRACING == 1
+
+class TraceScope
+{
+public:
+	explicit TraceScope(const char *name_); // name must be a string literal
+	~TraceScope();
+
+private:
+	Q_DISABLE_COPY(TraceScope)
+
+	const char *name;
+	qint64 begin;
+};
+
+#define KAFFEINE_TRACE_CONCAT_INTERNAL(a, b) a ## b
+#define KAFFEINE_TRACE_CONCAT(a, b) KAFFEINE_TRACE_CONCAT_INTERNAL(a, b)
+#define KAFFEINE_TRACE_SCOPE(name) \
+	TraceScope KAFFEINE_TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else /* HAVE_TRACING == 1 */
+
+#define KAFFEINE_TRACE_SCOPE(name) do { } while (0)
+
+#endif /* HAVE_TRACING == 1 */
+
+#endif /* TRACING_H */
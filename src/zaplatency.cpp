@@ -0,0 +1,208 @@
+/*
+ * zaplatency.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "log.h"
+
+#include "zaplatency.h"
+
+// upper bounds of the histogram buckets (ms); the last bucket is unbounded
+static const int bucketBounds[] = { 100, 250, 500, 1000, 2000, 4000, 8000 };
+static const int bucketCount = (sizeof(bucketBounds) / sizeof(bucketBounds[0])) + 1;
+static const int historySize = 100;
+
+ZapLatency::ZapLatency() : active(false), hasVideo(true)
+{
+	clear();
+}
+
+ZapLatency::~ZapLatency()
+{
+}
+
+ZapLatency *ZapLatency::instance()
+{
+	static ZapLatency zapLatency;
+	return &zapLatency;
+}
+
+void ZapLatency::start(const QString &channelName_)
+{
+	QMutexLocker locker(&mutex);
+	clear();
+	active = true;
+	channelName = channelName_;
+	timer.start();
+	elapsed[ZapStarted] = 0;
+
+	qCInfo(logDvb, "zap channel=\"%s\" milestone=%s elapsed_ms=0",
+		qPrintable(channelName), milestoneName(ZapStarted));
+}
+
+void ZapLatency::mark(Milestone milestone)
+{
+	QMutexLocker locker(&mutex);
+
+	if (!active || (elapsed[milestone] >= 0)) {
+		return;
+	}
+
+	elapsed[milestone] = timer.elapsed();
+	qCInfo(logDvb, "zap channel=\"%s\" milestone=%s elapsed_ms=%lld",
+		qPrintable(channelName), milestoneName(milestone), elapsed[milestone]);
+
+	if ((milestone == VideoOutput) || ((milestone == AudioOutput) && !hasVideo)) {
+		finish();
+	}
+}
+
+void ZapLatency::setHasVideo(bool hasVideo_)
+{
+	QMutexLocker locker(&mutex);
+
+	if (active) {
+		hasVideo = hasVideo_;
+	}
+}
+
+void ZapLatency::reset()
+{
+	QMutexLocker locker(&mutex);
+	clear();
+}
+
+QVariantMap ZapLatency::getLastZap()
+{
+	QMutexLocker locker(&mutex);
+	QVariantMap result;
+
+	if (active) {
+		for (int i = 0; i <= MilestoneMax; ++i) {
+			result.insert(QLatin1String(milestoneName(i)), elapsed[i]);
+		}
+	} else if (!history.isEmpty()) {
+		const QList<qint64> &zap = history.last();
+
+		for (int i = 0; i <= MilestoneMax; ++i) {
+			result.insert(QLatin1String(milestoneName(i)), zap.at(i));
+		}
+	}
+
+	return result;
+}
+
+QVariantMap ZapLatency::getHistogram()
+{
+	QMutexLocker locker(&mutex);
+	QVariantMap result;
+	QVariantList bounds;
+
+	for (int i = 0; i < (bucketCount - 1); ++i) {
+		bounds.append(bucketBounds[i]);
+	}
+
+	result.insert(QLatin1String("BucketBoundsMs"), bounds);
+	result.insert(QLatin1String("Zaps"), history.size());
+
+	for (int i = 0; i <= MilestoneMax; ++i) {
+		int counts[bucketCount] = { 0 };
+
+		foreach (const QList<qint64> &zap, history) {
+			qint64 value = zap.at(i);
+
+			if (value < 0) {
+				continue;
+			}
+
+			int bucket = 0;
+
+			while ((bucket < (bucketCount - 1)) && (value > bucketBounds[bucket])) {
+				++bucket;
+			}
+
+			++counts[bucket];
+		}
+
+		QVariantList buckets;
+
+		for (int j = 0; j < bucketCount; ++j) {
+			buckets.append(counts[j]);
+		}
+
+		result.insert(QLatin1String(milestoneName(i)), buckets);
+	}
+
+	return result;
+}
+
+void ZapLatency::finish()
+{
+	// mutex must be locked by the caller
+
+	QList<qint64> zap;
+
+	for (int i = 0; i <= MilestoneMax; ++i) {
+		zap.append(elapsed[i]);
+	}
+
+	history.append(zap);
+
+	if (history.size() > historySize) {
+		history.removeFirst();
+	}
+
+	active = false;
+}
+
+void ZapLatency::clear()
+{
+	// mutex must be locked by the caller
+
+	active = false;
+	hasVideo = true;
+	channelName.clear();
+
+	for (int i = 0; i <= MilestoneMax; ++i) {
+		elapsed[i] = -1;
+	}
+}
+
+const char *ZapLatency::milestoneName(int milestone)
+{
+	switch (milestone) {
+	case ZapStarted:
+		return "ZapStarted";
+	case DeviceRequested:
+		return "DeviceRequested";
+	case DeviceTuned:
+		return "DeviceTuned";
+	case PmtReceived:
+		return "PmtReceived";
+	case FirstPacketWritten:
+		return "FirstPacketWritten";
+	case PlayerPlaying:
+		return "PlayerPlaying";
+	case VideoOutput:
+		return "VideoOutput";
+	case AudioOutput:
+		return "AudioOutput";
+	}
+
+	return "Unknown";
+}
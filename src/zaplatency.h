@@ -0,0 +1,86 @@
+/*
+ * zaplatency.h
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ZAPLATENCY_H
+#define ZAPLATENCY_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+/*
+ * measures the time from a channel change request to the first decoded frame
+ * (or to the first played audio samples for channels without video); every
+ * milestone is logged and the last zaps are kept for a histogram
+ *
+ * libvlc has no event for the audio output, so AudioOutput is approximated
+ * by the first advance of the playback time; it can be reached a bit later
+ * than the first audible samples
+ */
+
+class ZapLatency
+{
+private:
+	ZapLatency();
+	~ZapLatency();
+
+public:
+	enum Milestone {
+		ZapStarted = 0, // DvbTab::playChannel()
+		DeviceRequested = 1,
+		DeviceTuned = 2,
+		PmtReceived = 3, // from the stream (not the cached pmt of the channel)
+		FirstPacketWritten = 4,
+		PlayerPlaying = 5,
+		VideoOutput = 6,
+		AudioOutput = 7, // approximated (see above)
+		MilestoneMax = AudioOutput
+	};
+
+	static ZapLatency *instance(); // thread-safe
+
+	// an unfinished zap is dropped
+	void start(const QString &channelName);
+	void setHasVideo(bool hasVideo_); // thread-safe
+	void mark(Milestone milestone); // thread-safe
+	void reset(); // thread-safe; the playback has left dvb
+
+	// milliseconds since ZapStarted for each milestone (-1 = not reached)
+	QVariantMap getLastZap();
+	// counts per bucket for each milestone over the last zaps
+	QVariantMap getHistogram();
+
+private:
+	void finish();
+	void clear();
+	static const char *milestoneName(int milestone);
+
+	QMutex mutex;
+	QElapsedTimer timer;
+	bool active;
+	bool hasVideo;
+	QString channelName;
+	qint64 elapsed[MilestoneMax + 1];
+	QList<QList<qint64> > history;
+};
+
+#endif /* ZAPLATENCY_H */
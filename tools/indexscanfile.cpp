@@ -0,0 +1,66 @@
+/*
+ * indexscanfile.cpp
+ *
+ * Copyright (C) 2026 The Kaffeine authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QDebug>
+#include <QCoreApplication>
+#include <QFile>
+
+#include "../src/dvb/dvbscanindex.h"
+
+int main(int argc, char *argv[])
+{
+	// QCoreApplication is needed for proper file name handling
+	QCoreApplication app(argc, argv);
+
+	if (argc != 3) {
+		qCritical() << "Syntax: indexscanfile <scan file> <output file>";
+		return 1;
+	}
+
+	QFile scanFile(argv[1]);
+
+	if (!scanFile.open(QIODevice::ReadOnly)) {
+		qCritical() << "Error: can't open file" << scanFile.fileName();
+		return 1;
+	}
+
+	QString errorMessage;
+	QByteArray index = DvbScanIndex::build(scanFile.readAll(), &errorMessage);
+
+	if (index.isEmpty()) {
+		qCritical() << "Error:" << errorMessage;
+		return 1;
+	}
+
+	if (!errorMessage.isEmpty()) {
+		qWarning() << "Warning:" << errorMessage;
+	}
+
+	QFile file(argv[2]);
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qCritical() << "Error: can't open file" << file.fileName();
+		return 1;
+	}
+
+	file.write(index);
+
+	return 0;
+}